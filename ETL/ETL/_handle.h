@@ -80,30 +80,39 @@ protected:
 #endif
 
 public:
+	// New reference may be taken only from the existing one,
+	// so increment needs no ordering with other memory operations.
+	// Decrement releases the changes made by this owner, and the last
+	// owner acquires changes of all other owners before deletion.
+
 	virtual void ref()const
 	{
-		++refcount;
+		refcount.fetch_add(1, std::memory_order_relaxed);
 	}
 
 	//! Returns \c false if object needs to be deleted
 	virtual bool unref()const
 	{
-		bool ret = (bool)(--refcount);
+		if (refcount.fetch_sub(1, std::memory_order_release) != 1)
+			return true;
+		std::atomic_thread_fence(std::memory_order_acquire);
 #ifdef ETL_SELF_DELETING_SHARED_OBJECT
-		if (!ret)
-			delete this;
+		delete this;
 #endif
-		return ret;
+		return false;
 	}
 
 	//! Decrease reference counter without deletion of object
 	//! Returns \c false if references exceed and object should be deleted
 	virtual bool unref_inactive()const
 	{
-		return (bool)(--refcount);
+		if (refcount.fetch_sub(1, std::memory_order_release) != 1)
+			return true;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return false;
 	}
 
-	int count()const { return refcount; }
+	int count()const { return refcount.load(std::memory_order_relaxed); }
 
 }; // END of class shared_object
 
@@ -171,6 +180,14 @@ public:
 			obj->ref();
 	}
 
+	//! Move constructor, takes the reference from \a x without touching the counter
+	handle(handle<value_type> &&x) noexcept:obj(x.obj)
+		{ x.obj = nullptr; }
+
+	//! rhandle keeps itself in the list of object, so it is always copied
+	template <class U>
+	handle(rhandle<U> &&x):handle(x.get()) { }
+
 	//! Handle is released on deletion
 	~handle() { detach(); }
 
@@ -207,6 +224,24 @@ public:
 		return *this;
 	}
 
+	//! Move assignment operator
+	handle<value_type> &
+	operator=(handle<value_type> &&x) noexcept
+	{
+		if(&x==this)
+			return *this;
+		pointer xobj(x.obj);
+		x.obj=nullptr;
+		detach();
+		obj=xobj;
+		return *this;
+	}
+
+	template <class U>
+	handle<value_type> &
+	operator=(rhandle<U> &&x)
+		{ return operator=(handle<value_type>(x.get())); }
+
 	//! Swaps the values of two handles without reference counts
 	handle<value_type> &
 	swap(handle<value_type> &x)
@@ -24,7 +24,10 @@
 /* === H E A D E R S ======================================================= */
 
 #include <ETL/handle>
+#include <atomic>
+#include <chrono>
 #include <list>
+#include <utility>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string>
@@ -34,6 +37,7 @@
 /* === M A C R O S ========================================================= */
 
 #define NUMBER_OF_OBJECTS	40000
+#define NUMBER_OF_COPIES	4000000
 
 /* === C L A S S E S ======================================================= */
 
@@ -74,6 +78,30 @@ struct my_other_test_obj : public my_test_obj
 	}
 };
 
+// reference counting with sequentially consistent operations,
+// as it was done by shared_object before, used as baseline for speed test
+struct seq_cst_test_obj : public etl::shared_object
+{
+	mutable std::atomic<int> refcount;
+	seq_cst_test_obj():refcount(0) { }
+
+	virtual void ref()const
+		{ ++refcount; }
+	virtual bool unref()const
+	{
+		bool ret = (bool)(--refcount);
+		if (!ret)
+			delete this;
+		return ret;
+	}
+	virtual bool unref_inactive()const
+		{ return (bool)(--refcount); }
+	int count()const
+		{ return refcount; }
+};
+
+struct relaxed_test_obj : public etl::shared_object { };
+
 int my_test_obj::instance_count=0;
 int my_other_test_obj::instance_count=0;
 
@@ -488,6 +516,131 @@ int handle_cast_test()
 	return 0;
 }
 
+int handle_move_test()
+{
+	printf("handle: move test: ");
+
+	{
+		obj_handle a(new my_test_obj(rand()));
+		obj_handle b(std::move(a));
+		if(a || !b || b.count()!=1)
+		{
+			printf("FAILED!\n");
+			printf(__FILE__":%d: on move construction, count=%d, should be 1.\n",__LINE__,b.count());
+			return 1;
+		}
+
+		obj_handle c(new my_test_obj(rand()));
+		c=std::move(b);
+		if(b || !c || c.count()!=1 || my_test_obj::instance_count!=1)
+		{
+			printf("FAILED!\n");
+			printf(__FILE__":%d: on move assignment, instance count=%d, should be 1.\n",__LINE__,my_test_obj::instance_count);
+			return 1;
+		}
+
+		// rhandle must stay in the replace list of object
+		robj_handle r(c);
+		obj_handle d(std::move(r));
+		if(!r || r.rcount()!=1 || d.count()!=3)
+		{
+			printf("FAILED!\n");
+			printf(__FILE__":%d: on move from rhandle, rcount=%d, should be 1.\n",__LINE__,r.rcount());
+			return 1;
+		}
+	}
+
+	if(my_test_obj::instance_count!=0)
+	{
+		printf("FAILED!\n");
+		printf(__FILE__":%d: on create/destroy, instance count=%d, should be zero.\n",__LINE__,my_test_obj::instance_count);
+		return 1;
+	}
+
+	printf("PASSED\n");
+	return 0;
+}
+
+template<typename T>
+int handle_copy_speed_test(const char *name)
+{
+	typedef std::chrono::steady_clock clock;
+
+	etl::handle<T> obj(new T());
+	std::vector< etl::handle<T> > list;
+	list.reserve(NUMBER_OF_COPIES);
+
+	clock::time_point begin = clock::now();
+	for(int i = 0; i < NUMBER_OF_COPIES; ++i)
+		list.push_back(obj);
+	clock::time_point end = clock::now();
+	printf("handle:   %s: %d copies: %f s\n", name, NUMBER_OF_COPIES, std::chrono::duration<double>(end - begin).count());
+
+	begin = clock::now();
+	list.clear();
+	end = clock::now();
+	printf("handle:   %s: %d releases: %f s\n", name, NUMBER_OF_COPIES, std::chrono::duration<double>(end - begin).count());
+
+	if(obj.count()!=1)
+	{
+		printf("handle: speed test: FAILED!\n");
+		printf(__FILE__":%d: %s: after releases, count=%d, should be 1.\n",__LINE__,name,obj.count());
+		return 1;
+	}
+	return 0;
+}
+
+int handle_speed_test()
+{
+	typedef std::chrono::steady_clock clock;
+
+	printf("handle: speed test:\n");
+
+	// both counters are touched through virtual calls, so only ordering differs
+	if(handle_copy_speed_test<seq_cst_test_obj>("seq_cst counter")
+	|| handle_copy_speed_test<relaxed_test_obj>("relaxed counter"))
+		return 1;
+
+	obj_handle obj(new my_test_obj(rand()));
+	std::vector<obj_handle> list;
+	list.reserve(NUMBER_OF_COPIES);
+
+	clock::time_point begin = clock::now();
+	for(int i = 0; i < NUMBER_OF_COPIES; ++i)
+		list.push_back(obj);
+	clock::time_point end = clock::now();
+	printf("handle:   %d copies: %f s\n", NUMBER_OF_COPIES, std::chrono::duration<double>(end - begin).count());
+
+	begin = clock::now();
+	std::vector<obj_handle> moved;
+	for(std::vector<obj_handle>::iterator i = list.begin(); i != list.end(); ++i)
+		moved.push_back(std::move(*i));
+	end = clock::now();
+	printf("handle:   %d moves with reallocations: %f s\n", NUMBER_OF_COPIES, std::chrono::duration<double>(end - begin).count());
+
+	if(obj.count()!=NUMBER_OF_COPIES+1)
+	{
+		printf("handle: speed test: FAILED!\n");
+		printf(__FILE__":%d: after moves, count=%d, should be %d.\n",__LINE__,obj.count(),NUMBER_OF_COPIES+1);
+		return 1;
+	}
+
+	begin = clock::now();
+	moved.clear();
+	end = clock::now();
+	printf("handle:   %d releases: %f s\n", NUMBER_OF_COPIES, std::chrono::duration<double>(end - begin).count());
+
+	if(obj.count()!=1)
+	{
+		printf("handle: speed test: FAILED!\n");
+		printf(__FILE__":%d: after releases, count=%d, should be 1.\n",__LINE__,obj.count());
+		return 1;
+	}
+
+	printf("handle: speed test: PASSED\n");
+	return 0;
+}
+
 /* === E N T R Y P O I N T ================================================= */
 
 int main()
@@ -500,6 +653,8 @@ int main()
 	error+=handle_inheritance_test();
 	error+=loose_handle_test();
 	error+=rhandle_general_use_test();
+	error+=handle_move_test();
+	error+=handle_speed_test();
 
 	return error;
 }
@@ -1132,6 +1132,15 @@ Layer_Freetype::get_bounding_rect() const
 	return bounds;
 }
 
+Rect
+Layer_Freetype::get_culling_rect() const
+{
+	Rect bounds = Layer_Shape::get_culling_rect();
+	if (bounds.is_full_infinite())
+		return bounds;
+	return Rect(contour_to_world(bounds.get_min()), contour_to_world(bounds.get_max()));
+}
+
 void
 Layer_Freetype::on_param_text_changed()
 {
@@ -121,6 +121,7 @@ public:
 
 protected:
 	synfig::rendering::Task::Handle build_composite_task_vfunc(synfig::ContextParams) const override;
+	synfig::Rect get_culling_rect() const override;
 
 	bool is_inside_contour(const synfig::Point& p, bool ignore_feather) const override;
 
@@ -68,6 +68,8 @@ public:
 		{ return !invert_negative && !clamp_floor && !clamp_ceiling; }
 	bool is_constant() const
 		{ return clamp_floor && clamp_ceiling && !approximate_less(floor, ceiling); }
+	bool get_operations(OperationList &list) const
+		{ add_operation(list, Operation(invert_negative, clamp_floor, clamp_ceiling, floor, ceiling)); return true; }
 
 	TaskClamp():
 		invert_negative(false),
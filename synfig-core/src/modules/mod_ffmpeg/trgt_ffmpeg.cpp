@@ -36,9 +36,18 @@
 
 #include "trgt_ffmpeg.h"
 
+#include <chrono>
+
+#ifndef _WIN32
+# include <fcntl.h> // for O_ flags
+# include <sys/stat.h> // for mkfifo()
+# include <unistd.h> // for close()
+#endif
+
 #include <ETL/stringf>
 
 #include <synfig/filesystemnative.h>
+#include <synfig/filesystemtemporary.h>
 #include <synfig/general.h>
 #include <synfig/localization.h>
 #include <synfig/soundprocessor.h>
@@ -56,6 +65,11 @@ SYNFIG_TARGET_SET_NAME(ffmpeg_trgt,"ffmpeg");
 SYNFIG_TARGET_SET_EXT(ffmpeg_trgt,"mpg");
 SYNFIG_TARGET_SET_VERSION(ffmpeg_trgt,"0.1");
 
+static const int sound_frequency = 48000;
+static const int sound_channels = 2;
+//! time to wait for the end of sound mixdown after ffmpeg is finished, in seconds
+static const int sound_stop_timeout = 10;
+
 /* === M E T H O D S ======================================================= */
 
 bool
@@ -73,6 +87,7 @@ ffmpeg_trgt::ffmpeg_trgt(const char *Filename, const synfig::TargetParam &params
 	pipe(nullptr),
 	filename(Filename),
 	sound_filename(""),
+	sound_done(false),
 	bitrate()
 {
 	// Set default video codec and bitrate if they weren't given.
@@ -100,6 +115,8 @@ ffmpeg_trgt::~ffmpeg_trgt()
 	}
 	pipe = nullptr;
 
+	stop_sound_thread();
+
 	// Remove temporary sound file
 	if (FileSystemNative::instance()->is_file(sound_filename.c_str())) {
 		if(FileSystemNative::instance()->remove_recursive(sound_filename.c_str())) {
@@ -108,6 +125,72 @@ ffmpeg_trgt::~ffmpeg_trgt()
 	}
 }
 
+bool
+ffmpeg_trgt::create_sound_fifo()
+{
+#ifndef _WIN32
+	// pipe is placed into the local temporary directory, nothing is written to disk
+	sound_fifo = FileSystemTemporary::generate_system_temporary_filename("ffmpeg_sound", ".pcm");
+	if (!mkfifo(sound_fifo.c_str(), 0600))
+		return true;
+	synfig::warning("Unable to create named pipe for sound (%s), temporary file will be used", sound_fifo.c_str());
+#endif
+	sound_fifo.clear();
+	return false;
+}
+
+void
+ffmpeg_trgt::export_sound()
+{
+	sound_processor->do_export_raw(sound_fifo, sound_frequency, sound_channels);
+#ifndef _WIN32
+	// if mixdown failed to open the pipe, then ffmpeg still waits for a writer,
+	// so open and close it here to give ffmpeg the end of stream
+	int fd = open(sound_fifo.c_str(), O_WRONLY | O_NONBLOCK);
+	if (fd >= 0)
+		close(fd);
+#endif
+	std::lock_guard<std::mutex> lock(sound_mutex);
+	sound_done = true;
+	sound_cond.notify_all();
+}
+
+void
+ffmpeg_trgt::stop_sound_thread()
+{
+	if (sound_thread.joinable()) {
+		std::unique_lock<std::mutex> lock(sound_mutex);
+		std::chrono::steady_clock::time_point deadline =
+			std::chrono::steady_clock::now() + std::chrono::seconds(sound_stop_timeout);
+		bool stopped = false;
+		while (!sound_done) {
+#ifndef _WIN32
+			// ffmpeg is finished here, but the mixdown may still wait for a reader
+			// or be blocked by the full pipe, opening and closing the reader side
+			// makes it fail with broken pipe
+			int fd = open(sound_fifo.c_str(), O_RDONLY | O_NONBLOCK);
+			if (fd >= 0)
+				close(fd);
+#endif
+			if (sound_cond.wait_for(lock, std::chrono::milliseconds(100), [this]() { return sound_done; }))
+				break;
+			if (!stopped && std::chrono::steady_clock::now() >= deadline) {
+				synfig::error("ffmpeg: sound mixdown is not finished in %d seconds, stopping it", sound_stop_timeout);
+				sound_processor->stop_export();
+				stopped = true;
+			}
+		}
+		lock.unlock();
+		sound_thread.join();
+	}
+	sound_processor.reset();
+
+	if (!sound_fifo.empty()) {
+		FileSystemNative::instance()->file_remove(sound_fifo);
+		sound_fifo.clear();
+	}
+}
+
 bool
 ffmpeg_trgt::set_rend_desc(RendDesc *given_desc)
 {
@@ -159,20 +242,28 @@ ffmpeg_trgt::init(ProgressCallback* cb = nullptr)
 		if (cb) cb->error(_("Unable to initialize Sound subsystem"));
 		with_sound = false;
 	} else {
-		auto& fs = FileSystemNative::instance();
-		synfig::SoundProcessor soundProcessor;
-		soundProcessor.set_infinite(false);
-		get_canvas()->fill_sound_processor(soundProcessor);
-		// Generate random filename here
-		do {
-			synfig::GUID guid;
-			sound_filename = String(filename)+"."+guid.get_string().substr(0,8)+".wav";
-		} while (fs->is_exists(sound_filename));
-
-		soundProcessor.do_export(sound_filename);
-
-		if (!fs->is_exists(sound_filename)) {
-			with_sound = false;
+		sound_processor.reset(new synfig::SoundProcessor());
+		sound_processor->set_infinite(false);
+		get_canvas()->fill_sound_processor(*sound_processor);
+
+		if (sound_processor->is_empty()) {
+			sound_processor.reset();
+		} else
+		if (create_sound_fifo()) {
+			// mixdown will run together with rendering, see below
+			with_sound = true;
+		} else {
+			auto& fs = FileSystemNative::instance();
+			// Generate random filename here
+			do {
+				synfig::GUID guid;
+				sound_filename = String(filename)+"."+guid.get_string().substr(0,8)+".wav";
+			} while (fs->is_exists(sound_filename));
+
+			sound_processor->do_export(sound_filename);
+			sound_processor.reset();
+
+			with_sound = fs->is_exists(sound_filename);
 		}
 	}
 
@@ -219,6 +310,16 @@ ffmpeg_trgt::init(ProgressCallback* cb = nullptr)
 	std::string video_codec_real = (video_codec == "libx264-lossless" ? "libx264" : video_codec);
 
 	OS::RunArgs vargs;
+	if (with_sound && !sound_fifo.empty()) {
+		vargs.push_back("-f");
+		vargs.push_back("s16le");
+		vargs.push_back("-ar");
+		vargs.push_back(strprintf("%d", sound_frequency));
+		vargs.push_back("-ac");
+		vargs.push_back(strprintf("%d", sound_channels));
+		vargs.push_back("-i");
+		vargs.push_back(filesystem::Path(sound_fifo));
+	} else
 	if (with_sound) {
 		vargs.push_back("-i");
 		vargs.push_back(filesystem::Path(sound_filename));
@@ -288,6 +389,9 @@ ffmpeg_trgt::init(ProgressCallback* cb = nullptr)
 
 	synfig::info(_("Running async command: %s"), pipe->get_command().c_str());
 
+	if (with_sound && !sound_fifo.empty())
+		sound_thread = std::thread(&ffmpeg_trgt::export_sound, this);
+
 	return true;
 }
 
@@ -31,6 +31,11 @@
 
 /* === H E A D E R S ======================================================= */
 
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
 #include <synfig/os.h>
 #include <synfig/string.h>
 #include <synfig/target_scanline.h>
@@ -43,6 +48,8 @@
 
 class TargetParam;
 
+namespace synfig { class SoundProcessor; }
+
 class ffmpeg_trgt : public synfig::Target_Scanline
 {
 	SYNFIG_TARGET_MODULE_EXT
@@ -53,6 +60,14 @@ private:
 	synfig::OS::RunPipe::Handle pipe;
 	synfig::String filename;
 	synfig::String sound_filename;
+	//! named pipe which ffmpeg reads the sound from, while sound_thread mixes it
+	synfig::String sound_fifo;
+	std::unique_ptr<synfig::SoundProcessor> sound_processor;
+	std::thread sound_thread;
+	//! sound_done is set by sound_thread when the mixdown is finished
+	std::mutex sound_mutex;
+	std::condition_variable sound_cond;
+	bool sound_done;
 	std::vector<unsigned char> buffer;
 	std::vector<synfig::Color> color_buffer;
 	std::string video_codec;
@@ -60,6 +75,10 @@ private:
 
 	bool does_video_codec_support_alpha_channel(const synfig::String& video_codec) const;
 
+	bool create_sound_fifo();
+	void export_sound();
+	void stop_sound_thread();
+
 public:
 
 	ffmpeg_trgt(const char *filename,
@@ -69,7 +69,11 @@ extern "C"
 #ifndef DISABLE_MODULE
 #	include <cstring>
 #	include <algorithm>
+#	include <condition_variable>
 #	include <functional>
+#	include <mutex>
+#	include <thread>
+#	include <vector>
 #	include <synfig/general.h>
 #	include <synfig/localization.h>
 #	include "trgt_av.h"
@@ -96,6 +100,9 @@ SYNFIG_TARGET_SET_VERSION(Target_LibAVCodec,"0.2");
 
 static bool av_registered = false;
 
+//! count of rendered frames which may wait for the encoder
+static const int frame_queue_size = 4;
+
 class Target_LibAVCodec::Internal
 {
 private:
@@ -111,6 +118,18 @@ private:
 	AVFrame *video_frame_rgb;
 	SwsContext *video_swscale_context;
 
+	// frames are converted and encoded by the encoder thread,
+	// render thread waits only when all slots of the queue are busy
+	std::vector<Surface> frame_queue;
+	int queue_first;
+	int queue_count;
+	bool queue_last;
+	bool encoder_stop;
+	bool encoder_failed;
+	std::mutex queue_mutex;
+	std::condition_variable queue_cond;
+	std::thread encoder_thread;
+
 	bool add_video_stream(enum AVCodecID codec_id, const RendDesc &desc) {
 		// find the video encoder
 		video_codec = avcodec_find_encoder(codec_id);
@@ -148,6 +167,10 @@ private:
 		video_context->time_base    = AVRational{ 1, fps };
 		video_stream->time_base     = video_context->time_base;
 
+		// let the encoder choose count of threads, frame threading is used when codec supports it
+		video_context->thread_count = 0;
+		video_context->thread_type  = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
 		// some formats want stream headers to be separate.
 		if (context->oformat->flags & AVFMT_GLOBALHEADER)
 			video_context->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
@@ -155,8 +178,22 @@ private:
 		return true;
     }
 
-	bool open_video_stream() {
-		if (avcodec_open2(video_context, nullptr, nullptr) < 0) {
+	bool open_video_stream(const TargetParam &params) {
+		AVDictionary *options = nullptr;
+		if (!params.video_preset.empty())
+			av_dict_set(&options, "preset", params.video_preset.c_str(), 0);
+		if (params.video_crf >= 0)
+			av_dict_set_int(&options, "crf", params.video_crf, 0);
+
+		int res = avcodec_open2(video_context, nullptr, &options);
+
+		// options which are left in dictionary are not supported by encoder
+		AVDictionaryEntry *entry = nullptr;
+		while((entry = av_dict_get(options, "", entry, AV_DICT_IGNORE_SUFFIX)))
+			synfig::warning("Target_LibAVCodec: option '%s' is not supported by the video codec", entry->key);
+		av_dict_free(&options);
+
+		if (res < 0) {
 			synfig::error("Target_LibAVCodec: could not open video codec");
 			// seems the calling of avcodec_free_context after error will cause crash
 			// so just forget about this context
@@ -227,11 +264,16 @@ public:
 		video_context(),
 		video_frame(),
 		video_frame_rgb(),
-		video_swscale_context()
+		video_swscale_context(),
+		queue_first(),
+		queue_count(),
+		queue_last(),
+		encoder_stop(),
+		encoder_failed()
 	{ }
 	~Internal() { close(); }
 
-	bool open(const String &filename, const RendDesc &desc) {
+	bool open(const String &filename, const RendDesc &desc, const TargetParam &params) {
 		close();
 
 		if (!av_registered) {
@@ -291,7 +333,7 @@ public:
 		}
 		if (!add_video_stream(format->video_codec, desc))
 			return false;
-		if (!open_video_stream())
+		if (!open_video_stream(params))
 			return false;
 
 		// just print selected format options
@@ -315,11 +357,112 @@ public:
 			close();
             return false;
 		}
+		headers_sent = true;
+
+		// start the encoder thread
+		frame_queue.resize(frame_queue_size);
+		queue_first = queue_count = 0;
+		queue_last = encoder_stop = encoder_failed = false;
+		encoder_thread = std::thread(&Internal::encoder_loop, this);
+
+		return true;
+	}
+
+	//! copies the surface into the queue, blocks while the queue is full
+	bool push_frame(const Surface &surface, bool last_frame) {
+		int index;
+		{
+			std::unique_lock<std::mutex> lock(queue_mutex);
+			if (!encoder_thread.joinable() || queue_last)
+				return false;
+			queue_cond.wait(lock, [this]() { return encoder_failed || queue_count < (int)frame_queue.size(); });
+			if (encoder_failed)
+				{ lock.unlock(); close(); return false; }
+			index = (queue_first + queue_count) % (int)frame_queue.size();
+		}
+
+		// the slot is not visible for the encoder thread until queue_count is increased
+		frame_queue[index] = surface;
+
+		{
+			std::lock_guard<std::mutex> lock(queue_mutex);
+			++queue_count;
+			queue_last = last_frame;
+		}
+		queue_cond.notify_all();
 
+		if (last_frame) {
+			// wait until all frames will be encoded
+			encoder_thread.join();
+			bool success = !encoder_failed;
+			close();
+			return success;
+		}
+		return true;
+	}
+
+	//! runs at the encoder thread
+	void encoder_loop() {
+		while(true) {
+			int index;
+			bool last;
+			{
+				std::unique_lock<std::mutex> lock(queue_mutex);
+				queue_cond.wait(lock, [this]() { return encoder_stop || queue_count > 0; });
+				if (encoder_stop) return;
+				index = queue_first;
+				last = queue_last && queue_count == 1;
+			}
+
+			bool success = encode_frame(frame_queue[index]);
+			if (success && last)
+				success = flush_encoder();
+
+			{
+				std::lock_guard<std::mutex> lock(queue_mutex);
+				queue_first = (queue_first + 1) % (int)frame_queue.size();
+				--queue_count;
+				if (!success) encoder_failed = true;
+			}
+			queue_cond.notify_all();
+
+			if (!success || last) return;
+		}
+	}
+
+	bool write_packets() {
+		while(true) {
+			int res = avcodec_receive_packet(video_context, packet);
+			if (res == AVERROR(EAGAIN) || res == AVERROR_EOF)
+				break;
+			if (res) {
+				synfig::error("Target_LibAVCodec: error during encoding");
+				return false;
+			}
+
+			av_packet_rescale_ts(packet, video_context->time_base, video_stream->time_base);
+			packet->stream_index = video_stream->index;
+
+			res = av_interleaved_write_frame(context, packet);
+			av_packet_unref(packet);
+			if (res < 0) {
+				synfig::error("Target_LibAVCodec: error while writing video frame");
+				return false;
+			}
+		}
 		return true;
 	}
 
-	bool encode_frame(const Surface &surface, bool last_frame) {
+	//! sends the end of stream and writes frames delayed by the encoder
+	bool flush_encoder() {
+		if (avcodec_send_frame(video_context, nullptr) < 0) {
+			synfig::error("Target_LibAVCodec: error flushing the video encoder");
+			return false;
+		}
+		return write_packets();
+	}
+
+	bool encode_frame(const Surface &surface) {
 		assert(context);
 		if (!context) return false;
 
@@ -335,7 +478,6 @@ public:
 
 		if (av_frame_make_writable(frame_rgb) < 0) {
 	    	synfig::error("Target_LibAVCodec: could not make frame data writable");
-			close();
 			return false;
 		}
 
@@ -349,6 +491,12 @@ public:
 			frame_rgb->linesize[0],
 			surface.get_pitch() );
 
+		// encoder may still keep the reference to the previous frame
+		if (video_swscale_context && av_frame_make_writable(video_frame) < 0) {
+	    	synfig::error("Target_LibAVCodec: could not make frame data writable");
+			return false;
+		}
+
 		if (video_swscale_context)
 			sws_scale(
 				video_swscale_context,
@@ -363,42 +511,26 @@ public:
 
 		if (avcodec_send_frame(video_context, video_frame) < 0) {
 			synfig::error("Target_LibAVCodec: error sending a frame for encoding");
-			close();
 			return false;
 		}
-		while(true) {
-			int res = avcodec_receive_packet(video_context, packet);
-			if (res == AVERROR(EAGAIN) || res == AVERROR_EOF)
-				break;
-			if (res) {
-				synfig::error("Target_LibAVCodec: error during encoding");
-				close();
-				return false;
-			}
-
-			av_packet_rescale_ts(packet, video_context->time_base, video_stream->time_base);
-			packet->stream_index = video_stream->index;
-
-			res = av_interleaved_write_frame(context, packet);
-			av_packet_unref(packet);
-			if (res < 0) {
-				synfig::error("Target_LibAVCodec: error while writing video frame");
-				close();
-				return false;
-			}
-	    }
-
-	    // increment frame counter
-
-		if (last_frame)
-			close();
-		else
-			++video_frame->pts;
+		if (!write_packets())
+			return false;
 
+		++video_frame->pts;
 		return true;
 	}
 
 	void close() {
+		if (encoder_thread.joinable()) {
+			{
+				std::lock_guard<std::mutex> lock(queue_mutex);
+				encoder_stop = true;
+			}
+			queue_cond.notify_all();
+			encoder_thread.join();
+		}
+		frame_queue.clear();
+
 		if (headers_sent) {
 			if (av_write_trailer(context) < 0)
 				synfig::error("Target_LibAVCodec: could not write format trailer");
@@ -431,10 +563,11 @@ public:
 
 Target_LibAVCodec::Target_LibAVCodec(
 	const char *filename,
-	const synfig::TargetParam &/*params*/
+	const synfig::TargetParam &params
 ):
 	internal(new Internal()),
-	filename(filename)
+	filename(filename),
+	params(params)
 { }
 
 Target_LibAVCodec::~Target_LibAVCodec()
@@ -478,7 +611,7 @@ Target_LibAVCodec::set_rend_desc(RendDesc *given_desc)
 
 void
 Target_LibAVCodec::end_frame()
-	{ internal->encode_frame(surface, curr_frame_ > desc.get_frame_end()); }
+	{ internal->push_frame(surface, curr_frame_ > desc.get_frame_end()); }
 
 bool
 Target_LibAVCodec::start_frame(synfig::ProgressCallback */*callback*/)
@@ -495,7 +628,7 @@ Target_LibAVCodec::end_scanline()
 bool Target_LibAVCodec::init(synfig::ProgressCallback */*cb*/)
 {
 	surface.set_wh(desc.get_w(), desc.get_h());
-	if (!internal->open(filename, desc)) {
+	if (!internal->open(filename, desc, params)) {
 		synfig::warning("Target_LibAVCodec: unable to initialize encoders");
 		return false;
 	}
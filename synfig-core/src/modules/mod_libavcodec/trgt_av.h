@@ -52,6 +52,7 @@ private:
 	Internal *internal;
 
 	synfig::String filename;
+	synfig::TargetParam params;
 	synfig::Surface	surface;
 
 public:
@@ -34,9 +34,31 @@
 #endif
 
 #include "trgt_openexr.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
 #include <cstdio>
 #include <ETL/stringf>
 
+#include <OpenEXR/OpenEXRConfig.h>
+#include <OpenEXR/ImfChannelList.h>
+#include <OpenEXR/ImfFrameBuffer.h>
+#include <OpenEXR/ImfHeader.h>
+#include <OpenEXR/ImfMultiPartOutputFile.h>
+#include <OpenEXR/ImfOutputFile.h>
+#include <OpenEXR/ImfOutputPart.h>
+#include <OpenEXR/ImfPartType.h>
+#include <OpenEXR/ImfTiledOutputFile.h>
+#include <OpenEXR/ImfTiledOutputPart.h>
+
+#include <synfig/canvas.h>
+#include <synfig/context.h>
+#include <synfig/general.h>
+#include <synfig/localization.h>
+#include <synfig/rendering/surface.h>
+#include <synfig/rendering/task.h>
+#include <synfig/rendering/software/surfacesw.h>
+
 #endif
 
 /* === M A C R O S ========================================================= */
@@ -49,14 +71,73 @@ using namespace etl;
 SYNFIG_TARGET_INIT(exr_trgt);
 SYNFIG_TARGET_SET_NAME(exr_trgt,"openexr");
 SYNFIG_TARGET_SET_EXT(exr_trgt,"exr");
-SYNFIG_TARGET_SET_VERSION(exr_trgt,"1.0.4");
+SYNFIG_TARGET_SET_VERSION(exr_trgt,"1.1.0");
+
+/* === P R O C E D U R E S ================================================= */
+
+static bool
+parse_compression(const String &name, Imf::Compression &out_compression)
+{
+	static const struct { const char *name; Imf::Compression compression; } methods[] = {
+		{ "none",  Imf::NO_COMPRESSION    },
+		{ "rle",   Imf::RLE_COMPRESSION   },
+		{ "zips",  Imf::ZIPS_COMPRESSION  },
+		{ "zip",   Imf::ZIP_COMPRESSION   },
+		{ "piz",   Imf::PIZ_COMPRESSION   },
+		{ "pxr24", Imf::PXR24_COMPRESSION },
+		{ "b44",   Imf::B44_COMPRESSION   },
+		{ "b44a",  Imf::B44A_COMPRESSION  },
+#if OPENEXR_VERSION_MAJOR > 2 || (OPENEXR_VERSION_MAJOR == 2 && OPENEXR_VERSION_MINOR >= 2)
+		{ "dwaa",  Imf::DWAA_COMPRESSION  },
+		{ "dwab",  Imf::DWAB_COMPRESSION  },
+#endif
+	};
+	String lower(name);
+	for(String::iterator i = lower.begin(); i != lower.end(); ++i)
+		*i = (char)tolower(*i);
+	for(size_t i = 0; i < sizeof(methods)/sizeof(methods[0]); ++i)
+		if (lower == methods[i].name)
+			{ out_compression = methods[i].compression; return true; }
+	return false;
+}
+
+static Imf::FrameBuffer
+rgba_frame_buffer(synfig::surface<Imf::Rgba> &surface)
+{
+	const size_t xstride = sizeof(Imf::Rgba);
+	const size_t ystride = surface.get_pitch();
+	Imf::Rgba *base = surface[0];
+
+	Imf::FrameBuffer frame_buffer;
+	frame_buffer.insert("R", Imf::Slice(Imf::HALF, (char*)&base->r, xstride, ystride));
+	frame_buffer.insert("G", Imf::Slice(Imf::HALF, (char*)&base->g, xstride, ystride));
+	frame_buffer.insert("B", Imf::Slice(Imf::HALF, (char*)&base->b, xstride, ystride));
+	frame_buffer.insert("A", Imf::Slice(Imf::HALF, (char*)&base->a, xstride, ystride));
+	return frame_buffer;
+}
+
+template<typename T>
+static void
+write_tiled(T &file, synfig::surface<Imf::Rgba> &surface)
+{
+	file.setFrameBuffer(rgba_frame_buffer(surface));
+	file.writeTiles(0, file.numXTiles() - 1, 0, file.numYTiles() - 1);
+}
+
+template<typename T>
+static void
+write_scanlines(T &file, synfig::surface<Imf::Rgba> &surface)
+{
+	file.setFrameBuffer(rgba_frame_buffer(surface));
+	file.writePixels(surface.get_h());
+}
 
 /* === M E T H O D S ======================================================= */
 
 bool
 exr_trgt::ready()
 {
-	return (bool)exr_file;
+	return !frame_name.empty();
 }
 
 exr_trgt::exr_trgt(const char *Filename, const synfig::TargetParam &params):
@@ -64,18 +145,37 @@ exr_trgt::exr_trgt(const char *Filename, const synfig::TargetParam &params):
 	imagecount(0),
 	scanline(),
 	filename(Filename),
-	exr_file(nullptr),
-	buffer(nullptr),
-	buffer_color(nullptr)
+	buffer_color(nullptr),
+	compression(Imf::ZIP_COMPRESSION),
+	tile_size(std::max(0, params.tile_size))
 {
 	// OpenEXR uses linear gamma
 	sequence_separator = params.sequence_separator;
+
+	if (!params.compression.empty() && !parse_compression(params.compression, compression))
+		synfig::warning("exr_trgt: unknown compression \"%s\", using zip", params.compression.c_str());
+
+	for(std::vector<String>::const_iterator i = params.passes.begin(); i != params.passes.end(); ++i)
+	{
+		String::size_type eq = i->find('=');
+		if (eq == String::npos || eq == 0 || i->substr(0, eq) == "rgba")
+		{
+			synfig::warning("exr_trgt: skipped render pass \"%s\"", i->c_str());
+			continue;
+		}
+
+		Pass pass;
+		pass.name = i->substr(0, eq);
+		String spec = i->substr(eq + 1);
+		char tail = 0;
+		if (2 != sscanf(spec.c_str(), "%lf:%lf%c", &pass.z_from, &pass.z_to, &tail) || pass.z_from > pass.z_to)
+			pass.description = spec;
+		passes.push_back(pass);
+	}
 }
 
 exr_trgt::~exr_trgt()
 {
-	if(exr_file) delete exr_file;
-	if(buffer) delete [] buffer;
 	if(buffer_color) delete [] buffer_color;
 }
 
@@ -92,15 +192,82 @@ exr_trgt::set_rend_desc(RendDesc *given_desc)
 	return true;
 }
 
+bool
+exr_trgt::call_renderer(
+	const etl::handle<rendering::SurfaceResource> &surface,
+	Canvas &canvas,
+	const ContextParams &context_params,
+	const RendDesc &renddesc )
+{
+	if (passes.empty())
+		return Target_Scanline::call_renderer(surface, canvas, context_params, renddesc);
+
+	// all passes are built from the same state of canvas and run by the single call of renderer
+	std::vector<rendering::Task::Handle> tasks;
+	std::vector<rendering::SurfaceResource::Handle> pass_surfaces;
+	tasks.push_back(build_task(surface, canvas, context_params, renddesc));
+	for(std::vector<Pass>::const_iterator i = passes.begin(); i != passes.end(); ++i)
+	{
+		ContextParams params(context_params);
+		params.z_range = true;
+		params.z_range_blur = 0.0;
+		if (i->description.empty())
+		{
+			params.z_range_position = i->z_from;
+			params.z_range_depth = i->z_to - i->z_from;
+		}
+		else
+		{
+			Layer::Handle layer;
+			for(Canvas::const_iterator j = canvas.begin(); j != canvas.end(); ++j)
+				if (*j && (*j)->get_description() == i->description)
+					{ layer = *j; break; }
+			if (!layer)
+			{
+				// pass stays transparent
+				pass_surfaces.push_back(rendering::SurfaceResource::Handle());
+				continue;
+			}
+			params.z_range_position = layer->get_true_z_depth();
+			params.z_range_depth = 0.0;
+		}
+
+		rendering::SurfaceResource::Handle pass_surface = new rendering::SurfaceResource();
+		rendering::Task::Handle task = build_task(pass_surface, canvas, params, renddesc);
+		tasks.push_back(task);
+		pass_surfaces.push_back(task ? pass_surface : rendering::SurfaceResource::Handle());
+	}
+
+	run_tasks(tasks);
+
+	// renddesc may be a horizontal strip of the frame
+	int offset_y = (int)std::round((renddesc.get_tl()[1] - desc.get_tl()[1])/desc.get_ph());
+	for(size_t i = 0; i < passes.size(); ++i)
+	{
+		if (!pass_surfaces[i]) continue;
+		rendering::SurfaceResource::LockRead<rendering::SurfaceSW> lock(pass_surfaces[i]);
+		if (!lock) return false;
+
+		const Surface &s = lock->get_surface();
+		synfig::surface<Imf::Rgba> &out = passes[i].out_surface;
+		for(int y = 0; y < s.get_h() && y + offset_y < out.get_h(); ++y)
+		{
+			if (y + offset_y < 0) continue;
+			const Color *src = s[y];
+			Imf::Rgba *dst = out[y + offset_y];
+			for(int x = 0; x < s.get_w() && x < out.get_w(); ++x, ++src, ++dst)
+				*dst = Imf::Rgba(src->get_r(), src->get_g(), src->get_b(), src->get_a());
+		}
+	}
+
+	return true;
+}
+
 bool
 exr_trgt::start_frame(synfig::ProgressCallback *cb)
 {
 	int w=desc.get_w(),h=desc.get_h();
 
-	String frame_name;
-
-	if(exr_file)
-		delete exr_file;
 	if(multi_image)
 	{
 		frame_name = (filename_sans_extension(filename) +
@@ -114,28 +281,89 @@ exr_trgt::start_frame(synfig::ProgressCallback *cb)
 		frame_name=filename;
 		if(cb)cb->task(filename);
 	}
-	exr_file=new Imf::RgbaOutputFile(frame_name.c_str(),w,h,Imf::WRITE_RGBA,desc.get_pixel_aspect());
 	if(buffer_color) delete [] buffer_color;
 	buffer_color=new Color[w];
-	//if(buffer) delete [] buffer;
-	//buffer=new Imf::Rgba[w];
 	out_surface.set_wh(w,h);
 
+	for(std::vector<Pass>::iterator i = passes.begin(); i != passes.end(); ++i)
+	{
+		i->out_surface.set_wh(w,h);
+		i->out_surface.fill(Imf::Rgba(0.f, 0.f, 0.f, 0.f));
+	}
+
 	return true;
 }
 
-void
-exr_trgt::end_frame()
+bool
+exr_trgt::write_frame()
 {
-	if(exr_file)
+	int w=desc.get_w(),h=desc.get_h();
+
+	Imf::Header header(w, h, desc.get_pixel_aspect());
+	header.compression() = compression;
+	header.channels().insert("R", Imf::Channel(Imf::HALF));
+	header.channels().insert("G", Imf::Channel(Imf::HALF));
+	header.channels().insert("B", Imf::Channel(Imf::HALF));
+	header.channels().insert("A", Imf::Channel(Imf::HALF));
+	if (tile_size > 0)
+		header.setTileDescription(Imf::TileDescription(tile_size, tile_size, Imf::ONE_LEVEL));
+
+	try
 	{
-		exr_file->setFrameBuffer(out_surface[0],1,desc.get_w());
-		exr_file->writePixels(desc.get_h());
+		if (passes.empty())
+		{
+			if (tile_size > 0)
+			{
+				Imf::TiledOutputFile file(frame_name.c_str(), header);
+				write_tiled(file, out_surface);
+			}
+			else
+			{
+				Imf::OutputFile file(frame_name.c_str(), header);
+				write_scanlines(file, out_surface);
+			}
+			return true;
+		}
+
+		// the main image and each pass are stored as separate parts of the same file
+		std::vector<Imf::Header> headers(passes.size() + 1, header);
+		headers[0].setName("rgba");
+		for(size_t i = 0; i < passes.size(); ++i)
+			headers[i + 1].setName(passes[i].name);
+		for(std::vector<Imf::Header>::iterator i = headers.begin(); i != headers.end(); ++i)
+			i->setType(tile_size > 0 ? Imf::TILEDIMAGE : Imf::SCANLINEIMAGE);
 
-		delete exr_file;
+		Imf::MultiPartOutputFile file(frame_name.c_str(), &headers.front(), (int)headers.size());
+		for(int i = 0; i < (int)headers.size(); ++i)
+		{
+			synfig::surface<Imf::Rgba> &surface = i ? passes[i - 1].out_surface : out_surface;
+			if (tile_size > 0)
+			{
+				Imf::TiledOutputPart part(file, i);
+				write_tiled(part, surface);
+			}
+			else
+			{
+				Imf::OutputPart part(file, i);
+				write_scanlines(part, surface);
+			}
+		}
+	}
+	catch(const std::exception &e)
+	{
+		synfig::error("exr_trgt: cannot write \"%s\": %s", frame_name.c_str(), e.what());
+		return false;
 	}
+	return true;
+}
 
-	exr_file=0;
+void
+exr_trgt::end_frame()
+{
+	if(ready())
+		write_frame();
+
+	frame_name.clear();
 
 	imagecount++;
 }
@@ -156,7 +384,6 @@ exr_trgt::end_scanline()
 	int i;
 	for(i=0;i<desc.get_w();i++)
 	{
-//		Imf::Rgba &rgba=buffer[i];
 		Imf::Rgba &rgba=out_surface[scanline][i];
 		Color &color=buffer_color[i];
 		rgba.r=color.get_r();
@@ -165,8 +392,5 @@ exr_trgt::end_scanline()
 		rgba.a=color.get_a();
 	}
 
-    //exr_file->setFrameBuffer(buffer,1,desc.get_w());
-	//exr_file->writePixels(1);
-
 	return true;
 }
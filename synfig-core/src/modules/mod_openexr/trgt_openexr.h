@@ -30,11 +30,14 @@
 
 /* === H E A D E R S ======================================================= */
 
+#include <vector>
+
 #include <synfig/target_scanline.h>
 #include <synfig/string.h>
 #include <synfig/surface.h>
 #include <OpenEXR/ImfArray.h>
-#include <OpenEXR/ImfRgbaFile.h>
+#include <OpenEXR/ImfCompression.h>
+#include <OpenEXR/ImfRgba.h>
 
 /* === M A C R O S ========================================================= */
 
@@ -48,18 +51,40 @@ public:
 	SYNFIG_TARGET_MODULE_EXT
 
 private:
+	//! Render pass, written as separate part of the image
+	struct Pass
+	{
+		synfig::String name;
+		//! description of the root layer, or empty to use z-depth range
+		synfig::String description;
+		synfig::Real z_from, z_to;
+		synfig::surface<Imf::Rgba> out_surface;
+
+		Pass(): z_from(), z_to() { }
+	};
 
 	bool multi_image;
 	int imagecount,scanline;
 	synfig::String filename;
-	Imf::RgbaOutputFile *exr_file;
-	Imf::Rgba *buffer;
+	synfig::String frame_name;
 	synfig::surface<Imf::Rgba> out_surface;
 	synfig::Color *buffer_color;
 
+	Imf::Compression compression;
+	int tile_size;
+	std::vector<Pass> passes;
+
 	bool ready();
+	bool write_frame();
 	synfig::String sequence_separator;
 
+protected:
+	bool call_renderer(
+		const etl::handle<synfig::rendering::SurfaceResource> &surface,
+		synfig::Canvas &canvas,
+		const synfig::ContextParams &context_params,
+		const synfig::RendDesc &renddesc ) override;
+
 public:
 
 	exr_trgt(const char *filename, const synfig::TargetParam& /* params */);
@@ -41,6 +41,7 @@
 #include "mptr_png.h"
 
 #include <ETL/stringf>
+#include <synfig/color/gammatable.h>
 #include <synfig/filecontainerzip.h>
 #include <synfig/general.h>
 
@@ -62,16 +63,6 @@ SYNFIG_IMPORTER_SET_SUPPORTS_FILE_SYSTEM_WRAPPER(png_mptr, true);
 
 /* === M E T H O D S ======================================================= */
 
-namespace {
-	inline ColorReal get_channel(png_bytep *rows, int bit_depth, int row, int col) {
-		int x = bit_depth > 8
-			  ? GUINT16_FROM_BE((png_uint_16p(rows[row]))[col])
-			  : rows[row][col];
-		int max = (1 << bit_depth) - 1;
-		return x/ColorReal(max);
-	}
-}
-
 void
 png_mptr::png_out_error(png_struct */*png_data*/,const char *msg)
 {
@@ -234,42 +225,33 @@ png_mptr::get_frame(synfig::Surface &surface, const synfig::RendDesc &/*renddesc
 	png_read_image(png_ptr, row_pointers);
 
 	surface.set_wh(width, height);
+
+	int channels = 0;
+	switch(color_type)
+	{
+	case PNG_COLOR_TYPE_GRAY:       channels = 1; break;
+	case PNG_COLOR_TYPE_GRAY_ALPHA: channels = 2; break;
+	case PNG_COLOR_TYPE_RGB:        channels = 3; break;
+	case PNG_COLOR_TYPE_RGB_ALPHA:  channels = 4; break;
+	default: break;
+	}
+
 	switch(color_type)
 	{
 	case PNG_COLOR_TYPE_RGB:
-		for(int y = 0; y < surface.get_h(); ++y)
-			for(int x = 0; x < surface.get_w(); ++x)
-				surface[y][x]=gamma.apply(Color(
-					get_channel(row_pointers, bit_depth, y, x*3+0),
-					get_channel(row_pointers, bit_depth, y, x*3+1),
-					get_channel(row_pointers, bit_depth, y, x*3+2) ));
-		break;
 	case PNG_COLOR_TYPE_RGB_ALPHA:
-		for(int y = 0; y < surface.get_h(); ++y)
-			for(int x = 0; x < surface.get_w(); ++x)
-				surface[y][x]=gamma.apply(Color(
-					get_channel(row_pointers, bit_depth, y, x*4+0),
-					get_channel(row_pointers, bit_depth, y, x*4+1),
-					get_channel(row_pointers, bit_depth, y, x*4+2),
-					get_channel(row_pointers, bit_depth, y, x*4+3) ));
-		break;
 	case PNG_COLOR_TYPE_GRAY:
-		for(int y = 0; y < surface.get_h(); ++y)
-			for(int x = 0; x < surface.get_w(); ++x)
-			{
-				ColorReal gray = get_channel(row_pointers, bit_depth, y, x);
-				surface[y][x] = gamma.apply(Color(gray, gray, gray));
-			}
-		break;
 	case PNG_COLOR_TYPE_GRAY_ALPHA:
+	{
+		// gamma is applied by lookup, not by powf() for each channel of each pixel
+		GammaTable::Handle table = GammaTable::get(gamma, bit_depth);
 		for(int y = 0; y < surface.get_h(); ++y)
-			for(int x = 0; x < surface.get_w(); ++x)
-			{
-				ColorReal gray = get_channel(row_pointers, bit_depth, y, x*2+0);
-				ColorReal a    = get_channel(row_pointers, bit_depth, y, x*2+1);
-				surface[y][x] = gamma.apply(Color(gray, gray, gray, a));
-			}
+			if (bit_depth > 8)
+				table->convert_row_be16(surface[y], row_pointers[y], surface.get_w(), channels);
+			else
+				table->convert_row(surface[y], row_pointers[y], surface.get_w(), channels);
 		break;
+	}
 
 	case PNG_COLOR_TYPE_PALETTE:
 	{
@@ -285,18 +267,22 @@ png_mptr::get_frame(synfig::Surface &surface, const synfig::RendDesc &/*renddesc
 		int num_trans = 0;
 		bool has_alpha = png_get_tRNS(png_ptr, info_ptr, &trans_alpha, &num_trans, nullptr)
 		               & PNG_INFO_tRNS;
+		// each entry of palette is converted only once
 		const ColorReal k = 1/255.0;
+		Color colors[256];
+		for(int i = 0; i < num_palette && i < 256; ++i) {
+			ColorReal a = 1;
+			if (has_alpha && num_trans > 0 && trans_alpha && i < num_trans)
+				a = k*(unsigned char)trans_alpha[i];
+			colors[i] = gamma.apply(Color(
+				k*(unsigned char)palette[i].red,
+				k*(unsigned char)palette[i].green,
+				k*(unsigned char)palette[i].blue,
+				a ));
+		}
 		for(int y = 0; y < surface.get_h(); ++y)
 			for(int x = 0; x < surface.get_w(); ++x)
-			{
-				ColorReal r = k*(unsigned char)palette[row_pointers[y][x]].red;
-				ColorReal g = k*(unsigned char)palette[row_pointers[y][x]].green;
-				ColorReal b = k*(unsigned char)palette[row_pointers[y][x]].blue;
-				ColorReal a = 1;
-				if (has_alpha && num_trans > 0 && trans_alpha && row_pointers[y][x] < num_trans)
-                    a = k*(unsigned char)trans_alpha[row_pointers[y][x]];
-				surface[y][x] = gamma.apply(Color(r, g, b, a));
-			}
+				surface[y][x] = colors[row_pointers[y][x]];
 		break;
 	}
 	default:
@@ -0,0 +1,145 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file gammatable.cpp
+**	\brief Lookup tables for gamma correction of imported images
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <list>
+#include <mutex>
+
+#include "gammatable.h"
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace synfig;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+//! 16-bit tables take 768 KiB, so only a few recently used ones are kept
+static const size_t max_cached_tables = 4;
+
+/* === P R O C E D U R E S ================================================= */
+
+namespace {
+	struct Read8 {
+		static unsigned int read(const unsigned char *src, int i)
+			{ return src[i]; }
+	};
+
+	struct ReadBE16 {
+		static unsigned int read(const unsigned char *src, int i)
+			{ return ((unsigned int)src[2*i] << 8) | src[2*i + 1]; }
+	};
+
+	template<typename Reader, int channels>
+	void convert(const GammaTable &table, Color *dst, const unsigned char *src, int width)
+	{
+		for(int x = 0; x < width; ++x, ++dst) {
+			const int i = x*channels;
+			if (channels < 3) {
+				const unsigned int gray = Reader::read(src, i);
+				dst->set_r(table.get_r(gray));
+				dst->set_g(table.get_g(gray));
+				dst->set_b(table.get_b(gray));
+				dst->set_a(channels == 2 ? table.get_a(Reader::read(src, i + 1)) : ColorReal(1));
+			} else {
+				dst->set_r(table.get_r(Reader::read(src, i)));
+				dst->set_g(table.get_g(Reader::read(src, i + 1)));
+				dst->set_b(table.get_b(Reader::read(src, i + 2)));
+				dst->set_a(channels == 4 ? table.get_a(Reader::read(src, i + 3)) : ColorReal(1));
+			}
+		}
+	}
+
+	template<typename Reader>
+	void convert(const GammaTable &table, Color *dst, const unsigned char *src, int width, int channels)
+	{
+		switch(channels) {
+		case 1: convert<Reader, 1>(table, dst, src, width); break;
+		case 2: convert<Reader, 2>(table, dst, src, width); break;
+		case 3: convert<Reader, 3>(table, dst, src, width); break;
+		case 4: convert<Reader, 4>(table, dst, src, width); break;
+		default: assert(false);
+		}
+	}
+}
+
+/* === M E T H O D S ======================================================= */
+
+GammaTable::GammaTable(const Gamma &gamma, int bits):
+	gamma(gamma),
+	bits(bits)
+{
+	// table is never smaller than one byte, so any value read from byte is valid index
+	const unsigned int max = (1u << bits) - 1;
+	const unsigned int size = bits > 8 ? 65536 : 256;
+	const ColorReal k = 1/ColorReal(max);
+	for(int channel = 0; channel < 4; ++channel) {
+		std::vector<ColorReal> &table = tables[channel];
+		table.resize(size);
+		for(unsigned int x = 0; x < size; ++x) {
+			const ColorReal value = std::min(x, max)*k;
+			table[x] = channel < 3 ? gamma.apply(channel, value) : value;
+		}
+	}
+}
+
+GammaTable::Handle
+GammaTable::get(const Gamma &gamma, int bits)
+{
+	static std::mutex mutex;
+	static std::list<Handle> cache;
+
+	assert(bits >= 1 && bits <= 16);
+	std::lock_guard<std::mutex> lock(mutex);
+	for(std::list<Handle>::iterator i = cache.begin(); i != cache.end(); ++i)
+		if ((*i)->get_bits() == bits && (*i)->get_gamma() == gamma) {
+			cache.splice(cache.begin(), cache, i);
+			return cache.front();
+		}
+
+	cache.push_front(Handle(new GammaTable(gamma, bits)));
+	if (cache.size() > max_cached_tables)
+		cache.pop_back();
+	return cache.front();
+}
+
+void
+GammaTable::convert_row(Color *dst, const unsigned char *src, int width, int channels) const
+	{ convert<Read8>(*this, dst, src, width, channels); }
+
+void
+GammaTable::convert_row_be16(Color *dst, const unsigned char *src, int width, int channels) const
+	{ assert(bits > 8); convert<ReadBE16>(*this, dst, src, width, channels); }
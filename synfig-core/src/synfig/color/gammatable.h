@@ -0,0 +1,89 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file gammatable.h
+**	\brief Lookup tables for gamma correction of imported images
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_COLOR_GAMMATABLE_H
+#define __SYNFIG_COLOR_GAMMATABLE_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <vector>
+
+#include <ETL/handle>
+
+#include "color.h"
+#include "gamma.h"
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig {
+
+/*!	\class GammaTable
+**	\brief Converts integer channels of 8 or 16-bit images into Color
+**
+**	All possible values of channel are gamma corrected once
+**	when table is built, so conversion of pixel is only a lookup.
+**	Tables are shared between importers with the same gamma and bit depth.
+*/
+class GammaTable: public etl::shared_object
+{
+public:
+	typedef etl::handle<GammaTable> Handle;
+
+private:
+	Gamma gamma;
+	int bits;
+	//! red, green, blue and linear alpha
+	std::vector<ColorReal> tables[4];
+
+	GammaTable(const Gamma &gamma, int bits);
+
+public:
+	//! returns shared table, bits must be in range [1, 16]
+	static Handle get(const Gamma &gamma, int bits);
+
+	const Gamma& get_gamma() const { return gamma; }
+	int get_bits() const { return bits; }
+
+	ColorReal get_r(unsigned int x) const { return tables[0][x]; }
+	ColorReal get_g(unsigned int x) const { return tables[1][x]; }
+	ColorReal get_b(unsigned int x) const { return tables[2][x]; }
+	ColorReal get_a(unsigned int x) const { return tables[3][x]; }
+
+	//! converts row of one byte channels,
+	//! channels is 1 for gray, 2 for gray and alpha, 3 for RGB and 4 for RGBA
+	void convert_row(Color *dst, const unsigned char *src, int width, int channels) const;
+	//! converts row of two bytes big-endian channels (as stored in PNG)
+	void convert_row_be16(Color *dst, const unsigned char *src, int width, int channels) const;
+}; // END of class GammaTable
+
+}; // END of namespace synfig
+
+/* === E N D =============================================================== */
+
+#endif
@@ -92,6 +92,22 @@ _print_profile_report()
 
 /* === M E T H O D S ======================================================= */
 
+bool
+BoundsCache::get(const Layer *layer, Rect &out_rect)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::map<const Layer*, Rect>::const_iterator i = bounds.find(layer);
+	if (i == bounds.end()) return false;
+	out_rect = i->second;
+	return true;
+}
+
+void
+BoundsCache::put(const Layer *layer, const Rect &rect)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	bounds[layer] = rect;
+}
 
 void
 IndependentContext::set_time(Time time, bool force)const
@@ -409,16 +425,26 @@ Context::build_rendering_task() const
 	while ( *context
 		 && ( !context.active()
 		   || ( !get_params().render_excluded_contexts
-			 && (*context)->get_exclude_from_rendering() )))
+			 && (*context)->get_exclude_from_rendering() )
+		   || !context.in_z_range() ))
 		++context;
 
-	// TODO: apply z_range and z_blur (now applies in Canvas::optimize_layers)
+	// z_blur applies in Layer::build_rendering_task_vfunc by amount of composite layers
 
 	if (!*context)
 		return rendering::Task::Handle();
 	else {
 		if (context.get_params().force_set_time)
 			context.set_time((*context)->get_time_mark(), true);
+		if ( !context.get_params().render_rect.is_full_infinite()
+		  && !(*context)->passes_render_rect() )
+		{
+			// layer may transform or filter the context below it,
+			// so the area which should be rendered is unknown there
+			ContextParams params(context.get_params());
+			params.render_rect = Rect::infinite();
+			return (*context)->build_rendering_task(Context(context.get_next(), params));
+		}
 		return (*context)->build_rendering_task(context.get_next());
 	}
 }
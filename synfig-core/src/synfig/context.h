@@ -31,6 +31,10 @@
 
 /* === H E A D E R S ======================================================= */
 
+#include <map>
+#include <memory>
+#include <mutex>
+
 #include "canvas.h"
 #include "rect.h"
 #include "renddesc.h"
@@ -87,6 +91,22 @@ public:
 };
 
 
+/*!	\class BoundsCache
+**	\brief Keeps bounds of layers calculated while building rendering tasks of one frame.
+**	Targets build the tasks for each tile of the frame, so the bounds of groups
+**	are calculated only once. Cache is valid until the time of canvas is changed.
+**	\see ContextParams::bounds_cache */
+class BoundsCache {
+private:
+	std::mutex mutex;
+	std::map<const Layer*, Rect> bounds;
+
+public:
+	//! returns false if bounds of layer is not calculated yet
+	bool get(const Layer *layer, Rect &out_rect);
+	void put(const Layer *layer, const Rect &rect);
+};
+
 /*!	\class ContextParams
 **	\brief ContextParams is a class to store rendering parameters significant for Context.
 **	\see Context */
@@ -104,6 +124,12 @@ public:
 	Real z_range_blur;
 	//! Force set_time (to current time mark) at every rendering
 	bool force_set_time;
+	//! Area of the context which will be rendered, in units of the context.
+	//! Layers which are entirely outside of it may be skipped.
+	//! \see Layer::passes_render_rect()
+	Rect render_rect;
+	//! Bounds of layers shared by all tiles of the frame, may be empty
+	std::shared_ptr<BoundsCache> bounds_cache;
 
 	explicit ContextParams(bool render_excluded_contexts = false):
 	render_excluded_contexts(render_excluded_contexts),
@@ -111,7 +137,8 @@ public:
 	z_range_position(0.0),
 	z_range_depth(0.0),
 	z_range_blur(0.0),
-	force_set_time(false){ }
+	force_set_time(false),
+	render_rect(Rect::infinite()) { }
 };
 
 /*!	\class Context
@@ -113,6 +113,15 @@ Importer::open(const FileSystem::Identifier &identifier, bool force)
 		return (*__open_importers)[identifier];
 	}
 
+	Importer::Handle importer = open_unshared(identifier);
+	if (importer)
+		(*__open_importers)[identifier]=importer;
+	return importer;
+}
+
+Importer::Handle
+Importer::open_unshared(const FileSystem::Identifier &identifier)
+{
 	if(filename_extension(identifier.filename) == "")
 	{
 		synfig::error(_("Importer::open(): Couldn't find extension"));
@@ -131,10 +140,7 @@ Importer::open(const FileSystem::Identifier &identifier, bool force)
 	}
 
 	try {
-		Importer::Handle importer;
-		importer=Importer::book()[ext].factory(identifier);
-		(*__open_importers)[identifier]=importer;
-		return importer;
+		return Importer::book()[ext].factory(identifier);
 	}
 	catch (const String& str)
 	{
@@ -172,6 +172,8 @@ public:
 
 	//! Attempts to open \a filename, and returns a handle to the associated Importer
 	static Handle open(const FileSystem::Identifier &identifier, bool force=false);
+	//! Creates new importer for \a identifier, which is not shared with other users of the file
+	static Handle open_unshared(const FileSystem::Identifier &identifier);
 	static void forget(const FileSystem::Identifier &identifier);
 };
 
@@ -536,6 +536,12 @@ Layer::reads_context() const
 	return false;
 }
 
+bool
+Layer::passes_render_rect() const
+{
+	return false;
+}
+
 Rect
 Layer::get_full_bounding_rect(Context context)const
 {
@@ -643,6 +643,13 @@ public:
 	**  context until the final blend operation. */
 	virtual bool reads_context()const;
 
+	//! Returns true if the layer renders its context in the same coordinates
+	//! and does not need the context outside of ContextParams::render_rect.
+	/*! Only such layers receive the render_rect in build_rendering_task_vfunc(),
+	**  for all other layers it will be reset to infinite.
+	**  \see Context::build_rendering_task() */
+	virtual bool passes_render_rect()const;
+
 	//! Duplicates the Layer without duplicating the value nodes
 	virtual Handle simple_clone()const;
 
@@ -198,9 +198,20 @@ Layer_Composite::build_composite_task_vfunc(ContextParams /*context_params*/)con
 rendering::Task::Handle
 Layer_Composite::build_rendering_task_vfunc(Context context)const
 {
+	// skip layer if it is outside of the rendering area
+	const Rect &render_rect = context.get_params().render_rect;
+	if ( !render_rect.is_full_infinite()
+	  && !Color::is_straight(get_blend_method())
+	  && !(get_culling_rect() && render_rect) )
+		return context.build_rendering_task();
+
 	rendering::Task::Handle sub_task = build_composite_task_vfunc(context.get_params());
-	if (sub_task.type_is<rendering::TaskLayer>())
-		return Layer::build_rendering_task_vfunc(context);
+	if (sub_task.type_is<rendering::TaskLayer>()) {
+		// old-style rendering may read context anywhere
+		ContextParams params(context.get_params());
+		params.render_rect = Rect::infinite();
+		return Layer::build_rendering_task_vfunc(Context(context, params));
+	}
 
 	rendering::TaskBlend::Handle task_blend(new rendering::TaskBlend());
 	task_blend->amount = get_amount() * Context::z_depth_visibility(context.get_params(), *this);
@@ -109,8 +109,14 @@ public:
 	//!Returns the rectangle that includes the context of the layer and
 	//! the intersection of the layer in case it is active and not onto
 	virtual Rect get_full_bounding_rect(Context context)const;
+	//! Composite layer just blends itself onto the context
+	virtual bool passes_render_rect()const { return !reads_context(); }
 
 protected:
+	//! Bounds used to skip the layer outside of the rendered area.
+	//! Must be cheap and conservative, may return full plane when bounds are not known
+	virtual Rect get_culling_rect()const { return get_bounding_rect(); }
+
 	virtual rendering::Task::Handle build_composite_task_vfunc(ContextParams context_params)const;
 	virtual rendering::Task::Handle build_rendering_task_vfunc(Context context)const;
 }; // END of class Layer_Composite
@@ -51,6 +51,8 @@ protected:
 	explicit Layer_CompositeFork(Real amount=1.0, Color::BlendMethod blend_method=Color::BLEND_COMPOSITE);
 	virtual rendering::Task::Handle build_composite_fork_task_vfunc(ContextParams context_params, rendering::Task::Handle sub_task)const;
 	virtual rendering::Task::Handle build_rendering_task_vfunc(Context context)const;
+public:
+	virtual bool passes_render_rect()const { return false; }
 }; // END of class Layer_Invisible
 
 }; // END of namespace synfig
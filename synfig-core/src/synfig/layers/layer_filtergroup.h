@@ -56,6 +56,8 @@ public:
 	virtual Vocab get_param_vocab()const;
 	//! Get the value of the specified parameter. \see Layer::get_param
 	virtual ValueBase get_param(const String & param)const;
+	//! Sub-canvas of filter group is applied to the context
+	virtual bool passes_render_rect()const { return false; }
 
 protected:
 	virtual Context build_context_queue(Context context, CanvasBase &queue)const;
@@ -475,11 +475,34 @@ Layer_PasteCanvas::fill_sound_processor(SoundProcessor &soundProcessor) const
 rendering::Task::Handle
 Layer_PasteCanvas::build_rendering_task_vfunc(Context context)const
 {
+	const Rect &render_rect = context.get_params().render_rect;
+	if (!render_rect.is_full_infinite() && !Color::is_straight(get_blend_method())) {
+		// bounds of the whole sub-canvas are calculated once for all tiles of the frame
+		const ContextParams &params = context.get_params();
+		Rect bounds;
+		if (!params.bounds_cache || !params.bounds_cache->get(this, bounds)) {
+			bounds = get_bounding_rect_context_dependent(params);
+			if (params.bounds_cache)
+				params.bounds_cache->put(this, bounds);
+		}
+		if (!(bounds && render_rect))
+			return context.build_rendering_task();
+	}
+
 	rendering::Task::Handle sub_task;
 	if (sub_canvas)
 	{
 		CanvasBase sub_queue;
 		Context sub_context = build_context_queue(context, sub_queue);
+		if (!render_rect.is_full_infinite()) {
+			// pass rendering area into the sub-canvas coordinates
+			Transformation transformation = get_summary_transformation();
+			ContextParams params(sub_context.get_params());
+			params.render_rect = transformation.get_matrix().is_invertible()
+			                   ? transformation.back_transform_bounds(render_rect)
+			                   : Rect::infinite();
+			sub_context = Context(sub_context, params);
+		}
 
 		rendering::TaskTransformationAffine::Handle task_transformation(new rendering::TaskTransformationAffine());
 		task_transformation->transformation->matrix = get_summary_transformation().get_matrix();
@@ -298,10 +298,9 @@ Layer_Shape::set_time_vfunc(IndependentContext context, Time time)const
 void
 Layer_Shape::sync(bool force) const
 {
-	if ( force
-	  || !last_sync_time.is_equal(get_time_mark())
-	  || fabs(last_sync_outline_grow - get_outline_grow_mark()) > 1e-8 )
+	if (force || !is_synced())
 	{
+		sync_forced = false;
 		last_sync_time = get_time_mark();
 		last_sync_outline_grow = get_outline_grow_mark();
 		const_cast<Layer_Shape*>(this)->sync_vfunc();
@@ -309,6 +308,14 @@ Layer_Shape::sync(bool force) const
 	}
 }
 
+bool
+Layer_Shape::is_synced() const
+{
+	return !sync_forced
+	    && last_sync_time.is_equal(get_time_mark())
+	    && fabs(last_sync_outline_grow - get_outline_grow_mark()) <= 1e-8;
+}
+
 void
 Layer_Shape::sync_vfunc()
 	{ }
@@ -373,6 +380,20 @@ Rect
 Layer_Shape::get_bounding_rect()const
 {
 	sync();
+	return calc_bounding_rect();
+}
+
+Rect
+Layer_Shape::get_culling_rect()const
+{
+	// geometry is usually synced by set_time(), so bounds are known without the sync,
+	// otherwise the shape may be anywhere and it cannot be skipped
+	return is_synced() ? calc_bounding_rect() : Rect::full_plane();
+}
+
+Rect
+Layer_Shape::calc_bounding_rect()const
+{
 	Point origin = param_origin.get(Point());
 	bool invert = param_invert.get(bool(true));
 	rendering::Blur::Type blurtype = (rendering::Blur::Type)param_blurtype.get(int());
@@ -390,7 +411,7 @@ Layer_Shape::get_bounding_rect()const
 	bounds += origin;
 	bounds.expand((bounds.get_min() - bounds.get_max()).mag()*0.01);
 	bounds.expand_x( fabs(feather_amplifier * feather[0]) );
-	bounds.expand_x( fabs(feather_amplifier * feather[1]) );
+	bounds.expand_y( fabs(feather_amplifier * feather[1]) );
 
 	return bounds;
 }
@@ -74,6 +74,10 @@ private:
 
 	mutable Time last_sync_time;
 	mutable Real last_sync_outline_grow = 0.l;
+	mutable bool sync_forced = true;
+
+	//! bounds of the current geometry, without syncing
+	Rect calc_bounding_rect()const;
 
 protected:
 	Layer_Shape(const Real &a = 1.0, const Color::BlendMethod m = Color::BLEND_COMPOSITE);
@@ -115,6 +119,8 @@ protected:
 public:
 	void sync(bool force = false) const;
 	void force_sync() const { sync(true); }
+	//! true if geometry is actual for the current time and outline grow
+	bool is_synced() const;
 
 	virtual bool set_shape_param(const String & param, const synfig::ValueBase &value);
 	virtual bool set_param(const String & param, const synfig::ValueBase &value);
@@ -128,6 +134,7 @@ public:
 
 protected:
 	virtual void sync_vfunc();
+	virtual Rect get_culling_rect()const;
 	virtual void set_time_vfunc(IndependentContext context, Time time)const;
 	virtual rendering::Task::Handle build_composite_task_vfunc(ContextParams context_params)const;
 
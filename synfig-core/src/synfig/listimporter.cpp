@@ -35,12 +35,21 @@
 
 #include "listimporter.h"
 
+#include <algorithm>
+#include <condition_variable>
+#include <atomic>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <set>
+
 #include <ETL/stringf>
 
 #include "general.h"
 #include <synfig/localization.h>
 
 #include "filesystemnative.h"
+#include "threadpool.h"
 #include <synfig/rendering/software/surfacesw.h>
 
 
@@ -54,6 +63,14 @@ using namespace synfig;
 
 #define LIST_IMPORTER_CACHE_SIZE	20
 
+//! Max count of frames decoded ahead
+#define LIST_IMPORTER_PREFETCH_FRAMES	16
+//! Default memory budget for decoded frames in megabytes,
+//! may be changed by SYNFIG_LIST_IMPORTER_PREFETCH_MB environment variable
+#define LIST_IMPORTER_PREFETCH_MB	256
+//! Larger steps between requested frames are treated as seeking
+#define LIST_IMPORTER_MAX_STEP	4
+
 /* === G L O B A L S ======================================================= */
 
 SYNFIG_IMPORTER_INIT(ListImporter);
@@ -64,10 +81,171 @@ SYNFIG_IMPORTER_SET_SUPPORTS_FILE_SYSTEM_WRAPPER(ListImporter, false);
 
 /* === P R O C E D U R E S ================================================= */
 
+/* === C L A S S E S ======================================================= */
+
+class ListImporter::Prefetcher: public std::enable_shared_from_this<ListImporter::Prefetcher>
+{
+public:
+	enum Status { QUEUED, LOADING, READY };
+
+	struct Entry
+	{
+		Importer::Handle importer;
+		rendering::Surface::Handle surface;
+		Status status;
+		Entry(): status(QUEUED) { }
+	};
+
+	//! frames are keyed by filename, so repeated images (as in lip sync files) are decoded once
+	typedef std::map<String, Entry> EntryMap;
+
+private:
+	std::mutex mutex;
+	std::condition_variable cond;
+	EntryMap entries;
+	RendDesc renddesc;
+	size_t memory_limit;
+	size_t frame_size;
+	int running;
+	bool stopped;
+
+	// statistics, updated by the thread pool too
+	std::atomic<int> requests;
+	std::atomic<int> hits;
+	std::atomic<int> prefetched;
+
+	//! decodes frame in the thread pool
+	//! Importers are never created or destroyed here, because registry of importers
+	//! is not thread-safe, entry in LOADING state is never removed by other threads.
+	static void load(std::shared_ptr<Prefetcher> prefetcher, String filename)
+	{
+		Prefetcher &p = *prefetcher;
+		std::unique_lock<std::mutex> lock(p.mutex);
+		if (p.stopped) return;
+		EntryMap::iterator i = p.entries.find(filename);
+		if (i == p.entries.end() || i->second.status != QUEUED) return;
+
+		i->second.status = LOADING;
+		Importer *importer = i->second.importer.get();
+		RendDesc renddesc = p.renddesc;
+		++p.running;
+		lock.unlock();
+
+		rendering::Surface::Handle surface = importer ? importer->get_frame(renddesc, 0) : nullptr;
+
+		lock.lock();
+		i->second.surface = surface;
+		i->second.status = READY;
+		if (surface) p.frame_size = surface->get_buffer_size();
+		++p.prefetched;
+		--p.running;
+		p.cond.notify_all();
+	}
+
+	static Importer::Handle open(const String &filename)
+		{ return Importer::open_unshared(FileSystem::Identifier(FileSystemNative::instance(), filename)); }
+
+public:
+	Prefetcher():
+		memory_limit((size_t)LIST_IMPORTER_PREFETCH_MB*1024*1024),
+		frame_size(),
+		running(),
+		stopped(),
+		requests(0),
+		hits(0),
+		prefetched(0)
+	{
+		if (const char *s = getenv("SYNFIG_LIST_IMPORTER_PREFETCH_MB"))
+			memory_limit = (size_t)std::max(0, atoi(s))*1024*1024;
+	}
+
+	//! returns how many frames may be decoded ahead within the memory limit
+	int get_window()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!frame_size) return 2;
+		return (int)std::min(memory_limit/frame_size, (size_t)LIST_IMPORTER_PREFETCH_FRAMES + 1) - 1;
+	}
+
+	rendering::Surface::Handle fetch(const String &filename, const RendDesc &renddesc)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		this->renddesc = renddesc;
+		++requests;
+
+		EntryMap::iterator i = entries.find(filename);
+		if (i == entries.end()) {
+			i = entries.insert(EntryMap::value_type(filename, Entry())).first;
+			i->second.importer = open(filename);
+		} else
+		if (i->second.status != QUEUED) {
+			++hits;
+			// frame is decoding now, so let the thread pool run other tasks while waiting
+			while(i->second.status != READY)
+				ThreadPool::instance().wait(cond, lock);
+			return i->second.surface;
+		}
+
+		// frame is not started yet, so decode it here
+		i->second.status = LOADING;
+		Importer *importer = i->second.importer.get();
+		lock.unlock();
+
+		rendering::Surface::Handle surface = importer ? importer->get_frame(renddesc, 0) : nullptr;
+
+		lock.lock();
+		i->second.surface = surface;
+		i->second.status = READY;
+		if (surface) frame_size = surface->get_buffer_size();
+		cond.notify_all();
+		return surface;
+	}
+
+	//! queues decoding of given frames and forgets all other decoded frames
+	void prefetch(const String &current, const std::vector<String> &filenames)
+	{
+		std::set<String> keep(filenames.begin(), filenames.end());
+		keep.insert(current);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		for(EntryMap::iterator i = entries.begin(); i != entries.end();)
+			if (i->second.status != LOADING && !keep.count(i->first))
+				entries.erase(i++); else ++i;
+
+		for(std::vector<String>::const_iterator i = filenames.begin(); i != filenames.end(); ++i) {
+			if (entries.count(*i)) continue;
+			entries[*i].importer = open(*i);
+			ThreadPool::instance().enqueue(sigc::bind(sigc::ptr_fun(&Prefetcher::load), shared_from_this(), *i));
+		}
+	}
+
+	//! waits for running tasks and releases importers in the current thread
+	void stop()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		stopped = true;
+		while(running)
+			cond.wait(lock);
+		entries.clear();
+	}
+
+	PrefetchStatistics get_statistics() const
+	{
+		PrefetchStatistics statistics;
+		statistics.requests = requests;
+		statistics.hits = hits;
+		statistics.prefetched = prefetched;
+		return statistics;
+	}
+};
+
 /* === M E T H O D S ======================================================= */
 
 ListImporter::ListImporter(const FileSystem::Identifier &identifier):
-Importer(identifier)
+	Importer(identifier),
+	prefetcher(new Prefetcher()),
+	last_frame(-1),
+	frame_step(1)
 {
 	fps=15;
 
@@ -157,10 +335,20 @@ Importer(identifier)
 }
 
 
-ListImporter::~ListImporter() = default;
+ListImporter::~ListImporter()
+{
+	prefetcher->stop();
+
+	DEBUG_LOG("SYNFIG_DEBUG_LIST_IMPORTER",
+		"ListImporter: %s: %d of %d requested frames were ready or decoding, %d frames were decoded ahead\n",
+		identifier.filename.c_str(),
+		get_prefetch_statistics().hits,
+		get_prefetch_statistics().requests,
+		get_prefetch_statistics().prefetched );
+}
 
-Importer::Handle
-ListImporter::get_sub_importer(const RendDesc &renddesc, Time time, ProgressCallback *cb)
+int
+ListImporter::get_frame_index(const RendDesc &renddesc, Time time, ProgressCallback *cb) const
 {
 	float document_fps=renddesc.get_frame_rate();
 	int document_frame=round_to_int(time*document_fps);
@@ -170,11 +358,20 @@ ListImporter::get_sub_importer(const RendDesc &renddesc, Time time, ProgressCall
 	{
 		if (cb) cb->error(_("No images in list"));
 		else synfig::error(_("No images in list"));
-		return Importer::Handle();
+		return -1;
 	}
 
 	if(frame<0)frame=0;
 	if(frame>=(signed)filename_list.size())frame=filename_list.size()-1;
+	return frame;
+}
+
+Importer::Handle
+ListImporter::get_sub_importer(const RendDesc &renddesc, Time time, ProgressCallback *cb)
+{
+	int frame = get_frame_index(renddesc, time, cb);
+	if (frame < 0)
+		return Importer::Handle();
 
 	const String &filename = filename_list[frame];
 	Importer::Handle importer(Importer::open(FileSystem::Identifier(FileSystemNative::instance(), filename)));
@@ -205,10 +402,38 @@ ListImporter::get_frame(Surface &surface, const RendDesc &renddesc, Time time, P
 rendering::Surface::Handle
 ListImporter::get_frame(const RendDesc &renddesc, const Time &time)
 {
-	Importer::Handle importer = get_sub_importer(renddesc, time, nullptr);
-	return importer ? importer->get_frame(renddesc, 0) : new rendering::SurfaceSW();
+	int frame = get_frame_index(renddesc, time, nullptr);
+	if (frame < 0)
+		return new rendering::SurfaceSW();
+
+	// guess direction and speed of rendering by the previous request
+	int step = last_frame < 0 ? 0 : frame - last_frame;
+	if (step)
+		frame_step = std::abs(step) <= LIST_IMPORTER_MAX_STEP ? step : (step > 0 ? 1 : -1);
+	last_frame = frame;
+
+	const String &filename = filename_list[frame];
+	rendering::Surface::Handle surface = prefetcher->fetch(filename, renddesc);
+
+	std::vector<String> ahead;
+	for(int i = 1, window = prefetcher->get_window(); i <= window; ++i) {
+		int f = frame + i*frame_step;
+		if (f < 0 || f >= (int)filename_list.size()) break;
+		if (filename_list[f] != filename) ahead.push_back(filename_list[f]);
+	}
+	prefetcher->prefetch(filename, ahead);
+
+	if (!surface) {
+		synfig::error(_("Unable to open ")+filename);
+		return new rendering::SurfaceSW();
+	}
+	return surface;
 }
 
+ListImporter::PrefetchStatistics
+ListImporter::get_prefetch_statistics() const
+	{ return prefetcher->get_statistics(); }
+
 bool
 ListImporter::is_animated()
 {
@@ -35,6 +35,7 @@
 #include "surface.h"
 #include <vector>
 #include <list>
+#include <memory>
 
 /* === M A C R O S ========================================================= */
 
@@ -51,13 +52,34 @@ class ListImporter : public Importer
 {
 	SYNFIG_IMPORTER_MODULE_EXT
 private:
+	//! Decodes frames ahead of the requested one by the thread pool
+	class Prefetcher;
+
 	float fps;
 	std::vector<String> filename_list;
 	std::list<Importer::Handle> frame_cache;
 
+	std::shared_ptr<Prefetcher> prefetcher;
+	int last_frame;
+	int frame_step;
+
+	int get_frame_index(const RendDesc &renddesc, Time time, ProgressCallback *cb) const;
 	Importer::Handle get_sub_importer(const RendDesc &renddesc, Time time, ProgressCallback *cb);
 
 public:
+	class PrefetchStatistics
+	{
+	public:
+		//! count of requested frames
+		int requests;
+		//! count of requested frames which were ready or decoding already
+		int hits;
+		//! count of frames decoded ahead by the thread pool
+		int prefetched;
+
+		PrefetchStatistics(): requests(), hits(), prefetched() { }
+	};
+
 	ListImporter(const FileSystem::Identifier &identifier);
 
 	~ListImporter();
@@ -66,6 +88,8 @@ public:
 	virtual rendering::Surface::Handle get_frame(const RendDesc &renddesc, const Time &time);
 	virtual bool is_animated();
 
+	PrefetchStatistics get_prefetch_statistics() const;
+
 };
 
 }; // END of namespace synfig
@@ -0,0 +1,119 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/common/optimizer/optimizercontour.cpp
+**	\brief OptimizerContour
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+
+#include "optimizercontour.h"
+
+#include "../task/taskcontour.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+// accumulation buffers are cleared and resolved for every pixel of the contour bounds,
+// so they pay off only when the contour has enough cells to sort
+#define CONTOUR_MIN_ACCUMULATION_CELLS_PER_PIXEL (1.0/16.0)
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+/* === M E T H O D S ======================================================= */
+
+OptimizerContourAccumulation::OptimizerContourAccumulation()
+{
+	category_id = CATEGORY_ID_COORDS;
+	depends_from = CATEGORY_BEGIN;
+	for_task = true;
+}
+
+Real
+OptimizerContourAccumulation::calc_cells_per_pixel(const TaskContour &task)
+{
+	if (!task.contour)
+		return 0.0;
+
+	Vector ppu = task.get_pixels_per_unit();
+	Matrix bounds_transfromation;
+	bounds_transfromation.m00 = ppu[0];
+	bounds_transfromation.m11 = ppu[1];
+	bounds_transfromation.m20 = task.target_rect.minx - ppu[0]*task.source_rect.minx;
+	bounds_transfromation.m21 = task.target_rect.miny - ppu[1]*task.source_rect.miny;
+	Matrix matrix = bounds_transfromation * task.transformation->matrix;
+
+	// edge makes a cell in every pixel it crosses,
+	// and the control polygon is never shorter than the curve
+	Real cells = 0.0;
+	Vector prev;
+	const Contour::ChunkList &chunks = task.contour->get_chunks();
+	for(Contour::ChunkList::const_iterator i = chunks.begin(); i != chunks.end(); ++i) {
+		Vector points[] = { i->pp0, i->pp1, i->p1 };
+		int first = i->type == Contour::CUBIC ? 0
+		          : i->type == Contour::CONIC ? 1
+		          : 2;
+		if (i->type == Contour::CONIC) points[1] = i->pp0;
+		for(int j = first; j < 3; ++j) {
+			Vector p = matrix.get_transformed(points[j]);
+			if (i->type != Contour::MOVE)
+				cells += std::fabs(p[0] - prev[0]) + std::fabs(p[1] - prev[1]);
+			prev = p;
+		}
+	}
+
+	Rect bounds = task.contour->calc_bounds(matrix);
+	rect_set_intersect(bounds, bounds, Rect(task.target_rect.minx, task.target_rect.miny, task.target_rect.maxx, task.target_rect.maxy));
+	Real area = std::max(1.0, (bounds.maxx - bounds.minx + 2.0)*(bounds.maxy - bounds.miny + 2.0));
+	return std::isnan(cells) || std::isnan(area) ? 0.0 : cells/area;
+}
+
+void
+OptimizerContourAccumulation::run(const RunParams &params) const
+{
+	if (TaskContour::Handle contour = TaskContour::Handle::cast_dynamic(params.ref_task))
+	{
+		if ( !contour->allow_accumulation
+		  && contour->is_valid_coords()
+		  && calc_cells_per_pixel(*contour) >= CONTOUR_MIN_ACCUMULATION_CELLS_PER_PIXEL )
+		{
+			contour = TaskContour::Handle::cast_dynamic(contour->clone());
+			contour->allow_accumulation = true;
+			apply(params, contour);
+		}
+	}
+}
+
+/* === E N T R Y P O I N T ================================================= */
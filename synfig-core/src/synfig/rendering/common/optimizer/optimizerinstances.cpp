@@ -0,0 +1,354 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/common/optimizer/optimizerinstances.cpp
+**	\brief OptimizerInstances
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cmath>
+#include <functional>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include <synfig/general.h>
+#include <synfig/localization.h>
+
+#include "optimizerinstances.h"
+
+#include "../task/taskblend.h"
+#include "../task/taskblur.h"
+#include "../task/taskcontour.h"
+#include "../task/tasklayer.h"
+#include "../task/taskpixelprocessor.h"
+#include "../task/tasktransformation.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+namespace {
+
+typedef std::unordered_map<const Task*, size_t> HashMap;
+
+struct Instance
+{
+	TaskTransformationAffine::Handle task;
+	int parent;  //!< index of the nearest instance containing this one, or -1
+	int group;
+	size_t hash;
+
+	Instance(): parent(-1), group(-1), hash() { }
+};
+
+struct Group
+{
+	std::vector<int> members;
+	std::vector<int> eligible;
+};
+
+void
+hash_combine(size_t &hash, size_t value)
+	{ hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2); }
+
+size_t
+calc_hash(const Task::Handle &task, HashMap &hashes)
+{
+	if (!task) return 0;
+	HashMap::const_iterator i = hashes.find(task.get());
+	if (i != hashes.end()) return i->second;
+
+	// only cheap parameters, full comparison is done by OptimizerInstances::is_equal()
+	size_t hash = std::hash<std::string>()(task->get_token()->name);
+	if (TaskBlend::Handle blend = TaskBlend::Handle::cast_dynamic(task))
+		hash_combine(hash, blend->blend_method);
+	if (TaskContour::Handle contour = TaskContour::Handle::cast_dynamic(task))
+		if (contour->contour)
+			hash_combine(hash, contour->contour->get_chunks().size());
+	if (TaskLayer::Handle layer = TaskLayer::Handle::cast_dynamic(task))
+		hash_combine(hash, std::hash<const void*>()(layer->layer.get()));
+	if (task.type_is<TaskSurface>())
+		hash_combine(hash, std::hash<const void*>()(task->target_surface.get()));
+	for(Task::List::const_iterator j = task->sub_tasks.begin(); j != task->sub_tasks.end(); ++j)
+		hash_combine(hash, calc_hash(*j, hashes));
+
+	return hashes[task.get()] = hash;
+}
+
+bool
+is_equal_contour(const Contour &a, const Contour &b)
+{
+	if (&a == &b) return true;
+	if ( a.invert != b.invert
+	  || a.antialias != b.antialias
+	  || a.winding_style != b.winding_style
+	  || a.color != b.color
+	  || a.beginning_of_unclosed() != b.beginning_of_unclosed()
+	  || a.get_chunks().size() != b.get_chunks().size() )
+		return false;
+	for(Contour::ChunkList::const_iterator i = a.get_chunks().begin(), j = b.get_chunks().begin(); i != a.get_chunks().end(); ++i, ++j)
+		if ( i->type != j->type
+		  || i->p1 != j->p1
+		  || i->pp0 != j->pp0
+		  || i->pp1 != j->pp1 )
+			return false;
+	return true;
+}
+
+bool
+is_equal_params(const Task &a, const Task &b)
+{
+	if (const TaskBlend *ta = dynamic_cast<const TaskBlend*>(&a)) {
+		const TaskBlend &tb = dynamic_cast<const TaskBlend&>(b);
+		return ta->blend_method == tb.blend_method && ta->amount == tb.amount;
+	}
+	if (const TaskContour *ta = dynamic_cast<const TaskContour*>(&a)) {
+		const TaskContour &tb = dynamic_cast<const TaskContour&>(b);
+		return ta->contour && tb.contour
+			&& is_equal_contour(*ta->contour, *tb.contour)
+			&& ta->detail == tb.detail
+			&& ta->allow_antialias == tb.allow_antialias
+			&& ta->transformation->matrix == tb.transformation->matrix;
+	}
+	if (const TaskPixelColorMatrix *ta = dynamic_cast<const TaskPixelColorMatrix*>(&a))
+		return ta->matrix == dynamic_cast<const TaskPixelColorMatrix&>(b).matrix;
+	if (const TaskPixelGamma *ta = dynamic_cast<const TaskPixelGamma*>(&a))
+		return ta->gamma == dynamic_cast<const TaskPixelGamma&>(b).gamma;
+	if (const TaskTransformationAffine *ta = dynamic_cast<const TaskTransformationAffine*>(&a)) {
+		const TaskTransformationAffine &tb = dynamic_cast<const TaskTransformationAffine&>(b);
+		return ta->interpolation == tb.interpolation
+			&& ta->supersample == tb.supersample
+			&& ta->transformation->matrix == tb.transformation->matrix;
+	}
+	if (const TaskBlur *ta = dynamic_cast<const TaskBlur*>(&a)) {
+		const TaskBlur &tb = dynamic_cast<const TaskBlur&>(b);
+		return ta->blur.type == tb.blur.type && ta->blur.size == tb.blur.size;
+	}
+	if (const TaskLayer *ta = dynamic_cast<const TaskLayer*>(&a))
+		return ta->layer && ta->layer == dynamic_cast<const TaskLayer&>(b).layer;
+	if (a.get_token() == TaskSurface::token.handle())
+		return a.target_surface && a.target_surface == b.target_surface;
+	return false;
+}
+
+bool
+is_same_resolution(const Task &a, const Task &b)
+{
+	Vector pa = a.get_pixels_per_unit();
+	Vector pb = b.get_pixels_per_unit();
+	Real precision = 1e-4;
+	return std::fabs(pa[0] - pb[0]) <= precision*std::fabs(pa[0])
+		&& std::fabs(pa[1] - pb[1]) <= precision*std::fabs(pa[1]);
+}
+
+bool
+is_candidate(const TaskTransformationAffine &task)
+{
+	// transformations which will be replaced by their sub-tasks
+	// (see OptimizerPass) cannot share the surface of sub-task
+	return task.sub_task()
+		&& task.is_valid_coords()
+		&& task.sub_task()->is_valid_coords()
+		&& task.get_pass_subtask_index() == Task::PASSTO_THIS_TASK;
+}
+
+//! sub-task contains the whole its content, so it can be used by any instance
+bool
+is_complete(const Task &sub_task)
+{
+	const Rect &bounds = sub_task.get_bounds();
+	return bounds.is_valid()
+		&& !bounds.is_nan_or_inf()
+		&& sub_task.source_rect.contains(bounds)
+		&& sub_task.target_surface
+		&& sub_task.target_surface->is_exists();
+}
+
+void
+collect_instances(const Task::Handle &task, int parent, std::vector<Instance> &instances)
+{
+	if (!task) return;
+	if (TaskTransformationAffine::Handle transformation = TaskTransformationAffine::Handle::cast_dynamic(task))
+		if (is_candidate(*transformation)) {
+			Instance instance;
+			instance.task = transformation;
+			instance.parent = parent;
+			parent = (int)instances.size();
+			instances.push_back(instance);
+		}
+	for(Task::List::const_iterator i = task->sub_tasks.begin(); i != task->sub_tasks.end(); ++i)
+		collect_instances(*i, parent, instances);
+}
+
+Task::Handle
+replace_instances(const Task::Handle &task, const std::map<const Task*, Task::Handle> &replacements)
+{
+	if (!task) return task;
+	std::map<const Task*, Task::Handle>::const_iterator r = replacements.find(task.get());
+	if (r != replacements.end())
+		return r->second;
+
+	Task::Handle new_task = task;
+	for(int i = 0; i < (int)task->sub_tasks.size(); ++i) {
+		Task::Handle sub_task = replace_instances(task->sub_tasks[i], replacements);
+		if (sub_task != task->sub_tasks[i]) {
+			if (new_task == task) new_task = task->clone();
+			new_task->sub_tasks[i] = sub_task;
+		}
+	}
+	return new_task;
+}
+
+} // end of anonymous namespace
+
+/* === M E T H O D S ======================================================= */
+
+
+OptimizerInstances::OptimizerInstances()
+{
+	category_id = CATEGORY_ID_COORDS;
+	depends_from = CATEGORY_BEGIN;
+	for_root_task = true;
+}
+
+bool
+OptimizerInstances::is_equal(const Task::Handle &a, const Task::Handle &b)
+{
+	if (a == b) return true;
+	if (!a || !b) return false;
+	if ( a->get_token() != b->get_token()
+	  || a->sub_tasks.size() != b->sub_tasks.size()
+	  || !is_equal_params(*a, *b) )
+		return false;
+	for(Task::List::const_iterator i = a->sub_tasks.begin(), j = b->sub_tasks.begin(); i != a->sub_tasks.end(); ++i, ++j)
+		if (!is_equal(*i, *j)) return false;
+	return true;
+}
+
+void
+OptimizerInstances::run(const RunParams& params) const
+{
+	//
+	// share sub-task of equal instances
+	//
+	//  blend
+	//  - transformationA
+	//    - taskA (same as taskB)
+	//  - transformationB
+	//    - taskB
+	//
+	// converts to:
+	//
+	//  blend
+	//  - transformationA
+	//    - taskB (has no truncated parts)
+	//  - transformationB
+	//    - surface (target of taskB)
+	//
+	// the first instance in order of tasks renders the sub-task,
+	// so dependencies by target surface will be found for the others
+	//
+
+	std::vector<Instance> instances;
+	collect_instances(params.ref_task, -1, instances);
+	if (instances.size() < 2)
+		return;
+
+	// find groups of equal instances
+	HashMap hashes;
+	std::vector<Group> groups;
+	std::multimap<size_t, int> groups_by_hash;
+	for(int i = 0; i < (int)instances.size(); ++i) {
+		Instance &instance = instances[i];
+		const Task::Handle &sub_task = instance.task->sub_task();
+		instance.hash = calc_hash(sub_task, hashes);
+
+		typedef std::multimap<size_t, int>::const_iterator Iterator;
+		std::pair<Iterator, Iterator> range = groups_by_hash.equal_range(instance.hash);
+		for(Iterator j = range.first; j != range.second; ++j) {
+			const Task::Handle &first = instances[ groups[j->second].members.front() ].task->sub_task();
+			if (is_same_resolution(*first, *sub_task) && is_equal(first, sub_task))
+				{ instance.group = j->second; break; }
+		}
+		if (instance.group < 0) {
+			instance.group = (int)groups.size();
+			groups.push_back(Group());
+			groups_by_hash.insert(std::make_pair(instance.hash, instance.group));
+		}
+		groups[instance.group].members.push_back(i);
+	}
+
+	// instances inside of repeated instances will not be rendered separately
+	for(int i = 0; i < (int)instances.size(); ++i) {
+		bool eligible = true;
+		for(int p = instances[i].parent; p >= 0 && eligible; p = instances[p].parent)
+			if (groups[instances[p].group].members.size() > 1)
+				eligible = false;
+		if (eligible)
+			groups[instances[i].group].eligible.push_back(i);
+	}
+
+	std::map<const Task*, Task::Handle> replacements;
+	for(std::vector<Group>::const_iterator g = groups.begin(); g != groups.end(); ++g) {
+		if (g->eligible.size() < 2)
+			continue;
+
+		// choose sub-task which is not truncated by viewport
+		Task::Handle source;
+		for(std::vector<int>::const_iterator i = g->eligible.begin(); i != g->eligible.end() && !source; ++i)
+			if (is_complete(*instances[*i].task->sub_task()))
+				source = instances[*i].task->sub_task();
+		if (!source)
+			continue;
+
+		for(std::vector<int>::const_iterator i = g->eligible.begin(); i != g->eligible.end(); ++i) {
+			const TaskTransformationAffine::Handle &task = instances[*i].task;
+			Task::Handle new_task = task->clone();
+			if (i == g->eligible.begin()) {
+				new_task->sub_task(0) = source;
+			} else {
+				Task::Handle surface(new TaskSurface());
+				surface->assign_target(*source);
+				new_task->sub_task(0) = surface;
+			}
+			replacements[task.get()] = new_task;
+		}
+	}
+
+	if (!replacements.empty())
+		apply(params, replace_instances(params.ref_task, replacements));
+}
+
+/* === E N T R Y P O I N T ================================================= */
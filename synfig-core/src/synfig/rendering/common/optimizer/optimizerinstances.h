@@ -0,0 +1,64 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/common/optimizer/optimizerinstances.h
+**	\brief OptimizerInstances Header
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_RENDERING_OPTIMIZERINSTANCES_H
+#define __SYNFIG_RENDERING_OPTIMIZERINSTANCES_H
+
+/* === H E A D E R S ======================================================= */
+
+#include "../../optimizer.h"
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace rendering
+{
+
+//! Renders equal sub-trees of affine transformations only once.
+//! Such sub-trees appear when the same exported canvas is pasted
+//! several times, and differ only by the outer transformation.
+//! Other instances read the shared surface through TaskSurface.
+class OptimizerInstances: public Optimizer
+{
+public:
+	OptimizerInstances();
+	virtual void run(const RunParams &params) const;
+
+	//! Compares task sub-trees ignoring coordinates,
+	//! tasks of unknown types are never equal
+	static bool is_equal(const Task::Handle &a, const Task::Handle &b);
+};
+
+} /* end namespace rendering */
+} /* end namespace synfig */
+
+/* -- E N D ----------------------------------------------------------------- */
+
+#endif
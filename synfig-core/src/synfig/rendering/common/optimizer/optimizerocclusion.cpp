@@ -0,0 +1,311 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/common/optimizer/optimizerocclusion.cpp
+**	\brief OptimizerOcclusion
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cmath>
+
+#include <synfig/general.h>
+#include <synfig/localization.h>
+
+#include "optimizerocclusion.h"
+
+#include "../task/taskblend.h"
+#include "../task/taskcontour.h"
+#include "../task/taskpixelprocessor.h"
+#include "../task/tasktransformation.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+namespace {
+
+bool
+is_opaque_color(const Color &color)
+	{ return approximate_greater_or_equal_lp(color.get_a(), ColorReal(1.0)); }
+
+bool
+is_axis_aligned(const Matrix &m)
+{
+	return approximate_zero_lp(m.m01)
+		&& approximate_zero_lp(m.m10)
+		&& approximate_zero_lp(m.m02)
+		&& approximate_zero_lp(m.m12)
+		&& approximate_equal_lp(m.m22, Real(1.0));
+}
+
+Rect
+transform_rect(const Matrix &m, const Rect &rect)
+{
+	Rect r(m.get_transformed(rect.get_min()));
+	r.expand(m.get_transformed(rect.get_max()));
+	return r;
+}
+
+//! pixels of task target which are fully inside of rect (in units),
+//! one more pixel is excluded at each side for antialiasing
+RectInt
+inner_pixels(const Task &task, const Rect &rect)
+{
+	if (!rect.is_valid())
+		return RectInt::zero();
+	Vector ppu = task.get_pixels_per_unit();
+	Vector min = (rect.get_min() - task.source_rect.get_min()).multiply_coords(ppu);
+	Vector max = (rect.get_max() - task.source_rect.get_min()).multiply_coords(ppu);
+
+	RectInt r;
+	r.minx = task.target_rect.minx + (int)std::ceil(min[0]) + 1;
+	r.miny = task.target_rect.miny + (int)std::ceil(min[1]) + 1;
+	r.maxx = task.target_rect.minx + (int)std::floor(max[0]) - 1;
+	r.maxy = task.target_rect.miny + (int)std::floor(max[1]) - 1;
+	if (!r.is_valid())
+		return RectInt::zero();
+	return r & task.target_rect;
+}
+
+//! detects contour made of four axis-aligned lines (like in the rectangle layer)
+bool
+get_contour_rect(const Contour &contour, Rect &rect)
+{
+	const Contour::ChunkList &chunks = contour.get_chunks();
+	std::vector<Vector> points;
+	for(Contour::ChunkList::const_iterator i = chunks.begin(); i != chunks.end(); ++i) {
+		if (i->type == Contour::MOVE) {
+			if (!points.empty()) return false;
+		} else
+		if (i->type == Contour::LINE) {
+			if (points.empty()) return false;
+		} else
+		if (i->type == Contour::CLOSE) {
+			if (i + 1 != chunks.end()) return false;
+			continue;
+		} else {
+			return false;
+		}
+		points.push_back(i->p1);
+	}
+
+	if (points.size() == 5 && points.back().is_equal_to(points.front()))
+		points.pop_back();
+	if (points.size() != 4)
+		return false;
+
+	rect = Rect(points.front());
+	for(std::vector<Vector>::const_iterator i = points.begin(); i != points.end(); ++i)
+		rect.expand(*i);
+
+	for(int i = 0; i < 4; ++i) {
+		const Vector &a = points[i];
+		const Vector &b = points[(i + 1)%4];
+		bool corner = (approximate_equal_lp(a[0], rect.minx) || approximate_equal_lp(a[0], rect.maxx))
+		           && (approximate_equal_lp(a[1], rect.miny) || approximate_equal_lp(a[1], rect.maxy));
+		bool edge = approximate_equal_lp(a[0], b[0]) != approximate_equal_lp(a[1], b[1]);
+		if (!corner || !edge)
+			return false;
+	}
+	return rect.is_valid();
+}
+
+RectInt
+calc_opaque_rect_surface(const TaskTransformationAffine &transformation, const Task &surface)
+{
+	if ( !surface.target_surface
+	  || !surface.target_surface->is_exists()
+	  || !surface.source_rect.is_valid()
+	  || !is_axis_aligned(transformation.transformation->matrix) )
+		return RectInt::zero();
+
+	SurfaceResource::LockReadBase lock(surface.target_surface);
+	if (!lock.convert(Surface::Token::Handle(), false, true) || !lock.get_surface()->is_opaque())
+		return RectInt::zero();
+
+	// edge texels are interpolated with transparent pixels outside of surface
+	Vector texel = surface.source_rect.get_size().divide_coords(
+		Vector(surface.target_surface->get_width(), surface.target_surface->get_height()) );
+	Rect rect = surface.source_rect;
+	rect.minx += 2*texel[0];
+	rect.miny += 2*texel[1];
+	rect.maxx -= 2*texel[0];
+	rect.maxy -= 2*texel[1];
+	if (!rect.is_valid())
+		return RectInt::zero();
+
+	return inner_pixels(transformation, transform_rect(transformation.transformation->matrix, rect));
+}
+
+RectInt
+sub_opaque_rect(const Task &task, const Task::Handle &sub_task)
+{
+	if (!sub_task || !sub_task->is_valid_coords())
+		return RectInt::zero();
+	RectInt r = OptimizerOcclusion::calc_opaque_rect(sub_task);
+	if (!r.is_valid())
+		return RectInt::zero();
+	return (r - TaskList::calc_target_offset(task, *sub_task)) & task.target_rect;
+}
+
+RectInt
+max_rect(const RectInt &a, const RectInt &b)
+{
+	if (!a.is_valid()) return b;
+	if (!b.is_valid()) return a;
+	return (long long)a.get_width()*a.get_height() >= (long long)b.get_width()*b.get_height() ? a : b;
+}
+
+} // end of anonymous namespace
+
+/* === M E T H O D S ======================================================= */
+
+
+OptimizerOcclusion::OptimizerOcclusion()
+{
+	category_id = CATEGORY_ID_COORDS;
+	depends_from = CATEGORY_BEGIN;
+	mode = MODE_REPEAT_LAST;
+	for_task = true;
+}
+
+RectInt
+OptimizerOcclusion::calc_opaque_rect(const Task::Handle &task)
+{
+	if (!task || !task->is_valid_coords())
+		return RectInt::zero();
+
+	if (TaskPixelColorMatrix::Handle color_matrix = TaskPixelColorMatrix::Handle::cast_dynamic(task)) {
+		if (color_matrix->matrix.is_constant() && is_opaque_color(color_matrix->matrix.get_constant()))
+			return task->target_rect;
+		return RectInt::zero();
+	}
+
+	if (TaskPixelGamma::Handle gamma = TaskPixelGamma::Handle::cast_dynamic(task))
+		// gamma keeps alpha
+		return sub_opaque_rect(*task, gamma->sub_task());
+
+	if (TaskContour::Handle contour = TaskContour::Handle::cast_dynamic(task)) {
+		Rect rect;
+		if ( !contour->contour
+		  || contour->contour->invert
+		  || !is_opaque_color(contour->contour->color)
+		  || !is_axis_aligned(contour->transformation->matrix)
+		  || !get_contour_rect(*contour->contour, rect) )
+			return RectInt::zero();
+		return inner_pixels(*task, transform_rect(contour->transformation->matrix, rect));
+	}
+
+	if (TaskTransformationAffine::Handle transformation = TaskTransformationAffine::Handle::cast_dynamic(task)) {
+		if (TaskSurface::Handle surface = TaskSurface::Handle::cast_dynamic(transformation->sub_task()))
+			return calc_opaque_rect_surface(*transformation, *surface);
+		return RectInt::zero();
+	}
+
+	if (TaskBlend::Handle blend = TaskBlend::Handle::cast_dynamic(task)) {
+		if (!approximate_equal_lp(blend->amount, ColorReal(1.0)))
+			return RectInt::zero();
+		if (blend->blend_method == Color::BLEND_COMPOSITE)
+			return max_rect(
+				sub_opaque_rect(*task, blend->sub_task_a()),
+				sub_opaque_rect(*task, blend->sub_task_b()) );
+		if (blend->blend_method == Color::BLEND_STRAIGHT)
+			return sub_opaque_rect(*task, blend->sub_task_b());
+		return RectInt::zero();
+	}
+
+	return RectInt::zero();
+}
+
+void
+OptimizerOcclusion::run(const RunParams& params) const
+{
+	//
+	// cull bottom task of blending (only for BLEND_COMPOSITE and BLEND_STRAIGHT with amount 1)
+	//
+	//  blend(target)
+	//  - taskA(targetA)
+	//  - taskB(targetB) with opaque region
+	//
+	// drops taskA when it is fully covered by opaque region of taskB,
+	// or truncates targetA when opaque region covers it from one side
+	//
+
+	TaskBlend::Handle blend = TaskBlend::Handle::cast_dynamic(params.ref_task);
+	if ( !blend
+	  || !blend->is_valid_coords()
+	  || !blend->sub_task_a()
+	  || !blend->sub_task_a()->is_valid_coords()
+	  || !blend->sub_task_b()
+	  || ( blend->blend_method != Color::BLEND_COMPOSITE
+	    && blend->blend_method != Color::BLEND_STRAIGHT )
+	  || !approximate_equal_lp(blend->amount, ColorReal(1.0)) )
+		return;
+
+	RectInt opaque = sub_opaque_rect(*blend, blend->sub_task_b());
+	VectorInt offset_a = blend->get_offset_a();
+	RectInt ra = blend->sub_task_a()->target_rect - offset_a;
+	if (!(opaque && ra))
+		return;
+
+	TaskBlend::Handle new_blend = TaskBlend::Handle::cast_dynamic(blend->clone());
+	if (opaque.contains(ra)) {
+		new_blend->sub_task_a() = nullptr;
+		apply(params, new_blend);
+		return;
+	}
+
+	// visible part of taskA must stay rectangular
+	RectInt visible = ra;
+	if (opaque.minx <= ra.minx && opaque.maxx >= ra.maxx) {
+		if (opaque.miny <= ra.miny) visible.miny = opaque.maxy; else
+		if (opaque.maxy >= ra.maxy) visible.maxy = opaque.miny; else
+			return;
+	} else
+	if (opaque.miny <= ra.miny && opaque.maxy >= ra.maxy) {
+		if (opaque.minx <= ra.minx) visible.minx = opaque.maxx; else
+		if (opaque.maxx >= ra.maxx) visible.maxx = opaque.minx; else
+			return;
+	} else {
+		return;
+	}
+
+	Task::Handle task_a = blend->sub_task_a()->clone_recursive();
+	task_a->trunc_target_rect(visible + offset_a);
+	task_a->touch_coords();
+	new_blend->sub_task_a() = task_a;
+	apply(params, new_blend);
+}
+
+/* === E N T R Y P O I N T ================================================= */
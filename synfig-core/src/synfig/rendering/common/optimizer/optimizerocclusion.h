@@ -0,0 +1,64 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/common/optimizer/optimizerocclusion.h
+**	\brief OptimizerOcclusion Header
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_RENDERING_OPTIMIZEROCCLUSION_H
+#define __SYNFIG_RENDERING_OPTIMIZEROCCLUSION_H
+
+/* === H E A D E R S ======================================================= */
+
+#include "../../optimizer.h"
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace rendering
+{
+
+//! Skips rendering of pixels of the bottom task of blending
+//! which are covered by fully opaque pixels of the top task.
+//! Opaque regions are estimated conservatively: constant fills,
+//! axis-aligned rectangles and bitmaps without transparent pixels.
+class OptimizerOcclusion: public Optimizer
+{
+public:
+	OptimizerOcclusion();
+	virtual void run(const RunParams &params) const;
+
+	//! Returns rectangle in pixels of task's target where all pixels
+	//! of the result are known to be fully opaque (or invalid rect)
+	static RectInt calc_opaque_rect(const Task::Handle &task);
+};
+
+} /* end namespace rendering */
+} /* end namespace synfig */
+
+/* -- E N D ----------------------------------------------------------------- */
+
+#endif
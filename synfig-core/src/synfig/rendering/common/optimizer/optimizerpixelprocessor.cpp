@@ -0,0 +1,78 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/common/optimizer/optimizerpixelprocessor.cpp
+**	\brief OptimizerPixelProcessor
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include "optimizerpixelprocessor.h"
+
+#include "../task/taskpixelprocessor.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+/* === M E T H O D S ======================================================= */
+
+OptimizerPixelProcessor::OptimizerPixelProcessor()
+{
+	category_id = CATEGORY_ID_BEGIN;
+	mode = MODE_REPEAT_LAST;
+	for_task = true;
+}
+
+void
+OptimizerPixelProcessor::run(const RunParams &params) const
+{
+	TaskPixelProcessor::Handle task = TaskPixelProcessor::Handle::cast_dynamic(params.ref_task);
+	if (!task) return;
+	TaskPixelProcessor::Handle sub_task = TaskPixelProcessor::Handle::cast_dynamic(task->sub_task());
+	if (!sub_task) return;
+
+	// operations of sub-task are applied first,
+	// the neighboring matrices and gammas are merged into one operation
+	TaskPixelProcessor::OperationList operations;
+	if (!sub_task->get_operations(operations) || !task->get_operations(operations))
+		return;
+
+	TaskPixelChain::Handle chain(new TaskPixelChain());
+	chain->assign(*task);
+	chain->sub_task() = sub_task->sub_task();
+	chain->operations.swap(operations);
+	apply(params, chain);
+}
+
+/* === E N T R Y P O I N T ================================================= */
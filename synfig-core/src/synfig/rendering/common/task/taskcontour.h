@@ -56,9 +56,11 @@ public:
 	Contour::Handle contour;
 	Real detail;
 	bool allow_antialias;
+	//! Rasterize into dense accumulation buffers instead of the sorted list of cells
+	bool allow_accumulation;
 	Holder<TransformationAffine> transformation;
 
-	TaskContour(): detail(1.0), allow_antialias(true) { }
+	TaskContour(): detail(1.0), allow_antialias(true), allow_accumulation(false) { }
 
 	virtual Rect calc_bounds() const;
 
@@ -32,6 +32,8 @@
 #	include <config.h>
 #endif
 
+#include <cmath>
+
 #include "taskpixelprocessor.h"
 
 #endif
@@ -45,6 +47,20 @@ using namespace rendering;
 
 /* === P R O C E D U R E S ================================================= */
 
+static inline ColorReal
+clamp_gamma_value(ColorReal x)
+{
+	const ColorReal max = ColorReal(1.0)/real_low_precision<ColorReal>();
+	return synfig::clamp(x, -max, max);
+}
+
+static inline ColorReal
+clamp_gamma(ColorReal gamma)
+{
+	const ColorReal max = ColorReal(1.0)/real_low_precision<ColorReal>();
+	return synfig::clamp(gamma, real_low_precision<ColorReal>(), max);
+}
+
 /* === M E T H O D S ======================================================= */
 
 
@@ -54,6 +70,127 @@ Task::Token TaskPixelGamma::token(
 	DescAbstract<TaskPixelGamma, TaskPixelProcessor>("PixelGamma") );
 SYNFIG_EXPORT Task::Token TaskPixelColorMatrix::token(
 	DescAbstract<TaskPixelColorMatrix, TaskPixelProcessor>("PixelColorMatrix") );
+SYNFIG_EXPORT Task::Token TaskPixelChain::token(
+	DescAbstract<TaskPixelChain, TaskPixelProcessor>("PixelChain") );
+
+
+TaskPixelProcessor::Operation::Operation(const ColorMatrix &matrix):
+	type(MATRIX), matrix(matrix),
+	invert_negative(), clamp_floor(), clamp_ceiling(), floor(), ceiling()
+{ }
+
+TaskPixelProcessor::Operation::Operation(const Gamma &gamma):
+	type(GAMMA), gamma(gamma),
+	invert_negative(), clamp_floor(), clamp_ceiling(), floor(), ceiling()
+{ }
+
+TaskPixelProcessor::Operation::Operation(bool invert_negative, bool clamp_floor, bool clamp_ceiling, Real floor, Real ceiling):
+	type(CLAMP),
+	invert_negative(invert_negative), clamp_floor(clamp_floor), clamp_ceiling(clamp_ceiling), floor(floor), ceiling(ceiling)
+{ }
+
+bool
+TaskPixelProcessor::Operation::merge(const Operation &next)
+{
+	if (type != next.type)
+		return false;
+	if (type == MATRIX) {
+		// colors are multiplied by matrix as row-vectors, so this matrix goes first
+		matrix = ColorMatrix::BatchProcessor(matrix.get_matrix() * next.matrix.get_matrix());
+		return true;
+	}
+	if (type == GAMMA) {
+		// pow(pow(x, a), b) == pow(x, a*b)
+		gamma = gamma * next.gamma;
+		return true;
+	}
+	return false;
+}
+
+void
+TaskPixelProcessor::Operation::process(Color *pixels, int count) const
+{
+	switch(type) {
+	case MATRIX:
+		matrix.process(pixels, count, pixels, count, count, 1);
+		break;
+	case GAMMA: {
+		const ColorReal g[] = {
+			clamp_gamma(gamma.get_r()),
+			clamp_gamma(gamma.get_g()),
+			clamp_gamma(gamma.get_b()) };
+		for(Color *p = pixels, *end = pixels + count; p != end; ++p) {
+			ColorReal *channels = (ColorReal*)p;
+			for(int i = 0; i < 3; ++i) {
+				ColorReal &x = channels[i];
+				if (approximate_equal_lp(g[i], ColorReal(0.0)))
+					x = ColorReal(1.0);
+				else
+				if (!approximate_equal_lp(g[i], ColorReal(1.0)))
+					x = clamp_gamma_value(x < 0 ? -pow(-x, g[i]) : pow(x, g[i]));
+			}
+		}
+		break;
+	}
+	case CLAMP:
+		for(Color *p = pixels, *end = pixels + count; p != end; ++p) {
+			Color &dst = *p;
+			if (std::fabs(dst.get_a()) < 1e-8)
+				{ dst = Color::alpha(); continue; }
+
+			if (invert_negative) {
+				if (dst.get_a() < floor)
+					dst = -dst;
+
+				if (dst.get_r() < floor) {
+					dst.set_g(dst.get_g() - dst.get_r());
+					dst.set_b(dst.get_b() - dst.get_r());
+					dst.set_r(floor);
+				}
+
+				if (dst.get_g() < floor) {
+					dst.set_r(dst.get_r() - dst.get_g());
+					dst.set_b(dst.get_b() - dst.get_g());
+					dst.set_g(floor);
+				}
+
+				if (dst.get_b() < floor) {
+					dst.set_g(dst.get_g() - dst.get_b());
+					dst.set_r(dst.get_r() - dst.get_b());
+					dst.set_b(floor);
+				}
+			} else
+			if (clamp_floor) {
+				if (dst.get_r() < floor) dst.set_r(floor);
+				if (dst.get_g() < floor) dst.set_g(floor);
+				if (dst.get_b() < floor) dst.set_b(floor);
+				if (dst.get_a() < floor) dst.set_a(floor);
+			}
+
+			if (clamp_ceiling) {
+				if (dst.get_r() > ceiling) dst.set_r(ceiling);
+				if (dst.get_g() > ceiling) dst.set_g(ceiling);
+				if (dst.get_b() > ceiling) dst.set_b(ceiling);
+				if (dst.get_a() > ceiling) dst.set_a(ceiling);
+			}
+		}
+		break;
+	}
+}
+
+void
+TaskPixelProcessor::add_operation(OperationList &list, const Operation &operation)
+{
+	if (list.empty() || !list.back().merge(operation))
+		list.push_back(operation);
+}
+
+void
+TaskPixelProcessor::process(const OperationList &list, Color *pixels, int count)
+{
+	for(OperationList::const_iterator i = list.begin(); i != list.end(); ++i)
+		i->process(pixels, count);
+}
 
 
 Rect
@@ -73,4 +210,30 @@ TaskPixelProcessor::get_offset() const
 	return VectorInt((int)round(offset[0]), (int)round(offset[1])) - sub_task()->target_rect.get_min();
 }
 
+
+Color
+TaskPixelChain::get_transparent_value() const
+{
+	Color color(0, 0, 0, 0);
+	process(operations, &color, 1);
+	return color;
+}
+
+bool
+TaskPixelChain::is_constant() const
+{
+	for(OperationList::const_iterator i = operations.begin(); i != operations.end(); ++i)
+		if (i->type == Operation::MATRIX && i->matrix.is_constant())
+			return true;
+	return false;
+}
+
+bool
+TaskPixelChain::get_operations(OperationList &list) const
+{
+	for(OperationList::const_iterator i = operations.begin(); i != operations.end(); ++i)
+		add_operation(list, *i);
+	return true;
+}
+
 /* === E N T R Y P O I N T ================================================= */
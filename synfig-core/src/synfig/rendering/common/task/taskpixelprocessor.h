@@ -30,7 +30,10 @@
 
 /* === H E A D E R S ======================================================= */
 
+#include <vector>
+
 #include <synfig/color/colormatrix.h>
+#include <synfig/color/gamma.h>
 
 #include "../../task.h"
 #include "tasktransformation.h"
@@ -57,11 +60,51 @@ public:
 	SYNFIG_EXPORT static Token token;
 	virtual Token::Handle get_token() const { return token.handle(); }
 
+	//! Per-pixel operation, the processors may be fused into the single
+	//! TaskPixelChain when each of them is represented by operations
+	class Operation {
+	public:
+		enum Type {
+			MATRIX,
+			GAMMA,
+			CLAMP
+		};
+
+		Type type;
+		ColorMatrix::BatchProcessor matrix;
+		Gamma gamma;
+		bool invert_negative;
+		bool clamp_floor;
+		bool clamp_ceiling;
+		Real floor;
+		Real ceiling;
+
+		explicit Operation(const ColorMatrix &matrix);
+		explicit Operation(const Gamma &gamma);
+		Operation(bool invert_negative, bool clamp_floor, bool clamp_ceiling, Real floor, Real ceiling);
+
+		//! merges the next operation of the same kind into this one,
+		//! returns false if it is not possible
+		bool merge(const Operation &next);
+
+		void process(Color *pixels, int count) const;
+	};
+
+	typedef std::vector<Operation> OperationList;
+
 	const Task::Handle& sub_task() const { return Task::sub_task(0); }
 	Task::Handle& sub_task() { return Task::sub_task(0); }
 
 	VectorInt get_offset() const;
 
+	//! appends operations of this task to the list, in order of application,
+	//! returns false if this task cannot be represented by operations
+	virtual bool get_operations(OperationList &/*list*/) const
+		{ return false; }
+
+	static void add_operation(OperationList &list, const Operation &operation);
+	static void process(const OperationList &list, Color *pixels, int count);
+
 	virtual Rect calc_bounds() const;
 
 	virtual int get_pass_subtask_index() const
@@ -106,6 +149,9 @@ public:
 			&& approximate_equal_lp(gamma.get_g(), ColorReal(1.0))
 			&& approximate_equal_lp(gamma.get_b(), ColorReal(1.0));
 	}
+
+	virtual bool get_operations(OperationList &list) const
+		{ add_operation(list, Operation(gamma)); return true; }
 };
 
 
@@ -126,6 +172,34 @@ public:
 		{ return matrix.is_constant(); }
 	virtual bool is_affects_transparent() const
 		{ return matrix.is_affects_transparent(); }
+
+	virtual bool get_operations(OperationList &list) const
+		{ add_operation(list, Operation(matrix)); return true; }
+};
+
+
+//! Applies the list of operations to each pixel in a single pass
+class TaskPixelChain: public TaskPixelProcessor
+{
+public:
+	typedef etl::handle<TaskPixelChain> Handle;
+	SYNFIG_EXPORT static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	OperationList operations;
+
+	//! color produced from the transparent pixel
+	Color get_transparent_value() const;
+
+	virtual bool is_zero() const
+		{ return is_constant() && get_transparent_value() == Color(0, 0, 0, 0); }
+	virtual bool is_transparent() const
+		{ return operations.empty(); }
+	virtual bool is_constant() const;
+	virtual bool is_affects_transparent() const
+		{ return get_transparent_value() != Color(0, 0, 0, 0); }
+
+	virtual bool get_operations(OperationList &list) const;
 };
 
 
@@ -65,7 +65,8 @@ Polyspan::Polyspan():
 	cur_line_y(0.0),
 	close_x(0.0),
 	close_y(0.0),
-	flags(NotSorted)
+	flags(NotSorted),
+	accumulation(false)
 { }
 
 //0 out all the variables involved in processing
@@ -77,6 +78,24 @@ Polyspan::clear()
 	open_index = 0;
 	current.set(0, 0, 0, 0);
 	flags = NotSorted;
+	accumulation = false;
+	accumulation_rect = RectInt();
+	accumulated_covers.clear();
+	accumulated_areas.clear();
+}
+
+void
+Polyspan::init_accumulation(const RectInt &window, const RectInt &rect)
+{
+	init(window);
+	accumulation = true;
+	rect_set_intersect(accumulation_rect, rect, window);
+	if (!accumulation_rect.is_valid())
+		accumulation_rect = RectInt(window.minx, window.miny);
+	size_t size = (size_t)(accumulation_rect.maxx - accumulation_rect.minx)
+	            * (size_t)(accumulation_rect.maxy - accumulation_rect.miny);
+	accumulated_covers.assign(size, 0.0);
+	accumulated_areas.assign(size, 0.0);
 }
 
 //add the current cell, but only if there is information to add
@@ -85,6 +104,24 @@ Polyspan::addcurrent()
 {
 	if(current.cover || current.area)
 	{
+		if (accumulation)
+		{
+			// cells at the right of the rect can not affect visible pixels,
+			// cells at the left affect them by the cover only
+			if ( current.y >= accumulation_rect.miny && current.y < accumulation_rect.maxy
+			  && current.x < accumulation_rect.maxx )
+			{
+				size_t index = (size_t)(current.y - accumulation_rect.miny)
+				             * (size_t)(accumulation_rect.maxx - accumulation_rect.minx);
+				if (current.x >= accumulation_rect.minx) {
+					index += (size_t)(current.x - accumulation_rect.minx);
+					accumulated_areas[index] += current.area;
+				}
+				accumulated_covers[index] += current.cover;
+			}
+			return;
+		}
+
 		if (covers.size() == covers.capacity())
 			covers.reserve(covers.size() + 1024*1024);
 		covers.push_back(current);
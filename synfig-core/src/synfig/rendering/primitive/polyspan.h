@@ -74,6 +74,7 @@ public:
 	};
 
 	typedef	std::vector<PenMark> cover_array;
+	typedef	std::vector<Real> accumulation_array;
 
 	//for assignment to flags value
 	enum PolySpanFlags
@@ -114,6 +115,12 @@ private:
 	//the window that will be drawn (used for clipping)
 	RectInt		    window;
 
+	//dense buffers of cells, used instead of the list of marks (see init_accumulation())
+	bool				accumulation;
+	RectInt				accumulation_rect;
+	accumulation_array	accumulated_covers;
+	accumulation_array	accumulated_areas;
+
 	//add the current cell, but only if there is information to add
 	void addcurrent();
 
@@ -139,6 +146,12 @@ public:
 	const RectInt& get_window() const { return window; }
 	const cover_array& get_covers() const { return covers; }
 
+	bool is_accumulation() const { return accumulation; }
+	const RectInt& get_accumulation_rect() const { return accumulation_rect; }
+	//rows of the accumulation rect one by one
+	const accumulation_array& get_accumulated_covers() const { return accumulated_covers; }
+	const accumulation_array& get_accumulated_areas() const { return accumulated_areas; }
+
 	bool notclosed() const
 		{ return (flags & NotClosed) || (cur_x != close_x) || (cur_y != close_y); }
 
@@ -155,6 +168,10 @@ public:
 		window.maxy = maxy;
 	}
 
+	//sum cells into the dense per-row buffers instead of the list of marks,
+	//all of the geometry inside the window is expected to be within the rect
+	void init_accumulation(const RectInt &window, const RectInt &rect);
+
 	//close the primitives with a line (or rendering will not work as expected)
 	void close();
 
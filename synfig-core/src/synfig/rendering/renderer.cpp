@@ -53,6 +53,8 @@
 #include "software/rendererpreviewsw.h"
 #include "software/rendererlowressw.h"
 #include "software/renderersafe.h"
+#include "software/surfacesw.h"
+#include "software/surfaceswcompact.h"
 #ifdef WITH_OPENGL
 #include "opengl/renderergl.h"
 #include "opengl/task/taskgl.h"
@@ -87,6 +89,7 @@ Renderer::Handle Renderer::blank;
 std::map<String, Renderer::Handle> *Renderer::renderers;
 RenderQueue *Renderer::queue;
 Renderer::DebugOptions Renderer::debug_options;
+rendering::Surface::Token::Handle Renderer::intermediate_token;
 long long Renderer::last_registered_optimizer_index = 0;
 long long Renderer::last_batch_index = 0;
 
@@ -786,6 +789,22 @@ Renderer::find_deps(const Task::List &list, long long batch_index) const
 	}
 }
 
+void
+Renderer::mark_intermediate(const Task::List &list, const Task::List &optimized_list) const
+{
+	// results of the input list are returned to caller and keep full precision
+	std::set<SurfaceResource::Handle> surfaces;
+	for(Task::List::const_iterator i = list.begin(); i != list.end(); ++i)
+		if (*i) surfaces.insert((*i)->target_surface);
+
+	// only the last writer of each surface converts it
+	for(Task::List::const_reverse_iterator i = optimized_list.rbegin(); i != optimized_list.rend(); ++i)
+		if ( *i && (*i)->is_valid() && (*i)->target_surface
+		  && (*i)->get_target_token() == SurfaceSW::token.handle()
+		  && surfaces.insert((*i)->target_surface).second )
+			(*i)->renderer_data.store_token = get_intermediate_token();
+}
+
 bool
 Renderer::run(const Task::List &list, bool quiet) const
 {
@@ -841,6 +860,8 @@ Renderer::enqueue(const Task::List &list, const TaskEvent::Handle &finish_event_
 	Task::List optimized_list(list);
 	optimize(optimized_list);
 	find_deps(optimized_list, ++last_batch_index);
+	if (get_intermediate_token())
+		mark_intermediate(list, optimized_list);
 
 	#ifdef DEBUG_TASK_LIST
 	if (!quiet) log("", optimized_list, "optimized list");
@@ -990,6 +1011,19 @@ Renderer::initialize()
 	if (const char *s = getenv("SYNFIG_RENDERING_DEBUG_RESULT_IMAGE"))
 		debug_options.result_image = s;
 
+	// init storage of intermediate surfaces
+	if (const char *s = getenv("SYNFIG_RENDERING_INTERMEDIATE_SURFACE")) {
+		String format(s);
+		if (format == "half")
+			intermediate_token = SurfaceSWHalf::token.handle();
+		else
+		if (format == "byte")
+			intermediate_token = SurfaceSWByte::token.handle();
+		else
+		if (format != "float")
+			synfig::warning("rendering::Renderer: unknown intermediate surface format '%s'", s);
+	}
+
 	renderers = new std::map<String, Handle>();
 	queue = new RenderQueue();
 
@@ -67,6 +67,7 @@ private:
 	static std::map<String, Handle> *renderers;
 	static RenderQueue *queue;
 	static DebugOptions debug_options;
+	static Surface::Token::Handle intermediate_token;
 	static long long last_registered_optimizer_index;
 	static long long last_batch_index; // TODO: atomic
 
@@ -140,6 +141,7 @@ private:
 	typedef DepTargetMap::value_type                    DepTargetPair;
 
 	void find_deps(const Task::List &list, long long batch_index) const;
+	void mark_intermediate(const Task::List &list, const Task::List &optimized_list) const;
 
 public:
 	int get_max_simultaneous_threads() const;
@@ -186,6 +188,15 @@ public:
 	static const DebugOptions& get_debug_options()
 		{ return debug_options; }
 
+	//! Surface type to keep results of intermediate software tasks
+	//! until they are read, null to keep them in full precision (default).
+	//! Also can be set by environment variable SYNFIG_RENDERING_INTERMEDIATE_SURFACE
+	//! with value "half" or "byte"
+	static const Surface::Token::Handle& get_intermediate_token()
+		{ return intermediate_token; }
+	static void set_intermediate_token(const Surface::Token::Handle &token)
+		{ intermediate_token = token; }
+
 	static bool subsys_init()
 		{ initialize(); return true; }
 	static bool subsys_stop()
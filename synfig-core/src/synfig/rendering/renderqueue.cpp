@@ -188,6 +188,9 @@ RenderQueue::process(int thread_index)
 			task->renderer_data.success = false;
 		}
 
+		if (success && task->renderer_data.store_token && task->target_surface)
+			task->target_surface->store_as(task->renderer_data.store_token);
+
 		done(thread_index, task);
 	}
 }
@@ -37,6 +37,10 @@
 #include <algorithm>
 #include <functional>
 
+#include <sigc++/bind.h>
+
+#include <synfig/threadpool.h>
+
 #include "blur.h"
 
 #include "blurtemplates.h"
@@ -53,6 +57,52 @@ using namespace rendering;
 
 /* === P R O C E D U R E S ================================================= */
 
+// convolves each row of real array with pattern given by its spectrum
+static void
+convolve_rows(const software::Array<Real, 2> &x, const software::Array<Complex, 1> &pattern)
+{
+	std::vector<Complex> spectrum(x.count*pattern.count);
+	software::Array<Complex, 2> arr_spectrum(&spectrum.front());
+	arr_spectrum
+		.set_dim(x.count, pattern.count)
+		.set_dim(pattern.count, 1);
+
+	software::FFT::fft_real(x, arr_spectrum, false);
+	for(software::Array<Complex, 2>::Iterator r(arr_spectrum); r; ++r)
+		r->process< std::multiplies<Complex> >(pattern);
+	software::FFT::fft_real(x, arr_spectrum, true);
+}
+
+static void
+convolve_2d(const software::Array<Real, 2> &x, const software::Array<Complex, 2> &pattern)
+{
+	std::vector<Complex> spectrum(pattern.count*pattern.sub().count);
+	software::Array<Complex, 2> arr_spectrum(&spectrum.front());
+	arr_spectrum
+		.set_dim(pattern.count, pattern.sub().count)
+		.set_dim(pattern.sub().count, 1);
+
+	software::FFT::fft2d_real(x, arr_spectrum, false);
+	arr_spectrum.process< std::multiplies<Complex> >(pattern);
+	software::FFT::fft2d_real(x, arr_spectrum, true);
+}
+
+// processes channels and blocks of rows in parallel
+static void
+convolve_rows_parallel(const software::Array<Real, 3> &channels, const software::Array<Complex, 1> &pattern)
+{
+	const int rows_per_block = 64;
+	// one unit of weight is about 2^18 transformed samples
+	const Real k = (Real)channels.sub().sub().count/(Real)(1 << 18);
+	ThreadPool::Group group;
+	for(software::Array<Real, 3>::Iterator channel(channels); channel; ++channel)
+		for(int i = 0; i < channel->count; i += rows_per_block) {
+			int e = std::min(i + rows_per_block, channel->count);
+			group.enqueue(sigc::bind(sigc::ptr_fun(&convolve_rows), channel->get_range(0, i, e), pattern), (e - i)*k);
+		}
+	group.run();
+}
+
 /* === M E T H O D S ======================================================= */
 
 bool
@@ -396,13 +446,15 @@ software::Blur::blur_fft(const Params &params)
 		BlurTemplates::mirror_pattern_2d( arr_full_pattern.reorder(0, 1) );
 		BlurTemplates::normalize_full_pattern_2d( arr_full_pattern.reorder(0, 1) );
 
+		// surface is real, so only the half of spectrum is needed
 		FFT::fft2d(arr_full_pattern.group_items<Complex>(), false);
-		for(Array<Complex, 3>::Iterator channel(arr_surface.group_items<Complex>().reorder(2, 0, 1)); channel; ++channel)
-		{
-			FFT::fft2d(*channel, false);
-			channel->process< std::multiplies<Complex> >(arr_full_pattern.group_items<Complex>());
-			FFT::fft2d(*channel, true);
-		}
+		Array<Complex, 2> arr_half_pattern = arr_full_pattern.group_items<Complex>().get_range(1, 0, cols/2 + 1);
+
+		const Real k = (Real)(rows*cols)/(Real)(1 << 18);
+		ThreadPool::Group group;
+		for(Array<Real, 3>::Iterator channel(arr_surface.reorder(2, 0, 1)); channel; ++channel)
+			group.enqueue(sigc::bind(sigc::ptr_fun(&convolve_2d), *channel, arr_half_pattern), k);
+		group.run();
 	}
 	else
 	{
@@ -423,23 +475,16 @@ software::Blur::blur_fft(const Params &params)
 			arr_surface_cols.pointer = &surface_copy.front();
 		}
 
+		// transform only real parts, imaginary parts of surface stay zero
 		FFT::fft(arr_row_pattern.group_items<Complex>(), false);
-		for(Array<Complex, 3>::Iterator channel(arr_surface_rows); channel; ++channel)
-		{
-			FFT::fft2d(*channel, false, true, false);
-			for(Array<Complex, 2>::Iterator r(*channel); r; ++r)
-				r->process< std::multiplies<Complex> >(arr_row_pattern.group_items<Complex>());
-			FFT::fft2d(*channel, true, true, false);
-		}
+		convolve_rows_parallel(
+			arr_surface_rows.split_items<Real>().reorder(0, 1, 2),
+			arr_row_pattern.group_items<Complex>().get_range(0, 0, cols/2 + 1) );
 
 		FFT::fft(arr_col_pattern.group_items<Complex>(), false);
-		for(Array<Complex, 3>::Iterator channel(arr_surface_cols); channel; ++channel)
-		{
-			FFT::fft2d(*channel, false, true, false);
-			for(Array<Complex, 2>::Iterator c(*channel); c; ++c)
-				c->process< std::multiplies<Complex> >(arr_col_pattern.group_items<Complex>());
-			FFT::fft2d(*channel, true, true, false);
-		}
+		convolve_rows_parallel(
+			arr_surface_cols.split_items<Real>().reorder(0, 1, 2),
+			arr_col_pattern.group_items<Complex>().get_range(0, 0, rows/2 + 1) );
 
 		arr_surface_rows.process< BlurTemplates::Abs<Complex> >();
 		if (cross)
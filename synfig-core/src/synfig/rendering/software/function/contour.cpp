@@ -60,6 +60,20 @@ software::Contour::render_polyspan(
 	Color::value_type opacity,
 	Color::BlendMethod blend_method )
 {
+	if (polyspan.is_accumulation())
+	{
+		render_accumulation(
+			target_surface,
+			polyspan,
+			invert,
+			antialias,
+			winding_style,
+			color,
+			opacity,
+			blend_method );
+		return;
+	}
+
 	bool simple_fill = (Color::BLEND_METHODS_OVERWRITE_ON_ALPHA_ONE & (1 << blend_method))
 			        && fabsf(1.f - opacity*color.get_a()) <= 1e-6;
 
@@ -278,6 +292,90 @@ software::Contour::render_polyspan(
 	}
 }
 
+void
+software::Contour::render_accumulation(
+	synfig::Surface &target_surface,
+	const Polyspan &polyspan,
+	bool invert,
+	bool antialias,
+	rendering::Contour::WindingStyle winding_style,
+	const Color &color,
+	Color::value_type opacity,
+	Color::BlendMethod blend_method )
+{
+	bool simple_fill = (Color::BLEND_METHODS_OVERWRITE_ON_ALPHA_ONE & (1 << blend_method))
+			        && fabsf(1.f - opacity*color.get_a()) <= 1e-6;
+
+	synfig::Surface::alpha_pen p(target_surface.begin(), opacity, blend_method);
+	synfig::Surface::pen sp(target_surface.begin());
+	p.set_value(color);
+	sp.set_value(color);
+
+	const RectInt &window = polyspan.get_window();
+	const RectInt &rect = polyspan.get_accumulation_rect();
+	const int pitch = rect.maxx - rect.minx;
+
+	// fill the block without antialiasing, like the spans between cells in render_polyspan()
+	struct Filler {
+		synfig::Surface::alpha_pen &p;
+		synfig::Surface::pen &sp;
+		bool simple_fill;
+		void operator() (int x, int y, int w, int h) {
+			if (w <= 0 || h <= 0) return;
+			if (simple_fill)
+				{ sp.move_to(x, y); sp.put_block(h, w); }
+			else
+				{ p.move_to(x, y); p.put_block(h, w); }
+		}
+	} fill = { p, sp, simple_fill };
+
+	if (invert)
+	{
+		// area outside of rect is not covered by contour
+		fill(window.minx, window.miny, window.maxx - window.minx, rect.miny - window.miny);
+		fill(window.minx, rect.maxy, window.maxx - window.minx, window.maxy - rect.maxy);
+		fill(window.minx, rect.miny, rect.minx - window.minx, rect.maxy - rect.miny);
+		fill(rect.maxx, rect.miny, window.maxx - rect.maxx, rect.maxy - rect.miny);
+	}
+
+	const Real *covers = polyspan.get_accumulated_covers().empty() ? nullptr : &polyspan.get_accumulated_covers().front();
+	const Real *areas = polyspan.get_accumulated_areas().empty() ? nullptr : &polyspan.get_accumulated_areas().front();
+	for(int y = rect.miny; y < rect.maxy; ++y, covers += pitch, areas += pitch)
+	{
+		// running sum of covers gives the winding of each pixel,
+		// pixels crossed by edges are reduced by the covered area
+		Real cover = 0;
+		int span = rect.minx;
+		for(int x = rect.minx; x < rect.maxx; ++x)
+		{
+			int i = x - rect.minx;
+			cover += covers[i];
+			Real area = areas[i];
+
+			Real alpha = polyspan.extract_alpha(cover - area, winding_style);
+			if (invert) alpha = 1 - alpha;
+
+			if (area && antialias)
+			{
+				fill(span, y, x - span, 1);
+				span = x + 1;
+				if (alpha)
+				{
+					p.move_to(x, y);
+					p.put_value_alpha(alpha);
+				}
+			}
+			else
+			if (alpha < .5)
+			{
+				fill(span, y, x - span, 1);
+				span = x + 1;
+			}
+		}
+		fill(span, y, rect.maxx - span, 1);
+	}
+}
+
 void
 software::Contour::build_polyspan(
 	const rendering::Contour::ChunkList &chunks,
@@ -61,6 +61,18 @@ public:
 		Color::value_type opacity,
 		Color::BlendMethod blend_method );
 
+	//! Renders polyspan initialized by Polyspan::init_accumulation(),
+	//! called from render_polyspan()
+	static void render_accumulation(
+		synfig::Surface &target_surface,
+		const Polyspan &polyspan,
+		bool invert,
+		bool antialias,
+		rendering::Contour::WindingStyle winding_style,
+		const Color &color,
+		Color::value_type opacity,
+		Color::BlendMethod blend_method );
+
 	static void build_polyspan(
 		const rendering::Contour::ChunkList &chunks,
 		const Matrix &transform_matrix,
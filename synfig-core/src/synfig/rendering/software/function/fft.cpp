@@ -34,8 +34,11 @@
 
 #include <cassert>
 #include <climits>
+#include <cstdlib>
 //#include <ccomplex>
 
+#include <map>
+#include <memory>
 #include <mutex>
 
 #include <vector>
@@ -43,6 +46,8 @@
 
 #include <fftw3.h>
 
+#include <synfig/general.h>
+
 #include "fft.h"
 
 #endif
@@ -52,6 +57,9 @@ using namespace rendering;
 
 /* === M A C R O S ========================================================= */
 
+// maximal count of FFTW plans kept for reuse
+#define FFT_MAX_PLANS 64
+
 /* === G L O B A L S ======================================================= */
 
 /* === P R O C E D U R E S ================================================= */
@@ -61,12 +69,148 @@ using namespace rendering;
 class software::FFT::Internal
 {
 public:
+	enum Kind {
+		COMPLEX_FORWARD,
+		COMPLEX_BACKWARD,
+		REAL_FORWARD,
+		REAL_BACKWARD
+	};
+
+	class Plan {
+	public:
+		const fftw_plan plan;
+		explicit Plan(fftw_plan plan): plan(plan) { }
+		~Plan() {
+			std::lock_guard<std::mutex> lock(mutex);
+			fftw_destroy_plan(plan);
+		}
+	};
+
+	typedef std::shared_ptr<Plan> PlanHandle;
+	typedef std::vector<int> Key;
+	typedef std::pair<PlanHandle, long long> Entry;
+	typedef std::map<Key, Entry> PlanMap;
+
 	static std::set<int> counts;
+
+	//! FFTW planner is not thread-safe, so all plans are created and destroyed under this mutex,
+	//! but execution of plans does not need it
 	static std::mutex mutex;
+	static PlanMap plans;
+	static long long last_usage;
+
+	static PlanHandle get_plan(
+		Kind kind,
+		int rank, const fftw_iodim *dims,
+		int howmany_rank, const fftw_iodim *howmany_dims,
+		void *in, void *out );
+
+	static void execute(
+		Kind kind,
+		int rank, const fftw_iodim *dims,
+		int howmany_rank, const fftw_iodim *howmany_dims,
+		void *in, void *out );
 };
 
 std::set<int> software::FFT::Internal::counts;
 std::mutex software::FFT::Internal::mutex;
+software::FFT::Internal::PlanMap software::FFT::Internal::plans;
+long long software::FFT::Internal::last_usage;
+
+software::FFT::Internal::PlanHandle
+software::FFT::Internal::get_plan(
+	Kind kind,
+	int rank, const fftw_iodim *dims,
+	int howmany_rank, const fftw_iodim *howmany_dims,
+	void *in, void *out )
+{
+	// plan may be executed for other arrays with the same layout and alignment
+	Key key;
+	key.reserve(6 + 3*(rank + howmany_rank));
+	key.push_back(kind);
+	key.push_back(rank);
+	for(int i = 0; i < rank; ++i)
+		{ key.push_back(dims[i].n); key.push_back(dims[i].is); key.push_back(dims[i].os); }
+	key.push_back(howmany_rank);
+	for(int i = 0; i < howmany_rank; ++i)
+		{ key.push_back(howmany_dims[i].n); key.push_back(howmany_dims[i].is); key.push_back(howmany_dims[i].os); }
+	key.push_back(fftw_alignment_of((double*)in));
+	key.push_back(fftw_alignment_of((double*)out));
+	key.push_back(in == out);
+
+	// evicted plan should be destroyed after unlocking of mutex
+	PlanHandle evicted;
+	std::lock_guard<std::mutex> lock(mutex);
+
+	PlanMap::iterator i = plans.find(key);
+	if (i != plans.end()) {
+		i->second.second = ++last_usage;
+		return i->second.first;
+	}
+
+	fftw_plan plan = nullptr;
+	switch(kind) {
+	case COMPLEX_FORWARD:
+	case COMPLEX_BACKWARD:
+		plan = fftw_plan_guru_dft(
+			rank, dims, howmany_rank, howmany_dims,
+			(fftw_complex*)in, (fftw_complex*)out,
+			kind == COMPLEX_BACKWARD ? FFTW_BACKWARD : FFTW_FORWARD, FFTW_ESTIMATE );
+		break;
+	case REAL_FORWARD:
+		plan = fftw_plan_guru_dft_r2c(
+			rank, dims, howmany_rank, howmany_dims,
+			(double*)in, (fftw_complex*)out, FFTW_ESTIMATE );
+		break;
+	case REAL_BACKWARD:
+		plan = fftw_plan_guru_dft_c2r(
+			rank, dims, howmany_rank, howmany_dims,
+			(fftw_complex*)in, (double*)out, FFTW_ESTIMATE );
+		break;
+	}
+	if (!plan) {
+		assert(false);
+		return PlanHandle();
+	}
+
+	if (plans.size() >= FFT_MAX_PLANS) {
+		PlanMap::iterator oldest = plans.begin();
+		for(PlanMap::iterator j = plans.begin(); j != plans.end(); ++j)
+			if (j->second.second < oldest->second.second)
+				oldest = j;
+		evicted = oldest->second.first;
+		plans.erase(oldest);
+	}
+
+	PlanHandle handle = std::make_shared<Plan>(plan);
+	plans[key] = Entry(handle, ++last_usage);
+	return handle;
+}
+
+void
+software::FFT::Internal::execute(
+	Kind kind,
+	int rank, const fftw_iodim *dims,
+	int howmany_rank, const fftw_iodim *howmany_dims,
+	void *in, void *out )
+{
+	PlanHandle plan = get_plan(kind, rank, dims, howmany_rank, howmany_dims, in, out);
+	if (!plan) return;
+
+	// new-array execute functions are thread-safe
+	switch(kind) {
+	case COMPLEX_FORWARD:
+	case COMPLEX_BACKWARD:
+		fftw_execute_dft(plan->plan, (fftw_complex*)in, (fftw_complex*)out);
+		break;
+	case REAL_FORWARD:
+		fftw_execute_dft_r2c(plan->plan, (double*)in, (fftw_complex*)out);
+		break;
+	case REAL_BACKWARD:
+		fftw_execute_dft_c2r(plan->plan, (fftw_complex*)in, (double*)out);
+		break;
+	}
+}
 
 void
 software::FFT::initialize()
@@ -81,12 +225,27 @@ software::FFT::initialize()
 				for(int c7 = c5; c7 < max7; c7 *= 7)
 					Internal::counts.insert(c7);
 	fftw_set_timelimit(0.0);
+
+	// wisdom may be prepared once by fftw-wisdom utility,
+	// plans are created with FFTW_ESTIMATE, so planning itself never measures anything
+	if (const char *s = getenv("SYNFIG_FFTW_WISDOM")) {
+		std::lock_guard<std::mutex> lock(Internal::mutex);
+		if (!fftw_import_wisdom_from_filename(s))
+			synfig::warning("FFT: cannot import FFTW wisdom from file: %s", s);
+	}
 }
 
 void
 software::FFT::deinitialize()
 {
 	Internal::counts.clear();
+
+	// plans will be destroyed out of the lock
+	Internal::PlanMap plans;
+	{
+		std::lock_guard<std::mutex> lock(Internal::mutex);
+		plans.swap(Internal::plans);
+	}
 }
 
 int
@@ -120,15 +279,9 @@ software::FFT::fft(const Array<Complex, 1> &x, bool invert)
 	iodim.is = x.stride;
 	iodim.os = x.stride;
 
-	{
-		std::lock_guard<std::mutex> lock(Internal::mutex);
-		fftw_plan plan = fftw_plan_guru_dft(
-			1, &iodim, 0, nullptr,
-			(fftw_complex*)x.pointer, (fftw_complex*)x.pointer,
-			invert ? FFTW_BACKWARD : FFTW_FORWARD, FFTW_ESTIMATE );
-		fftw_execute(plan);
-		fftw_destroy_plan(plan);
-	}
+	Internal::execute(
+		invert ? Internal::COMPLEX_BACKWARD : Internal::COMPLEX_FORWARD,
+		1, &iodim, 0, nullptr, x.pointer, x.pointer );
 
 	// divide by count to complete back-FFT
 	if (invert)
@@ -155,27 +308,11 @@ software::FFT::fft2d(const Array<Complex, 2> &x, bool invert, bool do_rows, bool
 	iodim[1].is = x.stride;
 	iodim[1].os = x.stride;
 
-	{
-		std::lock_guard<std::mutex> lock(Internal::mutex);
-
-		fftw_plan plan;
-		if (do_rows && do_cols)
-		{
-			plan = fftw_plan_guru_dft(
-				2, iodim, 0, nullptr,
-				(fftw_complex*)x.pointer, (fftw_complex*)x.pointer,
-				invert ? FFTW_BACKWARD : FFTW_FORWARD, FFTW_ESTIMATE );
-		}
-		else
-		{
-			plan = fftw_plan_guru_dft(
-				1, &iodim[do_rows ? 0 : 1], 1, &iodim[do_rows ? 1 : 0],
-				(fftw_complex*)x.pointer, (fftw_complex*)x.pointer,
-				invert ? FFTW_BACKWARD : FFTW_FORWARD, FFTW_ESTIMATE );
-		}
-		fftw_execute(plan);
-		fftw_destroy_plan(plan);
-	}
+	Internal::Kind kind = invert ? Internal::COMPLEX_BACKWARD : Internal::COMPLEX_FORWARD;
+	if (do_rows && do_cols)
+		Internal::execute(kind, 2, iodim, 0, nullptr, x.pointer, x.pointer);
+	else
+		Internal::execute(kind, 1, &iodim[do_rows ? 0 : 1], 1, &iodim[do_rows ? 1 : 0], x.pointer, x.pointer);
 
 	// divide by count to complete back-FFT
 	if (invert)
@@ -186,4 +323,62 @@ software::FFT::fft2d(const Array<Complex, 2> &x, bool invert, bool do_rows, bool
 	}
 }
 
+void
+software::FFT::fft_real(const Array<Real, 2> &x, const Array<Complex, 2> &spectrum, bool invert)
+{
+	if (x.count == 0 || x.sub().count == 0) return;
+
+	assert(is_valid_count(x.sub().count));
+	assert(spectrum.count == x.count && spectrum.sub().count == x.sub().count/2 + 1);
+
+	fftw_iodim iodim, howmany_iodim;
+	iodim.n = x.sub().count;
+	howmany_iodim.n = x.count;
+	if (invert) {
+		iodim.is = spectrum.sub().stride;
+		iodim.os = x.sub().stride;
+		howmany_iodim.is = spectrum.stride;
+		howmany_iodim.os = x.stride;
+		Internal::execute(Internal::REAL_BACKWARD, 1, &iodim, 1, &howmany_iodim, spectrum.pointer, x.pointer);
+
+		// divide by count to complete back-FFT
+		x.process< std::multiplies<Real> >( 1.0/(Real)x.sub().count );
+	} else {
+		iodim.is = x.sub().stride;
+		iodim.os = spectrum.sub().stride;
+		howmany_iodim.is = x.stride;
+		howmany_iodim.os = spectrum.stride;
+		Internal::execute(Internal::REAL_FORWARD, 1, &iodim, 1, &howmany_iodim, x.pointer, spectrum.pointer);
+	}
+}
+
+void
+software::FFT::fft2d_real(const Array<Real, 2> &x, const Array<Complex, 2> &spectrum, bool invert)
+{
+	if (x.count == 0 || x.sub().count == 0) return;
+
+	assert(is_valid_count(x.count) && is_valid_count(x.sub().count));
+	assert(spectrum.count == x.count && spectrum.sub().count == x.sub().count/2 + 1);
+
+	fftw_iodim iodim[2];
+	iodim[0].n = x.count;
+	iodim[1].n = x.sub().count;
+	if (invert) {
+		iodim[0].is = spectrum.stride;
+		iodim[0].os = x.stride;
+		iodim[1].is = spectrum.sub().stride;
+		iodim[1].os = x.sub().stride;
+		Internal::execute(Internal::REAL_BACKWARD, 2, iodim, 0, nullptr, spectrum.pointer, x.pointer);
+
+		// divide by count to complete back-FFT
+		x.process< std::multiplies<Real> >( 1.0/((Real)x.count*(Real)x.sub().count) );
+	} else {
+		iodim[0].is = x.stride;
+		iodim[0].os = spectrum.stride;
+		iodim[1].is = x.sub().stride;
+		iodim[1].os = spectrum.sub().stride;
+		Internal::execute(Internal::REAL_FORWARD, 2, iodim, 0, nullptr, x.pointer, spectrum.pointer);
+	}
+}
+
 /* === E N T R Y P O I N T ================================================= */
@@ -58,6 +58,13 @@ public:
 	static void fft(const Array<Complex, 1> &x, bool invert);
 	static void fft2d(const Array<Complex, 2> &x, bool invert, bool do_rows = true, bool do_cols = true);
 
+	//! Transforms each row of real array \a x into rows of \a spectrum,
+	//! which must contain x.sub().count/2 + 1 items per row.
+	//! Inverse transform destroys \a spectrum and writes result into \a x.
+	static void fft_real(const Array<Real, 2> &x, const Array<Complex, 2> &spectrum, bool invert);
+	//! Same as fft_real, but makes 2d transform
+	static void fft2d_real(const Array<Real, 2> &x, const Array<Complex, 2> &spectrum, bool invert);
+
 	static void initialize();
 	static void deinitialize();
 };
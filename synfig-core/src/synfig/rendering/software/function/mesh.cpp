@@ -32,6 +32,12 @@
 #	include <config.h>
 #endif
 
+#include <algorithm>
+
+#include <sigc++/bind.h>
+
+#include <synfig/threadpool.h>
+
 #include "mesh.h"
 
 #endif
@@ -74,6 +80,9 @@ namespace {
 
 		enum { FIXED_SHIFT = sizeof(int)*8 };
 
+		//! size of the square screen tiles used to bin triangles of the mesh
+		enum { TILE_SIZE = 64 };
+
 		inline static long long int_to_fixed(int i)
 			{ return (long long)i << FIXED_SHIFT; }
 		inline static int fixed_to_int(long long f)
@@ -86,6 +95,294 @@ namespace {
 			if (coords[1] < 0.0 || coords[1] > size[1])
 				coords[1] -= floor(coords[1]/size[1])*size[1];
 		}
+
+		//! returns false if triangle is degenerate or entirely outside of bounds
+		inline static bool check_triangle(
+			const IntVector &ip0, const IntVector &ip1, const IntVector &ip2, const RectInt &bounds )
+		{
+			if (ip0 == ip1 || ip0 == ip2 || ip1 == ip2) return false;
+			if (!bounds.is_valid()) return false;
+			if (ip0.x <  bounds.minx && ip1.x <  bounds.minx && ip2.x <  bounds.minx) return false;
+			if (ip0.y <  bounds.miny && ip1.y <  bounds.miny && ip2.y <  bounds.miny) return false;
+			if (ip0.x >= bounds.maxx && ip1.x >= bounds.maxx && ip2.x >= bounds.maxx) return false;
+			if (ip0.y >= bounds.maxy && ip1.y >= bounds.maxy && ip2.y >= bounds.maxy) return false;
+			return true;
+		}
+
+		//! walks the edges in range [y0, y1) and calls func(y, x0, x1) for each nonempty span,
+		//! rows outside of bounds are skipped without iteration
+		template<typename T>
+		static void rasterize_rows(
+			int y0, int y1,
+			long long wx0, long long wx1,
+			long long dx0, long long dx1,
+			const RectInt &bounds,
+			T &func )
+		{
+			int begin = std::max(y0, bounds.miny);
+			int end = std::min(y1, bounds.maxy);
+			if (begin >= end) return;
+
+			wx0 += dx0*(begin - y0);
+			wx1 += dx1*(begin - y0);
+			for(int y = begin; y < end; ++y, wx0 += dx0, wx1 += dx1) {
+				int x0 = std::max(fixed_to_int(wx0), bounds.minx);
+				int x1 = std::min(fixed_to_int(wx1), bounds.maxx - 1);
+				if (x1 >= x0) func(y, x0, x1);
+			}
+		}
+
+		//! calls func(y, x0, x1) for each horizontal span of triangle inside of bounds
+		template<typename T>
+		static void rasterize_triangle(
+			IntVector ip0, IntVector ip1, IntVector ip2,
+			const RectInt &bounds,
+			T &func )
+		{
+			// sort points
+			if (ip0.y > ip1.y) std::swap(ip0, ip1);
+			if (ip0.y > ip2.y) std::swap(ip0, ip2);
+			if (ip1.y > ip2.y) std::swap(ip1, ip2);
+
+			// increments
+			long long dx02 = (ip2-ip0).get_fixed_x_div_y();
+			long long dx01 = (ip1-ip0).get_fixed_x_div_y();
+			long long dx12 = (ip2-ip1).get_fixed_x_div_y();
+
+			// process top part of triangle,
+			// both edges starts at top point (p0)
+			long long wx = int_to_fixed(ip0.x);
+			long long dx_left  = std::min(dx01, dx02);
+			long long dx_right = std::max(dx01, dx02);
+			rasterize_rows(ip0.y, ip1.y, wx, wx, dx_left, dx_right, bounds, func);
+
+			// process bottom part of triangle
+			long long wx0, wx1;
+			if (ip0.y == ip1.y) {
+				wx0 = int_to_fixed(ip0.x);
+				wx1 = int_to_fixed(ip1.x);
+				if (wx0 > wx1) std::swap(wx0, wx1);
+			} else {
+				wx0 = wx + dx_left*(ip1.y - ip0.y);
+				wx1 = wx + dx_right*(ip1.y - ip0.y);
+			}
+			rasterize_rows(ip1.y, ip2.y + 1, wx0, wx1, std::max(dx02, dx12), std::min(dx02, dx12), bounds, func);
+		}
+
+		class SpanColor
+		{
+		public:
+			synfig::Surface::alpha_pen &apen;
+			const Color &color;
+
+			SpanColor(synfig::Surface::alpha_pen &apen, const Color &color):
+				apen(apen), color(color) { }
+
+			void operator() (int y, int x0, int x1)
+			{
+				apen.move_to(x0, y);
+				for(int x = x0; x <= x1; ++x) {
+					apen.put_value(color);
+					apen.inc_x();
+				}
+			}
+		};
+
+		class SpanTexture
+		{
+		public:
+			synfig::Surface::alpha_pen &apen;
+			const synfig::Surface &texture;
+			const Rect &tex_bounds;
+			Color::value_type opacity;
+			Vector tex_origin;
+			Vector tdx;
+			Vector tdy;
+
+			SpanTexture(
+				synfig::Surface::alpha_pen &apen,
+				const synfig::Surface &texture,
+				const Rect &tex_bounds,
+				Color::value_type opacity,
+				const Matrix &matrix
+			):
+				apen(apen),
+				texture(texture),
+				tex_bounds(tex_bounds),
+				opacity(opacity),
+				tex_origin(matrix.get_transformed(Vector())),
+				tdx(matrix.get_transformed(Vector(1.0, 0.0), false)),
+				tdy(matrix.get_transformed(Vector(0.0, 1.0), false))
+			{ }
+
+			void operator() (int y, int x0, int x1)
+			{
+				apen.move_to(x0, y);
+				Vector tex_point = tex_origin + tdy*Real(y) + tdx*Real(x0);
+				for(int x = x0; x <= x1; ++x)
+				{
+					if (tex_point[0] < tex_bounds.minx || tex_point[0] > tex_bounds.maxx
+					 || tex_point[1] < tex_bounds.miny || tex_point[1] > tex_bounds.maxy)
+					{
+						apen.set_alpha(0.0);
+						apen.put_value(Color());
+					}
+					else
+					{
+						apen.set_alpha(opacity);
+						apen.put_value(texture.cubic_sample(tex_point[0], tex_point[1]));
+					}
+					// uncomment following line to debug
+					//apen.put_value(Color(0,0,1,0.5));
+					apen.inc_x();
+					tex_point += tdx;
+				}
+			}
+		};
+
+		//! Renders mesh triangles binned into screen tiles,
+		//! tiles are independent and may be processed in parallel.
+		//! Triangles of each tile are rendered in the original order,
+		//! so result is the same as for the sequential rendering.
+		class TileRasterizer
+		{
+		public:
+			synfig::Surface &target_surface;
+			RectInt bounds;
+			const int *triangles;
+			int triangles_strip;
+			std::vector<Vector> positions;
+			std::vector<Vector> tex_coords;
+			const synfig::Surface *texture;
+			Rect texture_rect;
+			Color color;
+			Color::value_type opacity;
+			Color::BlendMethod blend_method;
+
+			int tiles_x;
+			int tiles_y;
+			std::vector< std::vector<int> > tiles;
+			std::vector<Real> weights;
+
+			TileRasterizer(
+				synfig::Surface &target_surface,
+				const RectInt &bounds,
+				const int *triangles,
+				int triangles_strip
+			):
+				target_surface(target_surface),
+				bounds(bounds),
+				triangles(triangles),
+				triangles_strip(triangles_strip),
+				texture(),
+				opacity(),
+				blend_method(),
+				tiles_x((bounds.get_width() + TILE_SIZE - 1)/TILE_SIZE),
+				tiles_y((bounds.get_height() + TILE_SIZE - 1)/TILE_SIZE),
+				tiles(tiles_x*tiles_y),
+				weights(tiles_x*tiles_y)
+			{ }
+
+			const int* triangle(int index) const
+				{ return (const int*)((const char*)triangles + index*triangles_strip); }
+
+			static void transform(
+				std::vector<Vector> &out,
+				const Vector *points,
+				int points_strip,
+				int count,
+				const Matrix &matrix )
+			{
+				out.resize(count);
+				for(int i = 0; i < count; ++i)
+					out[i] = matrix.get_transformed(*(const Vector*)((const char*)points + i*points_strip));
+			}
+
+			void bin(int triangles_count)
+			{
+				for(int i = 0; i < triangles_count; ++i) {
+					const int *t = triangle(i);
+					IntVector ip0(positions[t[0]]), ip1(positions[t[1]]), ip2(positions[t[2]]);
+					if (!check_triangle(ip0, ip1, ip2, bounds)) continue;
+
+					// bounds of triangle (inclusive, see rasterize_triangle)
+					RectInt rect(
+						std::min(std::min(ip0.x, ip1.x), ip2.x),
+						std::min(std::min(ip0.y, ip1.y), ip2.y),
+						std::max(std::max(ip0.x, ip1.x), ip2.x) + 1,
+						std::max(std::max(ip0.y, ip1.y), ip2.y) + 1 );
+					rect &= bounds;
+					if (!rect.is_valid()) continue;
+
+					int tx0 = (rect.minx - bounds.minx)/TILE_SIZE;
+					int ty0 = (rect.miny - bounds.miny)/TILE_SIZE;
+					int tx1 = (rect.maxx - 1 - bounds.minx)/TILE_SIZE;
+					int ty1 = (rect.maxy - 1 - bounds.miny)/TILE_SIZE;
+					for(int ty = ty0; ty <= ty1; ++ty) {
+						for(int tx = tx0; tx <= tx1; ++tx) {
+							int index = ty*tiles_x + tx;
+							RectInt r = rect & tile_rect(index);
+							tiles[index].push_back(i);
+							weights[index] += (Real)(r.get_width()*r.get_height());
+						}
+					}
+				}
+			}
+
+			RectInt tile_rect(int index) const
+			{
+				int x = bounds.minx + (index % tiles_x)*TILE_SIZE;
+				int y = bounds.miny + (index / tiles_x)*TILE_SIZE;
+				return RectInt(x, y, x + TILE_SIZE, y + TILE_SIZE) & bounds;
+			}
+
+			void render_tile(int index)
+			{
+				RectInt rect = tile_rect(index);
+				for(std::vector<int>::const_iterator i = tiles[index].begin(); i != tiles[index].end(); ++i) {
+					const int *t = triangle(*i);
+					if (texture)
+						software::Mesh::render_triangle(
+							target_surface, rect,
+							positions[t[0]], tex_coords[t[0]],
+							positions[t[1]], tex_coords[t[1]],
+							positions[t[2]], tex_coords[t[2]],
+							*texture, texture_rect,
+							opacity, blend_method );
+					else
+						software::Mesh::render_triangle(
+							target_surface, rect,
+							positions[t[0]], positions[t[1]], positions[t[2]],
+							color, opacity, blend_method );
+				}
+			}
+
+			void run()
+			{
+				// one unit of weight is about one fully covered tile
+				const Real k = 1.0/(Real)(TILE_SIZE*TILE_SIZE);
+				ThreadPool::Group group;
+				for(int i = 0; i < (int)tiles.size(); ++i)
+					if (!tiles[i].empty())
+						group.enqueue(
+							sigc::bind(sigc::mem_fun(*this, &TileRasterizer::render_tile), i),
+							weights[i]*k );
+				group.run();
+			}
+		};
+
+		static int vertices_count(
+			const int *triangles,
+			int triangles_strip,
+			int triangles_count )
+		{
+			int count = 0;
+			for(int i = 0; i < triangles_count; ++i) {
+				const int *t = (const int*)((const char*)triangles + i*triangles_strip);
+				count = std::max(count, std::max(std::max(t[0], t[1]), t[2]) + 1);
+			}
+			return count;
+		}
 	};
 }
 
@@ -105,99 +402,15 @@ software::Mesh::render_triangle(
 
 	// convert points to int
 	Internal::IntVector ip0(p0), ip1(p1), ip2(p2);
-	if (ip0 == ip1 || ip0 == ip2 || ip1 == ip2) return;
-
 	RectInt bounds = target_rect & RectInt(0, 0, target_surface.get_w(), target_surface.get_h());
-	if (!bounds.is_valid()) return;
-	if (ip0.x <  bounds.minx && ip1.x <  bounds.minx && ip2.x <  bounds.minx) return;
-	if (ip0.y <  bounds.miny && ip1.y <  bounds.miny && ip2.y <  bounds.miny) return;
-	if (ip0.x >= bounds.maxx && ip1.x >= bounds.maxx && ip2.x >= bounds.maxx) return;
-	if (ip0.y >= bounds.maxy && ip1.y >= bounds.maxy && ip2.y >= bounds.maxy) return;
+	if (!Internal::check_triangle(ip0, ip1, ip2, bounds)) return;
 
 	synfig::Surface::alpha_pen apen(target_surface.get_pen(0, 0));
 	apen.set_alpha(opacity);
 	apen.set_blend_method(blend_method);
 
-	// sort points
-	if (ip0.y > ip1.y) std::swap(ip0, ip1);
-	if (ip0.y > ip2.y) std::swap(ip0, ip2);
-	if (ip1.y > ip2.y) std::swap(ip1, ip2);
-
-	// increments
-	long long dx02 = (ip2-ip0).get_fixed_x_div_y();
-	long long dx01 = (ip1-ip0).get_fixed_x_div_y();
-	long long dx12 = (ip2-ip1).get_fixed_x_div_y();
-
-	// work points
-	// initially at top point (p0)
-	long long wx0 = Internal::int_to_fixed(ip0.x);
-	long long wx1 = wx0;
-
-	// process top part of triangle
-
-	// make copy of dx02
-	long long dx02_copy = dx02;
-	// sort increments
-	if (dx01 < dx02) std::swap(dx02, dx01);
-	// rasterize
-	for (int y = ip0.y; y < ip1.y; ++y)
-	{
-		// draw horizontal line (this code has a copy below)
-		if (y >= bounds.miny && y < bounds.maxy)
-		{
-			int x0 = Internal::fixed_to_int(wx0);
-			int x1 = Internal::fixed_to_int(wx1);
-			if (x0 <  bounds.minx) x0 = bounds.minx;
-			if (x1 >= bounds.maxx) x1 = bounds.maxx-1;
-			if (x1 >= x0)
-			{
-				apen.move_to(x0, y);
-				for(int x = x0; x <= x1; ++x)
-				{
-					apen.put_value(color);
-					apen.inc_x();
-				}
-			}
-    	}
-
-		wx0 += dx02;
-		wx1 += dx01;
-    }
-
-    if (ip0.y == ip1.y) {
-		wx0 = Internal::int_to_fixed(ip0.x);
-		wx1 = Internal::int_to_fixed(ip1.x);
-		if (wx0 > wx1) std::swap(wx0, wx1);
-    }
-
-    // process bottom part of triangle
-
-    // sort increments
-    if (dx02_copy < dx12) std::swap(dx02_copy, dx12);
-
-    // rasterize
-    for (int y = ip1.y; y <= ip2.y; ++y){
-		// draw horizontal line (this code has a copy above)
-    	if (y >= bounds.miny && y < bounds.maxy)
-    	{
-			int x0 = Internal::fixed_to_int(wx0);
-			int x1 = Internal::fixed_to_int(wx1);
-			if (x0 <  bounds.minx) x0 = bounds.minx;
-			if (x1 >= bounds.maxx) x1 = bounds.maxx-1;
-			if (x1 >= x0)
-			{
-				apen.move_to(x0, y);
-				for(int x = x0; x <= x1; ++x)
-				{
-					apen.put_value(color);
-					apen.inc_x();
-				}
-			}
-    	}
-
-		wx0 += dx02_copy;
-		wx1 += dx12;
-    }
+	Internal::SpanColor span(apen, color);
+	Internal::rasterize_triangle(ip0, ip1, ip2, bounds, span);
 }
 
 void
@@ -236,14 +449,8 @@ software::Mesh::render_triangle(
 
 	// convert points to int
 	Internal::IntVector ip0(p0), ip1(p1), ip2(p2);
-	if (ip0 == ip1 || ip0 == ip2 || ip1 == ip2) return;
-
 	RectInt bounds = target_rect & RectInt(0, 0, target_surface.get_w(), target_surface.get_h());
-	if (!bounds.is_valid()) return;
-	if (ip0.x <  bounds.minx && ip1.x <  bounds.minx && ip2.x <  bounds.minx) return;
-	if (ip0.y <  bounds.miny && ip1.y <  bounds.miny && ip2.y <  bounds.miny) return;
-	if (ip0.x >= bounds.maxx && ip1.x >= bounds.maxx && ip2.x >= bounds.maxx) return;
-	if (ip0.y >= bounds.maxy && ip1.y >= bounds.maxy && ip2.y >= bounds.maxy) return;
+	if (!Internal::check_triangle(ip0, ip1, ip2, bounds)) return;
 
 	// prepare texture matrix
 	Matrix matrix_of_texture_triangle(
@@ -257,121 +464,13 @@ software::Mesh::render_triangle(
 	matrix_of_target_triangle.invert();
 
 	Matrix matrix = matrix_of_texture_triangle * matrix_of_target_triangle;
-	Vector tdx = matrix.get_transformed(Vector(1.0, 0.0), false);
-	//Vector tdy = matrix.get_transformed(Vector(0.0, 1.0), false);
 
 	synfig::Surface::alpha_pen apen(target_surface.get_pen(0, 0));
 	apen.set_alpha(opacity);
 	apen.set_blend_method(blend_method);
 
-    // sort points
-    if (ip0.y > ip1.y) std::swap(ip0, ip1);
-    if (ip0.y > ip2.y) std::swap(ip0, ip2);
-    if (ip1.y > ip2.y) std::swap(ip1, ip2);
-
-    // increments
-    long long dx02 = (ip2-ip0).get_fixed_x_div_y();
-    long long dx01 = (ip1-ip0).get_fixed_x_div_y();
-    long long dx12 = (ip2-ip1).get_fixed_x_div_y();
-
-    // work points
-    // initially at top point (p0)
-    long long wx0 = Internal::int_to_fixed(ip0.x);
-    long long wx1 = wx0;
-
-    // process top part of triangle
-
-    // make copy of dx02
-    long long dx02_copy = dx02;
-    // sort increments
-    if (dx01 < dx02) std::swap(dx02, dx01);
-    // rasterize
-    for (int y = ip0.y; y < ip1.y; ++y)
-    {
-		// draw horizontal line (this code has a copy below)
-    	if (y >= bounds.miny && y < bounds.maxy)
-    	{
-			int x0 = Internal::fixed_to_int(wx0);
-			int x1 = Internal::fixed_to_int(wx1);
-			if (x0 <  bounds.minx) x0 = bounds.minx;
-			if (x1 >= bounds.maxx) x1 = bounds.maxx-1;
-			if (x1 >= x0)
-			{
-				apen.move_to(x0, y);
-				Vector tex_point = matrix.get_transformed(Vector(Real(x0), Real(y)));
-				for(int x = x0; x <= x1; ++x)
-				{
-					if (tex_point[0] < tex_bounds.minx || tex_point[0] > tex_bounds.maxx
-					 || tex_point[1] < tex_bounds.miny || tex_point[1] > tex_bounds.maxy)
-					{
-						apen.set_alpha(0.0);
-						apen.put_value(Color());
-					}
-					else
-					{
-						apen.set_alpha(opacity);
-						apen.put_value(texture.cubic_sample(tex_point[0], tex_point[1]));
-					}
-					// uncomment following line to debug
-					//apen.put_value(Color(0,0,1,0.5));
-					apen.inc_x();
-					tex_point += tdx;
-				}
-			}
-    	}
-
-		wx0 += dx02;
-		wx1 += dx01;
-    }
-
-    if (ip0.y == ip1.y) {
-		wx0 = Internal::int_to_fixed(ip0.x);
-		wx1 = Internal::int_to_fixed(ip1.x);
-		if (wx0 > wx1) std::swap(wx0, wx1);
-    }
-
-    // process bottom part of triangle
-
-    // sort increments
-    if (dx02_copy < dx12) std::swap(dx02_copy, dx12);
-
-    // rasterize
-    for (int y = ip1.y; y <= ip2.y; ++y){
-		// draw horizontal line (this code has a copy above)
-    	if (y >= bounds.miny && y < bounds.maxy)
-    	{
-			int x0 = Internal::fixed_to_int(wx0);
-			int x1 = Internal::fixed_to_int(wx1);
-			if (x0 <  bounds.minx) x0 = bounds.minx;
-			if (x1 >= bounds.maxx) x1 = bounds.maxx-1;
-			if (x1 >= x0)
-			{
-				apen.move_to(x0, y);
-				Vector tex_point = matrix.get_transformed(Vector(Real(x0), Real(y)));
-				for(int x = x0; x <= x1; ++x)
-				{
-					if (tex_point[0] < tex_bounds.minx || tex_point[0] > tex_bounds.maxx
-					 || tex_point[1] < tex_bounds.miny || tex_point[1] > tex_bounds.maxy)
-					{
-						apen.set_alpha(0.0);
-						apen.put_value(Color());
-					}
-					else
-					{
-						apen.set_alpha(opacity);
-						apen.put_value(texture.cubic_sample(tex_point[0], tex_point[1]));
-					}
-					// uncomment following line to debug
-					//apen.put_value(Color(1,0,0,0.5));
-					apen.inc_x();
-					tex_point += tdx;
-				}
-			}
-    	}
-
-		wx0 += dx02_copy;
-		wx1 += dx12;
-    }
+	Internal::SpanTexture span(apen, texture, tex_bounds, opacity, matrix);
+	Internal::rasterize_triangle(ip0, ip1, ip2, bounds, span);
 }
 
 void
@@ -396,19 +495,16 @@ software::Mesh::render_polygon(
 	if (vertices_strip <= 0) vertices_strip = sizeof(Vector);
 	if (triangles_strip <= 0) triangles_strip = sizeof(int[3]);
 
-	for(int i = 0; i < triangles_count; ++i)
-	{
-		int *triangle = (int*)((char*)triangles + i*triangles_strip);
-		render_triangle(
-			target_surface,
-			target_rect,
-			transform_matrix.get_transformed(*(Vector*)((char*)vertices + triangle[0]*vertices_strip)),
-			transform_matrix.get_transformed(*(Vector*)((char*)vertices + triangle[1]*vertices_strip)),
-			transform_matrix.get_transformed(*(Vector*)((char*)vertices + triangle[2]*vertices_strip)),
-			color,
-			opacity,
-			blend_method );
-	}
+	Internal::TileRasterizer rasterizer(target_surface, bounds, triangles, triangles_strip);
+	Internal::TileRasterizer::transform(
+		rasterizer.positions, vertices, vertices_strip,
+		Internal::vertices_count(triangles, triangles_strip, triangles_count),
+		transform_matrix );
+	rasterizer.color = color;
+	rasterizer.opacity = opacity;
+	rasterizer.blend_method = blend_method;
+	rasterizer.bin(triangles_count);
+	rasterizer.run();
 }
 
 void
@@ -474,23 +570,17 @@ software::Mesh::render_mesh(
 	if (tex_coords_strip <= 0) tex_coords_strip = sizeof(Vector);
 	if (triangles_strip <= 0) triangles_strip = sizeof(int[3]);
 
-	for(int i = 0; i < triangles_count; ++i)
-	{
-		int *triangle = (int*)((char*)triangles + i*triangles_strip);
-		render_triangle(
-			target_surface,
-			target_rect,
-			transform_matrix.get_transformed(*(Vector*)((char*)vertices + triangle[0]*vertices_strip)),
-			texture_matrix.get_transformed(*(Vector*)((char*)tex_coords + triangle[0]*tex_coords_strip)),
-			transform_matrix.get_transformed(*(Vector*)((char*)vertices + triangle[1]*vertices_strip)),
-			texture_matrix.get_transformed(*(Vector*)((char*)tex_coords + triangle[1]*tex_coords_strip)),
-			transform_matrix.get_transformed(*(Vector*)((char*)vertices + triangle[2]*vertices_strip)),
-			texture_matrix.get_transformed(*(Vector*)((char*)tex_coords + triangle[2]*tex_coords_strip)),
-			texture,
-			texture_rect,
-			opacity,
-			blend_method );
-	}
+	// transform all vertices once, they are shared between triangles
+	int count = Internal::vertices_count(triangles, triangles_strip, triangles_count);
+	Internal::TileRasterizer rasterizer(target_surface, bounds, triangles, triangles_strip);
+	Internal::TileRasterizer::transform(rasterizer.positions, vertices, vertices_strip, count, transform_matrix);
+	Internal::TileRasterizer::transform(rasterizer.tex_coords, tex_coords, tex_coords_strip, count, texture_matrix);
+	rasterizer.texture = &texture;
+	rasterizer.texture_rect = texture_rect;
+	rasterizer.opacity = opacity;
+	rasterizer.blend_method = blend_method;
+	rasterizer.bin(triangles_count);
+	rasterizer.run();
 }
 
 void
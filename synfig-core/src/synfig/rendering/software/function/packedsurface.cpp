@@ -294,6 +294,14 @@ PackedSurface::get_compressed_chunk(int index, const void *&data, int &size, boo
 	compressed = size != chunk_size;
 }
 
+bool
+PackedSurface::is_opaque() const
+{
+	return width > 0 && height > 0
+		&& channels[3] < 0
+		&& approximate_greater_or_equal_lp(constant.get_a(), Color::value_type(1));
+}
+
 void
 PackedSurface::set_pixels(const Color *pixels, int width, int height, int pitch) {
 	clear();
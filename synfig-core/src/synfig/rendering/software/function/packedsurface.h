@@ -165,6 +165,8 @@ public:
 	int get_width() const { return width; }
 	int get_height() const { return height; }
 	void get_pixels(Color *target) const;
+	//! All pixels have (almost) full alpha
+	bool is_opaque() const;
 };
 
 } /* end namespace software */
@@ -32,7 +32,16 @@
 #	include <config.h>
 #endif
 
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+#include <sigc++/bind.h>
+
+#include <synfig/angle.h>
 #include <synfig/debug/debugsurface.h>
+#include <synfig/general.h>
+#include <synfig/threadpool.h>
 
 #include "resample.h"
 #include "../../primitive/transformationaffine.h"
@@ -52,6 +61,8 @@ template Color software::PackedSurface::Reader::reader<clamping::clamp, clamping
 
 /* === G L O B A L S ======================================================= */
 
+static software::Resample::Filter cubic_filter = software::Resample::FILTER_CUBIC;
+
 /* === P R O C E D U R E S ================================================= */
 
 /* === M E T H O D S ======================================================= */
@@ -486,10 +497,381 @@ namespace {
 					blend_method );
 			}
 		};
+
+		class Separable
+		{
+		public:
+			enum { ROWS_PER_BLOCK = 16 };
+
+			//! Weights of source pixels for each destination pixel along one axis
+			struct Table {
+				int dst_begin;
+				int dst_end;
+				int taps;
+				std::vector<int> first;
+				std::vector<int> count;
+				std::vector<ColorReal> weights;
+
+				Table(): dst_begin(), dst_end(), taps() { }
+
+				// dst = src*scale + offset
+				void build(
+					const software::Resample::FilterDesc &filter,
+					Real scale,
+					Real offset,
+					int src_begin,
+					int src_end,
+					int dst_begin,
+					int dst_end )
+				{
+					this->dst_begin = dst_begin;
+					this->dst_end = dst_end;
+
+					Real k = std::min(std::fabs(scale), Real(1.0));
+					Real support = filter.radius/k;
+					taps = (int)std::ceil(2.0*support) + 2;
+
+					int size = dst_end - dst_begin;
+					first.assign(size, 0);
+					count.assign(size, 0);
+					weights.assign(size*taps, ColorReal());
+
+					std::vector<Real> w(taps);
+					for(int i = 0; i < size; ++i) {
+						Real center = ((Real)(dst_begin + i) + 0.5 - offset)/scale;
+						int j0 = (int)std::floor(center - support);
+						int j1 = std::min(j0 + taps, (int)std::ceil(center + support) + 1);
+
+						// normalize by the whole kernel, so the pixels outside of the source
+						// are transparent, and the edges are antialiased
+						Real sum = 0.0;
+						for(int j = j0; j < j1; ++j)
+							sum += (w[j - j0] = filter.func(((Real)j + 0.5 - center)*k));
+						if (approximate_zero(sum)) continue;
+
+						int begin = std::max(j0, src_begin);
+						int end = std::min(j1, src_end);
+						if (begin >= end) continue;
+
+						first[i] = begin;
+						count[i] = end - begin;
+						ColorReal *ww = &weights[i*taps];
+						for(int j = begin; j < end; ++j)
+							*ww++ = (ColorReal)(w[j - j0]/sum);
+					}
+				}
+
+				//! range of source pixels used by destination pixels [dst_index_begin, dst_index_end)
+				void get_src_range(int dst_index_begin, int dst_index_end, int &begin, int &end) const
+				{
+					begin = INT_MAX;
+					end = INT_MIN;
+					for(int i = dst_index_begin; i < dst_index_end; ++i)
+						if (count[i]) {
+							begin = std::min(begin, first[i]);
+							end = std::max(end, first[i] + count[i]);
+						}
+				}
+			};
+
+			struct SurfaceSource {
+				const void *surface;
+				explicit SurfaceSource(const synfig::Surface &surface): surface(&surface) { }
+				static Color read(const void *surface, int x, int y)
+					{ return synfig::Surface::reader_cook(surface, x, y); }
+			};
+
+			// PackedSurface::Reader caches unpacked chunks, so each thread needs own reader
+			struct PackedSource {
+				software::PackedSurface::Reader reader;
+				const void *surface;
+				explicit PackedSource(const software::PackedSurface &surface):
+					reader(surface), surface(&reader) { }
+				static Color read(const void *surface, int x, int y)
+					{ return software::PackedSurface::Reader::reader_cook(surface, x, y); }
+			};
+
+			template<typename Source, typename SourceSurface>
+			class Worker {
+			public:
+				synfig::Surface &dest;
+				const SourceSurface &src;
+				Table cols;
+				Table rows;
+				bool clamp;
+				bool blend;
+				ColorReal blend_amount;
+				Color::BlendMethod blend_method;
+
+				Worker(synfig::Surface &dest, const SourceSurface &src):
+					dest(dest),
+					src(src),
+					clamp(),
+					blend(),
+					blend_amount(),
+					blend_method() { }
+
+				int width() const
+					{ return cols.dst_end - cols.dst_begin; }
+
+				// rows [begin, end) of source into buffer, which starts from row buffer_begin
+				void horizontal(std::vector<Color> &buffer, int buffer_begin, int begin, int end) const
+				{
+					Source source(src);
+					int w = width();
+					for(int y = begin; y < end; ++y) {
+						Color *dst = &buffer[(y - buffer_begin)*w];
+						const int *first = &cols.first.front();
+						const int *count = &cols.count.front();
+						const ColorReal *weights = &cols.weights.front();
+						for(int x = 0; x < w; ++x, ++dst, ++first, ++count, weights += cols.taps) {
+							Color c;
+							for(int j = 0; j < *count; ++j)
+								c += Source::read(source.surface, *first + j, y)*weights[j];
+							*dst = c;
+						}
+					}
+				}
+
+				// kernels with negative lobes ring at hard edges
+				static Color clamp_ringing(Color c)
+				{
+					if (c.get_a() <= 0) return Color();
+					if (c.get_a() > 1) c.set_a(1);
+					if (c.get_r() < 0) c.set_r(0);
+					if (c.get_g() < 0) c.set_g(0);
+					if (c.get_b() < 0) c.set_b(0);
+					return c;
+				}
+
+				// destination rows [begin, end) from buffer, which starts from row buffer_begin
+				void vertical(const std::vector<Color> &buffer, int buffer_begin, int begin, int end) const
+				{
+					int w = width();
+					std::vector<Color> row(w);
+					for(int i = begin; i < end; ++i) {
+						int count = rows.count[i];
+						if (!count) continue;
+
+						std::fill(row.begin(), row.end(), Color());
+						const ColorReal *weights = &rows.weights[i*rows.taps];
+						for(int j = 0; j < count; ++j) {
+							const Color *src_row = &buffer[(rows.first[i] + j - buffer_begin)*w];
+							ColorReal k = weights[j];
+							for(int x = 0; x < w; ++x)
+								row[x] += src_row[x]*k;
+						}
+						if (clamp)
+							for(int x = 0; x < w; ++x)
+								row[x] = clamp_ringing(row[x]);
+
+						int y = rows.dst_begin + i;
+						if (blend) {
+							synfig::Surface::alpha_pen p(dest.get_pen(cols.dst_begin, y));
+							p.set_blend_method(blend_method);
+							p.set_alpha(blend_amount);
+							for(int x = 0; x < w; ++x, p.inc_x())
+								if (cols.count[x])
+									p.put_value(ColorPrep::uncook_static(row[x]));
+						} else {
+							Color *dst = &dest[y][cols.dst_begin];
+							for(int x = 0; x < w; ++x, ++dst)
+								if (cols.count[x])
+									*dst = ColorPrep::uncook_static(row[x]);
+						}
+					}
+				}
+
+				// Each band of destination rows filters horizontally only the source
+				// rows under its own vertical kernels, so the buffer never holds more
+				// than one band. Rows under a band border are filtered twice.
+				void band(int begin, int end)
+				{
+					int src_begin, src_end;
+					rows.get_src_range(begin, end, src_begin, src_end);
+					if (src_begin >= src_end) return;
+					std::vector<Color> buffer((src_end - src_begin)*width());
+					horizontal(buffer, src_begin, src_begin, src_end);
+					vertical(buffer, src_begin, begin, end);
+				}
+
+				void run()
+				{
+					int count = rows.dst_end - rows.dst_begin;
+					if (count <= 0 || width() <= 0) return;
+
+					int src_begin, src_end;
+					rows.get_src_range(0, count, src_begin, src_end);
+					if (src_begin >= src_end) return;
+
+					// choose band height so rows filtered twice are at most a quarter of work
+					Real src_per_dst = (Real)(src_end - src_begin)/(Real)count;
+					int rows_per_band = std::max(
+						(int)ROWS_PER_BLOCK,
+						(int)std::ceil(4.0*rows.taps/src_per_dst) );
+
+					// one unit of weight is about 2^18 multiplications of colors
+					const Real k = (Real)width()/(Real)(1 << 18);
+					ThreadPool::Group group;
+					for(int i = 0; i < count; i += rows_per_band) {
+						int e = std::min(i + rows_per_band, count);
+						Real weight = ((e - i)*src_per_dst + rows.taps)*cols.taps + (e - i)*rows.taps;
+						group.enqueue(sigc::bind(sigc::mem_fun(*this, &Worker::band), i, e), weight*k);
+					}
+					group.run();
+				}
+			};
+
+			static Real box(Real x)
+				{ return std::fabs(x) <= 0.5 ? 1.0 : 0.0; }
+
+			static Real linear(Real x)
+				{ x = std::fabs(x); return x < 1.0 ? 1.0 - x : 0.0; }
+
+			// Mitchell-Netravali family of cubic filters
+			template<int B6, int C6>
+			static Real cubic(Real x)
+			{
+				const Real b = B6/6.0, c = C6/6.0;
+				x = std::fabs(x);
+				if (x < 1.0)
+					return ((12 - 9*b - 6*c)*x*x*x + (-18 + 12*b + 6*c)*x*x + (6 - 2*b))/6.0;
+				if (x < 2.0)
+					return ((-b - 6*c)*x*x*x + (6*b + 30*c)*x*x + (-12*b - 48*c)*x + (8*b + 24*c))/6.0;
+				return 0.0;
+			}
+
+			static Real sinc(Real x)
+			{
+				if (approximate_zero(x)) return 1.0;
+				x *= PI;
+				return std::sin(x)/x;
+			}
+
+			static Real lanczos(Real x)
+				{ return std::fabs(x) < 3.0 ? sinc(x)*sinc(x/3.0) : 0.0; }
+
+			template<typename Source, typename SourceSurface>
+			static void resample(
+				synfig::Surface &dest,
+				const RectInt &dest_bounds,
+				const SourceSurface &src,
+				const RectInt &src_bounds,
+				const Matrix &transformation,
+				software::Resample::Filter filter,
+				bool blend,
+				ColorReal blend_amount,
+				Color::BlendMethod blend_method )
+			{
+				if (blend && approximate_equal_lp(blend_amount, ColorReal(0))) return;
+				if (!src_bounds.is_valid()) return;
+
+				const software::Resample::FilterDesc &desc = software::Resample::get_filter_desc(filter);
+				Real sx = transformation.m00, sy = transformation.m11;
+				Real ox = transformation.m20, oy = transformation.m21;
+
+				// destination bounds including support of filter
+				Real rx = desc.radius*std::max(std::fabs(sx), Real(1.0));
+				Real ry = desc.radius*std::max(std::fabs(sy), Real(1.0));
+				Real x0 = src_bounds.minx*sx + ox, x1 = src_bounds.maxx*sx + ox;
+				Real y0 = src_bounds.miny*sy + oy, y1 = src_bounds.maxy*sy + oy;
+				if (x0 > x1) std::swap(x0, x1);
+				if (y0 > y1) std::swap(y0, y1);
+				RectInt bounds(
+					(int)approximate_floor(x0 - rx),
+					(int)approximate_floor(y0 - ry),
+					(int)approximate_ceil (x1 + rx),
+					(int)approximate_ceil (y1 + ry) );
+				rect_set_intersect(bounds, bounds, dest_bounds);
+				rect_set_intersect(bounds, bounds, RectInt(0, 0, dest.get_w(), dest.get_h()));
+				if (!bounds.is_valid()) return;
+
+				Worker<Source, SourceSurface> worker(dest, src);
+				worker.cols.build(desc, sx, ox, src_bounds.minx, src_bounds.maxx, bounds.minx, bounds.maxx);
+				worker.rows.build(desc, sy, oy, src_bounds.miny, src_bounds.maxy, bounds.miny, bounds.maxy);
+				worker.blend = blend;
+				worker.blend_amount = blend_amount;
+				worker.blend_method = blend_method;
+				worker.clamp = desc.negative_lobes;
+				worker.run();
+			}
+		};
 	};
 }
 
 
+const software::Resample::FilterDesc&
+software::Resample::get_filter_desc(Filter filter)
+{
+	static const FilterDesc filters[FILTER_COUNT] = {
+		{ 0.5, &Helper::Separable::box,           false },
+		{ 1.0, &Helper::Separable::linear,        false },
+		{ 2.0, &Helper::Separable::cubic<0, 3>,   true  },
+		{ 2.0, &Helper::Separable::cubic<2, 2>,   true  },
+		{ 3.0, &Helper::Separable::lanczos,       true  } };
+	assert(filter >= 0 && filter < FILTER_COUNT);
+	return filters[filter];
+}
+
+
+software::Resample::Filter
+software::Resample::get_filter(Color::Interpolation interpolation)
+{
+	switch(interpolation)
+	{
+	case Color::INTERPOLATION_NEAREST: return FILTER_BOX;
+	case Color::INTERPOLATION_LINEAR:  return FILTER_LINEAR;
+	case Color::INTERPOLATION_COSINE:  return FILTER_MITCHELL;
+	default: break;
+	}
+	return get_cubic_filter();
+}
+
+
+void
+software::Resample::set_cubic_filter(Filter filter)
+{
+	assert(filter >= 0 && filter < FILTER_COUNT);
+	cubic_filter = filter;
+}
+
+
+software::Resample::Filter
+software::Resample::get_cubic_filter()
+	{ return cubic_filter; }
+
+
+void
+software::Resample::initialize()
+{
+	if (const char *s = getenv("SYNFIG_RENDERING_CUBIC_FILTER")) {
+		if (strcmp(s, "lanczos") == 0)
+			set_cubic_filter(FILTER_LANCZOS);
+		else
+		if (strcmp(s, "cubic") == 0)
+			set_cubic_filter(FILTER_CUBIC);
+		else
+			warning("Resample: unknown SYNFIG_RENDERING_CUBIC_FILTER value '%s'", s);
+	}
+}
+
+
+bool
+software::Resample::is_separable(const Matrix &transformation)
+{
+	const Matrix &m = transformation;
+	if ( !approximate_zero(m.m01) || !approximate_zero(m.m10)
+	  || !approximate_zero(m.m02) || !approximate_zero(m.m12)
+	  || !approximate_equal(m.m22, 1.0) )
+		return false;
+	if (approximate_zero(m.m00) || approximate_zero(m.m11))
+		return false;
+	// pure translation is better to process by simple resample()
+	return !approximate_equal(std::fabs(m.m00), 1.0)
+		|| !approximate_equal(std::fabs(m.m11), 1.0);
+}
+
+
 void
 software::Resample::downscale(
 	synfig::Surface &dest,
@@ -574,4 +956,54 @@ software::Resample::resample(
 }
 
 
+
+void
+software::Resample::resample_separable(
+	synfig::Surface &dest,
+	const RectInt &dest_bounds,
+	const synfig::Surface &src,
+	const RectInt &src_bounds,
+	const Matrix &transformation,
+	Filter filter,
+	bool blend,
+	ColorReal blend_amount,
+	Color::BlendMethod blend_method )
+{
+	Helper::Separable::resample<Helper::Separable::SurfaceSource>(
+		dest,
+		dest_bounds,
+		src,
+		src_bounds,
+		transformation,
+		filter,
+		blend,
+		blend_amount,
+		blend_method );
+}
+
+void
+software::Resample::resample_separable(
+	synfig::Surface &dest,
+	const RectInt &dest_bounds,
+	const software::PackedSurface &src,
+	const RectInt &src_bounds,
+	const Matrix &transformation,
+	Filter filter,
+	bool blend,
+	ColorReal blend_amount,
+	Color::BlendMethod blend_method )
+{
+	Helper::Separable::resample<Helper::Separable::PackedSource>(
+		dest,
+		dest_bounds,
+		src,
+		src_bounds,
+		transformation,
+		filter,
+		blend,
+		blend_amount,
+		blend_method );
+}
+
+
 /* === E N T R Y P O I N T ================================================= */
@@ -51,6 +51,36 @@ namespace software
 class Resample
 {
 public:
+	//! Kernels for separable resampling, see resample_separable()
+	enum Filter {
+		FILTER_BOX,      //!< area averaging
+		FILTER_LINEAR,   //!< tent, bilinear
+		FILTER_CUBIC,    //!< Catmull-Rom spline, bicubic
+		FILTER_MITCHELL, //!< Mitchell-Netravali, B = C = 1/3
+		FILTER_LANCZOS,  //!< windowed sinc with three lobes
+		FILTER_COUNT
+	};
+
+	struct FilterDesc {
+		Real radius;
+		Real (*func)(Real x);
+		bool negative_lobes; //!< output must be clamped
+	};
+
+	static const FilterDesc& get_filter_desc(Filter filter);
+	static Filter get_filter(Color::Interpolation interpolation);
+
+	//! Kernel used for Color::INTERPOLATION_CUBIC, FILTER_CUBIC by default
+	static void set_cubic_filter(Filter filter);
+	static Filter get_cubic_filter();
+
+	//! Reads SYNFIG_RENDERING_CUBIC_FILTER ("cubic" or "lanczos")
+	static void initialize();
+
+	//! Returns true when transformation contains only scale and translation,
+	//! and when it is worth to be processed by resample_separable()
+	static bool is_separable(const Matrix &transformation);
+
 	static void downscale(
 		synfig::Surface &dest,
 		const RectInt &dest_bounds,
@@ -86,6 +116,31 @@ public:
 		bool blend,
 		ColorReal blend_amount,
 		Color::BlendMethod blend_method );
+
+	//! Resamples through horizontal and vertical passes with precomputed weights.
+	//! The filter support grows with downscale factor, so there is no aliasing.
+	//! Transformation must pass is_separable() check.
+	static void resample_separable(
+		synfig::Surface &dest,
+		const RectInt &dest_bounds,
+		const synfig::Surface &src,
+		const RectInt &src_bounds,
+		const Matrix &transformation,
+		Filter filter,
+		bool blend,
+		ColorReal blend_amount,
+		Color::BlendMethod blend_method );
+
+	static void resample_separable(
+		synfig::Surface &dest,
+		const RectInt &dest_bounds,
+		const software::PackedSurface &src,
+		const RectInt &src_bounds,
+		const Matrix &transformation,
+		Filter filter,
+		bool blend,
+		ColorReal blend_amount,
+		Color::BlendMethod blend_method );
 };
 
 } /* end namespace software */
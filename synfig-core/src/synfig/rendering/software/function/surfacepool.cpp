@@ -0,0 +1,246 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/function/surfacepool.cpp
+**	\brief SurfacePool
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <new>
+
+#include "surfacepool.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+// default limit of pooled memory, may be changed by SYNFIG_RENDERING_SURFACE_POOL (in megabytes)
+#define SURFACE_POOL_MAX_BYTES ((size_t)256*1024*1024)
+
+// size classes: eight classes per power of two, but not less than one page
+#define SURFACE_POOL_CLASSES_PER_OCTAVE 8
+#define SURFACE_POOL_MIN_STEP ((size_t)4096)
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+/* === M E T H O D S ======================================================= */
+
+class software::SurfacePool::Internal
+{
+public:
+	//! Stored just before the aligned buffer
+	class Header
+	{
+	public:
+		void *memory;
+		size_t size;
+	};
+
+	// first bytes of the pooled buffers may be dirty
+	typedef std::pair<void*, size_t> Entry;
+	typedef std::multimap<size_t, Entry> Map;
+
+	static std::mutex mutex;
+	static Map pooled;
+	static size_t max_pooled_bytes;
+	static Statistics statistics;
+
+	static size_t header_size()
+		{ return (sizeof(Header) + alignment - 1)/alignment*alignment; }
+
+	static Header& header(void *buffer)
+		{ return *(Header*)((char*)buffer - header_size()); }
+
+	static size_t class_size(size_t size)
+	{
+		size_t octave = 1;
+		while(octave <= size/2) octave *= 2;
+		size_t step = std::max(SURFACE_POOL_MIN_STEP, octave/SURFACE_POOL_CLASSES_PER_OCTAVE);
+		return (size + step - 1)/step*step;
+	}
+
+	static size_t next_class_size(size_t size)
+		{ return class_size(size + 1); }
+
+	//! calloc may take zeroed pages directly from the system, so new buffers are not cleared twice
+	static void* allocate(size_t size)
+	{
+		void *memory = calloc(1, size + header_size() + alignment);
+		if (!memory)
+			return nullptr;
+		std::uintptr_t address = (std::uintptr_t)memory + header_size() + alignment - 1;
+		void *buffer = (void*)(address - address%alignment);
+		header(buffer).memory = memory;
+		header(buffer).size = size;
+		return buffer;
+	}
+
+	static void deallocate(void *buffer)
+		{ ::free(header(buffer).memory); }
+
+	//! Removes the largest buffers until \a size more bytes can be pooled, call under the lock
+	static void shrink(size_t size)
+	{
+		while(!pooled.empty() && statistics.pooled_bytes + size > max_pooled_bytes) {
+			Map::iterator i = pooled.end(); --i;
+			statistics.pooled_bytes -= i->first;
+			statistics.allocated_bytes -= i->first;
+			--statistics.pooled_count;
+			deallocate(i->second.first);
+			pooled.erase(i);
+		}
+	}
+};
+
+std::mutex software::SurfacePool::Internal::mutex;
+software::SurfacePool::Internal::Map software::SurfacePool::Internal::pooled;
+size_t software::SurfacePool::Internal::max_pooled_bytes = SURFACE_POOL_MAX_BYTES;
+software::SurfacePool::Statistics software::SurfacePool::Internal::statistics;
+
+void*
+software::SurfacePool::alloc(size_t size)
+{
+	size = Internal::class_size(std::max(size, (size_t)1));
+
+	void *buffer = nullptr;
+	size_t dirty = 0;
+	{
+		std::lock_guard<std::mutex> lock(Internal::mutex);
+		// accept slightly larger buffers, next two classes at most
+		size_t max_size = Internal::next_class_size(Internal::next_class_size(size));
+		Internal::Map::iterator i = Internal::pooled.lower_bound(size);
+		if (i != Internal::pooled.end() && i->first <= max_size) {
+			buffer = i->second.first;
+			dirty = i->second.second;
+			Internal::statistics.pooled_bytes -= i->first;
+			--Internal::statistics.pooled_count;
+			++Internal::statistics.hits;
+			Internal::pooled.erase(i);
+		} else {
+			++Internal::statistics.misses;
+			Internal::statistics.allocated_bytes += size;
+			Internal::statistics.peak_bytes = std::max(
+				Internal::statistics.peak_bytes, Internal::statistics.allocated_bytes );
+		}
+	}
+
+	if (buffer) {
+		memset(buffer, 0, dirty);
+		return buffer;
+	}
+
+	buffer = Internal::allocate(size);
+	if (!buffer) {
+		std::lock_guard<std::mutex> lock(Internal::mutex);
+		Internal::statistics.allocated_bytes -= size;
+		throw std::bad_alloc();
+	}
+	return buffer;
+}
+
+void
+software::SurfacePool::free(void *buffer, size_t used_size)
+{
+	if (!buffer) return;
+	size_t size = Internal::header(buffer).size;
+
+	{
+		std::lock_guard<std::mutex> lock(Internal::mutex);
+		if (size <= Internal::max_pooled_bytes) {
+			Internal::shrink(size);
+			Internal::pooled.insert(Internal::Map::value_type(
+				size, Internal::Entry(buffer, std::min(used_size, size)) ));
+			Internal::statistics.pooled_bytes += size;
+			++Internal::statistics.pooled_count;
+			return;
+		}
+		Internal::statistics.allocated_bytes -= size;
+	}
+	Internal::deallocate(buffer);
+}
+
+void
+software::SurfacePool::set_max_pooled_bytes(size_t max_pooled_bytes)
+{
+	std::lock_guard<std::mutex> lock(Internal::mutex);
+	Internal::max_pooled_bytes = max_pooled_bytes;
+	Internal::shrink(0);
+}
+
+size_t
+software::SurfacePool::get_max_pooled_bytes()
+{
+	std::lock_guard<std::mutex> lock(Internal::mutex);
+	return Internal::max_pooled_bytes;
+}
+
+software::SurfacePool::Statistics
+software::SurfacePool::get_statistics()
+{
+	std::lock_guard<std::mutex> lock(Internal::mutex);
+	return Internal::statistics;
+}
+
+void
+software::SurfacePool::clear()
+{
+	std::lock_guard<std::mutex> lock(Internal::mutex);
+	size_t max_pooled_bytes = Internal::max_pooled_bytes;
+	Internal::max_pooled_bytes = 0;
+	Internal::shrink(0);
+	Internal::max_pooled_bytes = max_pooled_bytes;
+}
+
+void
+software::SurfacePool::initialize()
+{
+	if (const char *s = getenv("SYNFIG_RENDERING_SURFACE_POOL")) {
+		long long megabytes = atoll(s);
+		set_max_pooled_bytes(megabytes > 0 ? (size_t)megabytes*1024*1024 : 0);
+	}
+}
+
+void
+software::SurfacePool::deinitialize()
+{
+	clear();
+}
+
+/* === E N T R Y P O I N T ================================================= */
@@ -0,0 +1,101 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/function/surfacepool.h
+**	\brief SurfacePool Header
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_RENDERING_SOFTWARE_SURFACEPOOL_H
+#define __SYNFIG_RENDERING_SOFTWARE_SURFACEPOOL_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <cstddef>
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace rendering
+{
+namespace software
+{
+
+//! Keeps pixel buffers of released surfaces for reuse by the next ones.
+//! Buffers are aligned to 64 bytes and grouped by size classes.
+//! Reused buffer is cleared only in the part written by its previous owner.
+class SurfacePool
+{
+private:
+	class Internal;
+
+public:
+	static const size_t alignment = 64;
+
+	class Statistics
+	{
+	public:
+		//! bytes of all allocated buffers, used and pooled
+		size_t allocated_bytes;
+		//! maximum of allocated_bytes
+		size_t peak_bytes;
+		//! bytes of buffers which wait for reuse
+		size_t pooled_bytes;
+		size_t pooled_count;
+		//! count of requests served by pooled buffers
+		size_t hits;
+		//! count of requests served by new allocations
+		size_t misses;
+
+		Statistics():
+			allocated_bytes(), peak_bytes(), pooled_bytes(),
+			pooled_count(), hits(), misses() { }
+	};
+
+	//! Returns zero-filled buffer of at least \a size bytes
+	static void* alloc(size_t size);
+	//! Returns buffer to the pool, only first \a used_size bytes of buffer may be non-zero
+	//! (pass (size_t)-1 if it is unknown)
+	static void free(void *buffer, size_t used_size);
+
+	//! Limits total size of pooled buffers, zero disables the pool
+	static void set_max_pooled_bytes(size_t max_pooled_bytes);
+	static size_t get_max_pooled_bytes();
+
+	static Statistics get_statistics();
+	//! Releases all pooled buffers
+	static void clear();
+
+	static void initialize();
+	static void deinitialize();
+};
+
+} /* end namespace software */
+} /* end namespace rendering */
+} /* end namespace synfig */
+
+/* -- E N D ----------------------------------------------------------------- */
+
+#endif
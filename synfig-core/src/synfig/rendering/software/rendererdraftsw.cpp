@@ -42,7 +42,10 @@
 #include "../common/optimizer/optimizerblendmerge.h"
 #include "../common/optimizer/optimizerblendtotarget.h"
 #include "../common/optimizer/optimizerdraft.h"
+#include "../common/optimizer/optimizerinstances.h"
 #include "../common/optimizer/optimizerlist.h"
+#include "../common/optimizer/optimizerocclusion.h"
+#include "../common/optimizer/optimizerpixelprocessor.h"
 #include "../common/optimizer/optimizersplit.h"
 #include "../common/optimizer/optimizertransformation.h"
 #include "../common/optimizer/optimizerpass.h"
@@ -95,6 +98,9 @@ RendererDraftSW::RendererDraftSW()
 	register_optimizer(new OptimizerTransformation());
 	register_optimizer(new OptimizerDraftTransformation());
 
+	register_optimizer(new OptimizerPixelProcessor());
+	register_optimizer(new OptimizerOcclusion());
+	register_optimizer(new OptimizerInstances());
 	register_optimizer(new OptimizerPass(false));
 	register_optimizer(new OptimizerPass(true));
 	register_optimizer(new OptimizerBlendMerge());
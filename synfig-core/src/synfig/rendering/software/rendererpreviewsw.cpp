@@ -41,7 +41,11 @@
 #include "../common/optimizer/optimizerblendassociative.h"
 #include "../common/optimizer/optimizerblendmerge.h"
 #include "../common/optimizer/optimizerblendtotarget.h"
+#include "../common/optimizer/optimizercontour.h"
+#include "../common/optimizer/optimizerinstances.h"
 #include "../common/optimizer/optimizerlist.h"
+#include "../common/optimizer/optimizerocclusion.h"
+#include "../common/optimizer/optimizerpixelprocessor.h"
 #include "../common/optimizer/optimizersplit.h"
 #include "../common/optimizer/optimizertransformation.h"
 #include "../common/optimizer/optimizerpass.h"
@@ -67,8 +71,12 @@ RendererPreviewSW::RendererPreviewSW()
 	register_mode(TaskSW::mode_token.handle());
 
 	// register optimizers
+	register_optimizer(new OptimizerContourAccumulation());
 	register_optimizer(new OptimizerTransformation());
 	register_optimizer(new OptimizerDraftTransformation());
+	register_optimizer(new OptimizerPixelProcessor());
+	register_optimizer(new OptimizerOcclusion());
+	register_optimizer(new OptimizerInstances());
 	register_optimizer(new OptimizerPass(false));
 	register_optimizer(new OptimizerPass(true));
 	register_optimizer(new OptimizerBlendMerge());
@@ -41,12 +41,18 @@
 #include "../common/optimizer/optimizerblendassociative.h"
 #include "../common/optimizer/optimizerblendmerge.h"
 #include "../common/optimizer/optimizerblendtotarget.h"
+#include "../common/optimizer/optimizercontour.h"
+#include "../common/optimizer/optimizerinstances.h"
 #include "../common/optimizer/optimizerlist.h"
+#include "../common/optimizer/optimizerocclusion.h"
+#include "../common/optimizer/optimizerpixelprocessor.h"
 #include "../common/optimizer/optimizersplit.h"
 #include "../common/optimizer/optimizertransformation.h"
 #include "../common/optimizer/optimizerpass.h"
 
 #include "function/fft.h"
+#include "function/resample.h"
+#include "function/surfacepool.h"
 
 #endif
 
@@ -66,8 +72,12 @@ RendererSW::RendererSW()
 	register_mode(TaskSW::mode_token.handle());
 
 	// register optimizers
+	register_optimizer(new OptimizerContourAccumulation());
 	register_optimizer(new OptimizerTransformation());
 
+	register_optimizer(new OptimizerPixelProcessor());
+	register_optimizer(new OptimizerOcclusion());
+	register_optimizer(new OptimizerInstances());
 	register_optimizer(new OptimizerPass(false));
 	register_optimizer(new OptimizerPass(true));
 	register_optimizer(new OptimizerBlendMerge());
@@ -84,10 +94,13 @@ String RendererSW::get_name() const { return _("Cobra (software)"); }
 void RendererSW::initialize()
 {
 	software::FFT::initialize();
+	software::SurfacePool::initialize();
+	software::Resample::initialize();
 }
 
 void RendererSW::deinitialize()
 {
+	software::SurfacePool::deinitialize();
 	software::FFT::deinitialize();
 }
 
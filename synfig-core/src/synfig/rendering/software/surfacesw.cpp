@@ -33,6 +33,7 @@
 #endif
 
 #include "surfacesw.h"
+#include "function/surfacepool.h"
 
 #endif
 
@@ -54,12 +55,14 @@ rendering::Surface::Token SurfaceSW::token(
 
 SurfaceSW::SurfaceSW():
 	own_surface(true),
-	surface(new synfig::Surface())
+	surface(new synfig::Surface()),
+	pool_buffer(nullptr)
 { }
 
 SurfaceSW::SurfaceSW(synfig::Surface &surface, bool own_surface):
 	own_surface(own_surface),
-	surface(&surface)
+	surface(&surface),
+	pool_buffer(nullptr)
 {
 	assert(this->surface);
 	set_desc(this->surface->get_w(), this->surface->get_h(), false);
@@ -68,18 +71,48 @@ SurfaceSW::SurfaceSW(synfig::Surface &surface, bool own_surface):
 
 SurfaceSW::~SurfaceSW()
 {
+	release_buffer();
 	if (own_surface)
 		{ assert(surface); delete surface; }
 	surface = nullptr;
 	set_desc(0, 0, true);
 }
 
+void
+SurfaceSW::create_buffer(int width, int height)
+{
+	assert(surface);
+	release_buffer();
+	if (!own_surface || width <= 0 || height <= 0) {
+		surface->set_wh(width, height);
+		surface->clear();
+		return;
+	}
+	// pool returns cleared buffer
+	pool_buffer = software::SurfacePool::alloc(sizeof(Color)*width*height);
+	surface->set_data((Color*)pool_buffer, width, height);
+}
+
+void
+SurfaceSW::release_buffer()
+{
+	if (!pool_buffer) return;
+	assert(surface);
+	if ((void*)(*surface)[0] == pool_buffer) {
+		size_t used_size = surface->get_pitch()*surface->get_h();
+		surface->set_wh(0, 0);
+		software::SurfacePool::free(pool_buffer, used_size);
+	} else {
+		// surface was reallocated outside, so the whole buffer may be dirty
+		software::SurfacePool::free(pool_buffer, (size_t)-1);
+	}
+	pool_buffer = nullptr;
+}
+
 bool
 SurfaceSW::create_vfunc(int width, int height)
 {
-	assert(surface);
-	surface->set_wh(width, height);
-	surface->clear();
+	create_buffer(width, height);
 	return true;
 }
 
@@ -87,9 +120,10 @@ bool
 SurfaceSW::assign_vfunc(const rendering::Surface &surface)
 {
 	assert(this->surface);
-	this->surface->set_wh(surface.get_width(), surface.get_height());
+	create_buffer(surface.get_width(), surface.get_height());
 	if (surface.get_pixels(&(*this->surface)[0][0]))
 		return true;
+	release_buffer();
 	this->surface->set_wh(0, 0);
 	set_desc(0, 0, true);
 	return false;
@@ -107,6 +141,7 @@ bool
 SurfaceSW::reset_vfunc()
 {
 	assert(surface);
+	release_buffer();
 	surface->set_wh(0, 0);
 	return true;
 }
@@ -127,6 +162,7 @@ SurfaceSW::set_surface(synfig::Surface &surface, bool own_surface)
 		return;
 	}
 
+	release_buffer();
 	if (this->own_surface) {
 		assert(this->surface);
 		delete(this->surface);
@@ -141,6 +177,7 @@ SurfaceSW::set_surface(synfig::Surface &surface, bool own_surface)
 void
 SurfaceSW::reset_surface()
 {
+	release_buffer();
 	if (own_surface) {
 		assert(surface);
 		delete(surface);
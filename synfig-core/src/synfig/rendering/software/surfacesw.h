@@ -57,6 +57,11 @@ public:
 private:
 	bool own_surface;
 	synfig::Surface *surface;
+	//! pixels of own surface taken from software::SurfacePool
+	void *pool_buffer;
+
+	void create_buffer(int width, int height);
+	void release_buffer();
 
 protected:
 	virtual bool create_vfunc(int width, int height);
@@ -0,0 +1,266 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/surfaceswcompact.cpp
+**	\brief SurfaceSWCompact
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "surfaceswcompact.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+namespace {
+
+class HalfTable
+{
+public:
+	float values[1 << 16];
+	HalfTable()
+	{
+		for(int i = 0; i < (1 << 16); ++i)
+			values[i] = SurfaceSWHalf::half_to_float((std::uint16_t)i);
+	}
+};
+
+class ByteTable
+{
+public:
+	ColorReal values[256];
+	ByteTable()
+	{
+		for(int i = 0; i < 256; ++i)
+			values[i] = ColorReal(i)/ColorReal(255);
+	}
+};
+
+inline unsigned char
+to_byte(ColorReal x)
+{
+	return x <= 0 ? 0 : x >= 1 ? 255 : (unsigned char)(x*ColorReal(255) + ColorReal(0.5));
+}
+
+} // end of anonymous namespace
+
+/* === P R O C E D U R E S ================================================= */
+
+/* === M E T H O D S ======================================================= */
+
+
+bool
+SurfaceSWCompact::create_vfunc(int width, int height)
+{
+	// zero bytes are transparent black in both formats
+	data.assign((size_t)width*height*get_pixel_size(), 0);
+	return true;
+}
+
+bool
+SurfaceSWCompact::assign_vfunc(const Surface &surface)
+{
+	int width = surface.get_width();
+	int height = surface.get_height();
+	int pixel_size = get_pixel_size();
+	data.resize((size_t)width*height*pixel_size);
+
+	const Color *pixels = surface.get_pixels_pointer();
+	std::vector<Color> buffer;
+	if (!pixels) {
+		buffer.resize((size_t)width*height);
+		if (!surface.get_pixels(&buffer.front()))
+			{ data.clear(); return false; }
+		pixels = &buffer.front();
+	}
+
+	encode(pixels, &data.front(), width*height);
+	return true;
+}
+
+bool
+SurfaceSWCompact::clear_vfunc()
+{
+	std::fill(data.begin(), data.end(), 0);
+	return true;
+}
+
+bool
+SurfaceSWCompact::reset_vfunc()
+{
+	data.clear();
+	data.shrink_to_fit();
+	return true;
+}
+
+bool
+SurfaceSWCompact::get_pixels_vfunc(Color *dest) const
+{
+	decode(&data.front(), dest, get_pixels_count());
+	return true;
+}
+
+void
+SurfaceSWCompact::get_row(int x, int y, int count, Color *dest) const
+{
+	assert(0 <= x && x + count <= get_width() && 0 <= y && y < get_height());
+	decode(&data[((size_t)y*get_width() + x)*get_pixel_size()], dest, count);
+}
+
+
+rendering::Surface::Token SurfaceSWHalf::token(
+	Desc<SurfaceSWHalf>("SurfaceSWHalf") );
+
+std::uint16_t
+SurfaceSWHalf::float_to_half(float f)
+{
+	std::uint32_t x;
+	memcpy(&x, &f, sizeof(x));
+	std::uint32_t sign = (x >> 16) & 0x8000;
+	std::uint32_t abs = x & 0x7fffffff;
+
+	// overflow, infinity and NaN
+	if (abs >= 0x47800000)
+		return sign | (abs > 0x7f800000 ? 0x7e00 : 0x7c00);
+
+	// subnormal half or zero
+	if (abs < 0x38800000) {
+		if (abs < 0x33000000)
+			return sign;
+		std::uint32_t mantissa = (abs & 0x007fffff) | 0x00800000;
+		int shift = 126 - (int)(abs >> 23);
+		std::uint32_t h = mantissa >> shift;
+		std::uint32_t rest = mantissa & ((1u << shift) - 1);
+		std::uint32_t halfway = 1u << (shift - 1);
+		if (rest > halfway || (rest == halfway && (h & 1)))
+			++h;
+		return sign | h;
+	}
+
+	// normal, rounding to nearest even may carry into exponent (up to infinity)
+	std::uint32_t h = (abs - 0x38000000) >> 13;
+	std::uint32_t rest = abs & 0x1fff;
+	if (rest > 0x1000 || (rest == 0x1000 && (h & 1)))
+		++h;
+	return sign | h;
+}
+
+float
+SurfaceSWHalf::half_to_float(std::uint16_t h)
+{
+	std::uint32_t sign = (std::uint32_t)(h & 0x8000) << 16;
+	std::uint32_t exponent = (h >> 10) & 0x1f;
+	std::uint32_t mantissa = h & 0x3ff;
+
+	if (exponent == 0) {
+		float f = mantissa*(1.f/16777216.f);
+		return sign ? -f : f;
+	}
+
+	std::uint32_t x = exponent == 0x1f
+		            ? sign | 0x7f800000 | (mantissa << 13)
+		            : sign | ((exponent + 112) << 23) | (mantissa << 13);
+	float f;
+	memcpy(&f, &x, sizeof(f));
+	return f;
+}
+
+void
+SurfaceSWHalf::encode(const Color *src, void *dest, int count) const
+{
+	std::uint16_t *d = (std::uint16_t*)dest;
+	for(const Color *end = src + count; src < end; ++src, d += 4) {
+		d[0] = float_to_half(src->get_r());
+		d[1] = float_to_half(src->get_g());
+		d[2] = float_to_half(src->get_b());
+		d[3] = float_to_half(src->get_a());
+	}
+}
+
+void
+SurfaceSWHalf::decode(const void *src, Color *dest, int count) const
+{
+	static const HalfTable table;
+	const std::uint16_t *s = (const std::uint16_t*)src;
+	for(Color *end = dest + count; dest < end; ++dest, s += 4)
+		*dest = Color(
+			table.values[s[0]],
+			table.values[s[1]],
+			table.values[s[2]],
+			table.values[s[3]] );
+}
+
+
+rendering::Surface::Token SurfaceSWByte::token(
+	Desc<SurfaceSWByte>("SurfaceSWByte") );
+
+void
+SurfaceSWByte::encode(const Color *src, void *dest, int count) const
+{
+	unsigned char *d = (unsigned char*)dest;
+	for(const Color *end = src + count; src < end; ++src, d += 4) {
+		ColorReal a = src->get_a();
+		d[3] = to_byte(a);
+		if (d[3]) {
+			d[0] = to_byte(src->get_r()*a);
+			d[1] = to_byte(src->get_g()*a);
+			d[2] = to_byte(src->get_b()*a);
+		} else {
+			d[0] = d[1] = d[2] = 0;
+		}
+	}
+}
+
+void
+SurfaceSWByte::decode(const void *src, Color *dest, int count) const
+{
+	static const ByteTable table;
+	const unsigned char *s = (const unsigned char*)src;
+	for(Color *end = dest + count; dest < end; ++dest, s += 4) {
+		if (s[3]) {
+			ColorReal k = ColorReal(1)/table.values[s[3]];
+			*dest = Color(
+				table.values[s[0]]*k,
+				table.values[s[1]]*k,
+				table.values[s[2]]*k,
+				table.values[s[3]] );
+		} else {
+			*dest = Color(0, 0, 0, 0);
+		}
+	}
+}
+
+/* === E N T R Y P O I N T ================================================= */
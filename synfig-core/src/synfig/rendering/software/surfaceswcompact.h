@@ -0,0 +1,122 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/surfaceswcompact.h
+**	\brief SurfaceSWCompact Header
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_RENDERING_SURFACESWCOMPACT_H
+#define __SYNFIG_RENDERING_SURFACESWCOMPACT_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <cstdint>
+#include <vector>
+
+#include <synfig/synfig_export.h>
+
+#include "../surface.h"
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig
+{
+namespace rendering
+{
+
+//! Low precision storage for results of intermediate software tasks.
+//! Pixels are converted to full precision Color row by row when read.
+class SurfaceSWCompact: public Surface
+{
+public:
+	typedef etl::handle<SurfaceSWCompact> Handle;
+
+private:
+	std::vector<unsigned char> data;
+
+protected:
+	virtual bool create_vfunc(int width, int height);
+	virtual bool assign_vfunc(const Surface &surface);
+	virtual bool clear_vfunc();
+	virtual bool reset_vfunc();
+	virtual bool get_pixels_vfunc(Color *dest) const;
+
+	virtual int get_pixel_size() const = 0;
+	virtual void encode(const Color *src, void *dest, int count) const = 0;
+	virtual void decode(const void *src, Color *dest, int count) const = 0;
+
+public:
+	virtual bool is_compact() const
+		{ return true; }
+
+	//! Decodes \a count pixels of the row \a y starting from \a x
+	void get_row(int x, int y, int count, Color *dest) const;
+
+	size_t get_data_size() const
+		{ return data.size(); }
+};
+
+//! Stores each channel as IEEE 754 half-float (8 bytes per pixel)
+class SurfaceSWHalf: public SurfaceSWCompact
+{
+public:
+	typedef etl::handle<SurfaceSWHalf> Handle;
+	SYNFIG_EXPORT static Token token;
+	virtual Token::Handle get_token() const
+		{ return token.handle(); }
+
+	static std::uint16_t float_to_half(float f);
+	static float half_to_float(std::uint16_t h);
+
+protected:
+	virtual int get_pixel_size() const
+		{ return 4*sizeof(std::uint16_t); }
+	virtual void encode(const Color *src, void *dest, int count) const;
+	virtual void decode(const void *src, Color *dest, int count) const;
+};
+
+//! Stores premultiplied colors clamped to [0, 1] as 8-bit values (4 bytes per pixel),
+//! suitable for previews only
+class SurfaceSWByte: public SurfaceSWCompact
+{
+public:
+	typedef etl::handle<SurfaceSWByte> Handle;
+	SYNFIG_EXPORT static Token token;
+	virtual Token::Handle get_token() const
+		{ return token.handle(); }
+
+protected:
+	virtual int get_pixel_size() const
+		{ return 4; }
+	virtual void encode(const Color *src, void *dest, int count) const;
+	virtual void decode(const void *src, Color *dest, int count) const;
+};
+
+} /* end namespace rendering */
+} /* end namespace synfig */
+
+/* -- E N D ----------------------------------------------------------------- */
+
+#endif
@@ -68,6 +68,8 @@ public:
 		{ assign(other); }
 	const software::PackedSurface& get_surface() const
 		{ return surface; }
+	virtual bool is_opaque() const
+		{ return surface.is_opaque(); }
 };
 
 } /* end namespace rendering */
@@ -36,6 +36,7 @@
 
 #include "../../common/task/taskblend.h"
 #include "tasksw.h"
+#include "../surfaceswcompact.h"
 
 #endif
 
@@ -52,6 +53,25 @@ using namespace rendering;
 
 namespace {
 
+//! Blits compact surface decoding one row at time,
+//! so the full precision copy of source is never allocated
+template<typename Pen>
+void blit_compact(const SurfaceSWCompact &src, Pen &pen, int x, int y, int w, int h)
+{
+	std::vector<Color> row(w);
+	for(int j = 0; j < h; ++j, pen.inc_y(), pen.dec_x(w)) {
+		src.get_row(x, y + j, w, &row.front());
+		for(int i = 0; i < w; ++i, pen.inc_x())
+			pen.put_value(row[i]);
+	}
+}
+
+//! Returns surface of the task if it is stored in compact form
+const SurfaceSWCompact* get_compact(const SurfaceResource::LockReadBase &lock)
+{
+	return dynamic_cast<const SurfaceSWCompact*>(lock.get_surface());
+}
+
 class TaskBlendSW: public TaskBlend,
                    public TaskSW,
                    public TaskInterfaceTargetAsSource
@@ -91,22 +111,36 @@ public:
 				rect_set_intersect(ra, ra, r);
 				if (ra.is_valid() && sub_task_a()->target_surface != target_surface)
 				{
-					LockRead la(sub_task_a());
-					if (!la) return false;
-					synfig::Surface &a = la.cast_handle()->get_surface(); // TODO: make blit_to constant
-
-					assert( 0 <= ra.minx && ra.minx < ra.maxx && ra.maxx <= c.get_w()
-						 && 0 <= ra.miny && ra.miny < ra.maxy && ra.miny <= c.get_h() );
-					assert( 0 <= ra.minx + oa[0] && ra.maxx + oa[0] <= a.get_w()
-						 && 0 <= ra.miny + oa[1] && ra.maxy + oa[1] <= a.get_h() );
-
+					SurfaceResource::LockReadBase la(sub_task_a()->target_surface, sub_task_a()->target_rect);
+					la.convert(rendering::Surface::Token::Handle(), false, true);
 					synfig::Surface::pen p = c.get_pen(ra.minx, ra.miny);
-					a.blit_to(
-						p,
-						ra.minx + oa[0],
-						ra.miny + oa[1],
-						ra.maxx - ra.minx,
-						ra.maxy - ra.miny );
+
+					if (const SurfaceSWCompact *compact_a = get_compact(la))
+					{
+						blit_compact(
+							*compact_a, p,
+							ra.minx + oa[0],
+							ra.miny + oa[1],
+							ra.maxx - ra.minx,
+							ra.maxy - ra.miny );
+					}
+					else
+					{
+						if (!la.convert<TargetSurface>()) return false;
+						synfig::Surface &a = la.cast<TargetSurface>()->get_surface(); // TODO: make blit_to constant
+
+						assert( 0 <= ra.minx && ra.minx < ra.maxx && ra.maxx <= c.get_w()
+							 && 0 <= ra.miny && ra.miny < ra.maxy && ra.miny <= c.get_h() );
+						assert( 0 <= ra.minx + oa[0] && ra.maxx + oa[0] <= a.get_w()
+							 && 0 <= ra.miny + oa[1] && ra.maxy + oa[1] <= a.get_h() );
+
+						a.blit_to(
+							p,
+							ra.minx + oa[0],
+							ra.miny + oa[1],
+							ra.maxx - ra.minx,
+							ra.maxy - ra.miny );
+					}
 				}
 			}
 		}
@@ -122,24 +156,38 @@ public:
 				rect_set_intersect(rb, rb, r);
 				if (rb.is_valid())
 				{
-					LockRead lb(sub_task_b());
-					if (!lb) return false;
-					synfig::Surface &b = lb.cast_handle()->get_surface(); // TODO: make blit_to constant
-
-					assert( 0 <= rb.minx && rb.minx < rb.maxx && rb.maxx <= c.get_w()
-						 && 0 <= rb.miny && rb.miny < rb.maxy && rb.miny <= c.get_h() );
-					assert( 0 <= rb.minx + ob[0] && rb.maxx + ob[0] <= b.get_w()
-						 && 0 <= rb.miny + ob[1] && rb.maxy + ob[1] <= b.get_h() );
-
+					SurfaceResource::LockReadBase lb(sub_task_b()->target_surface, sub_task_b()->target_rect);
+					lb.convert(rendering::Surface::Token::Handle(), false, true);
 					synfig::Surface::alpha_pen ap(c.get_pen(rb.minx, rb.miny));
 					ap.set_blend_method(blend_method);
 					ap.set_alpha(amount);
-					b.blit_to(
-						ap,
-						rb.minx + ob[0],
-						rb.miny + ob[1],
-						rb.maxx - rb.minx,
-						rb.maxy - rb.miny );
+
+					if (const SurfaceSWCompact *compact_b = get_compact(lb))
+					{
+						blit_compact(
+							*compact_b, ap,
+							rb.minx + ob[0],
+							rb.miny + ob[1],
+							rb.maxx - rb.minx,
+							rb.maxy - rb.miny );
+					}
+					else
+					{
+						if (!lb.convert<TargetSurface>()) return false;
+						synfig::Surface &b = lb.cast<TargetSurface>()->get_surface(); // TODO: make blit_to constant
+
+						assert( 0 <= rb.minx && rb.minx < rb.maxx && rb.maxx <= c.get_w()
+							 && 0 <= rb.miny && rb.miny < rb.maxy && rb.miny <= c.get_h() );
+						assert( 0 <= rb.minx + ob[0] && rb.maxx + ob[0] <= b.get_w()
+							 && 0 <= rb.miny + ob[1] && rb.maxy + ob[1] <= b.get_h() );
+
+						b.blit_to(
+							ap,
+							rb.minx + ob[0],
+							rb.miny + ob[1],
+							rb.maxx - rb.minx,
+							rb.maxy - rb.miny );
+					}
 
 					if (ra.is_valid())
 					{
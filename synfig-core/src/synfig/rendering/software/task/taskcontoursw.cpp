@@ -32,6 +32,8 @@
 #	include <config.h>
 #endif
 
+#include <cmath>
+
 #include <synfig/debug/debugsurface.h>
 
 #include "../../primitive/polyspan.h"
@@ -47,6 +49,9 @@ using namespace rendering;
 
 /* === M A C R O S ========================================================= */
 
+// maximal count of pixels in accumulation buffers of the single contour
+#define CONTOUR_MAX_ACCUMULATION_PIXELS (1 << 22)
+
 /* === G L O B A L S ======================================================= */
 
 /* === P R O C E D U R E S ================================================= */
@@ -97,6 +102,21 @@ public:
 
 		Polyspan polyspan;
 		polyspan.init(target_rect);
+		if (allow_accumulation) {
+			// all geometry is within the control points
+			Rect bounds = contour->calc_bounds(matrix);
+			if (!std::isnan(bounds.minx) && !std::isnan(bounds.miny) && !std::isnan(bounds.maxx) && !std::isnan(bounds.maxy)) {
+				bounds.expand(1.0);
+				rect_set_intersect(bounds, bounds, Rect(target_rect.minx, target_rect.miny, target_rect.maxx, target_rect.maxy));
+				RectInt rect(
+					(int)std::floor(bounds.minx),
+					(int)std::floor(bounds.miny),
+					(int)std::ceil(bounds.maxx),
+					(int)std::ceil(bounds.maxy) );
+				if ((long long)(rect.maxx - rect.minx)*(rect.maxy - rect.miny) <= CONTOUR_MAX_ACCUMULATION_PIXELS)
+					polyspan.init_accumulation(target_rect, rect);
+			}
+		}
 		software::Contour::build_polyspan(contour->get_chunks(), matrix, polyspan, detail);
 		polyspan.close();
 		polyspan.sort_marks();
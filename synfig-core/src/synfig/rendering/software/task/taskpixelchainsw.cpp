@@ -0,0 +1,155 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file synfig/rendering/software/task/taskpixelchainsw.cpp
+**	\brief TaskPixelChainSW
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cstring>
+#include <vector>
+
+#include "../../common/task/taskblend.h"
+#include "../../common/task/taskpixelprocessor.h"
+#include "tasksw.h"
+
+#endif
+
+using namespace synfig;
+using namespace rendering;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+/* === M E T H O D S ======================================================= */
+
+namespace {
+
+class TaskPixelChainSW: public TaskPixelChain, public TaskSW,
+	public TaskInterfaceBlendToTarget
+{
+public:
+	typedef etl::handle<TaskPixelChainSW> Handle;
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	virtual int get_target_subtask_index() const
+		{ return 1; }
+	virtual Color::BlendMethodFlags get_supported_blend_methods() const
+		{ return Color::BLEND_METHODS_ALL; }
+
+	// when blending the target sub-task must be kept
+	virtual int get_pass_subtask_index() const
+		{ return blend ? PASSTO_THIS_TASK : TaskPixelChain::get_pass_subtask_index(); }
+
+	virtual bool run(RunParams&) const {
+		if (!is_valid())
+			return true;
+
+		RectInt rd = target_rect;
+		Color constant_value = get_transparent_value();
+		std::vector<RectInt> constant_rects(1, rd);
+
+		LockWrite ldst(this);
+		if (!ldst) return false;
+		synfig::Surface &dst = ldst->get_surface();
+
+		if (!is_constant() && sub_task() && sub_task()->is_valid())
+		{
+			VectorInt offset = get_offset();
+			RectInt rs = sub_task()->target_rect + rd.get_min() + offset;
+			rect_set_intersect(rs, rs, rd);
+			if (rs.is_valid())
+			{
+				LockRead lsrc(sub_task());
+				if (!lsrc) return false;
+				const synfig::Surface &src = lsrc->get_surface();
+
+				rs.list_subtract(constant_rects);
+
+				// all operations are applied to one row at time,
+				// so the intermediate surfaces are never allocated
+				int w = rs.get_width();
+				if (blend)
+				{
+					std::vector<Color> row(w);
+					synfig::Surface::alpha_pen ap(dst.get_pen(rs.minx, rs.miny));
+					ap.set_blend_method(blend_method);
+					ap.set_alpha(amount);
+					for(int y = rs.miny; y < rs.maxy; ++y, ap.inc_y(), ap.dec_x(w)) {
+						memcpy(&row.front(), &src[y - rd.miny - offset[1]][rs.minx - rd.minx - offset[0]], w*sizeof(Color));
+						process(operations, &row.front(), w);
+						for(int x = 0; x < w; ++x, ap.inc_x())
+							ap.put_value(row[x]);
+					}
+				}
+				else
+				{
+					for(int y = rs.miny; y < rs.maxy; ++y) {
+						Color *dst_row = &dst[y][rs.minx];
+						memcpy(dst_row, &src[y - rd.miny - offset[1]][rs.minx - rd.minx - offset[0]], w*sizeof(Color));
+						process(operations, dst_row, w);
+					}
+				}
+			}
+		}
+
+		// blending of transparent color does nothing for non-straight methods
+		if ( blend
+		  && !Color::is_straight(blend_method)
+		  && constant_value == Color(0, 0, 0, 0) )
+			constant_rects.clear();
+
+		for(std::vector<RectInt>::const_iterator i = constant_rects.begin(); i != constant_rects.end(); ++i)
+		{
+			if (blend)
+			{
+				synfig::Surface::alpha_pen ap(dst.get_pen(i->minx, i->miny));
+				ap.set_blend_method(blend_method);
+				ap.set_alpha(amount);
+				dst.fill(constant_value, ap, i->get_width(), i->get_height());
+			}
+			else
+			{
+				dst.fill(constant_value, i->minx, i->miny, i->get_width(), i->get_height());
+			}
+		}
+
+		return true;
+	}
+};
+
+
+Task::Token TaskPixelChainSW::token(
+	DescReal<TaskPixelChainSW, TaskPixelChain>("PixelChainSW") );
+
+} // end of anonimous namespace
+
+/* === E N T R Y P O I N T ================================================= */
@@ -34,6 +34,7 @@
 
 #include <synfig/debug/debugsurface.h>
 
+#include "../../common/task/taskblend.h"
 #include "../../common/task/taskpixelprocessor.h"
 #include "tasksw.h"
 
@@ -52,13 +53,23 @@ using namespace rendering;
 
 namespace {
 
-class TaskPixelColorMatrixSW: public TaskPixelColorMatrix, public TaskSW
+class TaskPixelColorMatrixSW: public TaskPixelColorMatrix, public TaskSW,
+	public TaskInterfaceBlendToTarget
 {
 public:
 	typedef etl::handle<TaskPixelColorMatrixSW> Handle;
 	static Token token;
 	virtual Token::Handle get_token() const { return token.handle(); }
 
+	virtual int get_target_subtask_index() const
+		{ return 1; }
+	virtual Color::BlendMethodFlags get_supported_blend_methods() const
+		{ return Color::BLEND_METHODS_ALL; }
+
+	// when blending the target sub-task must be kept
+	virtual int get_pass_subtask_index() const
+		{ return blend ? PASSTO_THIS_TASK : TaskPixelColorMatrix::get_pass_subtask_index(); }
+
 	virtual bool run(RunParams&) const {
 		if (!is_valid())
 			return true;
@@ -83,18 +94,54 @@ public:
 				const synfig::Surface &src = lsrc->get_surface();
 
 				rs.list_subtract(constant_rects);
-				processor.process(
-					&dst[rs.miny][rs.minx],
-					dst.get_pitch()/sizeof(Color),
-					&src[rs.miny - rd.miny - offset[1]][rs.minx - rd.minx - offset[0]],
-					src.get_pitch()/sizeof(Color),
-					rs.get_width(),
-					rs.get_height() );
+				if (blend)
+				{
+					// process one row at time and blend it into the target,
+					// so the processed copy of source is never allocated
+					int w = rs.get_width();
+					std::vector<Color> row(w);
+					synfig::Surface::alpha_pen ap(dst.get_pen(rs.minx, rs.miny));
+					ap.set_blend_method(blend_method);
+					ap.set_alpha(amount);
+					for(int y = rs.miny; y < rs.maxy; ++y, ap.inc_y(), ap.dec_x(w)) {
+						processor.process(&row.front(), w, &src[y - rd.miny - offset[1]][rs.minx - rd.minx - offset[0]], w, w, 1);
+						for(int x = 0; x < w; ++x, ap.inc_x())
+							ap.put_value(row[x]);
+					}
+				}
+				else
+				{
+					processor.process(
+						&dst[rs.miny][rs.minx],
+						dst.get_pitch()/sizeof(Color),
+						&src[rs.miny - rd.miny - offset[1]][rs.minx - rd.minx - offset[0]],
+						src.get_pitch()/sizeof(Color),
+						rs.get_width(),
+						rs.get_height() );
+				}
 			}
 		}
 
+		// blending of transparent color does nothing for non-straight methods
+		if ( blend
+		  && !Color::is_straight(blend_method)
+		  && processor.get_constant_value() == Color(0, 0, 0, 0) )
+			constant_rects.clear();
+
 		for(std::vector<RectInt>::const_iterator i = constant_rects.begin(); i != constant_rects.end(); ++i)
-			dst.fill(processor.get_constant_value(), i->minx, i->miny, i->get_width(), i->get_height());
+		{
+			if (blend)
+			{
+				synfig::Surface::alpha_pen ap(dst.get_pen(i->minx, i->miny));
+				ap.set_blend_method(blend_method);
+				ap.set_alpha(amount);
+				dst.fill(processor.get_constant_value(), ap, i->get_width(), i->get_height());
+			}
+			else
+			{
+				dst.fill(processor.get_constant_value(), i->minx, i->miny, i->get_width(), i->get_height());
+			}
+		}
 
 		return true;
 	}
@@ -101,35 +101,63 @@ public:
 
 		Matrix matrix = dst_units_to_pixels * transformation->matrix * src_pixels_to_units;
 
+		// scale and translation may be processed by separable filter
+		bool separable = interpolation != Color::INTERPOLATION_NEAREST
+					  && software::Resample::is_separable(matrix);
+
 		// resample
 		LockReadBase lsrc(sub_task());
 		if (lsrc.convert<SurfaceSWPacked>(false)) {
 			SurfaceSWPacked::Handle src = lsrc.cast<SurfaceSWPacked>();
 			if (!src) return false;
-			software::Resample::resample(
-				ldst->get_surface(),
-				target_rect,
-				src->get_surface(),
-				sub_task()->target_rect,
-				matrix,
-				interpolation,
-				blend,
-				amount,
-				blend_method );
+			if (separable)
+				software::Resample::resample_separable(
+					ldst->get_surface(),
+					target_rect,
+					src->get_surface(),
+					sub_task()->target_rect,
+					matrix,
+					software::Resample::get_filter(interpolation),
+					blend,
+					amount,
+					blend_method );
+			else
+				software::Resample::resample(
+					ldst->get_surface(),
+					target_rect,
+					src->get_surface(),
+					sub_task()->target_rect,
+					matrix,
+					interpolation,
+					blend,
+					amount,
+					blend_method );
 		} else
 		if (lsrc.convert<TargetSurface>()) {
 			TargetSurface::Handle src = lsrc.cast<TargetSurface>();
 			if (!src) return false;
-			software::Resample::resample(
-				ldst->get_surface(),
-				target_rect,
-				src->get_surface(),
-				sub_task()->target_rect,
-				matrix,
-				interpolation,
-				blend,
-				amount,
-				blend_method );
+			if (separable)
+				software::Resample::resample_separable(
+					ldst->get_surface(),
+					target_rect,
+					src->get_surface(),
+					sub_task()->target_rect,
+					matrix,
+					software::Resample::get_filter(interpolation),
+					blend,
+					amount,
+					blend_method );
+			else
+				software::Resample::resample(
+					ldst->get_surface(),
+					target_rect,
+					src->get_surface(),
+					sub_task()->target_rect,
+					matrix,
+					interpolation,
+					blend,
+					amount,
+					blend_method );
 		} else {
 			return false;
 		}
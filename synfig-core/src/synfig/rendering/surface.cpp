@@ -214,24 +214,84 @@ Surface::touch()
 
 SurfaceResource::SurfaceResource():
 	id(++last_id),
-	width(),
-	height(),
-	blank(true)
-{ }
+	desc(pack_desc(0, 0, true))
+{
+	for(int i = 0; i < FastSlotsCount; ++i)
+		fast_slots[i].store(nullptr, std::memory_order_relaxed);
+}
 
 SurfaceResource::SurfaceResource(Surface::Handle surface):
-	width(),
-	height(),
-	blank(true)
-{ assign(surface); }
+	desc(pack_desc(0, 0, true))
+{
+	for(int i = 0; i < FastSlotsCount; ++i)
+		fast_slots[i].store(nullptr, std::memory_order_relaxed);
+	assign(surface);
+}
 
 SurfaceResource::~SurfaceResource()
 	{ reset(); }
 
+void
+SurfaceResource::publish(const Surface::Handle &surface)
+{
+	// mutex must be already locked
+	for(int i = 0; i < FastSlotsCount; ++i)
+		if (fast_slots[i].load(std::memory_order_relaxed) == surface.get())
+			return;
+	for(int i = 0; i < FastSlotsCount; ++i)
+		if (!fast_slots[i].load(std::memory_order_relaxed))
+			{ fast_slots[i].store(surface.get(), std::memory_order_release); return; }
+}
+
+void
+SurfaceResource::drop_surfaces(bool retire)
+{
+	// mutex must be already locked
+	++generation;
+	for(int i = 0; i < FastSlotsCount; ++i)
+		fast_slots[i].store(nullptr, std::memory_order_release);
+	// readers take surfaces from fast slots only after registration,
+	// so if caller is the only registered reader nobody else may hold them
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (retire && readers.load(std::memory_order_relaxed) > 1) {
+		for(Map::const_iterator i = surfaces.begin(); i != surfaces.end(); ++i)
+			retired.push_back(i->second);
+		has_retired.store(true, std::memory_order_relaxed);
+	} else {
+		retired.clear();
+		has_retired.store(false, std::memory_order_relaxed);
+	}
+	surfaces.clear();
+}
+
+void
+SurfaceResource::lock_reader()
+{
+	readers.fetch_add(1, std::memory_order_relaxed);
+	// pairs with the fence in drop_surfaces(), fast slots are read after it
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void
+SurfaceResource::unlock_reader()
+{
+	if (readers.fetch_sub(1, std::memory_order_acq_rel) != 1 || !has_retired.load(std::memory_order_relaxed))
+		return;
+
+	// retired surfaces are not reachable by the new readers,
+	// and all readers which were active when they were retired are gone
+	std::lock_guard<std::mutex> lock(mutex);
+	if (readers.load(std::memory_order_relaxed) == 0) {
+		retired.clear();
+		has_retired.store(false, std::memory_order_relaxed);
+	}
+}
+
 Surface::Handle
 SurfaceResource::get_surface(
 	const Surface::Token::Handle &token,
 	bool exclusive, // for write access
+	bool write_locked,
 	bool full,
 	const RectInt &rect,
 	bool create,
@@ -242,13 +302,24 @@ SurfaceResource::get_surface(
 	if (!full && !rect.is_valid())
 		return Surface::Handle();
 
-	std::lock_guard<std::mutex> lock(mutex);
-
+	// size may be changed only under the writer lock, so it's actual while resource is locked
+	const std::uint64_t d = get_desc();
+	const int width = unpack_width(d);
+	const int height = unpack_height(d);
 	if (width <= 0 || height <= 0)
 		return Surface::Handle();
 	if (!full && !rect_contains(RectInt(0, 0, width, height), rect))
 		return Surface::Handle();
 
+	// readers take already converted surface without locking of mutex
+	if (!exclusive && token)
+		for(int i = 0; i < FastSlotsCount; ++i)
+			if (Surface *surface = fast_slots[i].load(std::memory_order_acquire))
+				if (surface->get_token() == token)
+					return Surface::Handle(surface);
+
+	std::unique_lock<std::mutex> lock(mutex);
+
 	Surface::Handle surface;
 
 	Map::const_iterator i = surfaces.find(token);
@@ -266,48 +337,100 @@ SurfaceResource::get_surface(
 		if (!surface)
 			return Surface::Handle();
 
-		if (blank) {
+		if (unpack_blank(get_desc())) {
 			if (!surface->create(width, height))
 				return Surface::Handle();
 		} else {
-			bool found = false;
-			for(Map::const_iterator i = surfaces.begin(); i != surfaces.end() && !found; ++i)
-				if (i->second->get_pixels_pointer() && surface->assign(*i->second))
-					found = true;
-			for(Map::const_iterator i = surfaces.begin(); i != surfaces.end() && !found; ++i)
-				if (!i->second->get_pixels_pointer() && surface->assign(*i->second))
-					found = true;
-			if (!found)
+			std::vector<Surface::Handle> sources;
+			sources.reserve(surfaces.size());
+			for(Map::const_iterator i = surfaces.begin(); i != surfaces.end(); ++i)
+				if (i->second->get_pixels_pointer()) sources.push_back(i->second);
+			for(Map::const_iterator i = surfaces.begin(); i != surfaces.end(); ++i)
+				if (!i->second->get_pixels_pointer()) sources.push_back(i->second);
+
+			// readers don't change the sources, so let other readers work while converting
+			const long long source_generation = generation;
+			if (!exclusive) lock.unlock();
+
+			Surface::Handle source;
+			for(std::vector<Surface::Handle>::const_iterator i = sources.begin(); i != sources.end() && !source; ++i)
+				if (surface->assign(**i))
+					source = *i;
+			if (!source)
 				return Surface::Handle();
+
+			// decoded copy of compact surface is cached like any other conversion,
+			// it is dropped with the compact one by the next exclusive lock
+
+			if (!exclusive) {
+				lock.lock();
+				// source may be written by SemiLockWrite while converting,
+				// so this copy may be stale and must not be shared
+				if (generation != source_generation)
+					return surface;
+				// other reader may convert it at the same time
+				Map::const_iterator i = surfaces.find(token);
+				if (i != surfaces.end())
+					return i->second;
+			}
 		}
 
-		if (exclusive) surfaces.clear(); // all other surfaces invalidated
+		if (exclusive) drop_surfaces(!write_locked); // all other surfaces invalidated
 		surfaces[token] = surface;
+		publish(surface);
 	}
 
 	if (exclusive) {
-		if (surfaces.size() != 1) // keep only current surface in map
-			{ surfaces.clear(); surfaces[token] = surface; }
+		++generation;
+		if (surfaces.size() != 1) { // keep only current surface in map
+			drop_surfaces(!write_locked);
+			surfaces[token] = surface;
+			publish(surface);
+		}
 		surface->touch();
-		blank = false;
+		set_desc(width, height, false);
 	}
 	return surface;
 }
 
+bool
+SurfaceResource::store_as(const Surface::Token::Handle &token)
+{
+	if (!token)
+		return false;
+
+	Glib::Threads::RWLock::WriterLock lock(rwlock);
+	std::lock_guard<std::mutex> short_lock(mutex);
+
+	if (is_blank() || !is_exists() || surfaces.empty())
+		return false;
+
+	Map::iterator i = surfaces.find(token);
+	if (i != surfaces.end()) {
+		Surface::Handle surface = i->second;
+		drop_surfaces(false);
+		surfaces[token] = surface;
+		publish(surface);
+		return true;
+	}
+
+	Surface::Handle surface = token->fabric();
+	if (!surface || !surface->assign(*surfaces.begin()->second))
+		return false;
+
+	drop_surfaces(false);
+	surfaces[token] = surface;
+	publish(surface);
+	return true;
+}
+
 void
 SurfaceResource::create(int width, int height)
 {
 	Glib::Threads::RWLock::WriterLock lock(rwlock);
 	std::lock_guard<std::mutex> short_lock(mutex);
-	if (width > 0 && height > 0) {
-		this->width  = width;
-		this->height = height;
-	} else {
-		this->width  = 0;
-		this->height = 0;
-	}
-	blank = true;
-	surfaces.clear();
+	set_desc(width, height, true);
+	drop_surfaces(false);
 }
 
 void
@@ -320,17 +443,14 @@ SurfaceResource::assign(Surface::Handle surface)
 		if (i->second == surface)
 			return;
 
-	width = 0;
-	height = 0;
-	blank = true;
-	surfaces.clear();
+	set_desc(0, 0, true);
+	drop_surfaces(false);
 	if (!surface->is_exists())
 		return;
 
 	surfaces[surface->get_token()] = surface;
-	width = surface->get_width();
-	height = surface->get_height();
-	blank = surface->is_blank();
+	publish(surface);
+	set_desc(surface->get_width(), surface->get_height(), surface->is_blank());
 }
 
 void
@@ -338,8 +458,8 @@ SurfaceResource::clear()
 {
 	Glib::Threads::RWLock::WriterLock lock(rwlock);
 	std::lock_guard<std::mutex> short_lock(mutex);
-	blank = true;
-	surfaces.clear();
+	set_desc(get_width(), get_height(), true);
+	drop_surfaces(false);
 }
 
 void
@@ -347,10 +467,8 @@ SurfaceResource::reset()
 {
 	Glib::Threads::RWLock::WriterLock lock(rwlock);
 	std::lock_guard<std::mutex> short_lock(mutex);
-	width = 0;
-	height = 0;
-	blank = true;
-	surfaces.clear();
+	set_desc(0, 0, true);
+	drop_surfaces(false);
 }
 
 /* === E N T R Y P O I N T ================================================= */
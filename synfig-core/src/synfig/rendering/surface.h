@@ -30,6 +30,8 @@
 
 /* === H E A D E R S ======================================================= */
 
+#include <atomic>
+#include <cstdint>
 #include <map>
 #include <vector>
 
@@ -135,6 +137,14 @@ public:
 
 	virtual bool is_read_only() const
 		{ return false; }
+	//! Compact surfaces only keep pixels between tasks,
+	//! surfaces converted from them for reading are not cached in SurfaceResource
+	virtual bool is_compact() const
+		{ return false; }
+	//! Returns true only when all pixels are known to be fully opaque,
+	//! used by optimizers to skip rendering of covered tasks
+	virtual bool is_opaque() const
+		{ return false; }
 
 	bool create(int width, int height);
 	bool assign(const Surface &other);
@@ -188,14 +198,14 @@ public:
 		void lock() {
 			if (resource) {
 				if (write) resource->rwlock.writer_lock();
-				      else resource->rwlock.reader_lock();
+				      else { resource->rwlock.reader_lock(); resource->lock_reader(); }
 			}
 		}
 		void unlock() {
 			if (resource) {
 				surface.reset();
 				if (write) resource->rwlock.writer_unlock();
-				      else resource->rwlock.reader_unlock();
+				      else { resource->unlock_reader(); resource->rwlock.reader_unlock(); }
 			}
 		}
 
@@ -219,7 +229,7 @@ public:
 		bool convert(const Surface::Token::Handle &token, bool create = true, bool any = false) {
 			if (!resource) return false;
 			if (lock_token && token != this->token) return false;
-			return surface = resource->get_surface(token, exclusive, full, rect, create, any);
+			return surface = resource->get_surface(token, exclusive, write, full, rect, create, any);
 		}
 
 		template<typename T>
@@ -328,20 +338,65 @@ public:
 	};
 
 private:
+	enum { FastSlotsCount = 4 };
+
 	static int last_id;
 
 	int id = 0;
-	int width;
-	int height;
-	bool blank;
+
+	//! width, height and blank flag packed together, so they may be read without locking
+	std::atomic<std::uint64_t> desc;
+
+	//! controlled by mutex
 	Map surfaces;
+	//! changed by every exclusive access and by every drop of surfaces,
+	//! readers don't cache conversions made while it was changed, controlled by mutex
+	long long generation = 0;
+	//! surfaces dropped while readers may still use them,
+	//! controlled by mutex, released when readers which were active at the drop are gone
+	std::vector<Surface::Handle> retired;
+	std::atomic<bool> has_retired { false };
+	//! count of reader locks, including SemiLockWrite
+	std::atomic<int> readers { 0 };
+
+	//! surfaces from the map, readers take them without locking of mutex,
+	//! surfaces are never removed from map and destroyed while reader lock is held,
+	//! SemiLockWrite moves them to 'retired' list instead
+	std::atomic<Surface*> fast_slots[FastSlotsCount];
 
 	mutable std::mutex mutex;
 	mutable Glib::Threads::RWLock rwlock;
 
+	static std::uint64_t pack_desc(int width, int height, bool blank) {
+		return width > 0 && height > 0
+		     ? (std::uint64_t)width | ((std::uint64_t)height << 31) | ((std::uint64_t)blank << 62)
+		     : (std::uint64_t)1 << 62;
+	}
+	static int unpack_width(std::uint64_t desc)
+		{ return (int)(desc & 0x7fffffffu); }
+	static int unpack_height(std::uint64_t desc)
+		{ return (int)((desc >> 31) & 0x7fffffffu); }
+	static bool unpack_blank(std::uint64_t desc)
+		{ return (desc >> 62) & 1u; }
+
+	std::uint64_t get_desc() const
+		{ return desc.load(std::memory_order_acquire); }
+	void set_desc(int width, int height, bool blank)
+		{ desc.store(pack_desc(width, height, blank), std::memory_order_release); }
+
+	//! mutex must be locked before call
+	void publish(const Surface::Handle &surface);
+	//! mutex must be locked before call, 'retire' must be true when caller holds the reader lock,
+	//! so the other readers may use the surfaces
+	void drop_surfaces(bool retire);
+
+	void lock_reader();
+	void unlock_reader();
+
 	Surface::Handle get_surface(
 		const Surface::Token::Handle &token,
 		bool exclusive,
+		bool write_locked,
 		bool full,
 		const RectInt &rect,
 		bool create,
@@ -357,21 +412,24 @@ public:
 	void clear();
 	void reset();
 
+	//! Converts contents to the surface of given type and drops all other surfaces
+	bool store_as(const Surface::Token::Handle &token);
+
 	void create(const VectorInt &x)
 		{ create(x[0], x[1]); }
 
 	int get_id() const //!< helps to debug of renderer optimizers
 		{ return id; }
 	int get_width() const
-		{ std::lock_guard<std::mutex> lock(mutex); return width; }
+		{ return unpack_width(get_desc()); }
 	int get_height() const
-		{ std::lock_guard<std::mutex> lock(mutex); return height; }
+		{ return unpack_height(get_desc()); }
 	VectorInt get_size() const
-		{ std::lock_guard<std::mutex> lock(mutex); return VectorInt(width, height); }
+		{ std::uint64_t d = get_desc(); return VectorInt(unpack_width(d), unpack_height(d)); }
 	bool is_exists() const
-		{ std::lock_guard<std::mutex> lock(mutex); return width > 0 && height > 0; }
+		{ return get_width() > 0; }
 	bool is_blank() const
-		{ std::lock_guard<std::mutex> lock(mutex); return blank; }
+		{ return unpack_blank(get_desc()); }
 	bool has_surface(const Surface::Token::Handle &token) const
 		{ std::lock_guard<std::mutex> lock(mutex); return surfaces.count(token); }
 	template<typename T>
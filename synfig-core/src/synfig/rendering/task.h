@@ -295,6 +295,9 @@ public:
 		RunParams params;
 		bool success;
 
+		//! if set, result is converted to this surface type when task is done
+		Surface::Token::Handle store_token;
+
 		RendererData(): batch_index(), index(), success() { }
 	};
 
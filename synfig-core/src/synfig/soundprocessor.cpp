@@ -32,6 +32,7 @@
 #	include <config.h>
 #endif
 
+#include <mutex>
 #include <vector>
 
 #ifndef WITHOUT_MLT
@@ -63,6 +64,8 @@ public:
 	Mlt::Profile profile;
 	Mlt::Producer *last_track;
 	Mlt::Consumer *consumer;
+	//! guards consumer while export runs in the other thread
+	std::mutex export_mutex;
 #endif
 	bool playing;
 	Time position;
@@ -214,6 +217,15 @@ void SoundProcessor::set_infinite(bool value)
 	infinite = value;
 }
 
+bool SoundProcessor::is_empty() const
+{
+#ifndef WITHOUT_MLT
+	return !internal->last_track;
+#else
+	return true;
+#endif
+}
+
 Time SoundProcessor::get_position() const
 {
 #ifndef WITHOUT_MLT
@@ -277,6 +289,37 @@ void SoundProcessor::do_export(String path)
 #endif
 }
 
+void SoundProcessor::do_export_raw(String path, int frequency, int channels)
+{
+#ifndef WITHOUT_MLT
+	if (internal->last_track) {
+		Mlt::Consumer *consumer;
+		{
+			std::lock_guard<std::mutex> lock(internal->export_mutex);
+			internal->last_track->set_speed(1.0);
+			consumer = internal->consumer = new Mlt::Consumer(internal->profile, "avformat");
+			consumer->connect(*internal->last_track);
+			consumer->set("target", path.c_str());
+			consumer->set("f", "s16le");
+			consumer->set("acodec", "pcm_s16le");
+			consumer->set("frequency", frequency);
+			consumer->set("channels", channels);
+			consumer->set("vn", 1);
+		}
+		consumer->run();
+	}
+#endif
+}
+
+void SoundProcessor::stop_export()
+{
+#ifndef WITHOUT_MLT
+	std::lock_guard<std::mutex> lock(internal->export_mutex);
+	if (internal->consumer)
+		internal->consumer->stop();
+#endif
+}
+
 bool SoundProcessor::subsys_init() {
 	if (!Internal::initialized) {
 #ifndef WITHOUT_MLT
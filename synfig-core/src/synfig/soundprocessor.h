@@ -87,10 +87,18 @@ public:
 
 	void set_infinite(bool value);
 
+	//! returns true if no sound was added
+	bool is_empty() const;
+
 	bool get_playing() const;
 	void set_playing(bool value);
 
 	void do_export(String path);
+	//! Writes the mix as headerless signed 16-bit little-endian PCM,
+	//! so it may be streamed to the pipe which can not be seeked
+	void do_export_raw(String path, int frequency, int channels);
+	//! Stops do_export_raw() running in the other thread
+	void stop_export();
 
 	static bool subsys_init();
 	static bool subsys_stop();
@@ -340,6 +340,20 @@ public:
 		deletable_=true;
 	}
 
+	/** Use external memory space. The previous data is released, if it is deletable */
+	void
+	set_data(value_type *data, int w, int h, typename difference_type::value_type pitch=0, bool deletable=false)
+	{
+		if(data_ && deletable_ && data_ != data)
+			delete [] data_;
+
+		data_=data;
+		w_=w;
+		h_=h;
+		pitch_=pitch ? pitch : sizeof(value_type)*w_;
+		deletable_=deletable;
+	}
+
 
 	void
 	fill(value_type v, int x, int y, int w, int h)
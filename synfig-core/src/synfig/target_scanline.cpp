@@ -34,6 +34,9 @@
 #	include <config.h>
 #endif
 
+#include <algorithm>
+#include <cmath>
+
 #include "target_scanline.h"
 
 #include "general.h"
@@ -82,22 +85,22 @@ Target_Scanline::next_frame(Time& time)
 	return Target::next_frame(time);
 }
 
-bool
-synfig::Target_Scanline::call_renderer(
+rendering::Task::Handle
+synfig::Target_Scanline::build_task(
 	const etl::handle<rendering::SurfaceResource> &surface,
 	Canvas &canvas,
 	const ContextParams &context_params,
 	const RendDesc &renddesc )
 {
 	surface->create(renddesc.get_w(), renddesc.get_h());
-	rendering::Task::Handle task = canvas.build_rendering_task(context_params);
+	// layers outside of the frame will be skipped
+	ContextParams params(context_params);
+	params.render_rect = Rect(renddesc.get_tl(), renddesc.get_br())
+	                    .expand(std::max(std::fabs(renddesc.get_pw()), std::fabs(renddesc.get_ph())));
+	rendering::Task::Handle task = canvas.build_rendering_task(params);
 
 	if (task)
 	{
-		rendering::Renderer::Handle renderer = rendering::Renderer::get_renderer(get_engine());
-		if (!renderer)
-			throw "Renderer '" + get_engine() + "' not found";
-
 		Vector p0 = renddesc.get_tl();
 		Vector p1 = renddesc.get_br();
 		if (p0[0] > p1[0] || p0[1] > p1[1]) {
@@ -113,11 +116,33 @@ synfig::Target_Scanline::call_renderer(
 		task->target_surface = surface;
 		task->target_rect = RectInt( VectorInt(), surface->get_size() );
 		task->source_rect = Rect(p0, p1);
-
-		rendering::Task::List list;
-		list.push_back(task);
-		renderer->run(list);
 	}
+	return task;
+}
+
+void
+synfig::Target_Scanline::run_tasks(const std::vector<rendering::Task::Handle> &tasks)
+{
+	rendering::Task::List list;
+	for(std::vector<rendering::Task::Handle>::const_iterator i = tasks.begin(); i != tasks.end(); ++i)
+		if (*i) list.push_back(*i);
+	if (list.empty())
+		return;
+
+	rendering::Renderer::Handle renderer = rendering::Renderer::get_renderer(get_engine());
+	if (!renderer)
+		throw "Renderer '" + get_engine() + "' not found";
+	renderer->run(list);
+}
+
+bool
+synfig::Target_Scanline::call_renderer(
+	const etl::handle<rendering::SurfaceResource> &surface,
+	Canvas &canvas,
+	const ContextParams &context_params,
+	const RendDesc &renddesc )
+{
+	run_tasks(std::vector<rendering::Task::Handle>(1, build_task(surface, canvas, context_params, renddesc)));
 	return true;
 }
 
@@ -172,6 +197,9 @@ synfig::Target_Scanline::render(ProgressCallback *cb)
 			}
 			canvas->set_outline_grow(desc.get_outline_grow());
 
+			// bounds of layers are shared by all blocks of the frame
+			context_params.bounds_cache.reset(new BoundsCache());
+
 			// If quality is set otherwise, then we use the accelerated renderer
 			{
 				#if USE_PIXELRENDERING_LIMIT
@@ -324,6 +352,9 @@ synfig::Target_Scanline::render(ProgressCallback *cb)
 		}
 		canvas->set_outline_grow(desc.get_outline_grow());
 
+		// bounds of layers are shared by all blocks of the frame
+		context_params.bounds_cache.reset(new BoundsCache());
+
 		// If quality is set otherwise, then we use the accelerated renderer
 		{
 			#if USE_PIXELRENDERING_LIMIT
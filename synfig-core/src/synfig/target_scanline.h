@@ -31,6 +31,8 @@
 
 /* === H E A D E R S ======================================================= */
 
+#include <vector>
+
 #include "target.h"
 
 /* === M A C R O S ========================================================= */
@@ -41,7 +43,7 @@
 
 namespace synfig {
 
-namespace rendering { class SurfaceResource; }
+namespace rendering { class SurfaceResource; class Task; }
 
 /*!	\class Target_Scanline
 **	\brief This is a Target class that implements the render function
@@ -54,12 +56,17 @@ class Target_Scanline : public Target
 
 	String engine_;
 
-	bool call_renderer(
+protected:
+	//! Creates the surface and returns the task which renders the canvas into it
+	etl::handle<rendering::Task> build_task(
 		const etl::handle<rendering::SurfaceResource> &surface,
 		Canvas &canvas,
 		const ContextParams &context_params,
 		const RendDesc &renddesc );
 
+	//! Runs the tasks by the renderer selected for this target
+	void run_tasks(const std::vector< etl::handle<rendering::Task> > &tasks);
+
 public:
 	typedef etl::handle<Target_Scanline> Handle;
 	typedef etl::loose_handle<Target_Scanline> LooseHandle;
@@ -67,6 +74,14 @@ public:
 	//! Default constructor (threads = 2 current frame = 0)
 	Target_Scanline();
 
+	//! Renders the frame (or the part of the frame described by renddesc) into the surface
+	//! Public to let wrapping targets forward the call to the wrapped one
+	virtual bool call_renderer(
+		const etl::handle<rendering::SurfaceResource> &surface,
+		Canvas &canvas,
+		const ContextParams &context_params,
+		const RendDesc &renddesc );
+
 	//! Renders the canvas to the target
 	virtual bool render(ProgressCallback* cb = nullptr);
 
@@ -36,6 +36,7 @@
 
 #include <vector>
 #include <algorithm>
+#include <cmath>
 
 #include "synfig/clock.h"
 
@@ -134,7 +135,11 @@ synfig::Target_Tile::call_renderer(
 		#ifdef DEBUG_MEASURE
 		debug::Measure t("build rendering task");
 		#endif
-		task = canvas.build_rendering_task(context_params);
+		// layers outside of the tile will be skipped
+		ContextParams params(context_params);
+		params.render_rect = Rect(renddesc.get_tl(), renddesc.get_br())
+		                    .expand(std::max(std::fabs(renddesc.get_pw()), std::fabs(renddesc.get_ph())));
+		task = canvas.build_rendering_task(params);
 	}
 
 	if (task)
@@ -177,6 +182,9 @@ synfig::Target_Tile::render_frame_(Canvas::Handle canvas, ContextParams context_
 {
 	const RendDesc &rend_desc(desc);
 
+	// bounds of layers are shared by all tiles of the frame
+	context_params.bounds_cache.reset(new BoundsCache());
+
 	synfig::clock tile_timer;
 	tile_timer.reset();
 
@@ -29,6 +29,7 @@
 #define __SYNFIG_TARGETPARAM_H
 
 #include <string>
+#include <vector>
 
 /* === C L A S S E S & S T R U C T S ======================================= */
 
@@ -48,12 +49,23 @@ struct TargetParam
 	 *  its own valid default settings.
 	 */
 	TargetParam (const std::string& Video_codec = "none", int Bitrate = -1):
-		video_codec(Video_codec), bitrate(Bitrate), sequence_separator("."), offset_x(0), offset_y(0),rows(0),columns(0),append(true),dir(HR)
+		video_codec(Video_codec), bitrate(Bitrate), video_crf(-1), sequence_separator("."), tile_size(0), offset_x(0), offset_y(0),rows(0),columns(0),append(true),dir(HR)
 	{ }
 
 	std::string video_codec;
 	int bitrate;
+	//! Encoder preset (like "fast" or "slow"), empty for the encoder default
+	std::string video_preset;
+	//! Constant rate factor, negative for the encoder default
+	int video_crf;
 	std::string sequence_separator;
+	//! Compression of the image ("zip", "piz", "dwaa" etc.), empty for the target default
+	std::string compression;
+	//! Size of tiles for tiled images, 0 for scanline images
+	int tile_size;
+	//! Additional render passes, written as separate parts of the same image.
+	//! Each pass is "name=layer description" or "name=z_from:z_to"
+	std::vector<std::string> passes;
 	//TODO: It is a spike. Need to separate this class.
 	int offset_x;
 	int offset_y;
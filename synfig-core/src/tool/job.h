@@ -47,6 +47,11 @@ struct Job
 	bool list_canvases;
 	bool extract_alpha;
 
+	/// Strip of the frame to render when the frame is split among
+	/// several processes (see Target_TileShard), unused when tile_count is zero
+	int tile_index;
+	int tile_count;
+
 	bool
 		canvas_info,
 		canvas_info_all,
@@ -82,6 +87,8 @@ struct Job
 		sifout(false),
 		list_canvases(),
 		extract_alpha(false),
+		tile_index(),
+		tile_count(),
 		canvas_info(),
 		canvas_info_all(),
 		canvas_info_time_start(),
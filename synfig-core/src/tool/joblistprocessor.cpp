@@ -51,6 +51,7 @@
 #include "synfigtoolexception.h"
 #include "renderprogress.h"
 #include "joblistprocessor.h"
+#include "tileshard.h"
 
 #include <giomm/file.h>
 #include <glib/gstdio.h>
@@ -101,6 +102,22 @@ bool setup_job(Job& job, const TargetParam& target_parameters)
 {
 	VERBOSE_OUT(4) << _("Attempting to determine target/outfile...") << std::endl;
 
+	// Tiles are always written as raw strips, to be merged later,
+	// the target of the final image is given to --merge
+	if (job.tile_count > 0)
+	{
+		if (!job.target_name.empty() && job.target_name != "tile-shard")
+		{
+			synfig::error(_("Target \"%s\" can not be used with --tile-shard, give it to --merge instead"), job.target_name.c_str());
+			synfig::error(_("Throwing out job..."));
+			return false;
+		}
+		job.target_name = "tile-shard";
+		if (job.outfilename.empty())
+			job.outfilename = replace_extension(job.filename,
+				strprintf("%d-%d.sfrt", job.tile_index, job.tile_count));
+	}
+
 	// If the target type is not yet defined,
 	// try to figure it out from the outfile.
 	if(job.target_name.empty() && !job.outfilename.empty())
@@ -173,10 +190,16 @@ bool setup_job(Job& job, const TargetParam& target_parameters)
 	}
 
 	VERBOSE_OUT(4) << _("Creating the target...") << std::endl;
-	job.target =
-		synfig::Target::create(job.target_name,
-							   job.outfilename,
-							   target_parameters);
+	if (job.tile_count > 0)
+		job.target = new Target_TileShard(job.outfilename,
+										  job.tile_index,
+										  job.tile_count,
+										  target_parameters.sequence_separator);
+	else
+		job.target =
+			synfig::Target::create(job.target_name,
+								   job.outfilename,
+								   target_parameters);
 
 	if(job.target_name == "sif")
 		job.sifout=true;
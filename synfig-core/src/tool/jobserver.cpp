@@ -0,0 +1,491 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file tool/jobserver.cpp
+**	\brief Synfig Tool Batch Render Server
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+#include <synfig/general.h>
+#include <synfig/localization.h>
+#include <synfig/canvasfilenaming.h>
+#include <synfig/filesystemnative.h>
+#include <synfig/loadcanvas.h>
+#include <synfig/savecanvas.h>
+#include <synfig/target.h>
+
+#include "definitions.h"
+#include "job.h"
+#include "joblistprocessor.h"
+#include "jobserver.h"
+
+#include <glib/gstdio.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#endif
+
+using namespace synfig;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double seconds_since(const Clock::time_point& start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+std::string field(const JobServer::Fields& fields, const std::string& name)
+{
+	JobServer::Fields::const_iterator i = fields.find(name);
+	return i == fields.end() ? std::string() : i->second;
+}
+
+void send(std::ostream& out, const std::string& id, const std::string& event, const std::string& extra = std::string())
+{
+	out << "{\"id\": \"" << JobServer::escape(id) << "\", \"event\": \"" << event << "\"";
+	if (!extra.empty())
+		out << ", " << extra;
+	out << "}" << std::endl;
+}
+
+void send_error(std::ostream& out, const std::string& id, const std::string& message)
+{
+	send(out, id, "done", "\"status\": \"error\", \"message\": \"" + JobServer::escape(message) + "\"");
+}
+
+/// Streams the progress of one job
+class ServerProgress : public synfig::ProgressCallback
+{
+	std::ostream& out;
+	std::string id;
+	int last_percent;
+
+public:
+	ServerProgress(std::ostream& out, const std::string& id):
+		out(out), id(id), last_percent(-1) { }
+
+	virtual bool task(const std::string& /*task*/)
+		{ return true; }
+
+	virtual bool error(const std::string& task)
+	{
+		send(out, id, "error", "\"message\": \"" + JobServer::escape(task) + "\"");
+		return true;
+	}
+
+	virtual bool warning(const std::string& task)
+	{
+		send(out, id, "warning", "\"message\": \"" + JobServer::escape(task) + "\"");
+		return true;
+	}
+
+	virtual bool amount_complete(int current, int total)
+	{
+		int percent = total > 0 ? 100*current/total : 0;
+		if (percent != last_percent) {
+			last_percent = percent;
+			send(out, id, "progress", strprintf("\"current\": %d, \"total\": %d", current, total));
+		}
+		return true;
+	}
+};
+
+/// Writes into a stdio stream without owning it
+class FileStreamBuf : public std::streambuf
+{
+	FILE* file;
+
+public:
+	explicit FileStreamBuf(FILE* file): file(file) { }
+
+protected:
+	virtual int_type overflow(int_type c)
+	{
+		if (traits_type::eq_int_type(c, traits_type::eof()))
+			return traits_type::not_eof(c);
+		return std::fputc(c, file) == EOF ? traits_type::eof() : c;
+	}
+
+	virtual std::streamsize xsputn(const char* s, std::streamsize n)
+		{ return (std::streamsize)std::fwrite(s, 1, (size_t)n, file); }
+
+	virtual int sync()
+		{ return std::fflush(file) == 0 ? 0 : -1; }
+};
+
+class Parser
+{
+	const std::string& s;
+	size_t pos;
+
+public:
+	explicit Parser(const std::string& s): s(s), pos(0) { }
+
+	void skip_spaces()
+		{ while(pos < s.size() && isspace((unsigned char)s[pos])) ++pos; }
+
+	bool eof()
+		{ skip_spaces(); return pos >= s.size(); }
+
+	bool accept(char c)
+	{
+		skip_spaces();
+		if (pos < s.size() && s[pos] == c) { ++pos; return true; }
+		return false;
+	}
+
+	static void append_utf8(std::string& str, unsigned int code)
+	{
+		if (code < 0x80) {
+			str += (char)code;
+		} else
+		if (code < 0x800) {
+			str += (char)(0xC0 | (code >> 6));
+			str += (char)(0x80 | (code & 0x3F));
+		} else {
+			str += (char)(0xE0 | (code >> 12));
+			str += (char)(0x80 | ((code >> 6) & 0x3F));
+			str += (char)(0x80 | (code & 0x3F));
+		}
+	}
+
+	bool string(std::string& out)
+	{
+		if (!accept('"')) return false;
+		out.clear();
+		while(pos < s.size()) {
+			char c = s[pos++];
+			if (c == '"') return true;
+			if (c != '\\') { out += c; continue; }
+			if (pos >= s.size()) return false;
+			c = s[pos++];
+			switch(c) {
+			case 'b': out += '\b'; break;
+			case 'f': out += '\f'; break;
+			case 'n': out += '\n'; break;
+			case 'r': out += '\r'; break;
+			case 't': out += '\t'; break;
+			case 'u':
+				if (pos + 4 > s.size()) return false;
+				append_utf8(out, (unsigned int)strtoul(s.substr(pos, 4).c_str(), nullptr, 16));
+				pos += 4;
+				break;
+			default: out += c; break;
+			}
+		}
+		return false;
+	}
+
+	bool value(std::string& out)
+	{
+		skip_spaces();
+		if (pos < s.size() && s[pos] == '"')
+			return string(out);
+		size_t begin = pos;
+		while(pos < s.size() && s[pos] != ',' && s[pos] != '}' && !isspace((unsigned char)s[pos]))
+			++pos;
+		out = s.substr(begin, pos - begin);
+		if (out == "null") out.clear();
+		return begin < pos;
+	}
+};
+
+} // end of anonymous namespace
+
+JobServer::JobServer(const TargetParam& target_params, int max_cached_files):
+	target_params(target_params),
+	max_cached_files(max_cached_files)
+{ }
+
+bool
+JobServer::parse_fields(const std::string& line, Fields& fields, std::string& error)
+{
+	Parser p(line);
+	fields.clear();
+	if (!p.accept('{'))
+		{ error = _("Expected JSON object"); return false; }
+	if (p.accept('}'))
+		return p.eof();
+
+	do {
+		std::string key, value;
+		if (!p.string(key))
+			{ error = _("Expected string key"); return false; }
+		if (!p.accept(':'))
+			{ error = strprintf(_("Expected ':' after \"%s\""), key.c_str()); return false; }
+		if (!p.value(value))
+			{ error = strprintf(_("Expected value of \"%s\""), key.c_str()); return false; }
+		fields[key] = value;
+	} while(p.accept(','));
+
+	if (!p.accept('}') || !p.eof())
+		{ error = _("Expected end of JSON object"); return false; }
+	return true;
+}
+
+std::string
+JobServer::escape(const std::string& str)
+{
+	std::string result;
+	for(std::string::const_iterator i = str.begin(); i != str.end(); ++i) {
+		switch(*i) {
+		case '"':  result += "\\\""; break;
+		case '\\': result += "\\\\"; break;
+		case '\n': result += "\\n";  break;
+		case '\r': result += "\\r";  break;
+		case '\t': result += "\\t";  break;
+		default:
+			if ((unsigned char)*i < 0x20)
+				result += strprintf("\\u%04x", (int)(unsigned char)*i);
+			else
+				result += *i;
+		}
+	}
+	return result;
+}
+
+Canvas::Handle
+JobServer::open_file(const std::string& filename, bool& cached)
+{
+	cached = false;
+
+	GStatBuf stat_buf;
+	std::time_t mtime = g_stat(filename.c_str(), &stat_buf) == 0 ? stat_buf.st_mtime : 0;
+
+	for(std::list<CachedFile>::iterator i = cache.begin(); i != cache.end(); ++i) {
+		if (i->filename != filename) continue;
+		if (i->mtime != mtime) {
+			// file was changed since last load
+			cache.erase(i);
+			break;
+		}
+		cache.splice(cache.begin(), cache, i);
+		cached = true;
+		return cache.front().root;
+	}
+
+	std::string errors, warnings;
+	Canvas::Handle root;
+	if (FileSystem::Handle file_system = CanvasFileNaming::make_filesystem(filename))
+	{
+		FileSystem::Identifier identifier = file_system->get_identifier(CanvasFileNaming::project_file(filename));
+		root = open_canvas_as(identifier, filename, errors, warnings);
+	}
+	if (!root)
+		return root;
+
+	CachedFile entry;
+	entry.filename = filename;
+	entry.mtime = mtime;
+	entry.root = root;
+	cache.push_front(entry);
+	while((int)cache.size() > std::max(max_cached_files, 1))
+		cache.pop_back();
+	return root;
+}
+
+void
+JobServer::process_job(const Fields& fields, std::ostream& out)
+{
+	const std::string id = field(fields, "id");
+	Clock::time_point start = Clock::now();
+
+	Job job;
+	job.filename = field(fields, "file");
+	if (job.filename.empty())
+		{ send_error(out, id, _("No input file provided.")); return; }
+
+	bool cached = false;
+	job.root = open_file(job.filename, cached);
+	if (!job.root)
+		{ send_error(out, id, strprintf(_("Unable to load file '%s'."), job.filename.c_str())); return; }
+	job.canvas = job.root;
+	job.root->set_time(0);
+
+	std::string canvas_id = field(fields, "canvas");
+	if (!canvas_id.empty())
+	{
+		try
+		{
+			std::string warnings;
+			job.canvas = job.root->find_canvas(canvas_id, warnings);
+		}
+		catch(std::exception&)
+		{
+			send_error(out, id, strprintf(_("Unable to find canvas with ID \"%s\" in %s."),
+				canvas_id.c_str(), job.filename.c_str()));
+			return;
+		}
+	}
+	double load_time = seconds_since(start);
+
+	job.target_name = field(fields, "target");
+	job.outfilename = field(fields, "output");
+	int quality = atoi(field(fields, "quality").c_str());
+	job.quality = quality > 0 ? quality : DEFAULT_QUALITY;
+
+	// the same canvas is used by next jobs, so its RendDesc must be restored
+	RendDesc original_desc = job.canvas->rend_desc();
+	RendDesc desc = original_desc;
+
+	int antialias = atoi(field(fields, "antialias").c_str());
+	if (antialias > 0)
+		desc.set_antialias(antialias);
+	double fps = atof(field(fields, "fps").c_str());
+	if (fps > 0)
+		desc.set_frame_rate(fps);
+	std::string time = field(fields, "begin-time");
+	if (!time.empty())
+		desc.set_time_start(Time(time.c_str(), desc.get_frame_rate()));
+	time = field(fields, "end-time");
+	if (!time.empty())
+		desc.set_time_end(Time(time.c_str(), desc.get_frame_rate()));
+	time = field(fields, "time");
+	if (!time.empty())
+		desc.set_time(Time(time.c_str(), desc.get_frame_rate()));
+	int w = atoi(field(fields, "width").c_str());
+	int h = atoi(field(fields, "height").c_str());
+	if (w > 0 || h > 0)
+	{
+		if (w <= 0)
+			w = desc.get_w() * h / desc.get_h();
+		else if (h <= 0)
+			h = desc.get_h() * w / desc.get_w();
+		desc.set_wh(w, h);
+	}
+	double span = atof(field(fields, "span").c_str());
+	if (span > 0)
+		desc.set_span(span);
+
+	job.desc = job.canvas->rend_desc() = desc;
+
+	bool success = false;
+	std::string message;
+	Clock::time_point render_start = Clock::now();
+	try
+	{
+		if (!setup_job(job, target_params))
+		{
+			message = strprintf(_("Unable to create output for \"%s\"."), job.outfilename.c_str());
+		}
+		else
+		if (job.sifout)
+		{
+			success = save_canvas(FileSystemNative::instance()->get_identifier(job.outfilename), job.canvas);
+		}
+		else
+		{
+			ServerProgress progress(out, id);
+			success = job.target->render(&progress);
+		}
+		if (!success && message.empty())
+			message = _("Render Failure.");
+	}
+	catch(std::exception& e)
+	{
+		message = e.what();
+	}
+	double render_time = seconds_since(render_start);
+
+	job.target = nullptr;
+	job.canvas->rend_desc() = original_desc;
+
+	if (!success)
+		{ send_error(out, id, message); return; }
+
+	send(out, id, "done", strprintf(
+		"\"status\": \"ok\", \"output\": \"%s\", \"cached\": %s, \"load_time\": %f, \"render_time\": %f, \"total_time\": %f",
+		escape(job.outfilename).c_str(),
+		cached ? "true" : "false",
+		load_time,
+		render_time,
+		seconds_since(start) ));
+}
+
+void
+JobServer::run(std::istream& in, std::ostream& out)
+{
+	send(out, "", "ready");
+
+	std::string line;
+	while(std::getline(in, line))
+	{
+		Fields fields;
+		std::string error;
+		if (line.find_first_not_of(" \t\r") == std::string::npos)
+			continue;
+		if (!parse_fields(line, fields, error))
+			{ send_error(out, "", error); continue; }
+
+		std::string command = field(fields, "command");
+		if (command == "quit")
+			break;
+		if (!command.empty() && command != "render")
+			{ send_error(out, field(fields, "id"), strprintf(_("Unknown command \"%s\"."), command.c_str())); continue; }
+
+		process_job(fields, out);
+	}
+}
+
+void
+JobServer::run_stdio()
+{
+	std::cout.flush();
+	std::fflush(stdout);
+
+	int protocol_fd = dup(fileno(stdout));
+	FILE* protocol = protocol_fd < 0 ? nullptr : fdopen(protocol_fd, "w");
+	if (!protocol)
+	{
+		synfig::warning(_("Unable to separate server output from log, using stdout for both"));
+		run(std::cin, std::cout);
+		return;
+	}
+	// log of the jobs goes to stderr only while the server runs
+	dup2(fileno(stderr), fileno(stdout));
+
+	FileStreamBuf buf(protocol);
+	std::ostream out(&buf);
+	run(std::cin, out);
+	out.flush();
+
+	// give the original stdout back to the rest of the tool
+	std::cout.flush();
+	std::fflush(stdout);
+	dup2(protocol_fd, fileno(stdout));
+	std::fclose(protocol);
+}
@@ -0,0 +1,83 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file tool/jobserver.h
+**	\brief Synfig Tool Batch Render Server
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+#ifndef __SYNFIG_JOBSERVER_H
+#define __SYNFIG_JOBSERVER_H
+
+#include <ctime>
+#include <iosfwd>
+#include <list>
+#include <map>
+#include <string>
+
+#include <synfig/canvas.h>
+#include <synfig/targetparam.h>
+
+/// Long-running mode of the tool (--server).
+/// Reads one job per line as a flat JSON object from the input stream,
+/// for example:
+///   {"id": "sh010", "file": "a.sifz", "canvas": "", "begin-time": "0", "end-time": "48",
+///    "target": "png", "output": "out/sh010.png", "width": 1920, "height": 1080}
+/// and writes progress and result of each job to the output stream as JSON lines.
+/// Modules stay loaded between jobs, and recently used files are kept in memory.
+/// The line {"command": "quit"} or the end of input stops the server.
+class JobServer
+{
+public:
+	typedef std::map<std::string, std::string> Fields;
+
+	JobServer(const synfig::TargetParam& target_params, int max_cached_files = 8);
+
+	/// Process jobs until end of input or "quit" command
+	void run(std::istream& in, std::ostream& out);
+
+	/// Process jobs from standard input.
+	/// The protocol keeps the original standard output for itself, everything else
+	/// printed there while rendering (synfig::info, targets) is sent to stderr.
+	/// Standard output is restored when the server stops.
+	void run_stdio();
+
+	/// Parse flat JSON object with string, number or boolean values
+	/// \return false and set error message when line is not such object
+	static bool parse_fields(const std::string& line, Fields& fields, std::string& error);
+
+	static std::string escape(const std::string& str);
+
+private:
+	struct CachedFile
+	{
+		std::string filename;
+		std::time_t mtime;
+		synfig::Canvas::Handle root;
+		CachedFile(): mtime() { }
+	};
+
+	synfig::TargetParam target_params;
+	int max_cached_files;
+	std::list<CachedFile> cache; ///< most recently used first
+
+	synfig::Canvas::Handle open_file(const std::string& filename, bool& cached);
+	void process_job(const Fields& fields, std::ostream& out);
+};
+
+#endif // __SYNFIG_JOBSERVER_H
@@ -56,6 +56,8 @@
 #include "synfigtoolexception.h"
 #include "optionsprocessor.h"
 #include "joblistprocessor.h"
+#include "jobserver.h"
+#include "tileshard.h"
 #include "printing_functions.h"
 
 #endif
@@ -274,6 +276,23 @@ int main(int argc, char* argv[])
 		// Info options -----------------------------------------------
 		parser.process_info_options();
 
+		// Batch render server -----------------------------------------
+		if (parser.is_server_mode())
+		{
+			JobServer server(parser.extract_targetparam());
+			server.run_stdio();
+			return SYNFIGTOOL_OK;
+		}
+
+		// Merge of tiles rendered with --tile-shard -------------------
+		if (parser.is_merge_mode())
+		{
+			std::vector<std::string> files;
+			Job job = parser.extract_merge_job(files);
+			merge_tile_shards(files, job, parser.extract_targetparam());
+			return SYNFIGTOOL_OK;
+		}
+
 		std::list<Job> job_list;
 
 		// Processing --------------------------------------------------
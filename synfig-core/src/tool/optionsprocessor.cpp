@@ -51,6 +51,7 @@
 #include "synfigtoolexception.h"
 #include "printing_functions.h"
 #include "optionsprocessor.h"
+#include "tileshard.h"
 #include <glibmm/init.h>
 #endif
 
@@ -98,12 +99,17 @@ SynfigCommandLineParser::SynfigCommandLineParser() :
 	set_input_file(),
 	set_output_file(),
 	set_sequence_separator(),
+	set_compression(),
+	set_tile_size(),
+	set_passes(),
 	set_canvas_id(),
 	set_fps(),
 	set_time(),
 	set_begin_time(),
 	set_start_time(),
 	set_end_time(),
+	set_shard(),
+	set_tile_shard(),
 	set_dpi(),
 	set_dpi_x(),
 	set_dpi_y(),
@@ -118,10 +124,14 @@ SynfigCommandLineParser::SynfigCommandLineParser() :
 	misc_append_filename(),
 	misc_canvas_info(),
 	misc_canvases(),
+	misc_server(),
+	misc_merge(),
 
 	//FFMPEG group
 	video_codec(),
 	video_bitrate(),
+	video_preset(),
+	video_crf(-1),
 
 	// Synfig info group
 	show_help(),
@@ -156,12 +166,17 @@ SynfigCommandLineParser::SynfigCommandLineParser() :
 	add_option(og_set, "input-file",  'i', set_input_file, 	_("Specify input filename"), "filename");
 	add_option(og_set, "output-file", 'o', set_output_file, _("Specify output filename"), "filename");
 	add_option(og_set, "sequence-separator", ' ', set_sequence_separator, _("Output file sequence separator string (Use double quotes if you want to use spaces)"), "string");
+	add_option(og_set, "compression", ' ', set_compression, _("Set compression of the output image: none, rle, zips, zip, piz, pxr24, b44, b44a, dwaa, dwab (openexr target)"), "method");
+	add_option(og_set, "tile-size",   ' ', set_tile_size,	_("Write tiled image with tiles of the given size (openexr target)"), "NUM");
+	add_option(og_set, "pass",        ' ', set_passes,		_("Also render the pass of the root layer with the given description, or of the root layers in the given z-depth range, into the separate part of the output image (openexr target, may be repeated)"), "name=description|name=from:to");
 	add_option(og_set, "canvas",      'c', set_canvas_id, 	_("Render the canvas with the given id instead of the root."), "id");
 	add_option(og_set, "fps",         ' ', set_fps, 		_("Set the frame rate"), "NUM");
 	add_option(og_set, "time",        ' ', set_time, 		_("Render a single frame at <seconds>"), "seconds");
 	add_option(og_set, "begin-time",  ' ', set_begin_time, 	_("Set the starting time"), "seconds");
 	add_option(og_set, "start-time",  ' ', set_start_time,	_("Set the starting time"), "seconds");
 	add_option(og_set, "end-time",    ' ', set_end_time, 	_("Set the ending time"), "seconds");
+	add_option(og_set, "shard",       ' ', set_shard, 		_("Render only the i-th of N equal parts of the frame range"), "i/N");
+	add_option(og_set, "tile-shard",  ' ', set_tile_shard, 	_("Render only the i-th of N horizontal strips of each frame, to be joined with --merge"), "i/N");
 	add_option(og_set, "dpi",         ' ', set_dpi, 		_("Set the physical resolution (Dots-per-inch)"), "NUM");
 	add_option(og_set, "dpi-x",       ' ', set_dpi_x, 		_("Set the physical X resolution (Dots-per-inch)"), "NUM");
 	add_option(og_set, "dpi-y",       ' ', set_dpi_y, 		_("Set the physical Y resolution (Dots-per-inch)"), "NUM");
@@ -177,10 +192,14 @@ SynfigCommandLineParser::SynfigCommandLineParser() :
 	add_option_filename(og_misc, "append", ' ', misc_append_filename, 	_("Append layers in <filename> to composition"), _("filename"));
 	add_option(og_misc, "canvas-info",     ' ', misc_canvas_info, 			_("Print out specified details of the root canvas"), _("fields"));
 	add_option(og_misc, "canvases",		   ' ', misc_canvases,				_("Print out the list of exported canvases in the composition"), "");
+	add_option(og_misc, "server",		   ' ', misc_server,				_("Read render jobs as JSON lines from standard input and keep loaded files between jobs"), "");
+	add_option(og_misc, "merge",		   ' ', misc_merge,					_("Merge the tile files given as arguments into the output file"), "");
 
 	//SynfigOptionGroup og_ffmpeg("ffmpeg", _("FFMPEG target options"), "Show FFMPEG target options help");
 	add_option(og_ffmpeg, "video-codec",   ' ', video_codec, 	_("Set the codec for the video. See --target-video-codecs"), _("codec"));
 	add_option(og_ffmpeg, "video-bitrate", ' ', video_bitrate,	_("Set the bitrate for the output video"), _("bitrate"));
+	add_option(og_ffmpeg, "video-preset",  ' ', video_preset,	_("Set the encoder preset for the output video (libav target)"), _("preset"));
+	add_option(og_ffmpeg, "video-crf",     ' ', video_crf,		_("Set the constant rate factor for the output video (libav target)"), _("crf"));
 
 	//SynfigOptionGroup og_info("info", _("Synfig info options"), "Show Synfig info options help");
 	add_option(og_info, "help",       ' ', show_help, 			_("Produce this help message"), "");
@@ -564,6 +583,23 @@ RendDesc SynfigCommandLineParser::extract_renddesc(const RendDesc& renddesc)
 					   << std::endl;
 	}
 
+	if (!set_shard.empty())
+	{
+		int index, count;
+		if (!parse_shard(set_shard, index, count))
+			throw SynfigToolException(SYNFIGTOOL_UNKNOWNARGUMENT,
+				strprintf(_("Invalid shard \"%s\", expected i/N."), set_shard.c_str()));
+
+		if (!apply_frame_shard(desc, index, count))
+		{
+			VERBOSE_OUT(1) << strprintf(_("Shard %d/%d has no frames to render."), index, count) << std::endl;
+			throw SynfigToolException(SYNFIGTOOL_OK);
+		}
+
+		VERBOSE_OUT(1) << strprintf(_("Shard %d/%d renders frames %d to %d."),
+			index, count, desc.get_frame_start(), desc.get_frame_end()) << std::endl;
+	}
+
 	if (w || h)
 	{
 		// scale properly
@@ -627,6 +663,16 @@ TargetParam SynfigCommandLineParser::extract_targetparam()
 		VERBOSE_OUT(1) << _("Target bitrate set to: ") << params.bitrate << "k."
 					   << std::endl;
 	}
+	if (!video_preset.empty())
+	{
+		params.video_preset = video_preset;
+		VERBOSE_OUT(1) << _("Target video preset set to: ") << params.video_preset << std::endl;
+	}
+	if (video_crf >= 0)
+	{
+		params.video_crf = video_crf;
+		VERBOSE_OUT(1) << _("Target video CRF set to: ") << params.video_crf << std::endl;
+	}
 	if (!set_sequence_separator.empty())
 	{
 		params.sequence_separator = set_sequence_separator;
@@ -635,6 +681,24 @@ TargetParam SynfigCommandLineParser::extract_targetparam()
                        << "'."
 					   << std::endl;
 	}
+	if (!set_compression.empty())
+	{
+		params.compression = set_compression;
+		VERBOSE_OUT(1) << _("Output image compression set to: ") << params.compression << std::endl;
+	}
+	if (set_tile_size > 0)
+	{
+		params.tile_size = set_tile_size;
+		VERBOSE_OUT(1) << _("Output image tile size set to: ") << params.tile_size << std::endl;
+	}
+	for (const Glib::ustring& pass : set_passes)
+	{
+		if (pass.find('=') == Glib::ustring::npos)
+			throw SynfigToolException(SYNFIGTOOL_UNKNOWNARGUMENT,
+			                          strprintf(_("Render pass \"%s\" should be in form name=description or name=from:to."), pass.c_str()));
+		params.passes.push_back(pass);
+		VERBOSE_OUT(1) << _("Render pass added: ") << pass << std::endl;
+	}
 
 	return params;
 }
@@ -709,6 +773,14 @@ Job SynfigCommandLineParser::extract_job()
 
 	VERBOSE_OUT(1) << _("Quality set to ") << job.quality << std::endl;
 
+	if (!set_tile_shard.empty())
+	{
+		if (!parse_shard(set_tile_shard, job.tile_index, job.tile_count))
+			throw SynfigToolException(SYNFIGTOOL_UNKNOWNARGUMENT,
+				strprintf(_("Invalid tile shard \"%s\", expected i/N."), set_tile_shard.c_str()));
+		VERBOSE_OUT(1) << strprintf(_("Rendering tile %d/%d"), job.tile_index, job.tile_count) << std::endl;
+	}
+
 	// WARNING: canvas must be before append
 
 	if (!set_canvas_id.empty())
@@ -798,6 +870,24 @@ Job SynfigCommandLineParser::extract_job()
 	return job;
 }
 
+Job SynfigCommandLineParser::extract_merge_job(std::vector<std::string>& files)
+{
+	Job job;
+
+	files.assign(remaining_options_list.begin(), remaining_options_list.end());
+	if (files.empty() && !set_input_file.empty())
+		files.push_back(set_input_file);
+
+	if (!set_target.empty())
+		job.target_name = set_target;
+	if (!set_output_file.empty())
+		job.outfilename = set_output_file;
+	if (set_quality > 0)
+		job.quality = set_quality;
+
+	return job;
+}
+
 void SynfigCommandLineParser::print_target_video_codecs_help() const
 {
 	for (std::vector<VideoCodec>::const_iterator itr = _allowed_video_codecs.begin();
@@ -73,6 +73,15 @@ public:
 
 	void print_target_video_codecs_help() const;
 
+	/// Whether jobs should be read from standard input (see JobServer)
+	bool is_server_mode() const { return misc_server; }
+
+	/// Whether tiles written with --tile-shard should be merged into one image
+	bool is_merge_mode() const { return misc_merge; }
+
+	/// Extract target, output and quality of the merge job, and the tile files to merge
+	Job extract_merge_job(std::vector<std::string>& files);
+
 #ifdef _DEBUG
 	void process_debug_options();
 #endif
@@ -107,12 +116,17 @@ private:
 	Glib::ustring	set_input_file;
 	Glib::ustring	set_output_file;
 	Glib::ustring	set_sequence_separator;
+	Glib::ustring	set_compression;
+	int				set_tile_size;
+	std::vector<Glib::ustring> set_passes;
 	Glib::ustring	set_canvas_id;
 	double			set_fps;
 	Glib::ustring	set_time;
 	Glib::ustring	set_begin_time;
 	Glib::ustring	set_start_time;
 	Glib::ustring	set_end_time;
+	Glib::ustring	set_shard;
+	Glib::ustring	set_tile_shard;
 	double			set_dpi;
 	double			set_dpi_x;
 	double			set_dpi_y;
@@ -127,10 +141,14 @@ private:
 	std::string		misc_append_filename;
 	Glib::ustring	misc_canvas_info;
 	bool			misc_canvases;
+	bool			misc_server;
+	bool			misc_merge;
 
 	//FFMPEG group
 	Glib::ustring	video_codec;
 	int				video_bitrate;
+	Glib::ustring	video_preset;
+	int				video_crf;
 
 	// Synfig info group
 	bool			show_help;
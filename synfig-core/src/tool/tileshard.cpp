@@ -0,0 +1,287 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file tool/tileshard.cpp
+**	\brief Synfig Tool Frame and Tile Sharding
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include <ETL/stringf>
+
+#include <synfig/general.h>
+#include <synfig/localization.h>
+#include <synfig/canvas.h>
+#include <synfig/surface.h>
+
+#include "definitions.h"
+#include "synfigtoolexception.h"
+#include "renderprogress.h"
+#include "joblistprocessor.h"
+#include "tileshard.h"
+
+#include <glib/gstdio.h>
+
+#endif
+
+using namespace synfig;
+
+/* === M A C R O S ========================================================= */
+
+#define TILE_SHARD_MAGIC "synfig-tile-shard 1"
+
+/* === M E T H O D S ======================================================= */
+
+bool parse_shard(const std::string& str, int& index, int& count)
+{
+	char tail = 0;
+	if (sscanf(str.c_str(), "%d/%d%c", &index, &count, &tail) != 2)
+		return false;
+	return count > 0 && index >= 1 && index <= count;
+}
+
+bool apply_frame_shard(RendDesc& desc, int index, int count)
+{
+	int start = desc.get_frame_start();
+	int total = std::max(desc.get_frame_end() - start + 1, 1);
+
+	int first = start + total*(index - 1)/count;
+	int last = start + total*index/count - 1;
+	if (last < first)
+		return false;
+
+	desc.set_frame_start(first);
+	desc.set_frame_end(last);
+	return true;
+}
+
+Target_TileShard::Target_TileShard(const std::string& filename, int index, int count, const std::string& sequence_separator):
+	filename(filename),
+	sequence_separator(sequence_separator),
+	index(index),
+	count(count),
+	row_offset(),
+	imagecount(),
+	multi_image(),
+	file()
+{ }
+
+Target_TileShard::~Target_TileShard()
+{
+	if (file)
+		fclose(file);
+}
+
+void
+Target_TileShard::get_rows(int height, int index, int count, int& y0, int& y1)
+{
+	y0 = height*(index - 1)/count;
+	y1 = height*index/count;
+}
+
+bool
+Target_TileShard::set_rend_desc(RendDesc* d)
+{
+	full_desc = *d;
+	desc = *d;
+
+	int y0, y1;
+	get_rows(full_desc.get_h(), index, count, y0, y1);
+	desc.set_subwindow(0, y0, full_desc.get_w(), y1 - y0);
+	row_offset = y0;
+
+	imagecount = desc.get_frame_start();
+	multi_image = desc.get_frame_end() - desc.get_frame_start() > 0;
+	return true;
+}
+
+bool
+Target_TileShard::start_frame(ProgressCallback* cb)
+{
+	if (file)
+		fclose(file);
+
+	std::string name = multi_image
+		? etl::filename_sans_extension(filename) + sequence_separator
+		  + strprintf("%04d", imagecount) + etl::filename_extension(filename)
+		: filename;
+	if (cb) cb->task(name);
+
+	file = g_fopen(name.c_str(), "wb");
+	if (!file)
+		return false;
+
+	const Point &tl = full_desc.get_tl();
+	const Point &br = full_desc.get_br();
+	fprintf(file, "%s\n%d %d %d %d %d\n%.17g %.17g %.17g %.17g\n",
+		TILE_SHARD_MAGIC,
+		full_desc.get_w(), full_desc.get_h(),
+		row_offset, row_offset + desc.get_h(),
+		imagecount,
+		tl[0], tl[1], br[0], br[1] );
+
+	buffer.resize(desc.get_w());
+	return true;
+}
+
+void
+Target_TileShard::end_frame()
+{
+	if (file)
+		fclose(file);
+	file = nullptr;
+	++imagecount;
+}
+
+Color*
+Target_TileShard::start_scanline(int /*scanline*/)
+{
+	return file ? &buffer.front() : nullptr;
+}
+
+bool
+Target_TileShard::end_scanline()
+{
+	return file && fwrite(&buffer.front(), sizeof(Color), buffer.size(), file) == buffer.size();
+}
+
+namespace {
+
+struct TileHeader
+{
+	int w, h, y0, y1, frame;
+	double tl_x, tl_y, br_x, br_y;
+
+	bool same_frame(const TileHeader& other) const
+	{
+		return w == other.w && h == other.h && frame == other.frame
+			&& tl_x == other.tl_x && tl_y == other.tl_y
+			&& br_x == other.br_x && br_y == other.br_y;
+	}
+};
+
+bool read_header(FILE* file, TileHeader& header)
+{
+	char magic[64] = {};
+	if (!fgets(magic, sizeof(magic), file) || strncmp(magic, TILE_SHARD_MAGIC "\n", sizeof(magic)))
+		return false;
+	if (fscanf(file, "%d %d %d %d %d", &header.w, &header.h, &header.y0, &header.y1, &header.frame) != 5)
+		return false;
+	if (fscanf(file, "%lf %lf %lf %lf", &header.tl_x, &header.tl_y, &header.br_x, &header.br_y) != 4)
+		return false;
+	// binary data starts right after the single line feed
+	if (fgetc(file) != '\n')
+		return false;
+	return header.w > 0 && header.h > 0 && 0 <= header.y0 && header.y0 <= header.y1 && header.y1 <= header.h;
+}
+
+} // end of anonymous namespace
+
+void merge_tile_shards(const std::vector<std::string>& files, Job& job, const TargetParam& target_parameters)
+{
+	if (files.empty())
+		throw SynfigToolException(SYNFIGTOOL_MISSINGARGUMENT, _("No tile files provided."));
+
+	Surface surface;
+	TileHeader frame = TileHeader();
+	std::vector<bool> rows;
+
+	for(std::vector<std::string>::const_iterator i = files.begin(); i != files.end(); ++i)
+	{
+		FILE* file = g_fopen(i->c_str(), "rb");
+		if (!file)
+			throw SynfigToolException(SYNFIGTOOL_FILENOTFOUND,
+				strprintf(_("Unable to open tile '%s'."), i->c_str()));
+
+		TileHeader header;
+		if (!read_header(file, header))
+		{
+			fclose(file);
+			throw SynfigToolException(SYNFIGTOOL_INVALIDJOB,
+				strprintf(_("File '%s' is not a tile shard."), i->c_str()));
+		}
+
+		if (rows.empty())
+		{
+			frame = header;
+			surface.set_wh(header.w, header.h);
+			rows.resize(header.h, false);
+		}
+		else
+		if (!frame.same_frame(header))
+		{
+			fclose(file);
+			throw SynfigToolException(SYNFIGTOOL_INVALIDJOB,
+				strprintf(_("Tile '%s' belongs to another frame or image size."), i->c_str()));
+		}
+
+		for(int y = header.y0; y < header.y1; ++y)
+		{
+			if (rows[y] || fread(surface[y], sizeof(Color), header.w, file) != (size_t)header.w)
+			{
+				fclose(file);
+				throw SynfigToolException(SYNFIGTOOL_INVALIDJOB,
+					strprintf(_("Tile '%s' overlaps other tiles or is truncated."), i->c_str()));
+			}
+			rows[y] = true;
+		}
+		fclose(file);
+
+		VERBOSE_OUT(2) << _("Merged tile ") << *i << std::endl;
+	}
+
+	for(int y = 0; y < (int)rows.size(); ++y)
+		if (!rows[y])
+			throw SynfigToolException(SYNFIGTOOL_INVALIDJOB,
+				strprintf(_("Row %d is not covered by the given tiles."), y));
+
+	// the target needs a canvas to take the RendDesc from
+	RendDesc desc;
+	desc.set_flags(0);
+	desc.set_wh(frame.w, frame.h);
+	desc.set_tl_br(Point(frame.tl_x, frame.tl_y), Point(frame.br_x, frame.br_y));
+
+	job.filename = files.front();
+	job.root = job.canvas = Canvas::create();
+	job.desc = job.canvas->rend_desc() = desc;
+
+	if (!setup_job(job, target_parameters))
+		throw SynfigToolException(SYNFIGTOOL_INVALIDTARGET);
+
+	Target_Scanline::Handle target = Target_Scanline::Handle::cast_dynamic(job.target);
+	if (!target)
+		throw SynfigToolException(SYNFIGTOOL_INVALIDTARGET,
+			strprintf(_("Target \"%s\" does not support merging of tiles."), job.target_name.c_str()));
+
+	RenderProgress p;
+	p.task(job.filename + " ==> " + job.outfilename);
+	if (!target->init(&p) || !target->add_frame(&surface, &p))
+		throw SynfigToolException(SYNFIGTOOL_RENDERFAILURE, _("Render Failure."));
+
+	VERBOSE_OUT(1) << _("Done.") << std::endl;
+}
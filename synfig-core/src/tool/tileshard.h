@@ -0,0 +1,82 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file tool/tileshard.h
+**	\brief Synfig Tool Frame and Tile Sharding
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+#ifndef __SYNFIG_TILESHARD_H
+#define __SYNFIG_TILESHARD_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <synfig/target_scanline.h>
+#include <synfig/targetparam.h>
+#include "job.h"
+
+/// Parse shard description "i/N" where 1 <= i <= N
+bool parse_shard(const std::string& str, int& index, int& count);
+
+/// Restrict frames of the RendDesc to the shard \a index of \a count.
+/// Frames are split into contiguous ranges of (almost) equal size.
+/// \return false if shard has no frames
+bool apply_frame_shard(synfig::RendDesc& desc, int index, int count);
+
+/// Writes one horizontal strip of each frame as raw float colors (*.sfrt).
+/// The strip is rendered through RendDesc::set_subwindow() like the
+/// large frames in Target_Scanline, so merged strips are bit-exact
+/// to the single-process render.
+class Target_TileShard : public synfig::Target_Scanline
+{
+public:
+	typedef etl::handle<Target_TileShard> Handle;
+
+	Target_TileShard(const std::string& filename, int index, int count, const std::string& sequence_separator);
+	~Target_TileShard();
+
+	bool set_rend_desc(synfig::RendDesc* d) override;
+	bool start_frame(synfig::ProgressCallback* cb = nullptr) override;
+	void end_frame() override;
+	synfig::Color* start_scanline(int scanline) override;
+	bool end_scanline() override;
+
+	/// Rows [y0, y1) of the full frame rendered by the shard
+	static void get_rows(int height, int index, int count, int& y0, int& y1);
+
+private:
+	std::string filename;
+	std::string sequence_separator;
+	int index;
+	int count;
+	int row_offset;
+	int imagecount;
+	bool multi_image;
+	synfig::RendDesc full_desc;
+	std::vector<synfig::Color> buffer;
+	FILE* file;
+};
+
+/// Assemble tiles written by Target_TileShard into one frame,
+/// and write it to the target of the \a job
+void merge_tile_shards(const std::vector<std::string>& files, Job& job,
+					   const synfig::TargetParam& target_parameters);
+
+#endif // __SYNFIG_TILESHARD_H
@@ -24,18 +24,24 @@
 
 /* === H E A D E R S ======================================================= */
 
+#include <cmath>
 #include <cstdio>
 
 #include <synfig/angle.h>
 #include <synfig/bezier.h>
 #include <synfig/clock.h>
+#include <synfig/surface.h>
 #include <synfig/surface_etl.h>
+#include <synfig/rendering/primitive/contour.h>
+#include <synfig/rendering/primitive/polyspan.h>
+#include <synfig/rendering/software/function/contour.h>
 
 /* === M A C R O S ========================================================= */
 
 using namespace synfig;
 
 #define HERMITE_TEST_ITERATIONS		(100000)
+#define CONTOUR_TEST_SIZE			(1024)
 
 /* === C L A S S E S ======================================================= */
 
@@ -281,6 +287,70 @@ int hermite_angle_test(void)
 	return ret;
 }
 
+int contour_rasterization_test(void)
+{
+	using namespace synfig::rendering;
+
+	// dense star, every row of the surface is crossed by many edges
+	Contour contour;
+	const int count = 3000;
+	const Real c = 0.5*CONTOUR_TEST_SIZE;
+	for(int i = 0; i <= count; ++i) {
+		Real a = 2.0*M_PI*i/count;
+		Real r = (i % 2 ? 0.2 : 0.48)*CONTOUR_TEST_SIZE;
+		Vector p(c + r*cos(a) + 0.37, c + r*sin(a) + 0.21);
+		if (i) contour.line_to(p); else contour.move_to(p);
+	}
+	contour.close();
+
+	const RectInt window(0, 0, CONTOUR_TEST_SIZE, CONTOUR_TEST_SIZE);
+	Rect bounds = contour.calc_bounds(Matrix());
+	bounds.expand(1.0);
+	const RectInt rect((int)floor(bounds.minx), (int)floor(bounds.miny), (int)ceil(bounds.maxx), (int)ceil(bounds.maxy));
+
+	Surface sorted(CONTOUR_TEST_SIZE, CONTOUR_TEST_SIZE);
+	Surface accumulated(CONTOUR_TEST_SIZE, CONTOUR_TEST_SIZE);
+	sorted.clear();
+	accumulated.clear();
+
+	synfig::clock timer;
+	double t;
+
+	timer.reset();
+	{
+		Polyspan polyspan;
+		polyspan.init(window);
+		software::Contour::build_polyspan(contour.get_chunks(), Matrix(), polyspan);
+		polyspan.close();
+		polyspan.sort_marks();
+		software::Contour::render_polyspan(sorted, polyspan, false, true, Contour::WINDING_NON_ZERO, Color::white(), 1.0, Color::BLEND_COMPOSITE);
+	}
+	t=timer();
+	fprintf(stderr,"contour<sorted>:time=%f milliseconds\n",t*1000);
+
+	timer.reset();
+	{
+		Polyspan polyspan;
+		polyspan.init_accumulation(window, rect);
+		software::Contour::build_polyspan(contour.get_chunks(), Matrix(), polyspan);
+		polyspan.close();
+		polyspan.sort_marks();
+		software::Contour::render_polyspan(accumulated, polyspan, false, true, Contour::WINDING_NON_ZERO, Color::white(), 1.0, Color::BLEND_COMPOSITE);
+	}
+	t=timer();
+	fprintf(stderr,"contour<accumulation>:time=%f milliseconds\n",t*1000);
+
+	// both ways should produce the same image, up to rounding
+	for(int y = 0; y < CONTOUR_TEST_SIZE; ++y)
+		for(int x = 0; x < CONTOUR_TEST_SIZE; ++x)
+			if (std::fabs(sorted[y][x].get_a() - accumulated[y][x].get_a()) > 1e-5) {
+				fprintf(stderr,"contour: different alpha at %d, %d\n", x, y);
+				return 1;
+			}
+
+	return 0;
+}
+
 
 /* === E N T R Y P O I N T ================================================= */
 
@@ -292,6 +362,7 @@ int main()
 	error+=hermite_double_test();
 	error+=hermite_int_test();
 	error+=hermite_angle_test();
+	error+=contour_rasterization_test();
 
 	return error;
 }
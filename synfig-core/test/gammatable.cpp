@@ -0,0 +1,124 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file gammatable.cpp
+**	\brief Test lookup tables of gamma correction
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#include <vector>
+
+#include <synfig/color/gammatable.h>
+
+#include "test_base.h"
+
+/* === M A C R O S ========================================================= */
+
+using namespace synfig;
+
+/* === P R O C E D U R E S ================================================= */
+
+static const Gamma test_gamma(2.2f, 1.8f, 1.f);
+
+void
+test_same_configuration_shares_table()
+{
+	GammaTable::Handle a = GammaTable::get(test_gamma, 8);
+	GammaTable::Handle b = GammaTable::get(test_gamma, 8);
+	GammaTable::Handle c = GammaTable::get(test_gamma, 16);
+	ASSERT(a == b)
+	ASSERT(a != c)
+}
+
+void
+test_8bit_rgba_row_matches_gamma_apply()
+{
+	const int width = 256;
+	std::vector<unsigned char> src(width*4);
+	for(int x = 0; x < width; ++x) {
+		src[x*4 + 0] = (unsigned char)x;
+		src[x*4 + 1] = (unsigned char)(255 - x);
+		src[x*4 + 2] = (unsigned char)(x*7);
+		src[x*4 + 3] = (unsigned char)(x/2);
+	}
+
+	std::vector<Color> dst(width);
+	GammaTable::get(test_gamma, 8)->convert_row(&dst.front(), &src.front(), width, 4);
+
+	const ColorReal k = 1/255.0;
+	for(int x = 0; x < width; ++x) {
+		Color expected = test_gamma.apply(Color(k*src[x*4 + 0], k*src[x*4 + 1], k*src[x*4 + 2], k*src[x*4 + 3]));
+		ASSERT_APPROX_EQUAL_MICRO(expected.get_r(), dst[x].get_r())
+		ASSERT_APPROX_EQUAL_MICRO(expected.get_g(), dst[x].get_g())
+		ASSERT_APPROX_EQUAL_MICRO(expected.get_b(), dst[x].get_b())
+		ASSERT_APPROX_EQUAL_MICRO(expected.get_a(), dst[x].get_a())
+	}
+}
+
+void
+test_16bit_gray_row_matches_gamma_apply()
+{
+	const int width = 1000;
+	std::vector<unsigned char> src(width*2);
+	for(int x = 0; x < width; ++x) {
+		unsigned int value = x*65;
+		src[x*2 + 0] = (unsigned char)(value >> 8);
+		src[x*2 + 1] = (unsigned char)(value & 0xff);
+	}
+
+	std::vector<Color> dst(width);
+	GammaTable::get(test_gamma, 16)->convert_row_be16(&dst.front(), &src.front(), width, 1);
+
+	const ColorReal k = 1/65535.0;
+	for(int x = 0; x < width; ++x) {
+		ColorReal gray = k*(x*65);
+		Color expected = test_gamma.apply(Color(gray, gray, gray));
+		ASSERT_APPROX_EQUAL_MICRO(expected.get_r(), dst[x].get_r())
+		ASSERT_APPROX_EQUAL_MICRO(expected.get_g(), dst[x].get_g())
+		ASSERT_APPROX_EQUAL_MICRO(expected.get_b(), dst[x].get_b())
+		ASSERT_APPROX_EQUAL_MICRO(ColorReal(1), dst[x].get_a())
+	}
+}
+
+void
+test_low_bit_depth_uses_full_range()
+{
+	const unsigned char src[] = { 0, 1, 2, 3 };
+	Color dst[4];
+	GammaTable::get(Gamma(), 2)->convert_row(dst, src, 4, 1);
+	ASSERT_APPROX_EQUAL_MICRO(ColorReal(0), dst[0].get_r())
+	ASSERT_APPROX_EQUAL_MICRO(ColorReal(1/3.0), dst[1].get_r())
+	ASSERT_APPROX_EQUAL_MICRO(ColorReal(2/3.0), dst[2].get_r())
+	ASSERT_APPROX_EQUAL_MICRO(ColorReal(1), dst[3].get_r())
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main() {
+
+	TEST_SUITE_BEGIN()
+	TEST_FUNCTION(test_same_configuration_shares_table)
+	TEST_FUNCTION(test_8bit_rgba_row_matches_gamma_apply)
+	TEST_FUNCTION(test_16bit_gray_row_matches_gamma_apply)
+	TEST_FUNCTION(test_low_bit_depth_uses_full_range)
+	TEST_SUITE_END()
+
+	return tst_exit_status;
+}
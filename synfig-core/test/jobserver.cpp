@@ -0,0 +1,204 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file jobserver.cpp
+**	\brief Test the batch render server of the command line tool
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <synfig/main.h>
+
+#include "../src/tool/jobserver.h"
+
+#include "test_base.h"
+
+/* === M A C R O S ========================================================= */
+
+using namespace synfig;
+
+/* === P R O C E D U R E S ================================================= */
+
+static const char* sif_filename = "test_jobserver.sif";
+
+static void write_test_file()
+{
+	std::ofstream file(sif_filename);
+	file << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	        "<canvas version=\"1.2\" width=\"32\" height=\"24\" xres=\"2834.645669\" yres=\"2834.645669\""
+	        " view-box=\"-1 0.75 1 -0.75\" antialias=\"1\" fps=\"24\" begin-time=\"0f\" end-time=\"2f\""
+	        " bgcolor=\"0.5 0.5 0.5 1\">\n"
+	        "</canvas>\n";
+}
+
+static std::vector<std::string> split_lines(const std::string& str)
+{
+	std::vector<std::string> lines;
+	std::istringstream stream(str);
+	std::string line;
+	while(std::getline(stream, line))
+		lines.push_back(line);
+	return lines;
+}
+
+static bool contains(const std::string& str, const std::string& part)
+{
+	return str.find(part) != std::string::npos;
+}
+
+void test_parse_fields()
+{
+	JobServer::Fields fields;
+	std::string error;
+	ASSERT(JobServer::parse_fields("{\"id\": \"a\\\"b\", \"width\": 64, \"canvas\": null}", fields, error));
+	ASSERT_EQUAL(std::string("a\"b"), fields["id"]);
+	ASSERT_EQUAL(std::string("64"), fields["width"]);
+	ASSERT_EQUAL(std::string(), fields["canvas"]);
+	ASSERT(!JobServer::parse_fields("{\"id\" \"a\"}", fields, error));
+	ASSERT(!error.empty());
+}
+
+void test_render_one_job()
+{
+	write_test_file();
+
+	std::istringstream in(
+		std::string("{\"id\": \"sh010\", \"file\": \"") + sif_filename + "\", \"target\": \"null\", "
+		"\"output\": \"test_jobserver.null\", \"width\": 16}\n"
+		"{\"id\": \"sh020\", \"file\": \"" + sif_filename + "\", \"target\": \"null\", "
+		"\"output\": \"test_jobserver.null\"}\n"
+		"{\"id\": \"bad\", \"file\": \"test_jobserver_missing.sif\"}\n"
+		"{\"command\": \"quit\"}\n"
+		"{\"id\": \"after-quit\", \"file\": \"" + sif_filename + "\"}\n" );
+	std::ostringstream out;
+
+	TargetParam params;
+	JobServer server(params);
+	server.run(in, out);
+
+	std::vector<std::string> lines = split_lines(out.str());
+	ASSERT(!lines.empty());
+	ASSERT(contains(lines.front(), "\"event\": \"ready\""));
+
+	std::vector<std::string> done;
+	for(std::vector<std::string>::const_iterator i = lines.begin(); i != lines.end(); ++i) {
+		ASSERT_EQUAL('{', (*i)[0]);
+		if (contains(*i, "\"event\": \"done\""))
+			done.push_back(*i);
+	}
+	ASSERT_EQUAL(3, (int)done.size());
+
+	ASSERT(contains(done[0], "\"id\": \"sh010\""));
+	ASSERT(contains(done[0], "\"status\": \"ok\""));
+	ASSERT(contains(done[0], "\"cached\": false"));
+
+	// second job takes the file loaded by the first one
+	ASSERT(contains(done[1], "\"id\": \"sh020\""));
+	ASSERT(contains(done[1], "\"status\": \"ok\""));
+	ASSERT(contains(done[1], "\"cached\": true"));
+
+	ASSERT(contains(done[2], "\"id\": \"bad\""));
+	ASSERT(contains(done[2], "\"status\": \"error\""));
+
+	std::remove(sif_filename);
+}
+
+#ifndef _WIN32
+void test_stdio_keeps_protocol_separate()
+{
+	write_test_file();
+
+	const char* jobs_filename = "test_jobserver_jobs.txt";
+	const char* protocol_filename = "test_jobserver_protocol.txt";
+	{
+		// no target name, so the job logs which target it has chosen
+		std::ofstream jobs(jobs_filename);
+		jobs << "{\"id\": \"sh010\", \"file\": \"" << sif_filename << "\", \"output\": \"test_jobserver.null\"}\n";
+	}
+
+	std::cout.flush();
+	int saved_stdout = dup(fileno(stdout));
+	int protocol_fd = open(protocol_filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	ASSERT(saved_stdout >= 0 && protocol_fd >= 0);
+	dup2(protocol_fd, fileno(stdout));
+	close(protocol_fd);
+	ASSERT(std::freopen(jobs_filename, "r", stdin));
+
+	TargetParam params;
+	JobServer server(params);
+	server.run_stdio();
+
+	// stdout is not redirected to stderr after the server stops
+	std::cout << "after server" << std::endl;
+	std::cout.flush();
+	dup2(saved_stdout, fileno(stdout));
+	close(saved_stdout);
+	std::cin.clear();
+
+	std::ifstream protocol(protocol_filename);
+	std::stringstream content;
+	content << protocol.rdbuf();
+	std::vector<std::string> lines = split_lines(content.str());
+
+	ASSERT(!lines.empty());
+	ASSERT_EQUAL(std::string("after server"), lines.back());
+	lines.pop_back();
+
+	// only JSON lines of the protocol, the log went to stderr
+	ASSERT(lines.size() >= 2);
+	ASSERT(contains(lines.front(), "\"event\": \"ready\""));
+	ASSERT(contains(lines.back(), "\"event\": \"done\""));
+	ASSERT(contains(lines.back(), "\"status\": \"ok\""));
+	for(std::vector<std::string>::const_iterator i = lines.begin(); i != lines.end(); ++i) {
+		ASSERT_EQUAL('{', (*i)[0]);
+		ASSERT(!contains(*i, "target name not specified"));
+	}
+
+	std::remove(jobs_filename);
+	std::remove(protocol_filename);
+	std::remove(sif_filename);
+}
+#endif
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main() {
+	Main main(".");
+
+	TEST_SUITE_BEGIN()
+	TEST_FUNCTION(test_parse_fields)
+	TEST_FUNCTION(test_render_one_job)
+#ifndef _WIN32
+	TEST_FUNCTION(test_stdio_keeps_protocol_separate)
+#endif
+	TEST_SUITE_END()
+
+	return tst_exit_status;
+}
@@ -0,0 +1,347 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file optimizers.cpp
+**	\brief Test optimizers of the rendering task tree
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#include <cmath>
+#include <vector>
+
+#include <synfig/main.h>
+#include <synfig/rendering/renderer.h>
+#include <synfig/rendering/common/optimizer/optimizercontour.h>
+#include <synfig/rendering/common/optimizer/optimizerinstances.h>
+#include <synfig/rendering/common/optimizer/optimizerpixelprocessor.h>
+#include <synfig/rendering/common/task/taskblend.h>
+#include <synfig/rendering/common/task/taskblur.h>
+#include <synfig/rendering/common/task/taskcontour.h>
+#include <synfig/rendering/common/task/taskpixelprocessor.h>
+#include <synfig/rendering/common/task/tasktransformation.h>
+#include <synfig/rendering/software/surfacesw.h>
+
+#include "test_base.h"
+
+/* === M A C R O S ========================================================= */
+
+using namespace synfig;
+using namespace rendering;
+
+/* === P R O C E D U R E S ================================================= */
+
+static const int width = 64;
+static const int height = 32;
+
+static const Renderer::Handle& get_renderer()
+{
+	const Renderer::Handle &renderer = Renderer::get_renderer("software");
+	ASSERT(renderer);
+	return renderer;
+}
+
+static SurfaceResource::Handle create_target()
+{
+	SurfaceResource::Handle surface = new SurfaceResource();
+	surface->create(width, height);
+	return surface;
+}
+
+static void set_root_coords(const Task::Handle &task, const SurfaceResource::Handle &surface)
+{
+	task->target_surface = surface;
+	task->target_rect = RectInt(0, 0, width, height);
+	task->source_rect = Rect(-2.0, -1.0, 2.0, 1.0);
+}
+
+static Task::Handle create_square(const Color &color)
+{
+	Contour::Handle contour = new Contour();
+	contour->move_to(Vector(-0.3, -0.3));
+	contour->line_to(Vector( 0.3, -0.3));
+	contour->line_to(Vector( 0.3,  0.3));
+	contour->line_to(Vector(-0.3,  0.3));
+	contour->close();
+	contour->color = color;
+	contour->antialias = true;
+
+	TaskContour::Handle task = new TaskContour();
+	task->contour = contour;
+	return task;
+}
+
+static Task::Handle create_translation(const Task::Handle &sub_task, Real dx)
+{
+	TaskTransformationAffine::Handle task = new TaskTransformationAffine();
+	task->transformation->matrix.set_translate(dx, 0.0);
+	task->sub_task() = sub_task;
+	return task;
+}
+
+static Task::Handle create_blend(const Task::Handle &a, const Task::Handle &b)
+{
+	TaskBlend::Handle task = new TaskBlend();
+	task->blend_method = Color::BLEND_COMPOSITE;
+	task->sub_task_a() = a;
+	task->sub_task_b() = b;
+	return task;
+}
+
+//  blend
+//  - blend
+//    - transformation (blend to target)
+//      - blur
+//        - contour
+//  - transformation (blend to target)
+//    - blur (same as the first one)
+//      - contour
+static Task::Handle create_two_instances(const SurfaceResource::Handle &surface)
+{
+	Task::Handle instances[2];
+	for(int i = 0; i < 2; ++i) {
+		TaskBlur::Handle blur = new TaskBlur();
+		blur->blur = Blur(Blur::FASTGAUSSIAN, Vector(0.1, 0.1));
+		blur->sub_task() = create_square(Color(1.0, 0.5, 0.25, 1.0));
+		instances[i] = create_translation(blur, i ? 1.0 : -1.0);
+	}
+	Task::Handle task = create_blend(create_blend(Task::Handle(), instances[0]), instances[1]);
+	set_root_coords(task, surface);
+	return task;
+}
+
+static void render(const Task::Handle &task, std::vector<Color> &pixels)
+{
+	ASSERT(get_renderer()->run(task, true));
+	SurfaceResource::LockRead<SurfaceSW> lock(task->target_surface);
+	ASSERT(lock);
+	const synfig::Surface &surface = lock->get_surface();
+	pixels.clear();
+	for(int y = 0; y < surface.get_h(); ++y)
+		for(int x = 0; x < surface.get_w(); ++x)
+			pixels.push_back(surface[y][x]);
+}
+
+static bool reads_surface(const Task &task, const SurfaceResource::Handle &surface)
+{
+	for(Task::List::const_iterator i = task.sub_tasks.begin(); i != task.sub_tasks.end(); ++i)
+		if (*i && (*i)->target_surface == surface)
+			return true;
+	return false;
+}
+
+void test_instances_shared_surface_is_not_written_by_consumers()
+{
+	SurfaceResource::Handle target = create_target();
+	Task::List list(1, create_two_instances(target));
+	get_renderer()->optimize(list);
+
+	// blur is rendered only once
+	SurfaceResource::Handle shared;
+	for(Task::List::const_iterator i = list.begin(); i != list.end(); ++i)
+		if (TaskBlur::Handle::cast_dynamic(*i)) {
+			ASSERT(!shared);
+			shared = (*i)->target_surface;
+		}
+	ASSERT(shared);
+	ASSERT(shared != target);
+
+	// renderer orders tasks only by surfaces they write, so every write of shared
+	// surface must be done before the first consumer, and consumers must not write it
+	int readers = 0;
+	for(Task::List::const_iterator i = list.begin(); i != list.end(); ++i) {
+		if (!*i) continue;
+		if (reads_surface(**i, shared)) {
+			ASSERT((*i)->target_surface != shared);
+			++readers;
+		} else
+		if ((*i)->target_surface == shared) {
+			ASSERT_EQUAL(0, readers);
+		}
+	}
+	ASSERT_EQUAL(2, readers);
+}
+
+void test_instances_render_as_separate_copies()
+{
+	std::vector<Color> shared, separate;
+	for(int i = 0; i < 10; ++i) {
+		std::vector<Color> pixels;
+		render(create_two_instances(create_target()), pixels);
+		if (i) ASSERT(pixels == shared);
+		shared.swap(pixels);
+	}
+
+	// render again without sharing of instances
+	const Renderer::Handle &renderer = get_renderer();
+	Optimizer::Handle instances;
+	const Optimizer::List &optimizers = renderer->get_optimizers(Optimizer::CATEGORY_ID_COORDS);
+	for(Optimizer::List::const_iterator i = optimizers.begin(); i != optimizers.end(); ++i)
+		if (dynamic_cast<const OptimizerInstances*>(i->get()))
+			instances = *i;
+	ASSERT(instances);
+	renderer->unregister_optimizer(instances);
+	render(create_two_instances(create_target()), separate);
+	renderer->register_optimizer(instances);
+
+	ASSERT_EQUAL(separate.size(), shared.size());
+	for(size_t i = 0; i < shared.size(); ++i) {
+		ASSERT(std::fabs(shared[i].get_r() - separate[i].get_r()) < 1e-4);
+		ASSERT(std::fabs(shared[i].get_a() - separate[i].get_a()) < 1e-4);
+	}
+
+	// both instances are visible
+	ASSERT(shared[height/2*width + width/4].get_a() > 0.5);
+	ASSERT(shared[height/2*width + 3*width/4].get_a() > 0.5);
+}
+
+static TaskContour::Handle optimize_contour(const Contour::Handle &contour, int size)
+{
+	TaskContour::Handle task = new TaskContour();
+	task->contour = contour;
+	task->target_surface = new SurfaceResource();
+	task->target_surface->create(size, size);
+	task->target_rect = RectInt(0, 0, size, size);
+	task->source_rect = Rect(-1.0, -1.0, 1.0, 1.0);
+
+	Task::List list(1, task);
+	get_renderer()->optimize(list);
+	TaskContour::Handle result;
+	for(Task::List::const_iterator i = list.begin(); i != list.end(); ++i)
+		if (TaskContour::Handle contour_task = TaskContour::Handle::cast_dynamic(*i))
+			result = contour_task;
+	ASSERT(result);
+	return result;
+}
+
+void test_contour_accumulation_for_dense_contour()
+{
+	// star with a lot of thin rays
+	Contour::Handle contour = new Contour();
+	const int count = 400;
+	for(int i = 0; i < count; ++i) {
+		Real angle = 2.0*PI*i/count;
+		Real radius = i % 2 ? 0.1 : 0.9;
+		Vector p(radius*std::cos(angle), radius*std::sin(angle));
+		if (i) contour->line_to(p); else contour->move_to(p);
+	}
+	contour->close();
+
+	TaskContour::Handle task = optimize_contour(contour, 64);
+	ASSERT(OptimizerContourAccumulation::calc_cells_per_pixel(*task) > 1.0);
+	ASSERT(task->allow_accumulation);
+}
+
+void test_contour_accumulation_for_sparse_contour()
+{
+	// large square has a few cells, but a lot of pixels to resolve
+	Contour::Handle contour = new Contour();
+	contour->move_to(Vector(-0.9, -0.9));
+	contour->line_to(Vector( 0.9, -0.9));
+	contour->line_to(Vector( 0.9,  0.9));
+	contour->line_to(Vector(-0.9,  0.9));
+	contour->close();
+
+	TaskContour::Handle task = optimize_contour(contour, 512);
+	ASSERT(OptimizerContourAccumulation::calc_cells_per_pixel(*task) < 0.05);
+	ASSERT(!task->allow_accumulation);
+}
+
+// two color corrections, every one emits gamma and then color matrix
+static Task::Handle create_color_correct_stack(const SurfaceResource::Handle &surface)
+{
+	Task::Handle task = create_square(Color(1.0, 0.5, 0.25, 1.0));
+	for(int i = 0; i < 2; ++i) {
+		TaskPixelGamma::Handle gamma = new TaskPixelGamma();
+		gamma->gamma = Gamma(i ? 1.0/2.2 : 2.2);
+		gamma->sub_task() = task;
+
+		TaskPixelColorMatrix::Handle matrix = new TaskPixelColorMatrix();
+		matrix->matrix.set_scale_rgb(1.5);
+		matrix->matrix *= ColorMatrix().set_translate(-0.1, 0.05, 0.2);
+		matrix->sub_task() = gamma;
+		task = matrix;
+	}
+
+	set_root_coords(task, surface);
+	return task;
+}
+
+void test_pixel_processors_fused_into_one_task()
+{
+	Task::List list(1, create_color_correct_stack(create_target()));
+	get_renderer()->optimize(list);
+
+	int chains = 0;
+	for(Task::List::const_iterator i = list.begin(); i != list.end(); ++i) {
+		ASSERT(!TaskPixelGamma::Handle::cast_dynamic(*i));
+		ASSERT(!TaskPixelColorMatrix::Handle::cast_dynamic(*i));
+		if (TaskPixelChain::Handle::cast_dynamic(*i))
+			++chains;
+	}
+	ASSERT_EQUAL(1, chains);
+}
+
+void test_pixel_processors_fused_render_as_separate()
+{
+	std::vector<Color> fused, separate;
+	render(create_color_correct_stack(create_target()), fused);
+
+	// render again without fusion, every processor makes own pass
+	const Renderer::Handle &renderer = get_renderer();
+	Optimizer::Handle pixel_processor;
+	const Optimizer::List &optimizers = renderer->get_optimizers(Optimizer::CATEGORY_ID_BEGIN);
+	for(Optimizer::List::const_iterator i = optimizers.begin(); i != optimizers.end(); ++i)
+		if (dynamic_cast<const OptimizerPixelProcessor*>(i->get()))
+			pixel_processor = *i;
+	ASSERT(pixel_processor);
+	renderer->unregister_optimizer(pixel_processor);
+	render(create_color_correct_stack(create_target()), separate);
+	renderer->register_optimizer(pixel_processor);
+
+	ASSERT_EQUAL(separate.size(), fused.size());
+	for(size_t i = 0; i < fused.size(); ++i) {
+		ASSERT(std::fabs(fused[i].get_r() - separate[i].get_r()) < 1e-4);
+		ASSERT(std::fabs(fused[i].get_g() - separate[i].get_g()) < 1e-4);
+		ASSERT(std::fabs(fused[i].get_b() - separate[i].get_b()) < 1e-4);
+		ASSERT(std::fabs(fused[i].get_a() - separate[i].get_a()) < 1e-4);
+	}
+
+	// square is visible and corrected
+	const Color &center = fused[height/2*width + width/2];
+	ASSERT(center.get_a() > 0.5);
+	ASSERT(std::fabs(center.get_r() - 1.0) > 1e-2);
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main() {
+	Main main(".");
+
+	TEST_SUITE_BEGIN()
+	TEST_FUNCTION(test_instances_shared_surface_is_not_written_by_consumers)
+	TEST_FUNCTION(test_instances_render_as_separate_copies)
+	TEST_FUNCTION(test_contour_accumulation_for_dense_contour)
+	TEST_FUNCTION(test_contour_accumulation_for_sparse_contour)
+	TEST_FUNCTION(test_pixel_processors_fused_into_one_task)
+	TEST_FUNCTION(test_pixel_processors_fused_render_as_separate)
+	TEST_SUITE_END()
+
+	return tst_exit_status;
+}
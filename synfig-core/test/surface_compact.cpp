@@ -0,0 +1,231 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file surface_compact.cpp
+**	\brief Test precision of compact intermediate surfaces
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#include <cmath>
+#include <limits>
+
+#include <synfig/rendering/software/surfacesw.h>
+#include <synfig/rendering/software/surfaceswcompact.h>
+
+#include "test_base.h"
+
+/* === M A C R O S ========================================================= */
+
+using namespace synfig;
+using namespace rendering;
+
+/* === P R O C E D U R E S ================================================= */
+
+static const int width = 64;
+static const int height = 32;
+
+// gradients over full range of colors, including colors out of [0, 1]
+static void fill_test_surface(synfig::Surface &surface)
+{
+	surface.set_wh(width, height);
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width; ++x)
+			surface[y][x] = Color(
+				ColorReal(x)/(width - 1),
+				ColorReal(y)/(height - 1),
+				ColorReal(x + y)/(width + height)*ColorReal(4) - ColorReal(1),
+				ColorReal(y)/(height - 1) );
+}
+
+static void round_trip(rendering::Surface &compact, const synfig::Surface &source, std::vector<Color> &result)
+{
+	SurfaceSW float_surface(const_cast<synfig::Surface&>(source), false);
+	ASSERT(compact.assign(float_surface));
+	result.resize(width*height);
+	ASSERT(compact.get_pixels(&result.front()));
+}
+
+void test_half_conversion_of_special_values()
+{
+	ASSERT_EQUAL(0x0000, SurfaceSWHalf::float_to_half(0.f));
+	ASSERT_EQUAL(0x8000, SurfaceSWHalf::float_to_half(-0.f));
+	ASSERT_EQUAL(0x3c00, SurfaceSWHalf::float_to_half(1.f));
+	ASSERT_EQUAL(0xc000, SurfaceSWHalf::float_to_half(-2.f));
+	ASSERT_EQUAL(0x7bff, SurfaceSWHalf::float_to_half(65504.f));
+	ASSERT_EQUAL(0x7c00, SurfaceSWHalf::float_to_half(1e6f));
+	ASSERT_EQUAL(0x0001, SurfaceSWHalf::float_to_half(5.9604645e-8f));
+	ASSERT_EQUAL(0x7e00, SurfaceSWHalf::float_to_half(std::numeric_limits<float>::quiet_NaN()));
+
+	for(int i = 0; i < 0x7c00; ++i)
+		ASSERT_EQUAL(i, SurfaceSWHalf::float_to_half(SurfaceSWHalf::half_to_float(i)));
+}
+
+void test_half_surface_matches_float_surface()
+{
+	synfig::Surface source;
+	fill_test_surface(source);
+
+	SurfaceSWHalf half;
+	std::vector<Color> result;
+	round_trip(half, source, result);
+	ASSERT_EQUAL(size_t(width*height*8), half.get_data_size());
+
+	// half has 11 significant bits
+	const Real tolerance = std::pow(2.0, -11);
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width; ++x) {
+			const Color &a = source[y][x];
+			const Color &b = result[y*width + x];
+			ASSERT(std::fabs(a.get_r() - b.get_r()) <= tolerance*std::fabs(a.get_r()));
+			ASSERT(std::fabs(a.get_g() - b.get_g()) <= tolerance*std::fabs(a.get_g()));
+			ASSERT(std::fabs(a.get_b() - b.get_b()) <= tolerance*std::fabs(a.get_b()));
+			ASSERT(std::fabs(a.get_a() - b.get_a()) <= tolerance*std::fabs(a.get_a()));
+		}
+}
+
+void test_byte_surface_matches_float_surface_in_premultiplied_range()
+{
+	synfig::Surface source;
+	fill_test_surface(source);
+
+	SurfaceSWByte byte;
+	std::vector<Color> result;
+	round_trip(byte, source, result);
+	ASSERT_EQUAL(size_t(width*height*4), byte.get_data_size());
+
+	// premultiplied channels clamped to [0, 1] differ at most by half of 8-bit step
+	const Real tolerance = 0.5/255.0 + 1e-6;
+	for(int y = 0; y < height; ++y)
+		for(int x = 0; x < width; ++x) {
+			const Color &a = source[y][x];
+			const Color &b = result[y*width + x];
+			Real alpha = b.get_a();
+			ASSERT(std::fabs(a.get_a() - alpha) <= tolerance);
+			ASSERT(std::fabs(synfig::clamp(a.get_r()*a.get_a(), 0.f, 1.f) - b.get_r()*alpha) <= tolerance);
+			ASSERT(std::fabs(synfig::clamp(a.get_g()*a.get_a(), 0.f, 1.f) - b.get_g()*alpha) <= tolerance);
+			ASSERT(std::fabs(synfig::clamp(a.get_b()*a.get_a(), 0.f, 1.f) - b.get_b()*alpha) <= tolerance);
+		}
+}
+
+void test_compact_surface_rows_match_full_decode()
+{
+	synfig::Surface source;
+	fill_test_surface(source);
+
+	SurfaceSWHalf half;
+	std::vector<Color> result;
+	round_trip(half, source, result);
+
+	std::vector<Color> row(width/2);
+	half.get_row(width/4, height/2, width/2, &row.front());
+	for(int x = 0; x < width/2; ++x)
+		ASSERT(row[x] == result[height/2*width + width/4 + x]);
+}
+
+static SurfaceResource::Handle create_compact_resource()
+{
+	synfig::Surface source;
+	fill_test_surface(source);
+
+	SurfaceResource::Handle resource = new SurfaceResource();
+	resource->create(width, height);
+	{
+		SurfaceResource::LockWrite<SurfaceSW> lock(resource);
+		ASSERT(lock);
+		for(int y = 0; y < height; ++y)
+			for(int x = 0; x < width; ++x)
+				lock->get_surface()[y][x] = source[y][x];
+	}
+	ASSERT(resource->store_as(SurfaceSWHalf::token.handle()));
+	ASSERT(resource->has_surface<SurfaceSWHalf>());
+	ASSERT(!resource->has_surface<SurfaceSW>());
+	return resource;
+}
+
+void test_compact_resource_decodes_once()
+{
+	SurfaceResource::Handle resource = create_compact_resource();
+
+	rendering::Surface::Handle first;
+	{
+		SurfaceResource::LockRead<SurfaceSW> lock(resource);
+		ASSERT(lock);
+		first = lock.get_handle();
+	}
+	ASSERT(resource->has_surface<SurfaceSW>());
+
+	for(int i = 0; i < 3; ++i) {
+		SurfaceResource::LockRead<SurfaceSW> lock(resource);
+		ASSERT(lock);
+		ASSERT(lock.get_handle() == first);
+	}
+}
+
+void test_write_after_compact_read()
+{
+	SurfaceResource::Handle resource = create_compact_resource();
+
+	Color before;
+	{
+		SurfaceResource::LockRead<SurfaceSW> lock(resource);
+		ASSERT(lock);
+		before = lock->get_surface()[1][1];
+	}
+
+	const Color written(1.f, 0.25f, 0.5f, 1.f);
+	{
+		SurfaceResource::LockWrite<SurfaceSW> lock(resource);
+		ASSERT(lock);
+		ASSERT(lock->get_surface()[1][1] == before);
+		lock->get_surface()[1][1] = written;
+	}
+
+	// stale compact copy must not be used after write
+	ASSERT(!resource->has_surface<SurfaceSWHalf>());
+	{
+		SurfaceResource::LockRead<SurfaceSW> lock(resource);
+		ASSERT(lock);
+		ASSERT(lock->get_surface()[1][1] == written);
+	}
+
+	// values are exact in half precision, so they survive next compaction
+	ASSERT(resource->store_as(SurfaceSWHalf::token.handle()));
+	{
+		SurfaceResource::LockRead<SurfaceSW> lock(resource);
+		ASSERT(lock);
+		ASSERT(lock->get_surface()[1][1] == written);
+	}
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main() {
+
+	TEST_SUITE_BEGIN()
+	TEST_FUNCTION(test_half_conversion_of_special_values)
+	TEST_FUNCTION(test_half_surface_matches_float_surface)
+	TEST_FUNCTION(test_byte_surface_matches_float_surface_in_premultiplied_range)
+	TEST_FUNCTION(test_compact_surface_rows_match_full_decode)
+	TEST_FUNCTION(test_compact_resource_decodes_once)
+	TEST_FUNCTION(test_write_after_compact_read)
+	TEST_SUITE_END()
+
+	return tst_exit_status;
+}
@@ -0,0 +1,178 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file surface_pool.cpp
+**	\brief Test reuse of pixel buffers by SurfacePool
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#include <cstring>
+
+#include <synfig/rendering/software/function/surfacepool.h>
+#include <synfig/rendering/software/surfacesw.h>
+
+#include "test_base.h"
+
+/* === M A C R O S ========================================================= */
+
+using namespace synfig;
+using namespace rendering;
+using namespace software;
+
+/* === P R O C E D U R E S ================================================= */
+
+static const size_t max_pooled_bytes = (size_t)256*1024*1024;
+
+static void reset_pool()
+{
+	SurfacePool::set_max_pooled_bytes(max_pooled_bytes);
+	SurfacePool::clear();
+}
+
+static bool is_zero(const void *buffer, size_t size)
+{
+	for(const char *c = (const char*)buffer, *end = c + size; c < end; ++c)
+		if (*c) return false;
+	return true;
+}
+
+static void fill_surface(SurfaceSW &surface)
+{
+	synfig::Surface &s = surface.get_surface();
+	for(int y = 0; y < s.get_h(); ++y)
+		for(int x = 0; x < s.get_w(); ++x)
+			s[y][x] = Color(1.f, 0.5f, 0.25f, 1.f);
+}
+
+void test_reuse_after_smaller_owner()
+{
+	reset_pool();
+	const size_t size = 65536;
+	const size_t smaller_size = 60000;
+	size_t hits = SurfacePool::get_statistics().hits;
+
+	void *a = SurfacePool::alloc(size);
+	ASSERT(is_zero(a, size));
+	memset(a, 0xff, size);
+	SurfacePool::free(a, size);
+
+	// smaller owner writes only the beginning of the buffer
+	void *b = SurfacePool::alloc(smaller_size);
+	ASSERT(b == a);
+	ASSERT(is_zero(b, size));
+	memset(b, 0xff, smaller_size);
+	SurfacePool::free(b, smaller_size);
+
+	void *c = SurfacePool::alloc(size);
+	ASSERT(c == a);
+	ASSERT(is_zero(c, size));
+	SurfacePool::free(c, 0);
+
+	ASSERT_EQUAL(hits + 2, SurfacePool::get_statistics().hits);
+}
+
+void test_reuse_after_reallocation()
+{
+	reset_pool();
+	size_t hits = SurfacePool::get_statistics().hits;
+	{
+		SurfaceSW::Handle surface = new SurfaceSW();
+		ASSERT(surface->create(32, 32));
+		fill_surface(*surface);
+
+		// pixels are moved to own memory of synfig::Surface,
+		// so pooled buffer must be treated as dirty completely
+		surface->get_surface().set_wh(64, 64);
+		fill_surface(*surface);
+	}
+	{
+		SurfaceSW::Handle surface = new SurfaceSW();
+		ASSERT(surface->create(32, 32));
+		ASSERT_EQUAL(hits + 1, SurfacePool::get_statistics().hits);
+		const synfig::Surface &s = surface->get_surface();
+		ASSERT(is_zero(s[0], s.get_pitch()*s.get_h()));
+	}
+}
+
+void test_reuse_at_most_two_classes_larger()
+{
+	// classes of this octave are one page apart: 16K, 20K, 24K, 28K
+	const size_t size = 16384;
+
+	reset_pool();
+	void *buffer = SurfacePool::alloc(size + 8192);
+	SurfacePool::free(buffer, 0);
+	ASSERT(SurfacePool::alloc(size) == buffer);
+	SurfacePool::free(buffer, 0);
+
+	reset_pool();
+	buffer = SurfacePool::alloc(size + 12288);
+	SurfacePool::free(buffer, 0);
+	void *other = SurfacePool::alloc(size);
+	ASSERT(other != buffer);
+	SurfacePool::free(other, 0);
+	reset_pool();
+}
+
+void test_pooled_bytes_are_capped()
+{
+	const size_t size = 65536;
+	reset_pool();
+	SurfacePool::set_max_pooled_bytes(size + size/2);
+
+	size_t allocated = SurfacePool::get_statistics().allocated_bytes;
+	void *a = SurfacePool::alloc(size);
+	void *b = SurfacePool::alloc(size);
+	ASSERT_EQUAL(allocated + 2*size, SurfacePool::get_statistics().allocated_bytes);
+	SurfacePool::free(a, 0);
+	SurfacePool::free(b, 0);
+
+	SurfacePool::Statistics statistics = SurfacePool::get_statistics();
+	ASSERT_EQUAL(size, statistics.pooled_bytes);
+	ASSERT_EQUAL((size_t)1, statistics.pooled_count);
+	ASSERT_EQUAL(allocated + size, statistics.allocated_bytes);
+
+	// zero limit disables pooling
+	SurfacePool::set_max_pooled_bytes(0);
+	statistics = SurfacePool::get_statistics();
+	ASSERT_EQUAL((size_t)0, statistics.pooled_bytes);
+	ASSERT_EQUAL(allocated, statistics.allocated_bytes);
+
+	a = SurfacePool::alloc(size);
+	SurfacePool::free(a, 0);
+	statistics = SurfacePool::get_statistics();
+	ASSERT_EQUAL((size_t)0, statistics.pooled_count);
+	ASSERT_EQUAL(allocated, statistics.allocated_bytes);
+
+	reset_pool();
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main() {
+	TEST_SUITE_BEGIN()
+	TEST_FUNCTION(test_reuse_after_smaller_owner)
+	TEST_FUNCTION(test_reuse_after_reallocation)
+	TEST_FUNCTION(test_reuse_at_most_two_classes_larger)
+	TEST_FUNCTION(test_pooled_bytes_are_capped)
+	TEST_SUITE_END()
+
+	return tst_exit_status;
+}
@@ -0,0 +1,205 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file surface_resource.cpp
+**	\brief Test metadata and locking of SurfaceResource
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <synfig/rendering/software/surfacesw.h>
+#include <synfig/rendering/software/surfaceswcompact.h>
+
+#include "test_base.h"
+
+/* === M A C R O S ========================================================= */
+
+using namespace synfig;
+using namespace rendering;
+
+/* === P R O C E D U R E S ================================================= */
+
+//! Copies pixels like SurfaceSW, then waits, so the writer may change the source meanwhile
+class SurfaceSWSlow: public SurfaceSW
+{
+public:
+	static Token token;
+	virtual Token::Handle get_token() const { return token.handle(); }
+
+	static std::atomic<bool> copied;
+	static std::atomic<bool> resume;
+
+protected:
+	virtual bool assign_vfunc(const rendering::Surface &surface) {
+		bool success = SurfaceSW::assign_vfunc(surface);
+		copied = true;
+		while(!resume) std::this_thread::yield();
+		return success;
+	}
+};
+
+rendering::Surface::Token SurfaceSWSlow::token(
+	Desc<SurfaceSWSlow>("SurfaceSWSlow") );
+std::atomic<bool> SurfaceSWSlow::copied(false);
+std::atomic<bool> SurfaceSWSlow::resume(false);
+
+static void fill_test_resource(const SurfaceResource::Handle &resource)
+{
+	resource->create(16, 8);
+	SurfaceResource::LockWrite<SurfaceSW> lock(resource);
+	ASSERT(lock);
+	synfig::Surface &surface = lock->get_surface();
+	for(int y = 0; y < surface.get_h(); ++y)
+		for(int x = 0; x < surface.get_w(); ++x)
+			surface[y][x] = Color(x/16.f, y/8.f, 0.5f, 1.f);
+}
+
+void test_metadata_follows_create_and_reset()
+{
+	SurfaceResource::Handle resource = new SurfaceResource();
+	ASSERT(!resource->is_exists());
+	ASSERT(resource->is_blank());
+
+	resource->create(640, 480);
+	ASSERT_EQUAL(640, resource->get_width());
+	ASSERT_EQUAL(480, resource->get_height());
+	ASSERT(resource->get_size() == VectorInt(640, 480));
+	ASSERT(resource->is_exists());
+	ASSERT(resource->is_blank());
+
+	resource->create(-1, 10);
+	ASSERT(!resource->is_exists());
+	ASSERT(resource->get_size() == VectorInt(0, 0));
+
+	fill_test_resource(resource);
+	ASSERT(!resource->is_blank());
+	resource->clear();
+	ASSERT(resource->is_blank());
+	ASSERT(resource->get_size() == VectorInt(16, 8));
+
+	resource->reset();
+	ASSERT(!resource->is_exists());
+}
+
+void test_readers_share_converted_surface()
+{
+	SurfaceResource::Handle resource = new SurfaceResource();
+	fill_test_resource(resource);
+
+	rendering::Surface::Handle first, second;
+	{ SurfaceResource::LockRead<SurfaceSWHalf> lock(resource); ASSERT(lock); first = lock.get_handle(); }
+	{ SurfaceResource::LockRead<SurfaceSWHalf> lock(resource); ASSERT(lock); second = lock.get_handle(); }
+	ASSERT(first == second);
+	ASSERT(resource->has_surface<SurfaceSW>());
+	ASSERT(resource->has_surface<SurfaceSWHalf>());
+
+	// writing drops the other surfaces
+	{ SurfaceResource::LockWrite<SurfaceSW> lock(resource); ASSERT(lock); }
+	ASSERT(!resource->has_surface<SurfaceSWHalf>());
+	{ SurfaceResource::LockRead<SurfaceSWHalf> lock(resource); ASSERT(lock); ASSERT(lock.get_handle() != first); }
+}
+
+void test_concurrent_readers_see_same_pixels()
+{
+	SurfaceResource::Handle resource = new SurfaceResource();
+	fill_test_resource(resource);
+
+	std::atomic<int> errors(0);
+	std::vector<std::thread> threads;
+	for(int i = 0; i < 8; ++i)
+		threads.push_back(std::thread([&resource, &errors]() {
+			for(int j = 0; j < 1000; ++j) {
+				SurfaceResource::LockRead<SurfaceSW> lock(resource);
+				if (!lock || lock->get_surface()[3][5] != Color(5/16.f, 3/8.f, 0.5f, 1.f))
+					++errors;
+				if (resource->get_size() != VectorInt(16, 8))
+					++errors;
+			}
+		}));
+	for(std::vector<std::thread>::iterator i = threads.begin(); i != threads.end(); ++i)
+		i->join();
+	ASSERT_EQUAL(0, errors.load());
+}
+
+void test_reader_does_not_cache_conversion_during_semi_write()
+{
+	SurfaceResource::Handle resource = new SurfaceResource();
+	fill_test_resource(resource);
+	const Color written(0.f, 1.f, 0.f, 1.f);
+
+	std::thread reader([&resource]() {
+		SurfaceResource::LockRead<SurfaceSWSlow> lock(resource);
+	});
+	while(!SurfaceSWSlow::copied) std::this_thread::yield();
+	{
+		SurfaceResource::SemiLockWrite<SurfaceSW> lock(resource);
+		ASSERT(lock);
+		lock->get_surface()[3][5] = written;
+	}
+	SurfaceSWSlow::resume = true;
+	reader.join();
+
+	// reader copied pixels before they were written
+	ASSERT(!resource->has_surface<SurfaceSWSlow>());
+	SurfaceResource::LockRead<SurfaceSWSlow> lock(resource);
+	ASSERT(lock);
+	ASSERT(lock->get_surface()[3][5] == written);
+}
+
+void test_semi_write_releases_surfaces_after_readers()
+{
+	SurfaceResource::Handle resource = new SurfaceResource();
+	fill_test_resource(resource);
+
+	// no other readers, dropped surface is released at once
+	rendering::Surface::Handle half;
+	{ SurfaceResource::LockRead<SurfaceSWHalf> lock(resource); ASSERT(lock); half = lock.get_handle(); }
+	{ SurfaceResource::SemiLockWrite<SurfaceSW> lock(resource); ASSERT(lock); }
+	ASSERT_EQUAL(1, half->count());
+
+	// other reader may still use the dropped surface
+	{ SurfaceResource::LockRead<SurfaceSWHalf> lock(resource); ASSERT(lock); half = lock.get_handle(); }
+	{
+		SurfaceResource::LockRead<SurfaceSW> reader(resource);
+		ASSERT(reader);
+		for(int i = 0; i < 3; ++i)
+			{ SurfaceResource::SemiLockWrite<SurfaceSW> lock(resource); ASSERT(lock); }
+		ASSERT_EQUAL(2, half->count());
+	}
+	ASSERT_EQUAL(1, half->count());
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main() {
+
+	TEST_SUITE_BEGIN()
+	TEST_FUNCTION(test_metadata_follows_create_and_reset)
+	TEST_FUNCTION(test_readers_share_converted_surface)
+	TEST_FUNCTION(test_concurrent_readers_see_same_pixels)
+	TEST_FUNCTION(test_reader_does_not_cache_conversion_during_semi_write)
+	TEST_FUNCTION(test_semi_write_releases_surfaces_after_readers)
+	TEST_SUITE_END()
+
+	return tst_exit_status;
+}
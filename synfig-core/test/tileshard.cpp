@@ -0,0 +1,153 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file tileshard.cpp
+**	\brief Test rendering of frames split into tiles and their merge
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <synfig/canvas.h>
+#include <synfig/layer.h>
+#include <synfig/main.h>
+#include <synfig/surface.h>
+#include <synfig/target_scanline.h>
+
+#include "../src/tool/definitions.h"
+#include "../src/tool/job.h"
+#include "../src/tool/joblistprocessor.h"
+#include "../src/tool/tileshard.h"
+
+#include "test_base.h"
+
+/* === M A C R O S ========================================================= */
+
+using namespace synfig;
+
+/* === P R O C E D U R E S ================================================= */
+
+/// Keeps the last rendered frame in memory
+class Target_Capture : public Target_Scanline
+{
+public:
+	static Surface captured;
+
+	static Target* create(const char* /*filename*/, const TargetParam& /*params*/)
+		{ return new Target_Capture(); }
+
+	bool start_frame(ProgressCallback* /*cb*/) override
+		{ captured.set_wh(desc.get_w(), desc.get_h()); return true; }
+	void end_frame() override
+		{ }
+	Color* start_scanline(int scanline) override
+		{ return captured[scanline]; }
+	bool end_scanline() override
+		{ return true; }
+};
+
+Surface Target_Capture::captured;
+
+static Canvas::Handle create_test_canvas()
+{
+	Canvas::Handle canvas = Canvas::create();
+	RendDesc &desc = canvas->rend_desc();
+	desc.set_wh(37, 29);
+	desc.set_tl_br(Point(-1.0, 0.75), Point(1.0, -0.75));
+	desc.set_antialias(1);
+
+	// edges of the default triangle cross the borders of the strips
+	Layer::Handle layer = Layer::create("polygon");
+	ASSERT(layer);
+	layer->set_canvas(canvas);
+	canvas->push_back(layer);
+	return canvas;
+}
+
+void test_shard_keeps_user_target()
+{
+	Job job;
+	job.filename = "test_tileshard.sif";
+	job.canvas = job.root = create_test_canvas();
+	job.tile_index = 1;
+	job.tile_count = 2;
+	job.target_name = "null";
+	ASSERT(!setup_job(job, TargetParam()));
+	ASSERT(!job.target);
+}
+
+void test_merged_shards_match_full_render()
+{
+	Canvas::Handle canvas = create_test_canvas();
+
+	Target_Scanline::Handle full = new Target_Capture();
+	full->set_canvas(canvas);
+	ASSERT(full->render());
+	Surface expected = Target_Capture::captured;
+	Target_Capture::captured = Surface();
+
+	const int count = 3;
+	std::vector<std::string> files;
+	for(int i = 1; i <= count; ++i) {
+		Job job;
+		job.filename = "test_tileshard.sif";
+		job.outfilename = strprintf("test_tileshard.%d-%d.sfrt", i, count);
+		job.canvas = job.root = canvas;
+		job.tile_index = i;
+		job.tile_count = count;
+		ASSERT(setup_job(job, TargetParam()));
+		ASSERT_EQUAL(std::string("tile-shard"), job.target_name);
+		ASSERT(job.target->render());
+		files.push_back(job.outfilename);
+	}
+
+	Job merge;
+	merge.target_name = "test-capture";
+	merge.outfilename = "test_tileshard.out";
+	merge_tile_shards(files, merge, TargetParam());
+
+	const Surface &merged = Target_Capture::captured;
+	ASSERT_EQUAL(expected.get_w(), merged.get_w());
+	ASSERT_EQUAL(expected.get_h(), merged.get_h());
+	for(int y = 0; y < expected.get_h(); ++y)
+		for(int x = 0; x < expected.get_w(); ++x)
+			ASSERT(expected[y][x] == merged[y][x]);
+
+	for(std::vector<std::string>::const_iterator i = files.begin(); i != files.end(); ++i)
+		std::remove(i->c_str());
+}
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main() {
+	Main main(".");
+
+	Target::book()["test-capture"].factory = &Target_Capture::create;
+	Target::book()["test-capture"].filename = "test-capture";
+
+	TEST_SUITE_BEGIN()
+	TEST_FUNCTION(test_shard_keeps_user_target)
+	TEST_FUNCTION(test_merged_shards_match_full_render)
+	TEST_SUITE_END()
+
+	return tst_exit_status;
+}
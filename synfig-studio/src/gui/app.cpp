@@ -38,6 +38,7 @@
 #	include <config.h>
 #endif
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 
@@ -284,6 +285,9 @@ String studio::App::image_editor_path;
 
 String studio::App::sequence_separator(".");
 int    studio::App::number_of_threads = std::thread::hardware_concurrency();
+int    studio::App::workarea_cache_size = 512;
+bool   studio::App::workarea_disk_cache = false;
+int    studio::App::workarea_disk_cache_size = 4096;
 String studio::App::navigator_renderer;
 String studio::App::workarea_renderer;
 
@@ -556,6 +560,21 @@ public:
 				value=strprintf("%i",App::number_of_threads);
 				return true;
 			}
+			if(key=="workarea_cache_size")
+			{
+				value=strprintf("%i",App::workarea_cache_size);
+				return true;
+			}
+			if(key=="workarea_disk_cache")
+			{
+				value=strprintf("%i",(int)App::workarea_disk_cache);
+				return true;
+			}
+			if(key=="workarea_disk_cache_size")
+			{
+				value=strprintf("%i",App::workarea_disk_cache_size);
+				return true;
+			}
 			if(key=="navigator_renderer")
 			{
 				value=App::navigator_renderer;
@@ -749,6 +768,22 @@ public:
 				App::number_of_threads=atoi(value.c_str());
 				return true;
 			}
+			if(key=="workarea_cache_size")
+			{
+				App::workarea_cache_size=std::max(64, atoi(value.c_str()));
+				return true;
+			}
+			if(key=="workarea_disk_cache")
+			{
+				int i(atoi(value.c_str()));
+				App::workarea_disk_cache=i;
+				return true;
+			}
+			if(key=="workarea_disk_cache_size")
+			{
+				App::workarea_disk_cache_size=std::max(64, atoi(value.c_str()));
+				return true;
+			}
 			if(key=="navigator_renderer")
 			{
 				App::navigator_renderer=value;
@@ -844,6 +879,9 @@ public:
 		ret.push_back("predefined_fps");
 		ret.push_back("sequence_separator");
 		ret.push_back("number_of_threads");
+		ret.push_back("workarea_cache_size");
+		ret.push_back("workarea_disk_cache");
+		ret.push_back("workarea_disk_cache_size");
 		ret.push_back("navigator_renderer");
 		ret.push_back("workarea_renderer");
 		ret.push_back("default_background_layer_type");
@@ -231,6 +231,9 @@ public:
 	static synfig::String navigator_renderer;
 	static synfig::String workarea_renderer;
 	static int number_of_threads;
+	static int workarea_cache_size;       //!< in megabytes
+	static bool workarea_disk_cache;
+	static int workarea_disk_cache_size;  //!< in megabytes
 	static bool enable_mainwin_menubar;
 	static bool enable_mainwin_toolbar;
 	static synfig::String ui_language;
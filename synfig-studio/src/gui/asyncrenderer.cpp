@@ -340,6 +340,16 @@ public:
 
 	}
 
+	virtual bool call_renderer(
+		const etl::handle<rendering::SurfaceResource> &surface,
+		Canvas &canvas,
+		const ContextParams &context_params,
+		const RendDesc &renddesc )
+	{
+		// let the wrapped target take the frame from its own source
+		return warm_target->call_renderer(surface, canvas, context_params, renddesc);
+	}
+
 	void set_dead()
 	{
 		Glib::Mutex::Lock lock(mutex);
@@ -2511,7 +2511,7 @@ CanvasView::on_dirty_preview()
 {
 	if (!is_playing()) {
 		IsWorking is_working(*this);
-		work_area->queue_render();
+		work_area->queue_render_changes();
 	}
 }
 
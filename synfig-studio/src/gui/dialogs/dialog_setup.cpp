@@ -93,6 +93,8 @@ Dialog_Setup::Dialog_Setup(Gtk::Window& parent):
 	adj_pref_y_size(Gtk::Adjustment::create(270,1,10000,1,10,0)),
 	adj_pref_fps(Gtk::Adjustment::create(24.0,1.0,100,0.1,1,0)),
 	adj_number_of_threads(Gtk::Adjustment::create(App::number_of_threads,2,std::thread::hardware_concurrency(),1,10,0)),
+	adj_workarea_cache_size(Gtk::Adjustment::create(App::workarea_cache_size,64,65536,64,512,0)),
+	adj_workarea_disk_cache_size(Gtk::Adjustment::create(App::workarea_disk_cache_size,64,1048576,256,1024,0)),
 	pref_modification_flag(false),
 	refreshing(false)
 {
@@ -701,6 +703,19 @@ Dialog_Setup::create_render_page(PageInfo pi)
 	// Render - WorkArea
 	attach_label(pi.grid, _("WorkArea renderer"), ++row);
 	pi.grid->attach(workarea_renderer_combo, 1, row, 1, 1);
+	// Render - WorkArea frame cache
+	attach_label(pi.grid, _("WorkArea cache size (MB)"), ++row);
+	Gtk::SpinButton *workarea_cache_size_select = Gtk::manage(new Gtk::SpinButton(adj_workarea_cache_size,0,0));
+	workarea_cache_size_select->set_tooltip_text(_("Memory used to keep rendered frames for playback."));
+	pi.grid->attach(*workarea_cache_size_select, 1, row, 1, 1);
+	attach_label(pi.grid, _("Keep rendered frames on disk"), ++row);
+	pi.grid->attach(toggle_workarea_disk_cache, 1, row, 1, 1);
+	toggle_workarea_disk_cache.set_halign(Gtk::ALIGN_START);
+	toggle_workarea_disk_cache.set_hexpand(false);
+	toggle_workarea_disk_cache.set_tooltip_text(_("Frames which do not fit in memory are stored on disk and reused when the document is opened again."));
+	attach_label(pi.grid, _("Disk cache size (MB)"), ++row);
+	Gtk::SpinButton *workarea_disk_cache_size_select = Gtk::manage(new Gtk::SpinButton(adj_workarea_disk_cache_size,0,0));
+	pi.grid->attach(*workarea_disk_cache_size_select, 1, row, 1, 1);
 	// Render - Render Done sound
 	attach_label(pi.grid, _("Chime on render done"), ++row);
 	pi.grid->attach(toggle_play_sound_on_render_done, 1, row, 1, 1);
@@ -886,6 +901,9 @@ Dialog_Setup::on_restore_pressed()
 		adj_number_of_threads->set_value(std::thread::hardware_concurrency());
 
 		workarea_renderer_combo.set_active_id("");
+		adj_workarea_cache_size->set_value(512);
+		toggle_workarea_disk_cache.set_active(false);
+		adj_workarea_disk_cache_size->set_value(4096);
 		def_background_none.set_active();
 		
 		Gdk::RGBA m_color;
@@ -1042,6 +1060,11 @@ Dialog_Setup::on_apply_pressed()
 	// Set the workarea render and navigator render flag
 	App::navigator_renderer = App::workarea_renderer  = workarea_renderer_combo.get_active_id();
 
+	// Set the workarea frame cache options
+	App::workarea_cache_size      = int(adj_workarea_cache_size->get_value());
+	App::workarea_disk_cache      = toggle_workarea_disk_cache.get_active();
+	App::workarea_disk_cache_size = int(adj_workarea_disk_cache_size->get_value());
+
 	// Set the use of a render done sound
 	App::use_render_done_sound  = toggle_play_sound_on_render_done.get_active();
 	
@@ -1351,6 +1374,11 @@ Dialog_Setup::refresh()
 	// Refresh the status of the workarea_renderer
 	workarea_renderer_combo.set_active_id(App::workarea_renderer);
 
+	// Refresh the workarea frame cache options
+	adj_workarea_cache_size->set_value(App::workarea_cache_size);
+	toggle_workarea_disk_cache.set_active(App::workarea_disk_cache);
+	adj_workarea_disk_cache_size->set_value(App::workarea_disk_cache_size);
+
 	// Refresh ui tooltip handle info
 	toggle_handle_tooltip_widthpoint.set_active(App::ui_handle_tooltip_flag&Duck::STRUCT_WIDTHPOINT);
 	toggle_handle_tooltip_radius.set_active(App::ui_handle_tooltip_flag&Duck::STRUCT_RADIUS);
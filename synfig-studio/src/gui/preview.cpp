@@ -48,6 +48,7 @@
 #include <gui/docks/dock_info.h>
 #include <gui/exception_guard.h>
 #include <gui/localization.h>
+#include <gui/workarearenderer/framecache.h>
 
 #include <synfig/string.h>
 #include <synfig/surface.h>
@@ -82,9 +83,13 @@ class studio::Preview::Preview_Target : public Target_Scanline
 
 	int		nframes,curframe;
 
+	//! frames rendered after the change of canvas will not be shared
+	long long frame_cache_generation;
+
 public:
 
-	Preview_Target()
+	explicit Preview_Target(long long frame_cache_generation):
+		frame_cache_generation(frame_cache_generation)
 	{
 		set_alpha_mode(TARGET_ALPHA_MODE_FILL);
 		tbegin   = tend     = 0;
@@ -120,6 +125,33 @@ public:
 		return true;
 	}
 
+	virtual bool call_renderer(
+		const etl::handle<rendering::SurfaceResource> &surface,
+		Canvas &canvas,
+		const ContextParams &context_params,
+		const RendDesc &renddesc )
+	{
+		// only whole frames are shared with the work area
+		if (renddesc.get_w() != desc.get_w() || renddesc.get_h() != desc.get_h())
+			return Target_Scanline::call_renderer(surface, canvas, context_params, renddesc);
+
+		FrameCache &frame_cache = FrameCache::instance();
+		FrameCache::Key key(
+			&canvas,
+			rendering::Renderer::get_renderer(get_engine()).get(),
+			context_params.render_excluded_contexts,
+			canvas.get_time(),
+			desc.get_w(),
+			desc.get_h() );
+		if (FrameCache::convert(frame_cache.get(key), surface))
+			return true;
+
+		if (!Target_Scanline::call_renderer(surface, canvas, context_params, renddesc))
+			return false;
+		frame_cache.put(key, FrameCache::convert(surface), frame_cache_generation);
+		return true;
+	}
+
 	virtual void end_frame()
 	{
 		//ok... notify our subscribers...
@@ -227,7 +259,8 @@ void studio::Preview::render()
 		desc.set_time_end(desc.get_time_end() + 1.000001/fps);
 
 		// Render using a Preview target
-		etl::handle<Preview_Target> target = new Preview_Target;
+		etl::handle<Preview_Target> target =
+			new Preview_Target(FrameCache::instance().get_generation(get_canvas()->get_guid()));
 		target->signal_frame_done().connect(sigc::mem_fun(*this, &Preview::frame_finish));
 
 		//set the options
@@ -45,6 +45,10 @@
 #include <gui/timeplotdata.h>
 #include <gui/waypointrenderer.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
 #include <map>
 
 #include <synfig/blinepoint.h>
@@ -71,6 +75,11 @@ using namespace studio;
 #define ZOOM_CHANGING_FACTOR 1.25
 #define DEFAULT_PAGE_SIZE 2.0
 
+// curve samples are cached by blocks, see CurveStruct::get_sample()
+#define SAMPLES_PER_BLOCK 128
+// sampling levels kept in cache around the current one
+#define MAX_SAMPLE_LEVEL_DISTANCE 2
+
 /* === G L O B A L S ======================================================= */
 
 /* === P R O C E D U R E S ================================================= */
@@ -88,24 +97,37 @@ struct Widget_Curves::Channel
 
 struct Widget_Curves::CurveStruct: sigc::trackable
 {
+	typedef std::map<long long, std::vector<Real> > BlockMap;
+
 	std::string name;
 	ValueDesc value_desc;
 	std::vector<Channel> channels;
 
+	//! values sampled with step 2^level seconds, grouped into blocks of SAMPLES_PER_BLOCK,
+	//! each block contains values of all channels for each sample,
+	//! samples which can not be evaluated are NaN
+	std::map<int, BlockMap> samples;
+	//! sorted times of waypoints, where the curve may have corners or jumps
+	std::vector<Real> waypoint_times;
+	bool waypoint_times_ready;
+
 	void add_channel(const String &name, const Gdk::RGBA& color)
 		{ channels.push_back(Channel(name, color)); }
 	void add_channel(const String &name, const String &color)
 		{ add_channel(name, Gdk::RGBA(color)); }
 
-	CurveStruct() { }
+	CurveStruct(): waypoint_times_ready() { }
 
 	explicit CurveStruct(const ValueDesc& x, std::string name)
-		: name(name)
+		: name(name), waypoint_times_ready()
 		{ init(x); }
 
 	bool init(const ValueDesc& x) {
 		value_desc = x;
 		channels.clear();
+		samples.clear();
+		waypoint_times.clear();
+		waypoint_times_ready = false;
 
 		Type &type = value_desc.get_value_type();
 		if (type == type_real) {
@@ -161,6 +183,89 @@ struct Widget_Curves::CurveStruct: sigc::trackable
 	void clear_all_values() {
 		for(std::vector<Channel>::iterator i = channels.begin(); i != channels.end(); ++i)
 			i->values.clear();
+		samples.clear();
+		waypoint_times.clear();
+		waypoint_times_ready = false;
+	}
+
+	static Real invalid_sample()
+		{ return std::numeric_limits<Real>::quiet_NaN(); }
+
+	static bool is_valid_sample(Real value)
+		{ return !std::isnan(value); }
+
+	//! returns true if some waypoint lies strictly between the times
+	bool has_waypoint_between(Real begin, Real end) {
+		if (!waypoint_times_ready) {
+			const Node::time_set &tset = WaypointRenderer::get_times_from_valuedesc(value_desc);
+			for(Node::time_set::const_iterator i = tset.begin(); i != tset.end(); ++i)
+				waypoint_times.push_back((Real)i->get_time());
+			std::sort(waypoint_times.begin(), waypoint_times.end());
+			waypoint_times_ready = true;
+		}
+		std::vector<Real>::const_iterator i = std::upper_bound(waypoint_times.begin(), waypoint_times.end(), begin);
+		return i != waypoint_times.end() && *i < end;
+	}
+
+	static Real get_sample_step(int level)
+		{ return std::ldexp(1.0, level); }
+
+	static long long get_sample_block(long long sample)
+		{ return sample >= 0 ? sample/SAMPLES_PER_BLOCK : (sample + 1)/SAMPLES_PER_BLOCK - 1; }
+
+	bool is_block_ready(int level, long long block) const {
+		std::map<int, BlockMap>::const_iterator i = samples.find(level);
+		return i != samples.end() && i->second.count(block);
+	}
+
+	const std::vector<Real>& get_block(int level, long long block) {
+		std::vector<Real> &values = samples[level][block];
+		if (!values.empty())
+			return values;
+
+		const size_t count = channels.size();
+		const Real step = get_sample_step(level);
+		values.resize(SAMPLES_PER_BLOCK*count, invalid_sample());
+		std::vector<Real> channel_values;
+		for(int i = 0; i < SAMPLES_PER_BLOCK; ++i) {
+			Time t(Real(block*SAMPLES_PER_BLOCK + i)*step);
+			if ( get_value_base_channel_values(value_desc.get_value(t), channel_values)
+			  && channel_values.size() == count )
+				std::copy(channel_values.begin(), channel_values.end(), values.begin() + i*count);
+		}
+		return values;
+	}
+
+	//! returns value of channel at time, interpolated between the cached samples of level,
+	//! or invalid_sample() if value can not be evaluated
+	Real get_sampled_value(size_t channel, int level, Real time) {
+		const Real step = get_sample_step(level);
+		const Real x = time/step;
+		const long long sample = (long long)std::floor(x);
+
+		// interpolation cuts corners and jumps of the curve at waypoints,
+		// so the exact value is evaluated around them
+		if (has_waypoint_between(Real(sample)*step, Real(sample + 1)*step)) {
+			std::map<Real, Real>::const_iterator i = channels[channel].values.find(time);
+			if (i != channels[channel].values.end())
+				return i->second;
+			return evaluate(time) ? channels[channel].values[time] : invalid_sample();
+		}
+
+		const Real a = get_sample(channel, level, sample);
+		const Real b = get_sample(channel, level, sample + 1);
+		return a + (b - a)*(x - Real(sample));
+	}
+
+	Real get_sample(size_t channel, int level, long long sample) {
+		const long long block = get_sample_block(sample);
+		return get_block(level, block)[(sample - block*SAMPLES_PER_BLOCK)*channels.size() + channel];
+	}
+
+	//! removes cached samples of levels which are far from the current one
+	void forget_sample_levels(int level) {
+		for(std::map<int, BlockMap>::iterator i = samples.begin(); i != samples.end(); )
+			if (std::abs(i->first - level) > MAX_SAMPLE_LEVEL_DISTANCE) samples.erase(i++); else ++i;
 	}
 
 	Real get_value(size_t channel, Real time, Real tolerance) {
@@ -174,17 +279,23 @@ struct Widget_Curves::CurveStruct: sigc::trackable
 		// Since that didn't work, we now need
 		// to go ahead and figure out what the
 		// actual value is at that time.
+		if (!evaluate(time))
+			return Real(0.0);
+
+		return channels[channel].values[time];
+	}
+
+	//! stores values of all channels at time, returns false if value can not be evaluated
+	bool evaluate(Real time) {
 		ValueBase value(value_desc.get_value(time));
 		std::vector<Real> channel_values;
-		bool ok = get_value_base_channel_values(value, channel_values);
-		if (!ok)
-			return Real(0.0);
+		if (!get_value_base_channel_values(value, channel_values) || channel_values.size() != channels.size())
+			return false;
 
 		for (size_t c = 0; c < channel_values.size(); c++) {
 			channels[c].values[time] = channel_values[c];
 		}
-
-		return channels[channel].values[time];
+		return true;
 	}
 
 	static bool get_value_base_channel_values(const ValueBase &value_base, std::vector<Real>& channels) {
@@ -491,7 +602,8 @@ void Widget_Curves::on_waypoint_double_clicked(const Widget_Curves::ChannelPoint
 Widget_Curves::Widget_Curves()
 	: Widget_TimeGraphBase(),
 	  channel_point_sd(*this),
-	  waypoint_edge_length(16)
+	  waypoint_edge_length(16),
+	  sample_level()
 {
 	set_size_request(64, 64);
 
@@ -531,6 +643,7 @@ Widget_Curves::clear() {
 		value_desc_changed.back().disconnect();
 		value_desc_changed.pop_back();
 	}
+	sample_prefetch.disconnect();
 	curve_list.clear();
 	channel_point_sd.clear();
 }
@@ -544,6 +657,50 @@ Widget_Curves::refresh()
 	queue_draw();
 }
 
+void
+Widget_Curves::on_curve_changed(std::list<CurveStruct>::iterator curve_it)
+{
+	// samples of other curves are still valid
+	curve_it->clear_all_values();
+	channel_point_sd.refresh();
+	queue_draw();
+}
+
+void
+Widget_Curves::queue_sample_prefetch()
+{
+	if (!sample_prefetch.connected())
+		sample_prefetch = Glib::signal_idle().connect(
+			sigc::mem_fun(*this, &Widget_Curves::on_sample_prefetch), Glib::PRIORITY_LOW );
+}
+
+bool
+Widget_Curves::on_sample_prefetch()
+{
+	// Value nodes are not thread-safe, so samples are calculated in the main loop
+	// when it is idle, one block per call. Next priority is:
+	// pages before and after the visible range, then levels for zoom in and zoom out.
+	const Real page = Real(sample_upper - sample_lower);
+	const Real ranges[][3] = {
+		{ Real(sample_lower) - page, Real(sample_upper) + page, Real(sample_level)     },
+		{ Real(sample_lower),        Real(sample_upper),        Real(sample_level - 1) },
+		{ Real(sample_lower) - page, Real(sample_upper) + page, Real(sample_level + 1) } };
+
+	for(size_t r = 0; r < sizeof(ranges)/sizeof(ranges[0]); ++r) {
+		const int level = (int)ranges[r][2];
+		const Real step = CurveStruct::get_sample_step(level);
+		const long long first = CurveStruct::get_sample_block((long long)std::floor(ranges[r][0]/step));
+		const long long last  = CurveStruct::get_sample_block((long long)std::ceil (ranges[r][1]/step));
+		for(std::list<CurveStruct>::iterator i = curve_list.begin(); i != curve_list.end(); ++i)
+			for(long long block = first; block <= last; ++block)
+				if (!i->is_block_ready(level, block)) {
+					i->get_block(level, block);
+					return true;
+				}
+	}
+	return false;
+}
+
 void Widget_Curves::select_all_points()
 {
 	channel_point_sd.select_all_items();
@@ -567,19 +724,21 @@ Widget_Curves::set_value_descs(etl::handle<synfigapp::CanvasInterface> canvas_in
 			continue;
 
 		curve_list.push_back(curve_struct);
+		std::list<CurveStruct>::iterator curve_it = --curve_list.end();
 
+		// invalidate cached values of the changed curve only
 		if (i->is_value_node())
 			value_desc_changed.push_back(
 				i->get_value_node()->signal_changed().connect(
-						sigc::mem_fun(*this, &Widget_Curves::refresh )));
+					sigc::bind(sigc::mem_fun(*this, &Widget_Curves::on_curve_changed), curve_it )));
 		if (i->parent_is_value_node())
 			value_desc_changed.push_back(
 				i->get_parent_value_node()->signal_changed().connect(
-					sigc::mem_fun(*this, &Widget_Curves::refresh )));
+					sigc::bind(sigc::mem_fun(*this, &Widget_Curves::on_curve_changed), curve_it )));
 		if (i->parent_is_layer())
 			value_desc_changed.push_back(
 				i->get_layer()->signal_changed().connect(
-					sigc::mem_fun(*this, &Widget_Curves::refresh )));
+					sigc::bind(sigc::mem_fun(*this, &Widget_Curves::on_curve_changed), curve_it )));
 	}
 	queue_draw();
 }
@@ -661,6 +820,12 @@ Widget_Curves::on_draw(const Cairo::RefPtr<Cairo::Context> &cr)
 	// Draw current time
 	draw_current_time(cr);
 
+	// choose sampling level for curves and prepare samples around the visible range
+	sample_level = (int)std::ceil(std::log2(std::max((double)time_plot_data->dt, 1e-6)));
+	sample_lower = time_plot_data->lower_ex;
+	sample_upper = time_plot_data->lower_ex + time_plot_data->dt*w;
+	queue_sample_prefetch();
+
 	// reserve arrays for maximum number of channels
 	size_t max_channels = 0;
 	for(std::list<CurveStruct>::iterator i = curve_list.begin(); i != curve_list.end(); ++i)
@@ -712,10 +877,15 @@ Widget_Curves::on_draw(const Cairo::RefPtr<Cairo::Context> &cr)
 			points[c].reserve(w);
 		}
 
+		// read polyline from cached samples with step not less than time of one pixel,
+		// samples which can not be evaluated are skipped
+		curve_it->forget_sample_levels(sample_level);
 		Time t = time_plot_data->lower_ex;
 		for(int j = 0; j < w; ++j, t += time_plot_data->dt) {
 			for(size_t c = 0; c < channels; ++c) {
-				Real y = curve_it->get_value(c, t, time_plot_data->dt);
+				Real y = curve_it->get_sampled_value(c, sample_level, t);
+				if (!CurveStruct::is_valid_sample(y))
+					continue;
 				range_max = std::max(range_max, y);
 				range_min = std::min(range_min, y);
 				points[c].push_back( Gdk::Point(j, time_plot_data->get_pixel_y_coord(y)) );
@@ -740,7 +910,8 @@ Widget_Curves::on_draw(const Cairo::RefPtr<Cairo::Context> &cr)
 			std::vector<Gdk::Point> &p = points[c];
 			std::vector<Gdk::Point>::iterator p_it;
 			for(p_it = p.begin(); p_it != p.end(); ++p_it) {
-				if (p_it == p.begin())
+				// skipped samples split the curve
+				if (p_it == p.begin() || p_it->get_x() != (p_it - 1)->get_x() + 1)
 					cr->move_to(p_it->get_x(), p_it->get_y());
 				else
 					cr->line_to(p_it->get_x(), p_it->get_y());
@@ -753,7 +924,10 @@ Widget_Curves::on_draw(const Cairo::RefPtr<Cairo::Context> &cr)
 			// Draw the remaining curve
 			if (p_it != p.end()) {
 				for(; p_it != p.end(); ++p_it) {
-					cr->line_to(p_it->get_x(), p_it->get_y());
+					if (p_it == p.begin() || p_it->get_x() != (p_it - 1)->get_x() + 1)
+						cr->move_to(p_it->get_x(), p_it->get_y());
+					else
+						cr->line_to(p_it->get_x(), p_it->get_y());
 				}
 				cr->set_dash(dashes4, 0);
 				cr->stroke();
@@ -761,10 +935,13 @@ Widget_Curves::on_draw(const Cairo::RefPtr<Cairo::Context> &cr)
 				cr->set_dash(no_dashes, 0);
 			}
 
+			if (p.empty())
+				continue;
+
 			Glib::RefPtr<Pango::Layout> layout(Pango::Layout::create(get_pango_context()));
 			layout->set_text(curve_it->channels[c].name);
 
-			cr->move_to(1, points[c][0].get_y() + 1);
+			cr->move_to(1, p[0].get_y() + 1);
 			layout->show_in_cairo_context(cr);
 		}
 
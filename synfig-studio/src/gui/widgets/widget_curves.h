@@ -99,6 +99,16 @@ private:
 
 	std::vector<std::pair<synfig::Waypoint, std::list<CurveStruct>::iterator> > overlapped_waypoints;
 
+	//! sampling level and range of the last drawn graph, used to prefetch curve samples
+	int sample_level;
+	synfig::Time sample_lower;
+	synfig::Time sample_upper;
+	sigc::connection sample_prefetch;
+
+	void on_curve_changed(std::list<CurveStruct>::iterator curve_it);
+	void queue_sample_prefetch();
+	bool on_sample_prefetch();
+
 	void on_waypoint_clicked(const ChannelPoint &cp, unsigned int button, Gdk::Point /*point*/);
 	void on_waypoint_double_clicked(const ChannelPoint &cp, unsigned int button, Gdk::Point /*point*/);
 
@@ -32,6 +32,9 @@
 
 #include <gui/widgets/widget_soundwave.h>
 
+#include <algorithm>
+#include <cmath>
+
 #include <cairomm/cairomm.h>
 #include <gdkmm.h>
 #include <glibmm/convert.h>
@@ -53,6 +56,25 @@ using namespace studio;
 
 const int default_frequency = 48000;
 const int default_n_channels = 2;
+const int samples_per_peak = 16;
+
+#ifndef WITHOUT_MLT
+static Mlt::Producer*
+open_track(Mlt::Profile &profile, const std::string &filename)
+{
+	std::string real_filename = Glib::filename_from_utf8(filename);
+	Mlt::Producer *track = new Mlt::Producer(profile, (std::string("avformat:") + real_filename).c_str());
+	if (!track->get_producer() || track->get_length() <= 0) {
+		delete track;
+		track = new Mlt::Producer(profile, (std::string("vorbis:") + real_filename).c_str());
+		if (!track->get_producer() || track->get_length() <= 0) {
+			delete track;
+			return nullptr;
+		}
+	}
+	return track;
+}
+#endif
 
 Widget_SoundWave::MouseHandler::~MouseHandler() {}
 
@@ -62,10 +84,15 @@ Widget_SoundWave::Widget_SoundWave()
 	  n_channels(default_n_channels),
 	  n_samples(0),
 	  channel_idx(0),
-	  loading_error(false)
+	  loading_error(false),
+	  loading(false),
+	  loading_cancelled(false),
+	  loaded_n_samples(0),
+	  loading_finished(false)
 {
 	add_events(Gdk::BUTTON_PRESS_MASK | Gdk::BUTTON_RELEASE_MASK | Gdk::SCROLL_MASK | Gdk::POINTER_MOTION_MASK | Gdk::KEY_PRESS_MASK | Gdk::KEY_RELEASE_MASK);
 	setup_mouse_handler();
+	loading_done.connect(sigc::mem_fun(*this, &Widget_SoundWave::on_loading_done));
 
 	set_default_page_size(255);
 	set_zoom(1.0);
@@ -98,7 +125,9 @@ bool Widget_SoundWave::load(const std::string& filename)
 		return false;
 	}
 	loading_error = false;
+	loading = true;
 	this->filename = filename;
+	loading_thread = std::thread(&Widget_SoundWave::load_peaks, this, filename);
 	signal_file_loaded().emit(filename);
 	queue_draw();
 	return true;
@@ -106,8 +135,10 @@ bool Widget_SoundWave::load(const std::string& filename)
 
 void Widget_SoundWave::clear()
 {
+	stop_loading();
+
 	std::lock_guard<std::mutex> lock(mutex);
-	buffer.clear();
+	peaks.clear();
 	this->filename.clear();
 	loading_error = false;
 	sound_delay = 0.0;
@@ -176,43 +207,57 @@ bool Widget_SoundWave::on_draw(const Cairo::RefPtr<Cairo::Context>& cr)
 		cr->restore();
 	}
 
+	if (loading) {
+		Glib::RefPtr<Pango::Layout> layout(Pango::Layout::create(get_pango_context()));
+		layout->set_text(_("Loading audio..."));
+
+		cr->save();
+		Gdk::RGBA color = get_style_context()->get_color();
+		cr->set_source_rgba(color.get_red(), color.get_green(), color.get_blue(), 0.5);
+		cr->move_to(5, get_height()/2);
+		layout->show_in_cairo_context(cr);
+		cr->restore();
+	}
+
 	if (filename.empty())
 		return true;
 
-	if (buffer.empty())
+	if (peaks.empty())
 		return true;
 
-	if (!frequency || !n_channels)
+	if (!frequency || !n_channels || time_plot_data->k <= 0.0)
 		return true;
 
 	cr->save();
 
 	std::lock_guard<std::mutex> lock(mutex);
 
-	const int bytes_per_sample = 1;
-
 	Gdk::RGBA color = get_style_context()->get_color();
 	cr->set_source_rgb(color.get_red(), color.get_green(), color.get_blue());
 
-	const int middle_y = 127;
-	cr->move_to(0, middle_y);
-
-	const int stride = frequency * bytes_per_sample * n_channels;
-
-	for (double x = 0; x < get_width(); x+=.1) {
-		synfig::Time t = time_plot_data->get_t_from_pixel_coord(x);
-		int value = middle_y;
-		if (t >= sound_delay) {
-			synfig::Time dt = t - sound_delay;
-			unsigned long index = int(dt * stride) + channel_idx;
-			if (index < buffer.size())
-				std::copy(buffer.begin() + index, buffer.begin() + index + bytes_per_sample, &value);
-		}
-		int y = time_plot_data->get_pixel_y_coord(value);
-		cr->line_to(x, y);
+	// pick the coarsest level which still has at least one peak per pixel,
+	// so every pixel column merges only a couple of peaks
+	const double samples_per_pixel = frequency/time_plot_data->k;
+	int level = 0;
+	while (level + 1 < (int)peaks.size() && double(samples_per_peak << (level + 1)) <= samples_per_pixel)
+		++level;
+	const double samples_per_level_peak = double(samples_per_peak << level);
+
+	for (int x = 0; x < get_width(); ++x) {
+		const double first_sample = double(time_plot_data->get_t_from_pixel_coord(x) - sound_delay)*frequency;
+		const double last_sample = first_sample + samples_per_pixel;
+		if (last_sample <= 0.0)
+			continue;
+		const long long first = (long long)std::floor(first_sample/samples_per_level_peak);
+		const long long last = std::max(first, (long long)std::ceil(last_sample/samples_per_level_peak) - 1);
+		const Peak peak = get_peak(level, first, last);
+		if (peak.min > peak.max)
+			continue;
+		const int y_max = time_plot_data->get_pixel_y_coord(peak.max);
+		const int y_min = time_plot_data->get_pixel_y_coord(peak.min);
+		cr->rectangle(x, std::min(y_min, y_max), 1, std::abs(y_min - y_max) + 1);
 	}
-	cr->set_line_width(0.3);
-	cr->stroke();
+	cr->fill();
 
 	draw_current_time(cr);
 
@@ -226,30 +271,9 @@ bool Widget_SoundWave::on_draw(const Cairo::RefPtr<Cairo::Context>& cr)
 	return true;
 }
 
-void Widget_SoundWave::set_time_model(const etl::handle<TimeModel>& x)
-{
-	if (x) {
-		previous_lower_time = x->get_lower();
-		previous_upper_time = x->get_upper();
-	}
-	Widget_TimeGraphBase::set_time_model(x);
-}
-
 void Widget_SoundWave::on_time_model_changed()
 {
-	if (filename.empty())
-		return;
-	if (previous_lower_time == time_plot_data->time_model->get_lower()
-		&& previous_upper_time == time_plot_data->time_model->get_upper())
-		return;
-
-	previous_lower_time = time_plot_data->time_model->get_lower();
-	previous_upper_time = time_plot_data->time_model->get_upper();
-
-	std::lock_guard<std::mutex> lock(mutex);
-	buffer.clear();
-	n_samples = 0;
-	do_load(filename);
+	// peaks cover the whole sound, so nothing has to be reloaded
 	queue_draw();
 }
 
@@ -274,76 +298,150 @@ void Widget_SoundWave::setup_mouse_handler()
 
 bool Widget_SoundWave::do_load(const std::string& filename)
 {
-#ifndef WITHOUT_MLT	
-	std::string real_filename = Glib::filename_from_utf8(filename);
+#ifndef WITHOUT_MLT
 	Mlt::Profile profile;
-	Mlt::Producer *track = new Mlt::Producer(profile, (std::string("avformat:") + real_filename).c_str());
-	if (!track->get_producer() || track->get_length() <= 0) {
+	Mlt::Producer *track = open_track(profile, filename);
+	if (!track)
+		return false;
+
+	Mlt::Frame *frame = track->get_frame(0);
+	if (!frame) {
 		delete track;
-		track = new Mlt::Producer(profile, (std::string("vorbis:") + real_filename).c_str());
-		if (!track->get_producer() || track->get_length() <= 0) {
-			delete track;
-			return false;
-		}
+		return false;
 	}
+	frequency = std::stoi(frame->get("audio_frequency"));
+	n_channels = std::stoi(frame->get("audio_channels"));
+	if (!frequency)
+		frequency = default_frequency;
+	if (!n_channels)
+		n_channels = default_n_channels;
+	delete frame;
+	delete track;
 
-	const int length = track->get_length();
-	double fps = track->get_fps();
-	int start_frame = 0;
-	int end_frame = length;
-	start_frame = synfig::clamp(start_frame, 0, length);
-	end_frame = synfig::clamp(end_frame, 0, length);
-	track->seek(start_frame);
-	// check if audio is seekable
-	if (track->position() != start_frame) {
-		// Not seekable!
-		synfig::error("Audio file not seekable, but a delay (%s) was set: %s", sound_delay.get_string(time_plot_data->time_model->get_frame_rate()).c_str(), filename.c_str());
-	}
-	unsigned char *outbuffer = nullptr;
-	int bytes_written = 0;
-
-	frequency = 0;
-	n_channels = 0;
-
-	for (int i = start_frame; i < end_frame; ++i) {
-		Mlt::Frame *frame = track->get_frame(0);
-		if (!frame)
-			break;
-
-		if (!frequency)
-			frequency = std::stoi(frame->get("audio_frequency"));
-		if (!n_channels)
-			n_channels = std::stoi(frame->get("audio_channels"));
-
-		mlt_audio_format format = mlt_audio_u8;
-		int bytes_per_sample = 1;
-		int _frequency = frequency? frequency : default_frequency;
-		int _channels = n_channels ? n_channels : default_n_channels;
-		int _n_samples = 0;
-		void * _buffer = frame->get_audio(format, _frequency, _channels, _n_samples);
-		if (_buffer == nullptr) {
-			synfig::warning("couldn't get sound frame #%i", i);
+	if (channel_idx >= n_channels)
+		channel_idx = 0;
+#endif
+	return true;
+}
+
+void Widget_SoundWave::load_peaks(const std::string& filename)
+{
+	PeakPyramid pyramid(1);
+	long long total_samples = 0;
+
+#ifndef WITHOUT_MLT
+	Mlt::Profile profile;
+	Mlt::Producer *track = open_track(profile, filename);
+	if (track) {
+		// raw samples are not kept, only peaks of level 0 are collected while decoding
+		PeakList &base = pyramid.front();
+		PeakList current(n_channels);
+		int filled = 0;
+
+		const int length = track->get_length();
+		for (int i = 0; i < length && !loading_cancelled; ++i) {
+			Mlt::Frame *frame = track->get_frame(0);
+			if (!frame)
+				break;
+
+			mlt_audio_format format = mlt_audio_u8;
+			int _frequency = frequency;
+			int _channels = n_channels;
+			int _n_samples = 0;
+			const unsigned char *buffer = static_cast<const unsigned char*>(frame->get_audio(format, _frequency, _channels, _n_samples));
+			if (buffer == nullptr || _channels != n_channels) {
+				synfig::warning("couldn't get sound frame #%i", i);
+				delete frame;
+				break;
+			}
+
+			for (int j = 0; j < _n_samples; ++j, buffer += n_channels) {
+				for (int c = 0; c < n_channels; ++c) {
+					Peak &peak = current[c];
+					if (buffer[c] < peak.min) peak.min = buffer[c];
+					if (buffer[c] > peak.max) peak.max = buffer[c];
+				}
+				if (++filled == samples_per_peak) {
+					base.insert(base.end(), current.begin(), current.end());
+					current.assign(n_channels, Peak());
+					filled = 0;
+				}
+			}
+			total_samples += _n_samples;
 			delete frame;
-			break;
-		}
-		if (buffer.empty()) {
-			synfig::warning("sound frame #%i got empty buffer", i);
-			int buffer_length = (end_frame - start_frame + 1) * _channels * bytes_per_sample * std::round(_frequency/fps);
-			buffer.resize(buffer_length);
 		}
-		int _n_bytes = _n_samples * _channels * bytes_per_sample;
-		std::copy(static_cast<unsigned char*>(_buffer), static_cast<unsigned char*>(_buffer) + _n_bytes, buffer.begin()+bytes_written);
-		bytes_written += _n_bytes;
-		outbuffer += _n_bytes;
-		frequency = _frequency;
-		n_channels = _channels;
-		n_samples += _n_samples;
-		delete frame;
+		if (filled)
+			base.insert(base.end(), current.begin(), current.end());
+		delete track;
 	}
-	if (channel_idx > n_channels)
-		channel_idx = 0;
-	queue_draw();
-	delete track;
 #endif
-	return true;
+
+	while (pyramid.back().size() > (size_t)n_channels && !loading_cancelled) {
+		const PeakList &prev = pyramid.back();
+		const size_t count = prev.size()/n_channels;
+		PeakList next(((count + 1)/2)*n_channels);
+		for (size_t i = 0; i < count; ++i)
+			for (int c = 0; c < n_channels; ++c)
+				next[(i/2)*n_channels + c].add(prev[i*n_channels + c]);
+		pyramid.push_back(PeakList());
+		pyramid.back().swap(next);
+	}
+
+	if (loading_cancelled)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		loaded_peaks.swap(pyramid);
+		loaded_n_samples = int(total_samples);
+		loading_finished = true;
+	}
+	loading_done.emit();
+}
+
+void Widget_SoundWave::stop_loading()
+{
+	loading_cancelled = true;
+	if (loading_thread.joinable())
+		loading_thread.join();
+	loading_cancelled = false;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	loaded_peaks.clear();
+	loading_finished = false;
+	loading = false;
+}
+
+void Widget_SoundWave::on_loading_done()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		// notification may belong to a loading which is already cancelled
+		if (!loading_finished)
+			return;
+		peaks.swap(loaded_peaks);
+		loaded_peaks.clear();
+		n_samples = loaded_n_samples;
+		loading_finished = false;
+		loading = false;
+	}
+	if (loading_thread.joinable())
+		loading_thread.join();
+	signal_specs_changed().emit();
+	queue_draw();
+}
+
+Widget_SoundWave::Peak
+Widget_SoundWave::get_peak(int level, long long first, long long last) const
+{
+	Peak peak;
+	if (level < 0 || level >= (int)peaks.size() || channel_idx >= n_channels)
+		return peak;
+	const PeakList &list = peaks[level];
+	const long long count = (long long)list.size()/n_channels;
+	first = std::max(first, 0ll);
+	last = std::min(last, count - 1);
+	for (long long i = first; i <= last; ++i)
+		peak.add(list[i*n_channels + channel_idx]);
+	return peak;
 }
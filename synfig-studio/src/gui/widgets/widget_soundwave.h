@@ -26,6 +26,13 @@
 #ifndef SYNFIG_STUDIO_WIDGET_SOUNDWAVE_H
 #define SYNFIG_STUDIO_WIDGET_SOUNDWAVE_H
 
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glibmm/dispatcher.h>
+
 #include <gui/selectdraghelper.h>
 #include <gui/widgets/widget_timegraphbase.h>
 
@@ -52,8 +59,6 @@ public:
 	void set_delay(synfig::Time delay);
 	const synfig::Time& get_delay() const;
 
-	virtual void set_time_model(const etl::handle<TimeModel> &x) override;
-
 	sigc::signal<void, const std::string&> & signal_file_loaded() { return signal_file_loaded_; }
 	sigc::signal<void> & signal_delay_changed() { return signal_delay_changed_; }
 	sigc::signal<void> & signal_specs_changed() { return signal_specs_changed_; }
@@ -65,11 +70,26 @@ protected:
 	void on_time_model_changed() override;
 
 private:
+	//! Lowest and highest sample value of a span of sound
+	struct Peak {
+		unsigned char min, max;
+		Peak(): min(255), max(0) { }
+		void add(const Peak &other)
+			{ if (other.min < min) min = other.min; if (other.max > max) max = other.max; }
+	};
+	typedef std::vector<Peak> PeakList;
+
+	//! Peaks of all channels are interleaved.
+	//! Level 0 keeps one peak per samples_per_peak samples,
+	//! every next level merges two neighbour peaks of the previous one,
+	//! so any zoom may be drawn by reading a few peaks per pixel.
+	typedef std::vector<PeakList> PeakPyramid;
+
 	std::mutex mutex;
 	std::string filename;
 
 	// sound data
-	std::vector<unsigned char> buffer;
+	PeakPyramid peaks;
 
 	// sound format
 	int frequency;
@@ -82,8 +102,15 @@ private:
 
 	// status
 	bool loading_error;
-	synfig::Time previous_lower_time;
-	synfig::Time previous_upper_time;
+	bool loading;
+
+	// background loading
+	std::thread loading_thread;
+	std::atomic<bool> loading_cancelled;
+	PeakPyramid loaded_peaks;
+	int loaded_n_samples;
+	bool loading_finished;
+	Glib::Dispatcher loading_done;
 
 	sigc::signal<void, const std::string&> signal_file_loaded_;
 	sigc::signal<void> signal_delay_changed_;
@@ -91,7 +118,14 @@ private:
 
 	void setup_mouse_handler();
 
+	//! reads sound format, the sound data itself is decoded by load_peaks()
 	bool do_load(const std::string& filename);
+	//! runs in loading_thread
+	void load_peaks(const std::string& filename);
+	void stop_loading();
+	void on_loading_done();
+
+	Peak get_peak(int level, long long first, long long last) const;
 
 	// I'm too lazy to code/copy again mouse actions for panning/zooming/scrolling
 	struct MouseHandler : SelectDragHelper<int>
@@ -187,6 +187,10 @@ WorkArea::WorkArea(etl::loose_handle<synfigapp::CanvasInterface> canvas_interfac
 	insert_renderer(new Renderer_BoneSetup,  501);
 	insert_renderer(new Renderer_FrameError, 502);
 
+	// track changed regions to re-render only affected tiles, see queue_render_changes()
+	get_canvas()->signal_child_changed().connect(sigc::mem_fun(*renderer_canvas, &Renderer_Canvas::on_canvas_child_changed));
+	get_canvas()->signal_changed().connect(sigc::mem_fun(*renderer_canvas, &Renderer_Canvas::on_canvas_changed));
+
 	signal_duck_selection_changed().connect(sigc::mem_fun(*this,&studio::WorkArea::queue_draw));
 	signal_duck_selection_single().connect(sigc::mem_fun(*this, &studio::WorkArea::on_duck_selection_single));
 	signal_strokes_changed().connect(sigc::mem_fun(*this,&studio::WorkArea::queue_draw));
@@ -2204,6 +2208,21 @@ studio::WorkArea::queue_render(bool refresh)
 	}, *this));
 }
 
+void
+studio::WorkArea::queue_render_changes()
+{
+	assert(dirty_trap_count >= 0);
+	if (dirty_trap_count > 0)
+		{ dirty_trap_queued++; return; }
+	dirty_trap_queued = 0;
+	Glib::signal_idle().connect_once(sigc::track_obj([=] () {
+		renderer_canvas->clear_dirty_render();
+		Glib::signal_idle().connect_once(
+					sigc::mem_fun(*renderer_canvas, &Renderer_Canvas::enqueue_render),
+					Glib::PRIORITY_DEFAULT );
+	}, *this));
+}
+
 void
 studio::WorkArea::set_cursor(const Glib::RefPtr<Gdk::Cursor> &x)
 {
@@ -441,6 +441,10 @@ public:
 	//! initiate background rendering of canvas
 	void queue_render(bool refresh = true);
 
+	//! initiate background rendering of canvas after its changes,
+	//! only tiles affected by changed layers will be re-rendered
+	void queue_render_changes();
+
 	void zoom_in();
 	void zoom_out();
 	void zoom_fit();
@@ -0,0 +1,114 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file dirtyregion.cpp
+**	\brief Regions of the canvas changed by edits of its root layers
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <vector>
+
+#include <synfig/context.h>
+#include <synfig/layers/layer_composite.h>
+#include <synfig/layers/layer_group.h>
+#include <synfig/layers/layer_switch.h>
+#include <synfig/transform.h>
+
+#include "dirtyregion.h"
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace synfig;
+using namespace studio;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+//! layers which move their context by affine transformation, so corners of region are enough to map it
+static bool
+is_affine_transformation(const Layer &layer)
+{
+	const String name = layer.get_name();
+	return name == "translate"
+		|| name == "rotate"
+		|| name == "zoom"
+		|| name == "stretch";
+}
+
+/* === M E T H O D S ======================================================= */
+
+Rect
+DirtyRegion::calc_layer_bounds(const Layer &layer)
+{
+	// groups have no own bounds, so use bounds of their content
+	if (const Layer_PasteCanvas *paste = dynamic_cast<const Layer_Group*>(&layer))
+		return paste->get_bounding_rect_context_dependent(ContextParams(true));
+	if (const Layer_PasteCanvas *paste = dynamic_cast<const Layer_Switch*>(&layer))
+		return paste->get_bounding_rect_context_dependent(ContextParams(true));
+
+	// straight blending clears everything under the layer outside of its bounds too
+	if (const Layer_Composite *composite = dynamic_cast<const Layer_Composite*>(&layer))
+		if (Color::is_straight(composite->get_blend_method()))
+			return Rect::infinite();
+
+	return layer.get_bounding_rect();
+}
+
+bool
+DirtyRegion::map_to_frame(const Canvas &canvas, const Layer &layer, Rect &rect)
+{
+	// layers are stored from the top one
+	std::vector<const Layer*> upper_layers;
+	Canvas::const_iterator i = canvas.begin();
+	for(; i != canvas.end() && i->get() != &layer; ++i)
+		if ((*i)->active())
+			upper_layers.push_back(i->get());
+	if (i == canvas.end())
+		return false;
+
+	// the nearest layer above the edited one is applied first
+	for(std::vector<const Layer*>::const_reverse_iterator j = upper_layers.rbegin(); j != upper_layers.rend(); ++j) {
+		const Layer &upper = **j;
+		// layer renders its context in the same coordinates,
+		// so the region stays where it is, only blending over it changes
+		if (upper.passes_render_rect() && !upper.reads_context())
+			continue;
+		// distortions, blur and others take their context from other places
+		if (!is_affine_transformation(upper))
+			return false;
+		etl::handle<Transform> transform = upper.get_transform();
+		if (!transform)
+			return false;
+		rect = transform->perform(rect);
+	}
+	return true;
+}
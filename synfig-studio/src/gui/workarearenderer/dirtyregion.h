@@ -0,0 +1,59 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file dirtyregion.h
+**	\brief Regions of the canvas changed by edits of its root layers
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_STUDIO_DIRTYREGION_H
+#define __SYNFIG_STUDIO_DIRTYREGION_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <synfig/canvas.h>
+#include <synfig/rect.h>
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace studio {
+
+class DirtyRegion
+{
+public:
+	//! returns region in units of the layer's canvas which may be changed by the layer
+	static synfig::Rect calc_layer_bounds(const synfig::Layer &layer);
+
+	//! maps region changed by the root layer through the layers above it
+	//! to the units of the rendered frame, translation, rotation, zoom and stretch
+	//! layers move the region, returns false if some of the other layers
+	//! moves or spreads its context, then the changed region is unknown
+	static bool map_to_frame(const synfig::Canvas &canvas, const synfig::Layer &layer, synfig::Rect &rect);
+};
+
+}; // END of namespace studio
+
+/* === E N D =============================================================== */
+
+#endif
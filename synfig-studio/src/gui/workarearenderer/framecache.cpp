@@ -0,0 +1,347 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file framecache.cpp
+**	\brief Rendered frames shared by the work area and the preview
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <algorithm>
+#include <cstdlib>
+
+#include <cairomm/context.h>
+
+#include <synfig/canvas.h>
+#include <synfig/general.h>
+#include <synfig/layers/layer_pastecanvas.h>
+#include <synfig/rendering/software/surfacesw.h>
+
+#include "framecache.h"
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace synfig;
+using namespace studio;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+/* === P R O C E D U R E S ================================================= */
+
+static bool
+same_aspect(int w0, int h0, int w1, int h1)
+{
+	// sizes are rounded to integer pixels, so allow the difference of one pixel
+	return std::abs((long long)w0*h1 - (long long)w1*h0) <= (long long)std::max(w0 + h0, w1 + h1);
+}
+
+/* === M E T H O D S ======================================================= */
+
+FrameCache::Key::Key(
+	const Canvas *canvas,
+	const rendering::Renderer *renderer,
+	bool render_excluded_contexts,
+	const Time &time,
+	int width,
+	int height
+):
+	canvas(canvas ? canvas->get_guid() : GUID::zero()),
+	renderer(renderer),
+	render_excluded_contexts(render_excluded_contexts && canvas && instance().has_excluded_layers(*canvas)),
+	time(time),
+	width(width),
+	height(height)
+{ }
+
+FrameCache::FrameCache():
+	max_size(128ll*1024*1024),
+	size(),
+	last_usage()
+{ }
+
+FrameCache::~FrameCache()
+{
+	for(Map::iterator i = frames.begin(); i != frames.end(); ++i)
+		cairo_surface_destroy(i->second.surface);
+}
+
+FrameCache&
+FrameCache::instance()
+{
+	static FrameCache frame_cache;
+	return frame_cache;
+}
+
+PixelFormat
+FrameCache::get_pixel_format()
+{
+	// check endianness
+	union { int i; char c[4]; } checker = {0x01020304};
+	bool big_endian = checker.c[0] == 1;
+
+	return big_endian
+	     ? (PF_A_START | PF_RGB | PF_A_PREMULT)
+	     : (PF_BGR | PF_A | PF_A_PREMULT);
+}
+
+bool
+FrameCache::find_excluded_layers(const Canvas &canvas)
+{
+	for(Canvas::const_iterator i = canvas.begin(); i != canvas.end(); ++i) {
+		if ((*i)->get_exclude_from_rendering())
+			return true;
+		if (const Layer_PasteCanvas *paste = dynamic_cast<const Layer_PasteCanvas*>(i->get()))
+			if (Canvas::Handle sub_canvas = paste->get_sub_canvas())
+				if (find_excluded_layers(*sub_canvas))
+					return true;
+	}
+	return false;
+}
+
+bool
+FrameCache::has_excluded_layers(const Canvas &canvas)
+{
+	GUID id = canvas.get_guid();
+	long long generation;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		const CanvasState &state = canvases[id];
+		if (state.excluded_layers >= 0)
+			return state.excluded_layers > 0;
+		generation = state.generation;
+	}
+
+	// walk outside of the lock, canvas may be changed meanwhile,
+	// so the result is stored only if the generation is still the same
+	bool excluded = find_excluded_layers(canvas);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	CanvasState &state = canvases[id];
+	if (state.generation == generation)
+		state.excluded_layers = excluded ? 1 : 0;
+	return excluded;
+}
+
+Cairo::RefPtr<Cairo::ImageSurface>
+FrameCache::convert(const rendering::SurfaceResource::Handle &surface)
+{
+	rendering::SurfaceResource::LockRead<rendering::SurfaceSW> lock(surface);
+	if (!lock) return Cairo::RefPtr<Cairo::ImageSurface>();
+
+	const Surface &s = lock->get_surface();
+	if (!s.is_valid()) return Cairo::RefPtr<Cairo::ImageSurface>();
+
+	Cairo::RefPtr<Cairo::ImageSurface> frame =
+		Cairo::ImageSurface::create(Cairo::FORMAT_ARGB32, s.get_w(), s.get_h());
+	frame->flush();
+	color_to_pixelformat(
+		frame->get_data(),
+		&s[0][0],
+		get_pixel_format(),
+		nullptr,
+		s.get_w(),
+		s.get_h(),
+		frame->get_stride(),
+		s.get_pitch() );
+	frame->mark_dirty();
+	frame->flush();
+	return frame;
+}
+
+bool
+FrameCache::convert(const Cairo::RefPtr<Cairo::ImageSurface> &frame, const rendering::SurfaceResource::Handle &surface)
+{
+	if (!frame || !surface) return false;
+
+	surface->create(frame->get_width(), frame->get_height());
+	rendering::SurfaceResource::LockWrite<rendering::SurfaceSW> lock(surface);
+	if (!lock) return false;
+
+	Surface &s = lock->get_surface();
+	if (s.get_w() != frame->get_width() || s.get_h() != frame->get_height())
+		return false;
+
+	frame->flush();
+	pixelformat_to_color(
+		&s[0][0],
+		frame->get_data(),
+		get_pixel_format(),
+		s.get_w(),
+		s.get_h(),
+		s.get_pitch(),
+		frame->get_stride() );
+	return true;
+}
+
+void
+FrameCache::insert(const Key &key, cairo_surface_t *surface)
+{
+	// mutex must be already locked
+	Entry &entry = frames[key];
+	if (entry.surface)
+		cairo_surface_destroy(entry.surface);
+	else
+		size += frame_size(key);
+	entry.surface = surface;
+	entry.last_usage = ++last_usage;
+	remove_extra_frames();
+}
+
+void
+FrameCache::remove_extra_frames()
+{
+	// mutex must be already locked
+	while(size > max_size && !frames.empty()) {
+		Map::iterator oldest = frames.begin();
+		for(Map::iterator i = frames.begin(); i != frames.end(); ++i)
+			if (i->second.last_usage < oldest->second.last_usage)
+				oldest = i;
+		size -= frame_size(oldest->first);
+		cairo_surface_destroy(oldest->second.surface);
+		frames.erase(oldest);
+	}
+}
+
+void
+FrameCache::set_max_size(long long max_size)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	this->max_size = max_size;
+	remove_extra_frames();
+}
+
+long long
+FrameCache::get_max_size()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return max_size;
+}
+
+long long
+FrameCache::get_generation(const GUID &canvas)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return canvases[canvas].generation;
+}
+
+bool
+FrameCache::contains(const Key &key)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return frames.count(key) > 0;
+}
+
+void
+FrameCache::put(const Key &key, const Cairo::RefPtr<Cairo::ImageSurface> &frame, long long generation)
+{
+	if (!key.canvas || !frame || key.width <= 0 || key.height <= 0)
+		return;
+	if (frame->get_width() != key.width || frame->get_height() != key.height) {
+		synfig::warning("FrameCache: frame with wrong size");
+		return;
+	}
+
+	frame->flush();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (canvases[key.canvas].generation != generation || frame_size(key) > max_size)
+		return;
+	insert(key, cairo_surface_reference(frame->cobj()));
+}
+
+Cairo::RefPtr<Cairo::ImageSurface>
+FrameCache::get(const Key &key)
+{
+	if (!key.canvas || key.width <= 0 || key.height <= 0)
+		return Cairo::RefPtr<Cairo::ImageSurface>();
+
+	cairo_surface_t *source = nullptr;
+	long long generation;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		Map::iterator i = frames.find(key);
+		if (i != frames.end()) {
+			i->second.last_usage = ++last_usage;
+			return Cairo::RefPtr<Cairo::ImageSurface>(
+				new Cairo::ImageSurface(cairo_surface_reference(i->second.surface), true) );
+		}
+
+		// find the smallest frame with higher resolution
+		Map::iterator best = frames.end();
+		for(i = frames.begin(); i != frames.end(); ++i)
+			if ( i->first.same_frame(key)
+			  && i->first.width >= key.width
+			  && i->first.height >= key.height
+			  && same_aspect(i->first.width, i->first.height, key.width, key.height)
+			  && (best == frames.end() || i->first.width < best->first.width) )
+				best = i;
+		if (best == frames.end())
+			return Cairo::RefPtr<Cairo::ImageSurface>();
+
+		best->second.last_usage = ++last_usage;
+		source = cairo_surface_reference(best->second.surface);
+		generation = canvases[key.canvas].generation;
+	}
+
+	// downscale outside of the lock, surfaces in cache are never changed
+	Cairo::RefPtr<Cairo::ImageSurface> source_frame(new Cairo::ImageSurface(source, true));
+	Cairo::RefPtr<Cairo::ImageSurface> frame =
+		Cairo::ImageSurface::create(Cairo::FORMAT_ARGB32, key.width, key.height);
+	Cairo::RefPtr<Cairo::Context> context = Cairo::Context::create(frame);
+	context->scale(
+		(double)key.width/(double)source_frame->get_width(),
+		(double)key.height/(double)source_frame->get_height() );
+	Cairo::RefPtr<Cairo::SurfacePattern> pattern = Cairo::SurfacePattern::create(source_frame);
+	pattern->set_filter(Cairo::FILTER_GOOD);
+	context->set_operator(Cairo::OPERATOR_SOURCE);
+	context->set_source(pattern);
+	context->paint();
+	frame->flush();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (canvases[key.canvas].generation == generation && frame_size(key) <= max_size)
+		insert(key, cairo_surface_reference(frame->cobj()));
+	return frame;
+}
+
+void
+FrameCache::clear(const GUID &canvas)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	CanvasState &state = canvases[canvas];
+	++state.generation;
+	state.excluded_layers = -1;
+	for(Map::iterator i = frames.begin(); i != frames.end(); )
+		if (i->first.canvas == canvas) {
+			size -= frame_size(i->first);
+			cairo_surface_destroy(i->second.surface);
+			frames.erase(i++);
+		} else ++i;
+}
@@ -0,0 +1,177 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file framecache.h
+**	\brief Rendered frames shared by the work area and the preview
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_STUDIO_FRAMECACHE_H
+#define __SYNFIG_STUDIO_FRAMECACHE_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <map>
+#include <mutex>
+
+#include <cairo.h>
+#include <cairomm/surface.h>
+
+#include <synfig/color/pixelformat.h>
+#include <synfig/guid.h>
+#include <synfig/rendering/renderer.h>
+#include <synfig/rendering/surface.h>
+#include <synfig/time.h>
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace synfig { class Canvas; }
+
+namespace studio {
+
+//! Keeps whole rendered frames of canvases, so the work area and the preview
+//! may take frames rendered by each other.
+//! Frames are stored as premultiplied ARGB32 images without background.
+//! Frames of canvas are valid until clear() is called for it on any change.
+//! Canvases are identified by GUID, so a new canvas never takes frames of
+//! the deleted one, even if it is allocated at the same address.
+//! Missing frame may be downscaled from the cached frame of higher resolution.
+//! This class is thread-safe.
+class FrameCache
+{
+public:
+	class Key {
+	public:
+		synfig::GUID canvas;
+		const synfig::rendering::Renderer *renderer;
+		bool render_excluded_contexts;
+		synfig::Time time;
+		int width;
+		int height;
+
+		Key(): canvas(synfig::GUID::zero()), renderer(), render_excluded_contexts(), width(), height() { }
+		//! render_excluded_contexts is ignored when canvas has no excluded layers,
+		//! so the work area and the preview will share frames of such canvases
+		Key(
+			const synfig::Canvas *canvas,
+			const synfig::rendering::Renderer *renderer,
+			bool render_excluded_contexts,
+			const synfig::Time &time,
+			int width,
+			int height );
+
+		//! same frame at the other resolution
+		bool same_frame(const Key &other) const {
+			return canvas == other.canvas
+			    && renderer == other.renderer
+			    && render_excluded_contexts == other.render_excluded_contexts
+			    && time == other.time;
+		}
+
+		bool operator< (const Key &other) const {
+			if (canvas != other.canvas) return canvas < other.canvas;
+			if (renderer != other.renderer) return renderer < other.renderer;
+			if (render_excluded_contexts != other.render_excluded_contexts) return other.render_excluded_contexts;
+			if (time < other.time) return true;
+			if (other.time < time) return false;
+			if (width != other.width) return width < other.width;
+			return height < other.height;
+		}
+	};
+
+private:
+	class Entry {
+	public:
+		//! raw cairo surface, because reference counter of Cairo::RefPtr is not thread-safe
+		cairo_surface_t *surface;
+		long long last_usage;
+		Entry(): surface(), last_usage() { }
+	};
+
+	class CanvasState {
+	public:
+		long long generation;
+		//! excluded layers of the current generation: -1 - not known yet, 0 - no, 1 - yes
+		int excluded_layers;
+		CanvasState(): generation(), excluded_layers(-1) { }
+	};
+
+	typedef std::map<Key, Entry> Map;
+
+	std::mutex mutex;
+	Map frames;
+	std::map<synfig::GUID, CanvasState> canvases;
+	long long max_size;
+	long long size;
+	long long last_usage;
+
+	FrameCache();
+	~FrameCache();
+
+	static long long frame_size(const Key &key)
+		{ return 4ll*key.width*key.height; }
+
+	static bool find_excluded_layers(const synfig::Canvas &canvas);
+	//! walks the canvas once per generation
+	bool has_excluded_layers(const synfig::Canvas &canvas);
+
+	//! mutex must be locked before call, takes ownership of the surface reference
+	void insert(const Key &key, cairo_surface_t *surface);
+	//! mutex must be locked before call
+	void remove_extra_frames();
+
+public:
+	static FrameCache& instance();
+
+	//! pixel format of frames in the cache and of the work area tiles
+	static synfig::PixelFormat get_pixel_format();
+
+	//! converts rendered surface to the cache format, returns empty pointer on failure
+	static Cairo::RefPtr<Cairo::ImageSurface> convert(const synfig::rendering::SurfaceResource::Handle &surface);
+	//! fills rendering surface by the cached frame
+	static bool convert(const Cairo::RefPtr<Cairo::ImageSurface> &frame, const synfig::rendering::SurfaceResource::Handle &surface);
+
+	void set_max_size(long long max_size);
+	long long get_max_size();
+
+	//! generation of canvas is changed on each clear(),
+	//! frames rendered for the previous generation will not be accepted
+	long long get_generation(const synfig::GUID &canvas);
+
+	bool contains(const Key &key);
+	//! frame must not be changed after this call
+	void put(const Key &key, const Cairo::RefPtr<Cairo::ImageSurface> &frame, long long generation);
+	//! returns cached frame, or downscaled copy of frame with the same aspect and higher resolution,
+	//! or empty pointer
+	Cairo::RefPtr<Cairo::ImageSurface> get(const Key &key);
+
+	//! removes all frames of canvas, call it on any change of canvas
+	void clear(const synfig::GUID &canvas);
+};
+
+}; // END of namespace studio
+
+/* === E N D =============================================================== */
+
+#endif
@@ -35,20 +35,34 @@
 #	include <config.h>
 #endif
 
+#include <algorithm>
+#include <cmath>
 #include <cstring>
+#include <set>
 #include <valarray>
 
+#include <glibmm/checksum.h>
+
+#include <ETL/stringf>
+
 #include <synfig/general.h>
+#include <synfig/canvasfilenaming.h>
 #include <synfig/context.h>
 #include <synfig/threadpool.h>
 #include <synfig/rendering/renderer.h>
 #include <synfig/rendering/common/task/tasktransformation.h>
 
+#include <synfigapp/main.h>
+
+#include <gui/app.h>
 #include <gui/canvasview.h>
+#include <gui/instance.h>
 #include <gui/localization.h>
 #include <gui/timemodel.h>
 #include <gui/workarea.h>
 
+#include "dirtyregion.h"
+#include "framecache.h"
 #include "renderer_canvas.h"
 
 #endif
@@ -66,8 +80,35 @@ using namespace studio;
 
 /* === G L O B A L S ======================================================= */
 
+// work area shows the layers excluded from rendering
+static const bool render_excluded_contexts = true;
+
 /* === P R O C E D U R E S ================================================= */
 
+//! collects files used by layers of canvas, such as imported images, sounds and external canvases
+static void
+collect_external_files(const Canvas::Handle &canvas, std::set<String> &files, std::set<const Canvas*> &visited)
+{
+	if (!canvas || !visited.insert(canvas.get()).second)
+		return;
+	for(Canvas::const_iterator i = canvas->begin(); i != canvas->end(); ++i) {
+		const String canvas_filename = (*i)->get_canvas() ? (*i)->get_canvas()->get_file_name() : canvas->get_file_name();
+
+		ValueBase filename_value = (*i)->get_param("filename");
+		if (filename_value.get_type() == type_string && !filename_value.get(String()).empty())
+			files.insert(CanvasFileNaming::make_full_filename(canvas_filename, filename_value.get(String())));
+
+		ValueBase canvas_value = (*i)->get_param("canvas");
+		if (canvas_value.get_type() == type_canvas) {
+			Canvas::Handle sub_canvas(canvas_value.get(Canvas::Handle()));
+			if (sub_canvas && !sub_canvas->is_inline() && sub_canvas->get_file_name() != canvas_filename)
+				files.insert(sub_canvas->get_file_name());
+			collect_external_files(sub_canvas, files, visited);
+		}
+	}
+}
+
+
 static int
 int_floor(int x, int base)
 	{ int m = x % base; return m < 0 ? x - base - m : m > 0 ? x - m : x; }
@@ -80,11 +121,42 @@ static long long
 image_rect_size(const RectInt &rect)
 	{ return 4ll*rect.get_width()*rect.get_height(); }
 
+static RectInt
+units_to_pixels(const RendDesc &rend_desc, const Rect &rect, int w, int h)
+{
+	// tl and br of the canvas always maps to corners of frame, even if canvas is flipped
+	const int antialias_margin = 2;
+	Vector tl = rend_desc.get_tl();
+	Vector br = rend_desc.get_br();
+	if (approximate_equal(tl[0], br[0]) || approximate_equal(tl[1], br[1]))
+		return RectInt(0, 0, w, h);
+
+	Real kx = w/(br[0] - tl[0]);
+	Real ky = h/(br[1] - tl[1]);
+	Real x0 = (rect.minx - tl[0])*kx, x1 = (rect.maxx - tl[0])*kx;
+	Real y0 = (rect.miny - tl[1])*ky, y1 = (rect.maxy - tl[1])*ky;
+	if (x1 < x0) std::swap(x0, x1);
+	if (y1 < y0) std::swap(y0, y1);
+
+	// clamp before conversion to int
+	x0 = std::max(x0, -1.0); x1 = std::min(x1, w + 1.0);
+	y0 = std::max(y0, -1.0); y1 = std::min(y1, h + 1.0);
+	if (x1 < x0 || y1 < y0)
+		return RectInt::zero();
+
+	RectInt pixels(
+		(int)std::floor(x0) - antialias_margin,
+		(int)std::floor(y0) - antialias_margin,
+		(int)std::ceil(x1) + antialias_margin,
+		(int)std::ceil(y1) + antialias_margin );
+	return pixels &= RectInt(0, 0, w, h);
+}
+
 /* === M E T H O D S ======================================================= */
 
 Renderer_Canvas::Renderer_Canvas():
-	max_tiles_size_soft(512*1024*1024),
-	max_tiles_size_hard(max_tiles_size_soft + 128*1024*1024),
+	max_tiles_size_soft(512ll*1024*1024),
+	max_tiles_size_hard(max_tiles_size_soft + max_tiles_size_soft/4),
 	weight_future      (   1.0), // high priority
 	weight_past        (   2.0), // low priority
 	weight_future_extra(  16.0),
@@ -93,17 +165,15 @@ Renderer_Canvas::Renderer_Canvas():
 	weight_zoom_out    (1024.0),
 	max_enqueued_tasks (6),
 	enqueued_tasks(),
+	loading_tiles(),
 	tiles_size(),
-	pixel_format()
+	pixel_format(FrameCache::get_pixel_format()),
+	frame_cache_canvas(GUID::zero()),
+	content_key_saved(),
+	content_changes(),
+	dirty_unknown(true),
+	child_changed(false)
 {
-	// check endianness
-    union { int i; char c[4]; } checker = {0x01020304};
-    bool big_endian = checker.c[0] == 1;
-
-    pixel_format = big_endian
-		         ? (PF_A_START | PF_RGB | PF_A_PREMULT)
-		         : (PF_BGR | PF_A | PF_A_PREMULT);
-
 	alpha_src_surface = Cairo::ImageSurface::create(
 		Cairo::FORMAT_ARGB32, 1, 1);
 	alpha_dst_surface = Cairo::ImageSurface::create(
@@ -120,7 +190,13 @@ Renderer_Canvas::Renderer_Canvas():
 }
 
 Renderer_Canvas::~Renderer_Canvas()
-	{ clear_render(); }
+{
+	clear_render();
+
+	// tiles which are being read from disk hold the pointer to this object
+	std::unique_lock<std::mutex> lock(mutex);
+	tiles_loaded.wait(lock, [this]() { return !loading_tiles; });
+}
 
 void
 Renderer_Canvas::on_tile_finished_callback(bool success, Renderer_Canvas *obj, Tile::Handle tile)
@@ -141,6 +217,29 @@ Renderer_Canvas::on_post_tile_finished_callback(etl::handle<Renderer_Canvas> obj
 		obj->on_post_tile_finished(tile);
 }
 
+void
+Renderer_Canvas::load_tile_callback(Renderer_Canvas *obj, Tile::Handle tile, String filename)
+{
+	// This method called from the other threads
+	// Destructor of 'obj' waits until all of the enqueued tiles will loaded
+	obj->load_tile(tile, filename);
+}
+
+void
+Renderer_Canvas::on_post_tile_loaded_callback(etl::handle<Renderer_Canvas> obj, Tile::Handle tile, String filename, bool success) {
+	// this function should be called in main thread
+	if (obj->get_work_area())
+		obj->on_post_tile_loaded(tile, filename, success);
+}
+
+void
+Renderer_Canvas::pack_tile_callback(Renderer_Canvas *obj, Tile::Handle tile, Cairo::RefPtr<Cairo::ImageSurface> cairo_surface)
+{
+	// This method called from the other threads
+	// Destructor of 'obj' waits until all of the enqueued tiles will packed
+	obj->pack_tile_surface(tile, cairo_surface);
+}
+
 Cairo::RefPtr<Cairo::ImageSurface>
 Renderer_Canvas::convert(
 	const rendering::SurfaceResource::Handle &surface,
@@ -243,6 +342,7 @@ Renderer_Canvas::on_tile_finished(bool success, const Tile::Handle &tile)
 	tile->event.reset();
 	tile->cairo_surface = cairo_surface;
 	tile->surface.reset();
+	update_tile_size(*tile);
 
 	// don't create handle if ref-count is zero
 	// it means that object was nether had a handles and will removed with handle
@@ -270,6 +370,7 @@ Renderer_Canvas::on_post_tile_finished(const Tile::Handle &tile)
 	}
 
 	if (get_work_area()) {
+		publish_frame(tile->frame_id);
 		get_work_area()->signal_rendering()();
 		get_work_area()->signal_rendering_tile_finished()(time);
 		if (tile_visible)
@@ -280,13 +381,304 @@ Renderer_Canvas::on_post_tile_finished(const Tile::Handle &tile)
 	}
 }
 
+void
+Renderer_Canvas::load_tile(const Tile::Handle &tile, const String &filename)
+{
+	// this method must be called from load_tile_callback()
+	// this method may be called from other threads
+
+	TileStorage::Data data;
+	Cairo::RefPtr<Cairo::ImageSurface> cairo_surface;
+	if (TileStorage::load(filename, data))
+		cairo_surface = TileStorage::unpack(data, tile->rect.get_width(), tile->rect.get_height());
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	--loading_tiles;
+	tile->loading = false;
+
+	// tile may be removed while loading
+	if (cairo_surface && tile->filename == filename && !tile->cairo_surface) {
+		tile->packed.swap(data);
+		tile->cairo_surface = cairo_surface;
+		update_tile_size(*tile);
+	}
+
+	if (shared_object::count())
+		Glib::signal_idle().connect_once(
+			sigc::bind(sigc::ptr_fun(&on_post_tile_loaded_callback), etl::handle<Renderer_Canvas>(this), tile, filename, (bool)cairo_surface),
+			visible_frames.count(tile->frame_id) ? Glib::PRIORITY_DEFAULT : Glib::PRIORITY_DEFAULT_IDLE );
+
+	tiles_loaded.notify_all();
+}
+
+void
+Renderer_Canvas::on_post_tile_loaded(const Tile::Handle &tile, const String &filename, bool success)
+{
+	// this method must be called from on_post_tile_loaded_callback()
+	bool tile_visible = false;
+	rendering::Task::List events;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		tile_visible = visible_frames.count(tile->frame_id);
+		if (!success && tile->filename == filename) {
+			// file is lost or damaged, so remove tile to render it again
+			synfig::warning("Renderer_Canvas: stored tile is damaged");
+			storage.remove(filename);
+			TileMap::iterator i = tiles.find(tile->frame_id);
+			if (i != tiles.end()) {
+				TileList::iterator j = std::find(i->second.begin(), i->second.end(), tile);
+				if (j != i->second.end())
+					erase_tile(i->second, j, events);
+			}
+		}
+	}
+	rendering::Renderer::cancel(events);
+
+	get_work_area()->signal_rendering()();
+	if (tile_visible)
+		get_work_area()->queue_draw(); // enqueue_render will called while draw
+}
+
+void
+Renderer_Canvas::pack_tile_surface(const Tile::Handle &tile, const Cairo::RefPtr<Cairo::ImageSurface> &cairo_surface)
+{
+	// this method must be called from pack_tile_callback()
+	// this method may be called from other threads
+
+	TileStorage::Data data;
+	TileStorage::pack(cairo_surface, data);
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	--loading_tiles;
+	tile->packing = false;
+
+	// tile may be removed, rendered again or shown while packing
+	if ( !data.empty()
+	  && tile->cairo_surface == cairo_surface
+	  && tile->packed.empty()
+	  && !tile->event
+	  && !visible_frames.count(tile->frame_id)
+	  && tile->frame_id != current_thumb )
+	{
+		tile->packed.swap(data);
+		tile->cairo_surface = Cairo::RefPtr<Cairo::ImageSurface>();
+		update_tile_size(*tile);
+	}
+
+	tiles_loaded.notify_all();
+}
+
+void
+Renderer_Canvas::publish_frame(const FrameId &id)
+{
+	// this method may be called from the main thread only
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (calc_frame_status(id, id.rect()) != FS_Done)
+			return;
+	}
+
+	Canvas::Handle canvas = get_work_area()->get_canvas();
+	rendering::Renderer::Handle renderer = rendering::Renderer::get_renderer(get_work_area()->get_renderer());
+	if (!canvas || !renderer)
+		return;
+
+	FrameCache &frame_cache = FrameCache::instance();
+	FrameCache::Key key(canvas.get(), renderer.get(), true, id.time, id.width, id.height);
+	long long generation = frame_cache.get_generation(canvas->get_guid());
+	if (frame_cache.contains(key))
+		return;
+
+	// compose whole frame from tiles
+	Cairo::RefPtr<Cairo::ImageSurface> frame =
+		Cairo::ImageSurface::create(Cairo::FORMAT_ARGB32, id.width, id.height);
+	{
+		Cairo::RefPtr<Cairo::Context> context = Cairo::Context::create(frame);
+		context->set_operator(Cairo::OPERATOR_SOURCE);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (calc_frame_status(id, id.rect()) != FS_Done)
+			return;
+		const TileList &list = tiles[id];
+		for(TileList::const_iterator i = list.begin(); i != list.end(); ++i)
+			if (*i && (*i)->cairo_surface) {
+				context->set_source((*i)->cairo_surface, (*i)->rect.minx, (*i)->rect.miny);
+				context->rectangle((*i)->rect.minx, (*i)->rect.miny, (*i)->rect.get_width(), (*i)->rect.get_height());
+				context->fill();
+			}
+	}
+	frame->flush();
+
+	frame_cache.put(key, frame, generation);
+}
+
+void
+Renderer_Canvas::update_storage(const Canvas::Handle &canvas, const String &renderer_name)
+{
+	// this method may be called from the main thread only
+	if (!App::workarea_disk_cache || !canvas) {
+		storage.set_root(String(), 0);
+		return;
+	}
+	storage.set_root(
+		synfigapp::Main::get_user_app_directory() + ETL_DIRECTORY_SEPARATOR + "framecache",
+		App::workarea_disk_cache_size*1024ll*1024ll );
+
+	// tiles stored by the previous sessions are valid while the saved document and its files are the same,
+	// unsaved content is identified by the canvas and count of its changes, so it is not reused by other sessions
+	bool saved = get_work_area()->get_instance() && !get_work_area()->get_instance()->get_action_count();
+	if (content_key.empty() || content_key_saved != saved) {
+		String document_stamp = saved ? TileStorage::file_stamp(canvas->get_file_name()) : String();
+		if (document_stamp.empty())
+			content_key = strprintf("canvas:%s;changes:%lld",
+				canvas->get_guid().get_string().c_str(), content_changes);
+		else
+			content_key = strprintf("document:%s;%s",
+				canvas->get_file_name().c_str(), document_stamp.c_str());
+
+		std::set<String> files;
+		std::set<const Canvas*> visited;
+		collect_external_files(canvas, files, visited);
+		for(std::set<String>::const_iterator i = files.begin(); i != files.end(); ++i)
+			content_key += strprintf(";file:%s;%s", i->c_str(), TileStorage::file_stamp(*i).c_str());
+		content_key_saved = saved;
+	}
+
+	// rendered tiles depends on the render settings too
+	String cache_key;
+	{
+		const int *onion_skins = get_work_area()->get_onion_skins();
+		String settings = strprintf("%s;renderer:%s;excluded_contexts:%d;pixel_format:%d;onion:%d,%d,%d,%d",
+			content_key.c_str(),
+			renderer_name.c_str(),
+			(int)render_excluded_contexts,
+			(int)pixel_format,
+			(int)get_work_area()->get_onion_skin(),
+			onion_skins[0],
+			onion_skins[1],
+			(int)get_work_area()->get_onion_skin_keyframes() );
+		cache_key = Glib::Checksum::compute_checksum(Glib::Checksum::CHECKSUM_SHA1, settings);
+	}
+	if (cache_key == storage.get_key())
+		return;
+
+	storage.set_key(cache_key);
+
+	// files of the tiles belongs to the previous key
+	std::lock_guard<std::mutex> lock(mutex);
+	for(TileMap::iterator i = tiles.begin(); i != tiles.end(); ++i)
+		for(TileList::iterator j = i->second.begin(); j != i->second.end(); ++j)
+			if (*j && ((*j)->cairo_surface || !(*j)->packed.empty()))
+				(*j)->filename.clear();
+}
+
+void
+Renderer_Canvas::update_tile_size(Tile &tile)
+{
+	// mutex must be already locked
+	long long size = tile.event || tile.surface || tile.cairo_surface
+	               ? image_rect_size(tile.rect) + (long long)tile.packed.size()
+	               : (long long)tile.packed.size();
+	tiles_size += size - tile.size;
+	tile.size = size;
+}
+
+void
+Renderer_Canvas::pack_tile(Tile &tile)
+{
+	// mutex must be already locked
+	if (tile.event || !tile.cairo_surface || tile.packing) return;
+	if (!tile.packed.empty()) {
+		tile.cairo_surface = Cairo::RefPtr<Cairo::ImageSurface>();
+		update_tile_size(tile);
+		return;
+	}
+
+	// don't block the main thread by packing, tile keeps the surface until it is packed
+	tile.packing = true;
+	++loading_tiles;
+	ThreadPool::instance().enqueue( sigc::bind(
+		sigc::ptr_fun(&pack_tile_callback), this, Tile::Handle(&tile), tile.cairo_surface ));
+}
+
+bool
+Renderer_Canvas::unpack_tile(Tile &tile)
+{
+	// mutex must be already locked
+	if (tile.event || tile.cairo_surface) return true;
+	if (tile.packed.empty()) {
+		// nothing was rendered or tile is being read
+		if (tile.filename.empty() || tile.loading) return true;
+
+		// don't block drawing by the disk, tile will be redrawn when it is read
+		tile.loading = true;
+		++loading_tiles;
+		ThreadPool::instance().enqueue( sigc::bind(
+			sigc::ptr_fun(&load_tile_callback), this, Tile::Handle(&tile), tile.filename ));
+		return true;
+	}
+
+	tile.cairo_surface = TileStorage::unpack(tile.packed, tile.rect.get_width(), tile.rect.get_height());
+	if (!tile.cairo_surface) {
+		synfig::warning("Renderer_Canvas: stored tile is damaged");
+		tile.packed.clear();
+		if (!tile.filename.empty()) storage.remove(tile.filename);
+		update_tile_size(tile);
+		return false;
+	}
+	update_tile_size(tile);
+	return true;
+}
+
+bool
+Renderer_Canvas::spill_tile(Tile &tile)
+{
+	// mutex must be already locked
+	if (tile.event || !storage.is_enabled()) return false;
+	if (tile.packed.empty()) {
+		// tile will be moved to disk by one of the next calls, when it is packed
+		if (!tile.cairo_surface) return false;
+		pack_tile(tile);
+		return true;
+	}
+
+	if (tile.filename.empty())
+		tile.filename = storage.save(tile.frame_id.time, tile.frame_id.width, tile.frame_id.height, tile.rect, tile.packed);
+	if (tile.filename.empty()) return false;
+
+	TileStorage::Data().swap(tile.packed);
+	tile.cairo_surface = Cairo::RefPtr<Cairo::ImageSurface>();
+	update_tile_size(tile);
+	return true;
+}
+
+void
+Renderer_Canvas::load_stored_tiles(TileList &list, const FrameId &id)
+{
+	// mutex must be already locked
+	const TileStorage::EntryList &entries = storage.find(id.time, id.width, id.height);
+	for(TileStorage::EntryList::const_iterator i = entries.begin(); i != entries.end(); ++i) {
+		bool exists = false;
+		for(TileList::const_iterator j = list.begin(); j != list.end() && !exists; ++j)
+			if (*j && ((*j)->rect && i->rect)) exists = true;
+		if (exists) continue;
+
+		RectInt rect = i->rect;
+		Tile::Handle tile = new Tile(id, rect);
+		tile->filename = i->filename;
+		insert_tile(list, tile);
+	}
+}
+
 void
 Renderer_Canvas::insert_tile(TileList &list, const Tile::Handle &tile)
 {
 	// this method may be called from other threads
 	// mutex must be already locked
 	list.push_back(tile);
-	tiles_size += image_rect_size(tile->rect);
+	update_tile_size(*tile);
 }
 
 Renderer_Canvas::TileList::iterator
@@ -295,10 +687,13 @@ Renderer_Canvas::erase_tile(TileList &list, TileList::iterator i, rendering::Tas
 	// this method may be called from other threads
 	// mutex must be already locked
 	if ((*i)->event) events.push_back((*i)->event);
-	tiles_size -= image_rect_size((*i)->rect);
+	tiles_size -= (*i)->size;
+	(*i)->size = 0;
 	(*i)->event.reset();
 	(*i)->surface.reset();
 	(*i)->cairo_surface = Cairo::RefPtr<Cairo::ImageSurface>();
+	TileStorage::Data().swap((*i)->packed);
+	(*i)->filename.clear();
 	return list.erase(i);
 }
 
@@ -307,6 +702,12 @@ Renderer_Canvas::remove_extra_tiles(rendering::Task::List &events)
 {
 	// mutex must be already locked
 
+	// invisible tiles are kept packed, usually frames have large areas of the same color
+	for(TileMap::iterator i = tiles.begin(); i != tiles.end(); ++i)
+		if (!visible_frames.count(i->first) && i->first != current_thumb)
+			for(TileList::iterator j = i->second.begin(); j != i->second.end(); ++j)
+				if (*j) pack_tile(**j);
+
 	typedef std::multimap<Real, TileMap::iterator> WeightMap;
 	WeightMap sorted_frames;
 
@@ -330,10 +731,12 @@ Renderer_Canvas::remove_extra_tiles(rendering::Task::List &events)
 		}
 	}
 
-	// remove some extra tiles to free the memory
-	for(WeightMap::reverse_iterator ri = sorted_frames.rbegin(); ri != sorted_frames.rend() && tiles_size > max_tiles_size_hard; ++ri)
-		while(!ri->second->second.empty() && tiles_size > max_tiles_size_hard)
-			erase_tile(ri->second->second, ri->second->second.begin(), events);
+	// move some extra tiles to disk or remove them to free the memory
+	for(WeightMap::reverse_iterator ri = sorted_frames.rbegin(); ri != sorted_frames.rend() && tiles_size > max_tiles_size_hard; ++ri) {
+		TileList &list = ri->second->second;
+		for(TileList::iterator j = list.begin(); j != list.end() && tiles_size > max_tiles_size_hard; )
+			if (!(*j)->size || spill_tile(**j)) ++j; else j = erase_tile(list, j, events);
+	}
 
 	// remove empty entries from tiles map
 	for(TileMap::iterator i = tiles.begin(); i != tiles.end(); )
@@ -473,10 +876,25 @@ Renderer_Canvas::enqueue_render_frame(
 
 	rend_desc.clear_flags();
 	rend_desc.set_wh(w, h);
-	rend_desc.set_render_excluded_contexts(true);
+	rend_desc.set_render_excluded_contexts(render_excluded_contexts);
 	ContextParams context_params(rend_desc.get_render_excluded_contexts());
 	TileList &frame_tiles = tiles[id];
 
+	// take tiles stored by the previous renderings
+	if (storage.is_enabled())
+		load_stored_tiles(frame_tiles, id);
+
+	// take whole frame rendered by the preview
+	if (frame_tiles.empty()) {
+		FrameCache::Key key(canvas.get(), renderer.get(), true, id.time, w, h);
+		if (Cairo::RefPtr<Cairo::ImageSurface> frame = FrameCache::instance().get(key)) {
+			RectInt rect = id.rect();
+			Tile::Handle tile = new Tile(id, rect);
+			tile->cairo_surface = frame;
+			insert_tile(frame_tiles, tile);
+		}
+	}
+
 	// create transformation matrix to flip result if needed
 	bool transform = false;
 	Matrix matrix;
@@ -580,6 +998,12 @@ Renderer_Canvas::enqueue_render()
 {
 	assert(get_work_area());
 
+	// remember bounds of layers to find changed regions later, see clear_dirty_render()
+	if (Canvas::Handle canvas = get_work_area()->get_canvas())
+		if (!get_work_area()->get_canvas_view()->is_playing())
+			update_layer_bounds(canvas);
+	update_storage(get_work_area()->get_canvas(), get_work_area()->get_renderer());
+
 	rendering::Task::List events;
 
 	{
@@ -594,6 +1018,11 @@ Renderer_Canvas::enqueue_render()
 		bool			is_playing = canvas_view->is_playing();
 		bool			is_bounded = time_model->get_play_bounds_enabled();
 
+		max_tiles_size_soft = App::workarea_cache_size*1024ll*1024ll;
+		max_tiles_size_hard = max_tiles_size_soft + max_tiles_size_soft/4;
+		FrameCache::instance().set_max_size(max_tiles_size_soft/4);
+		frame_cache_canvas = canvas->get_guid();
+
 		build_onion_frames();
 
 		rendering::Renderer::Handle renderer = rendering::Renderer::get_renderer(renderer_name);
@@ -626,7 +1055,11 @@ Renderer_Canvas::enqueue_render()
 				bool time_in_repeat_range = time_model->get_time() >= time_model->get_play_bounds_lower()
 						                 && time_model->get_time() <= time_model->get_play_bounds_upper();
 				
-				while(bg_rendering && enqueued_tasks < max_tasks && tiles_size + frame_size < max_tiles_size_soft)
+				// when disk storage is enabled, the extra tiles will moved to disk by remove_extra_tiles()
+				while( bg_rendering
+					&& enqueued_tasks < max_tasks
+					&& ( tiles_size + frame_size < max_tiles_size_soft
+					  || (storage.is_enabled() && !storage.is_full(frame_size)) ) )
 				{
 					Time future_time = current_frame.time + frame_duration*future;
 					bool future_exists = future_time >= time_model->get_lower()
@@ -732,11 +1165,135 @@ Renderer_Canvas::clear_render()
 		tiles.clear();
 		rendering_error_msg_map.clear();
 	}
+	content_key.clear();
+	++content_changes;
+	if (frame_cache_canvas)
+		FrameCache::instance().clear(frame_cache_canvas);
 	rendering::Renderer::cancel(events);
 	if (cleared && get_work_area())
 		get_work_area()->signal_rendering()();
 }
 
+void
+Renderer_Canvas::update_layer_bounds(const Canvas::Handle &canvas)
+{
+	if (!layer_bounds.empty() && layer_bounds_time == canvas->get_time())
+		return;
+	layer_bounds.clear();
+	layer_bounds_time = canvas->get_time();
+	for(Canvas::const_iterator i = canvas->begin(); i != canvas->end(); ++i)
+		layer_bounds[i->get()] = DirtyRegion::calc_layer_bounds(**i);
+}
+
+void
+Renderer_Canvas::reset_dirty()
+{
+	dirty_layers.clear();
+	dirty_unknown = false;
+	child_changed = false;
+}
+
+void
+Renderer_Canvas::on_canvas_child_changed(const Node *node)
+{
+	// frames rendered by the preview are outdated too
+	if (frame_cache_canvas)
+		FrameCache::instance().clear(frame_cache_canvas);
+	content_key.clear();
+	++content_changes;
+
+	child_changed = true;
+	if (dirty_unknown)
+		return;
+
+	Canvas::Handle canvas = get_work_area() ? get_work_area()->get_canvas() : Canvas::Handle();
+	const Layer *layer = dynamic_cast<const Layer*>(node);
+	std::map<const Layer*, Rect>::const_iterator i = layer_bounds.find(layer);
+	if ( !canvas
+	  || i == layer_bounds.end()
+	  || layer_bounds_time != canvas->get_time()
+	  || (!dirty_layers.empty() && dirty_time != layer_bounds_time) )
+		{ dirty_unknown = true; return; }
+
+	// new bounds will be calculated in clear_dirty_render,
+	// when parameters of layer will be actualized for the current time
+	dirty_layers.insert(std::make_pair(Layer::Handle(const_cast<Layer*>(layer)), i->second));
+	dirty_time = layer_bounds_time;
+}
+
+void
+Renderer_Canvas::on_canvas_changed()
+{
+	// layer was added, removed or moved, or canvas changed by other way
+	if (!child_changed)
+		dirty_unknown = true;
+	child_changed = false;
+	content_key.clear();
+	++content_changes;
+	if (frame_cache_canvas)
+		FrameCache::instance().clear(frame_cache_canvas);
+}
+
+void
+Renderer_Canvas::clear_dirty_render()
+{
+	Canvas::Handle canvas = get_work_area() ? get_work_area()->get_canvas() : Canvas::Handle();
+	if (!canvas || dirty_unknown || dirty_layers.empty() || dirty_time != canvas->get_time()) {
+		reset_dirty();
+		layer_bounds.clear();
+		clear_render();
+		return;
+	}
+
+	// actualize parameters of changed layers
+	canvas->set_time(dirty_time);
+	Rect rect;
+	bool known = true;
+	for(std::map<Layer::Handle, Rect>::const_iterator i = dirty_layers.begin(); i != dirty_layers.end(); ++i) {
+		Rect bounds = DirtyRegion::calc_layer_bounds(*i->first);
+		layer_bounds[i->first.get()] = bounds;
+		// old and new look of the layer, as they are seen through the layers above
+		Rect layer_rect = i->second | bounds;
+		if (!DirtyRegion::map_to_frame(*canvas, *i->first, layer_rect))
+			{ known = false; break; }
+		rect = i == dirty_layers.begin() ? layer_rect : rect | layer_rect;
+	}
+
+	Time time = dirty_time;
+	reset_dirty();
+	FrameCache::instance().clear(canvas->get_guid());
+	if (!known || rect.is_nan_or_inf() || std::isinf(rect.minx) || std::isinf(rect.miny)) {
+		clear_render();
+		return;
+	}
+
+	RendDesc rend_desc = canvas->rend_desc();
+	rendering::Task::List events;
+	bool cleared = false;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for(TileMap::iterator i = tiles.begin(); i != tiles.end(); ++i) {
+			// changed layers may look different at other times, so other frames are cleared entirely
+			RectInt pixels = i->first.time.is_equal(time)
+			               ? units_to_pixels(rend_desc, rect, i->first.width, i->first.height)
+			               : i->first.rect();
+			for(TileList::iterator j = i->second.begin(); j != i->second.end(); )
+				if (*j && ((*j)->rect && pixels))
+					{ j = erase_tile(i->second, j, events); cleared = true; }
+				else
+					++j;
+		}
+
+		// remove empty entries from tiles map
+		for(TileMap::iterator i = tiles.begin(); i != tiles.end(); )
+			if (i->second.empty()) tiles.erase(i++); else ++i;
+		rendering_error_msg_map.clear();
+	}
+	rendering::Renderer::cancel(events);
+	if (cleared)
+		get_work_area()->signal_rendering()();
+}
+
 Renderer_Canvas::FrameStatus
 Renderer_Canvas::merge_status(FrameStatus a, FrameStatus b) {
 	static const FrameStatus map[FS_Count][FS_Count] = {
@@ -925,12 +1482,15 @@ Renderer_Canvas::render_vfunc(
 
 		// draw tiles
 		canvas_context->save();
+		rendering::Task::List events;
 		for(FrameList::const_iterator i = onion_frames.begin(); i != onion_frames.end(); ++i) {
-			TileMap::const_iterator ii = tiles.find(i->id);
+			TileMap::iterator ii = tiles.find(i->id);
 			if (ii == tiles.end()) continue;
-			for(TileList::const_iterator j = ii->second.begin(); j != ii->second.end(); ++j) {
-				if (!*j) continue;
-				if ((*j)->cairo_surface) {
+			for(TileList::iterator j = ii->second.begin(); j != ii->second.end(); ) {
+				// tiles may be packed or stored on disk
+				if (*j && !unpack_tile(**j))
+					{ j = erase_tile(ii->second, j, events); continue; }
+				if (*j && (*j)->cairo_surface) {
 					rects_subtract(empty_rects, (*j)->rect); // mark area as not empty
 					canvas_context->save();
 					canvas_context->rectangle((*j)->rect.minx, (*j)->rect.miny, (*j)->rect.get_width(), (*j)->rect.get_height());
@@ -942,6 +1502,7 @@ Renderer_Canvas::render_vfunc(
 						canvas_context->paint();
 					canvas_context->restore();
 				}
+				++j;
 			}
 		}
 		canvas_context->restore();
@@ -1009,7 +1570,8 @@ Renderer_Canvas::get_thumb(const Time &time)
 {
 	std::lock_guard<std::mutex> lock(mutex);
 	TileMap::const_iterator i = tiles.find( current_thumb.with_time(time) );
-	return i == tiles.end() || i->second.empty() || !*(i->second.begin())
-		 ? Cairo::RefPtr<Cairo::ImageSurface>()
-		 : (*(i->second.begin()))->cairo_surface;
+	if (i == tiles.end() || i->second.empty() || !*(i->second.begin()))
+		return Cairo::RefPtr<Cairo::ImageSurface>();
+	Tile &tile = **(i->second.begin());
+	return unpack_tile(tile) ? tile.cairo_surface : Cairo::RefPtr<Cairo::ImageSurface>();
 }
@@ -31,14 +31,17 @@
 
 /* === H E A D E R S ======================================================= */
 
+#include <condition_variable>
 #include <vector>
 #include <map>
+#include <set>
 
 #include <synfig/canvas.h>
 #include <synfig/rendering/task.h>
 #include <synfig/rendering/renderer.h>
 #include <synfig/time.h>
 
+#include "tilestorage.h"
 #include "workarearenderer.h"
 
 /* === M A C R O S ========================================================= */
@@ -124,9 +127,20 @@ public:
 		synfig::rendering::SurfaceResource::Handle surface;
 		Cairo::RefPtr<Cairo::ImageSurface> cairo_surface;
 
-		Tile() { }
+		//! rendered tile may be kept packed in memory or stored on disk only
+		TileStorage::Data packed;
+		synfig::String filename;
+		//! file of tile is being read by the other thread
+		bool loading;
+		//! cairo_surface of tile is being packed by the other thread
+		bool packing;
+
+		//! memory used by tile, counted in tiles_size
+		long long size;
+
+		Tile(): loading(), packing(), size() { }
 		Tile(const FrameId &frame_id, synfig::RectInt &rect):
-			frame_id(frame_id), rect(rect) { }
+			frame_id(frame_id), rect(rect), loading(), packing(), size() { }
 	};
 
 	typedef std::map<synfig::Time, FrameStatus> StatusMap;
@@ -137,8 +151,8 @@ public:
 
 private:
 	// cache options
-	const long long max_tiles_size_soft; //!< threshold for creation of new tiles
-	const long long max_tiles_size_hard; //!< threshold for removing already created tiles
+	long long max_tiles_size_soft;       //!< threshold for creation of new tiles, see App::workarea_cache_size
+	long long max_tiles_size_hard;       //!< threshold for removing already created tiles
 	const synfig::Real weight_future;    //!< will multiply to frames count
 	const synfig::Real weight_past;
 	const synfig::Real weight_future_extra;
@@ -147,11 +161,15 @@ private:
 	const synfig::Real weight_zoom_out;
 	const int max_enqueued_tasks;
 
-	//! controls access to fields: enqueued_tasks, tiles, onion_frames, visible_frames, current_frame, frame_duration, tiles_size
+	//! controls access to fields: enqueued_tasks, loading_tiles, tiles, onion_frames, visible_frames, current_frame, frame_duration, tiles_size
 	std::mutex mutex;
 
 	int enqueued_tasks;
 
+	//! count of tiles which files are being read or which are being packed, destructor waits for them
+	int loading_tiles;
+	std::condition_variable tiles_loaded;
+
 	//! stored tiles may be actual/outdated and rendered/not-rendered
 	TileMap tiles;
 
@@ -167,6 +185,9 @@ private:
 
 	synfig::PixelFormat pixel_format;
 
+	//! canvas which frames are shared by FrameCache, used from the main thread only
+	synfig::GUID frame_cache_canvas;
+
 	//! uses to normalize alpha value after blending of onion surfaces
 	Cairo::RefPtr<Cairo::ImageSurface> alpha_src_surface;
 	Cairo::RefPtr<Cairo::ImageSurface> alpha_dst_surface;
@@ -180,6 +201,9 @@ private:
 	// Renderer_Canvas is non-thread-safe sigc::trackable, so use static callback methods in signals
 	static void on_tile_finished_callback(bool success, Renderer_Canvas *obj, Tile::Handle tile);
 	static void on_post_tile_finished_callback(etl::handle<Renderer_Canvas> obj, Tile::Handle tile);
+	static void load_tile_callback(Renderer_Canvas *obj, Tile::Handle tile, synfig::String filename);
+	static void on_post_tile_loaded_callback(etl::handle<Renderer_Canvas> obj, Tile::Handle tile, synfig::String filename, bool success);
+	static void pack_tile_callback(Renderer_Canvas *obj, Tile::Handle tile, Cairo::RefPtr<Cairo::ImageSurface> cairo_surface);
 
 	//! this method may be called from the other threads
 	void on_tile_finished(bool success, const Tile::Handle &tile);
@@ -187,11 +211,55 @@ private:
 	//! this method may be called from the main thread only
 	void on_post_tile_finished(const Tile::Handle &tile);
 
+	//! puts fully rendered frame to FrameCache, so the preview may reuse it
+	//! this method may be called from the main thread only
+	void publish_frame(const FrameId &id);
+
 	//! this method may be called from the other threads
 	Cairo::RefPtr<Cairo::ImageSurface> convert(
 		const synfig::rendering::SurfaceResource::Handle &surface,
 		int width, int height ) const;
 
+	//! this method may be called from the other threads
+	void load_tile(const Tile::Handle &tile, const synfig::String &filename);
+
+	//! this method may be called from the main thread only
+	void on_post_tile_loaded(const Tile::Handle &tile, const synfig::String &filename, bool success);
+
+	//! this method may be called from other threads
+	void pack_tile_surface(const Tile::Handle &tile, const Cairo::RefPtr<Cairo::ImageSurface> &cairo_surface);
+
+	//! invisible tiles and tiles stored on disk, used from the main thread only
+	TileStorage storage;
+	//! canvas part of the storage key, empty when canvas was changed
+	synfig::String content_key;
+	//! content_key was built for the document without unsaved changes
+	bool content_key_saved;
+	//! incremented on each change of canvas, identifies unsaved content within the session
+	long long content_changes;
+
+	//! this method may be called from the main thread only
+	void update_storage(const synfig::Canvas::Handle &canvas, const synfig::String &renderer_name);
+
+	//! mutex must be locked before call
+	void update_tile_size(Tile &tile);
+
+	//! mutex must be locked before call
+	//! tile is packed by the other thread, it keeps cairo_surface until then
+	void pack_tile(Tile &tile);
+
+	//! mutex must be locked before call, may be called from the main thread only
+	//! returns false if stored data of tile is lost,
+	//! tile stored on disk only is read by the other thread and redrawn later
+	bool unpack_tile(Tile &tile);
+
+	//! mutex must be locked before call, may be called from the main thread only
+	//! returns false if tile cannot be moved to disk
+	bool spill_tile(Tile &tile);
+
+	//! mutex must be locked before call, may be called from the main thread only
+	void load_stored_tiles(TileList &list, const FrameId &id);
+
 	//! mutex must be locked before call
 	void insert_tile(TileList &list, const Tile::Handle &tile);
 
@@ -218,6 +286,23 @@ private:
 
 	std::map<synfig::Time, std::set<std::string>> rendering_error_msg_map;
 
+	// dirty region tracking, fields used from the main thread only
+
+	//! bounds of the root canvas layers at layer_bounds_time
+	std::map<const synfig::Layer*, synfig::Rect> layer_bounds;
+	synfig::Time layer_bounds_time;
+
+	//! layers changed since last clear with their old bounds
+	std::map<synfig::Layer::Handle, synfig::Rect> dirty_layers;
+	synfig::Time dirty_time;
+	bool dirty_unknown;
+	bool child_changed;
+
+	//! this method may be called from the main thread only
+	void update_layer_bounds(const synfig::Canvas::Handle &canvas);
+
+	void reset_dirty();
+
 public:
 	Renderer_Canvas();
 	~Renderer_Canvas();
@@ -228,6 +313,14 @@ public:
 	void wait_render();
 	void clear_render();
 
+	//! clears only tiles touched by the canvas changes collected since last call,
+	//! falls back to clear_render() when changed region is unknown
+	void clear_dirty_render();
+
+	// handlers of the root canvas signals, main thread only
+	void on_canvas_child_changed(const synfig::Node *node);
+	void on_canvas_changed();
+
 	void get_render_status(StatusMap &out_map);
 
 	void get_rendering_error_messages(std::vector<std::string>& messages);
@@ -0,0 +1,344 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file tilestorage.cpp
+**	\brief Compressed and on-disk storage for rendered tiles
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include <glib/gstdio.h>
+
+#include <ETL/stringf>
+
+#include <synfig/filesystemnative.h>
+#include <synfig/general.h>
+
+#include "tilestorage.h"
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace synfig;
+using namespace studio;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+static const std::uint32_t repeat_flag = 0x80000000u;
+
+/* === P R O C E D U R E S ================================================= */
+
+static void
+write_token(TileStorage::Data &data, std::uint32_t token)
+{
+	size_t size = data.size();
+	data.resize(size + sizeof(token));
+	memcpy(&data[size], &token, sizeof(token));
+}
+
+static void
+write_pixels(TileStorage::Data &data, const std::uint32_t *pixels, int count)
+{
+	size_t size = data.size();
+	data.resize(size + count*sizeof(*pixels));
+	memcpy(&data[size], pixels, count*sizeof(*pixels));
+}
+
+static long long
+file_size(const String &filename)
+{
+	GStatBuf buf;
+	return g_stat(filename.c_str(), &buf) ? 0 : (long long)buf.st_size;
+}
+
+static long long
+file_mtime(const String &filename)
+{
+	GStatBuf buf;
+	return g_stat(filename.c_str(), &buf) ? 0 : (long long)buf.st_mtime;
+}
+
+/* === M E T H O D S ======================================================= */
+
+TileStorage::TileStorage():
+	disk_limit(),
+	disk_size()
+{ }
+
+void
+TileStorage::pack(const Cairo::RefPtr<Cairo::ImageSurface> &surface, Data &out_data)
+{
+	out_data.clear();
+	if (!surface) return;
+
+	surface->flush();
+	const int width = surface->get_width();
+	const int height = surface->get_height();
+	const int stride = surface->get_stride();
+	const unsigned char *data = surface->get_data();
+
+	// each row is a sequence of tokens:
+	// (repeat_flag | count) followed by single pixel, or count followed by count literal pixels
+	std::vector<std::uint32_t> row(width);
+	for(int y = 0; y < height; ++y) {
+		memcpy(&row.front(), data + y*stride, width*sizeof(std::uint32_t));
+		const std::uint32_t *p = &row.front(), *end = p + width, *literal = p;
+		while(p < end) {
+			const std::uint32_t *run = p + 1;
+			while(run < end && *run == *p) ++run;
+			if (run - p > 2) {
+				if (literal < p) {
+					write_token(out_data, std::uint32_t(p - literal));
+					write_pixels(out_data, literal, int(p - literal));
+				}
+				write_token(out_data, repeat_flag | std::uint32_t(run - p));
+				write_pixels(out_data, p, 1);
+				literal = p = run;
+			} else {
+				p = run;
+			}
+		}
+		if (literal < end) {
+			write_token(out_data, std::uint32_t(end - literal));
+			write_pixels(out_data, literal, int(end - literal));
+		}
+	}
+	out_data.shrink_to_fit();
+}
+
+Cairo::RefPtr<Cairo::ImageSurface>
+TileStorage::unpack(const Data &data, int width, int height)
+{
+	if (width <= 0 || height <= 0)
+		return Cairo::RefPtr<Cairo::ImageSurface>();
+
+	Cairo::RefPtr<Cairo::ImageSurface> surface =
+		Cairo::ImageSurface::create(Cairo::FORMAT_ARGB32, width, height);
+	surface->flush();
+	const int stride = surface->get_stride();
+	unsigned char *dst = surface->get_data();
+
+	const unsigned char *src = data.empty() ? nullptr : &data.front();
+	const unsigned char *src_end = src + data.size();
+	for(int y = 0; y < height; ++y) {
+		std::uint32_t *p = (std::uint32_t*)(dst + y*stride);
+		std::uint32_t *end = p + width;
+		while(p < end) {
+			std::uint32_t token;
+			if (src_end - src < (long)sizeof(token))
+				return Cairo::RefPtr<Cairo::ImageSurface>();
+			memcpy(&token, src, sizeof(token));
+			src += sizeof(token);
+
+			std::uint32_t count = token & ~repeat_flag;
+			if (!count || count > std::uint32_t(end - p))
+				return Cairo::RefPtr<Cairo::ImageSurface>();
+
+			if (token & repeat_flag) {
+				std::uint32_t pixel;
+				if (src_end - src < (long)sizeof(pixel))
+					return Cairo::RefPtr<Cairo::ImageSurface>();
+				memcpy(&pixel, src, sizeof(pixel));
+				src += sizeof(pixel);
+				std::fill(p, p + count, pixel);
+			} else {
+				if (src_end - src < (long)(count*sizeof(*p)))
+					return Cairo::RefPtr<Cairo::ImageSurface>();
+				memcpy(p, src, count*sizeof(*p));
+				src += count*sizeof(*p);
+			}
+			p += count;
+		}
+	}
+	if (src != src_end)
+		return Cairo::RefPtr<Cairo::ImageSurface>();
+
+	surface->mark_dirty();
+	surface->flush();
+	return surface;
+}
+
+String
+TileStorage::frame_name(const Time &time, int width, int height)
+	{ return strprintf("%lld_%d_%d", (long long)std::round((double)time*1e6), width, height); }
+
+String
+TileStorage::key_directory() const
+	{ return root + ETL_DIRECTORY_SEPARATOR + key; }
+
+String
+TileStorage::file_stamp(const String &filename)
+{
+	GStatBuf buf;
+	if (filename.empty() || g_stat(filename.c_str(), &buf)) return String();
+	return strprintf("%lld,%lld", (long long)buf.st_mtime, (long long)buf.st_size);
+}
+
+void
+TileStorage::set_root(const String &root, long long disk_limit)
+{
+	this->disk_limit = disk_limit;
+	if (this->root == root) return;
+	this->root = root;
+	scan();
+}
+
+void
+TileStorage::set_key(const String &key)
+{
+	if (this->key == key) return;
+	this->key = key;
+	scan();
+}
+
+void
+TileStorage::scan()
+{
+	index.clear();
+	disk_size = 0;
+	if (!is_enabled()) return;
+
+	FileSystem::Handle fs = FileSystemNative::instance();
+	if (!fs->directory_create(root) || !fs->directory_create(key_directory())) {
+		synfig::warning("TileStorage: cannot create directory %s", key_directory().c_str());
+		root.clear();
+		return;
+	}
+
+	remove_old_keys();
+
+	FileSystem::FileList files;
+	fs->directory_scan(key_directory(), files);
+	for(FileSystem::FileList::const_iterator i = files.begin(); i != files.end(); ++i) {
+		long long time_us;
+		int w, h;
+		RectInt rect;
+		char tail[8] = {};
+		if ( 8 != sscanf(i->c_str(), "%lld_%d_%d_%d_%d_%d_%d.%4s", &time_us, &w, &h, &rect.minx, &rect.miny, &rect.maxx, &rect.maxy, tail)
+		  || strcmp(tail, "tile") || !rect.is_valid() )
+			continue;
+		String filename = key_directory() + ETL_DIRECTORY_SEPARATOR + *i;
+		index[frame_name(Time((double)time_us*1e-6), w, h)].push_back(Entry(rect, filename));
+		disk_size += file_size(filename);
+	}
+}
+
+void
+TileStorage::remove_old_keys()
+{
+	// total size of storage is limited, so remove the least recently used keys
+	FileSystem::Handle fs = FileSystemNative::instance();
+	FileSystem::FileList keys;
+	fs->directory_scan(root, keys);
+
+	typedef std::multimap<long long, String> KeyMap;
+	KeyMap sorted_keys;
+	long long total_size = 0;
+	for(FileSystem::FileList::const_iterator i = keys.begin(); i != keys.end(); ++i) {
+		String dir = root + ETL_DIRECTORY_SEPARATOR + *i;
+		if (*i == key || !fs->is_directory(dir)) continue;
+		FileSystem::FileList files;
+		fs->directory_scan(dir, files);
+		for(FileSystem::FileList::const_iterator j = files.begin(); j != files.end(); ++j)
+			total_size += file_size(dir + ETL_DIRECTORY_SEPARATOR + *j);
+		sorted_keys.insert(KeyMap::value_type(file_mtime(dir), dir));
+	}
+
+	for(KeyMap::const_iterator i = sorted_keys.begin(); i != sorted_keys.end() && total_size > disk_limit/2; ++i) {
+		FileSystem::FileList files;
+		fs->directory_scan(i->second, files);
+		for(FileSystem::FileList::const_iterator j = files.begin(); j != files.end(); ++j) {
+			String filename = i->second + ETL_DIRECTORY_SEPARATOR + *j;
+			total_size -= file_size(filename);
+			fs->file_remove(filename);
+		}
+		fs->file_remove(i->second);
+	}
+}
+
+const TileStorage::EntryList&
+TileStorage::find(const Time &time, int width, int height) const
+{
+	static const EntryList empty;
+	if (index.empty()) return empty;
+	std::map<String, EntryList>::const_iterator i = index.find(frame_name(time, width, height));
+	return i == index.end() ? empty : i->second;
+}
+
+String
+TileStorage::save(const Time &time, int width, int height, const RectInt &rect, const Data &data)
+{
+	if (!is_enabled() || data.empty() || disk_size + (long long)data.size() > disk_limit)
+		return String();
+
+	String filename = key_directory() + ETL_DIRECTORY_SEPARATOR
+	                + frame_name(time, width, height)
+	                + strprintf("_%d_%d_%d_%d.tile", rect.minx, rect.miny, rect.maxx, rect.maxy);
+	std::ofstream file(filesystem::Path(filename).c_str(), std::ios::binary);
+	if (!file.write((const char*)&data.front(), data.size())) {
+		file.close();
+		FileSystemNative::instance()->file_remove(filename);
+		return String();
+	}
+
+	disk_size += (long long)data.size();
+	index[frame_name(time, width, height)].push_back(Entry(rect, filename));
+	return filename;
+}
+
+bool
+TileStorage::load(const String &filename, Data &out_data)
+{
+	out_data.clear();
+	std::ifstream file(filesystem::Path(filename).c_str(), std::ios::binary | std::ios::ate);
+	if (!file) return false;
+	std::streamoff size = file.tellg();
+	if (size <= 0) return false;
+	out_data.resize((size_t)size);
+	file.seekg(0);
+	return (bool)file.read((char*)&out_data.front(), size);
+}
+
+void
+TileStorage::remove(const String &filename)
+{
+	disk_size -= file_size(filename);
+	FileSystemNative::instance()->file_remove(filename);
+	for(std::map<String, EntryList>::iterator i = index.begin(); i != index.end(); ++i)
+		for(EntryList::iterator j = i->second.begin(); j != i->second.end(); ++j)
+			if (j->filename == filename)
+				{ i->second.erase(j); return; }
+}
@@ -0,0 +1,117 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file tilestorage.h
+**	\brief Compressed and on-disk storage for rendered tiles
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === S T A R T =========================================================== */
+
+#ifndef __SYNFIG_STUDIO_TILESTORAGE_H
+#define __SYNFIG_STUDIO_TILESTORAGE_H
+
+/* === H E A D E R S ======================================================= */
+
+#include <map>
+#include <vector>
+
+#include <cairomm/surface.h>
+
+#include <synfig/rect.h>
+#include <synfig/string.h>
+#include <synfig/time.h>
+
+/* === M A C R O S ========================================================= */
+
+/* === T Y P E D E F S ===================================================== */
+
+/* === C L A S S E S & S T R U C T S ======================================= */
+
+namespace studio {
+
+//! Keeps rendered tiles of the work area which are not visible now.
+//! Tiles are packed in memory, and may be written to the disk directory
+//! selected by the key of canvas content, so they will be reused
+//! when the same document will be opened again.
+//! This class is not thread-safe.
+class TileStorage
+{
+public:
+	typedef std::vector<unsigned char> Data;
+
+	class Entry {
+	public:
+		synfig::RectInt rect;
+		synfig::String filename;
+		Entry() { }
+		Entry(const synfig::RectInt &rect, const synfig::String &filename):
+			rect(rect), filename(filename) { }
+	};
+
+	typedef std::vector<Entry> EntryList;
+
+private:
+	synfig::String root;
+	synfig::String key;
+	long long disk_limit;
+	long long disk_size;
+
+	//! files of the current key grouped by frame
+	std::map<synfig::String, EntryList> index;
+
+	static synfig::String frame_name(const synfig::Time &time, int width, int height);
+	synfig::String key_directory() const;
+	void scan();
+	void remove_old_keys();
+
+public:
+	TileStorage();
+
+	//! packs ARGB32 surface, runs of the equal pixels are stored once
+	static void pack(const Cairo::RefPtr<Cairo::ImageSurface> &surface, Data &out_data);
+	//! returns empty pointer if data is corrupted
+	static Cairo::RefPtr<Cairo::ImageSurface> unpack(const Data &data, int width, int height);
+
+	//! returns modification time and size of file, or empty string if file is not exists,
+	//! may be called from any thread
+	static synfig::String file_stamp(const synfig::String &filename);
+
+	//! empty root disables the disk storage
+	void set_root(const synfig::String &root, long long disk_limit);
+	void set_key(const synfig::String &key);
+
+	const synfig::String& get_key() const { return key; }
+	bool is_enabled() const { return !root.empty() && !key.empty(); }
+	bool is_full(long long reserve) const { return disk_size + reserve > disk_limit; }
+
+	//! returns tiles of frame stored at disk for the current key
+	const EntryList& find(const synfig::Time &time, int width, int height) const;
+
+	//! returns name of file or empty string if disk is full
+	synfig::String save(const synfig::Time &time, int width, int height, const synfig::RectInt &rect, const Data &data);
+	//! may be called from any thread
+	static bool load(const synfig::String &filename, Data &out_data);
+	void remove(const synfig::String &filename);
+};
+
+}; // END of namespace studio
+
+/* === E N D =============================================================== */
+
+#endif
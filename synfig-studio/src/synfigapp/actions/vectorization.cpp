@@ -242,6 +242,8 @@ Action::Vectorization::perform()
 
     const etl::handle<UIInterface> ui_interface = get_canvas_interface()->get_ui_interface();
     std::vector< etl::handle<synfig::Layer> > Result = vCore.vectorize(image_layer,ui_interface, configuration, gamma);
+    if (vCore.isCanceled())
+        throw Error(Error::TYPE_UNABLE, _("Vectorization was cancelled"));
 
     synfig::Canvas::Handle child_canvas;
     child_canvas=synfig::Canvas::create_inline(layer->get_canvas());
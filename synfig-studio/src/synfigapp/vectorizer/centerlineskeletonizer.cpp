@@ -33,6 +33,8 @@
 /* === H E A D E R S ======================================================= */
 
 #include "polygonizerclasses.h"
+#include <algorithm>
+#include <functional>
 #include <queue>
 #include <synfig/vector.h>
 
@@ -1695,25 +1697,34 @@ static SkeletonGraph *skeletonize(ContourFamily &regionContours,
 //--------------------------------------------------------------------------
 
 SkeletonList* studio::skeletonize(Contours &contours, const etl::handle<synfigapp::UIInterface> &ui_interface, VectorizerCoreGlobals &g) {
-  VectorizationContext context(&g);
-
-  SkeletonList *res = new SkeletonList;
-  unsigned int i, j,contours_size = contours.size();
-
-  // Find overall number of nodes
-  unsigned int overallNodes = 0;
-  for (i = 0; i < contours.size(); ++i)
+  unsigned int i, j, contours_size = contours.size();
+  SkeletonList *res = new SkeletonList(contours_size, nullptr);
+
+  // Families are independent, so each one gets its own context and they are
+  // skeletonized in parallel. Bigger families are taken first, not to leave
+  // a long one alone at the end.
+  std::vector<std::pair<unsigned int, unsigned int> > order(contours_size);
+  for (i = 0; i < contours_size; ++i) {
+    unsigned int familyNodes = 0;
     for (j = 0; j < contours[i].size(); ++j)
-      overallNodes += contours[i][j].size();
-
-
-  for (i = 0; i <contours_size ; ++i) {
-    /* To be enabled in case on isCancenled is implemented
-        if (thisVectorizer->isCanceled()) break;
-    */
-    res->push_back(skeletonize(contours[i], context));
-    float partial = 30.0 + ((i/(float)contours_size)*30.0);
-    ui_interface->amount_complete(partial,100);
+      familyNodes += contours[i][j].size();
+    order[i] = std::make_pair(familyNodes, i);
+  }
+  std::sort(order.begin(), order.end(),
+            std::greater<std::pair<unsigned int, unsigned int> >());
+
+  bool completed = runInParallel(contours_size,
+    [&](unsigned int k) {
+      unsigned int family = order[k].second;
+      VectorizationContext context(&g);
+      (*res)[family] = skeletonize(contours[family], context);
+    },
+    ui_interface, 30, 60);
+
+  if (!completed) {
+    for (i = 0; i < res->size(); ++i) delete (*res)[i];
+    delete res;
+    return nullptr;
   }
 
   return res;
@@ -412,7 +412,7 @@ public:
 
   Length lengthOf(unsigned int a, unsigned int b);
   void addMiddlePoints();
-  etl::handle<synfig::Layer> operator()(std::vector<unsigned int> *indices);
+  PointList operator()(std::vector<unsigned int> *indices);
 
   // Length construction methods
   bool parametrize(unsigned int a, unsigned int b);
@@ -468,7 +468,7 @@ inline void SequenceConverter::addMiddlePoints()
 
 //--------------------------------------------------------------------------
 
-etl::handle<synfig::Layer> SequenceConverter::operator()(std::vector<unsigned int> *indices) {
+PointList SequenceConverter::operator()(std::vector<unsigned int> *indices) {
   // Prepare Sequence
   inputIndices = indices;
   addMiddlePoints();
@@ -521,10 +521,8 @@ etl::handle<synfig::Layer> SequenceConverter::operator()(std::vector<unsigned in
       controlPoints[a] = K[b].CPs[i];
   }
   controlPoints[0] = middleAddedSequence[0];
-  
-  etl::handle<synfig::Layer> res = BezierToOutline(controlPoints);
 
-  return res;
+  return controlPoints;
 }
 
 //--------------------------------------------------------------------------
@@ -879,12 +877,12 @@ bool SequenceConverter::penalty(unsigned int a, unsigned int b, Length &len)
 }
 
 //--------------------------------------------------------------------------
-inline etl::handle<synfig::Layer> convert(const Sequence &s, double penalty) 
+// Returns control points of the quadratic chunks, they are turned into a layer
+// by BezierToOutline. Only reads the graph, so sequences may be converted in parallel.
+inline PointList convert(const Sequence &s, double penalty) 
 {
   SkeletonGraph *graph = s.m_graphHolder;
 
-  etl::handle<synfig::Layer> result;
-
   // First, we simplify the skeleton sequences found
   std::vector<unsigned int> reducedIndices;
 
@@ -920,23 +918,21 @@ inline etl::handle<synfig::Layer> convert(const Sequence &s, double penalty)
     segment[1] = (*graph->getNode(s.m_head) + *graph->getNode(s.m_tail)) * 0.5;
     segment[2] = *graph->getNode(s.m_tail);
     
-    return BezierToOutline(segment);
+    return segment;
   }
   // when calculating sequence with 3 thick points where x,y are coordinates and z is thickness of stroke
   // it then build quadratic chunk using the three control points
 
   // Then, we convert the sequence in a quadratic stroke
   SequenceConverter converter(&s, penalty);
-  result = converter(&reducedIndices);
-
-  return result;
+  return converter(&reducedIndices);
 }
 
 // Converts each forward or single Sequence of the image in its corresponding
 // Stroke. 
 // In synfig we will be using outline layer instead of TStroke  
 
-void studio::conversionToStrokes(std::vector< etl::handle<synfig::Layer> > &strokes, VectorizerCoreGlobals &g,const etl::handle<synfig::Layer_Bitmap> &image) 
+bool studio::conversionToStrokes(std::vector< etl::handle<synfig::Layer> > &strokes, VectorizerCoreGlobals &g,const etl::handle<synfig::Layer_Bitmap> &image, const etl::handle<synfigapp::UIInterface> &ui_interface) 
 {
   SequenceList &singleSequences           = g.singleSequences;
   JointSequenceGraphList &organizedGraphs = g.organizedGraphs;
@@ -962,6 +958,7 @@ void studio::conversionToStrokes(std::vector< etl::handle<synfig::Layer> > &stro
   h_factor = ((topleft[1] - bottomright[1]) * unit_size)/(surface.get_h());
   w_factor = ((bottomright[0] - topleft[0]) * unit_size)/(surface.get_w());
 
+  std::vector<const Sequence *> sequences;
 
   for (i = 0; i < singleSequences.size(); ++i) 
   {
@@ -993,7 +990,7 @@ void studio::conversionToStrokes(std::vector< etl::handle<synfig::Layer> > &stro
       singleSequences[i].m_tailLink = 1;
     }
 
-    strokes.push_back(convert(singleSequences[i], penalty));
+    sequences.push_back(&singleSequences[i]);
   }
 
   // Convert graph sequences
@@ -1005,7 +1002,19 @@ void studio::conversionToStrokes(std::vector< etl::handle<synfig::Layer> > &stro
         for (k = 0; k < organizedGraphs[i].getNode(j).getLinksCount(); ++k) {
           // A sequence is taken at both extremities in our organized graphs
           if (organizedGraphs[i].getNode(j).getLink(k)->isForward())
-            strokes.push_back(
-                convert(*organizedGraphs[i].getNode(j).getLink(k), penalty));
+            sequences.push_back(&*organizedGraphs[i].getNode(j).getLink(k));
         }
+
+  // Graphs are not modified from here, so the geometry of the strokes is
+  // computed in parallel. Layers are created afterwards in this thread,
+  // keeping the order of the sequences.
+  std::vector<PointList> segments(sequences.size());
+  bool completed = runInParallel(sequences.size(),
+    [&](unsigned int n) { segments[n] = convert(*sequences[n], penalty); },
+    ui_interface, 80, 90);
+  if (!completed) return false;
+
+  for (i = 0; i < segments.size(); ++i)
+    strokes.push_back(BezierToOutline(segments[i]));
+  return true;
 }
@@ -40,10 +40,21 @@
 #	include <config.h>
 #endif
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+
+#include <sigc++/bind.h>
+
 #include "centerlinevectorizer.h"
 #include "polygonizerclasses.h"
 #include <synfig/layer.h>
 #include <synfig/debug/log.h>
+#include <synfig/threadpool.h>
 #endif
 
 /* === U S I N G =========================================================== */
@@ -57,6 +68,107 @@ using namespace studio;
 
 /* === P R O C E D U R E S ================================================= */
 
+namespace {
+
+// State shared by the calling thread and the ThreadPool workers of
+// runInParallel(). Workers may still be queued when the call returns,
+// so it is owned through shared_ptr and never runs a job after that.
+struct ParallelJobs {
+  std::function<void(unsigned int)> m_job;
+  unsigned int m_count;
+
+  std::atomic<unsigned int> m_next;       // index of the next job to take
+  std::atomic<unsigned int> m_started;    // calls of runNext() begun
+  std::atomic<unsigned int> m_finished;   // calls of runNext() ended
+  std::atomic<unsigned int> m_completed;  // jobs done without errors
+  std::atomic<bool> m_canceled;
+
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  std::exception_ptr m_exception;
+
+  ParallelJobs(unsigned int count, const std::function<void(unsigned int)> &job)
+      : m_job(job)
+      , m_count(count)
+      , m_next(0)
+      , m_started(0)
+      , m_finished(0)
+      , m_completed(0)
+      , m_canceled(false) {}
+
+  // Runs one job, returns false when there is nothing left to take
+  bool runNext() {
+    ++m_started;
+    unsigned int i = m_next++;
+    bool run       = i < m_count && !m_canceled;
+    if (run) {
+      try {
+        m_job(i);
+        ++m_completed;
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_exception) m_exception = std::current_exception();
+        m_canceled = true;
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_finished;
+    m_cond.notify_all();
+    return run;
+  }
+
+  // NOTE: m_finished is read before m_started, so a job taken before the
+  // queue was found exhausted is always seen as running
+  bool isDone() const {
+    if (m_next < m_count && !m_canceled) return false;
+    unsigned int finished = m_finished;
+    return finished == m_started;
+  }
+
+  int progress(int from, int to) const {
+    return from + (int)((long long)(to - from) * m_completed / m_count);
+  }
+};
+
+void runParallelJobs(std::shared_ptr<ParallelJobs> jobs) {
+  while (jobs->runNext())
+    ;
+}
+
+}  // namespace
+
+bool studio::runInParallel(unsigned int count, const std::function<void(unsigned int)> &job,
+                           const etl::handle<synfigapp::UIInterface> &ui_interface,
+                           int progressFrom, int progressTo) {
+  if (!count) return true;
+
+  std::shared_ptr<ParallelJobs> jobs = std::make_shared<ParallelJobs>(count, job);
+
+  ThreadPool &pool = ThreadPool::instance();
+  int helpers      = std::min((int)count, pool.get_max_threads()) - 1;
+  for (int i = 0; i < helpers; ++i)
+    pool.enqueue(sigc::bind(sigc::ptr_fun(&runParallelJobs), jobs));
+
+  // The calling thread takes jobs too, so the work goes on even when all
+  // the workers of the pool are busy with rendering
+  while (jobs->runNext())
+    if (!ui_interface->amount_complete(jobs->progress(progressFrom, progressTo), 100))
+      jobs->m_canceled = true;
+
+  std::unique_lock<std::mutex> lock(jobs->m_mutex);
+  while (!jobs->isDone()) {
+    jobs->m_cond.wait_for(lock, std::chrono::milliseconds(100));
+    lock.unlock();
+    if (!ui_interface->amount_complete(jobs->progress(progressFrom, progressTo), 100))
+      jobs->m_canceled = true;
+    lock.lock();
+  }
+
+  if (jobs->m_exception) std::rethrow_exception(jobs->m_exception);
+  return !jobs->m_canceled;
+}
+
 /* === M E T H O D S ======================================================= */
 
 inline void deleteSkeletonList(SkeletonList *skeleton) {
@@ -85,31 +197,36 @@ const CenterlineConfiguration &configuration,const Gamma &gamma)
 
   // step 2 
   // Extracts a polygonal, minimal yet faithful representation of image contours
+  std::vector< etl::handle<synfig::Layer> > sortibleResult;
+
   Contours polygons;
   studio::polygonize(image, polygons, globals);
-  ui_interface->amount_complete(3,10);
+  if (!ui_interface->amount_complete(3,10))
+  {
+    m_isCanceled = true;
+    return sortibleResult;
+  }
   
   // step 3
   // The process of skeletonization reduces all objects in an image to lines, 
   //  without changing the essential structure of the image.
+  // Contour families are independent and skeletonized in parallel.
   SkeletonList *skeletons = studio::skeletonize(polygons,ui_interface, globals);
-  ui_interface->amount_complete(6,10);
-  /* To be uncommented if isCanceled is needed in future
-  if (isCanceled()) 
+  if (!skeletons || !ui_interface->amount_complete(6,10))
   {
-    // Clean and return 0 at cancel command
-    deleteSkeletonList(skeletons);
-    std::cout<<"CenterlineVectorize cancelled\n";
+    // Clean and return nothing at cancel command
+    if (skeletons) deleteSkeletonList(skeletons);
+    synfig::debug::Log::info("","CenterlineVectorize cancelled");
+    m_isCanceled = true;
+    return sortibleResult;
   }
-  */
+
   // step 4
   // The raw skeleton data obtained from StraightSkeletonizer
   // class need to be grouped in joints and sequences before proceeding further
   studio::organizeGraphs(skeletons, globals);
   ui_interface->amount_complete(8,10);
 
-
-  std::vector< etl::handle<synfig::Layer> > sortibleResult;
   
   // step 5
   // Take samples of image colors to associate each sequence to its corresponding
@@ -118,7 +235,12 @@ const CenterlineConfiguration &configuration,const Gamma &gamma)
 
   // step 6
   // Converts each forward or single Sequence of the image in its corresponding Stroke.
-  studio::conversionToStrokes(sortibleResult, globals, image);
+  if (!studio::conversionToStrokes(sortibleResult, globals, image, ui_interface))
+  {
+    synfig::debug::Log::info("","CenterlineVectorize cancelled");
+    m_isCanceled = true;
+    sortibleResult.clear();
+  }
   ui_interface->amount_complete(9,10);
 
   deleteSkeletonList(skeletons);
@@ -37,6 +37,7 @@
 #define __SYNFIG_APP_POLYGONIZERCLASSES_H
 
 /* === H E A D E R S ======================================================= */
+#include <functional>
 #include <synfig/vector.h>
 #include "centerlinevectorizer.h"
 
@@ -476,16 +477,26 @@ const int infinity = 1000000;  // just a great enough number
 
 void polygonize(const etl::handle<synfig::Layer_Bitmap> &ras, Contours &polygons,VectorizerCoreGlobals &g);
 
+//! Returns nullptr if vectorization was cancelled through ui_interface
 SkeletonList *skeletonize(Contours &contours,const etl::handle<synfigapp::UIInterface> &ui_interface, VectorizerCoreGlobals &g);
 
 void organizeGraphs(SkeletonList *skeleton, VectorizerCoreGlobals &g);
 
 // void junctionRecovery(Contours *polygons, VectorizerCoreGlobals &g);
 
-void conversionToStrokes(std::vector< etl::handle<synfig::Layer> > &strokes, VectorizerCoreGlobals &g, const etl::handle<synfig::Layer_Bitmap> &image) ;
+//! Returns false if vectorization was cancelled through ui_interface
+bool conversionToStrokes(std::vector< etl::handle<synfig::Layer> > &strokes, VectorizerCoreGlobals &g, const etl::handle<synfig::Layer_Bitmap> &image, const etl::handle<synfigapp::UIInterface> &ui_interface);
 
  void calculateSequenceColors(const etl::handle<synfig::Layer_Bitmap> &ras, VectorizerCoreGlobals &g, const synfig::Gamma &gamma);
 
+//! Calls job(i) for every i in [0, count) on the synfig ThreadPool.
+//! Only the calling thread talks to ui_interface: it reports progress in the
+//! [progressFrom, progressTo] range of 100 and stops taking new jobs when the
+//! user cancels. Returns false if cancelled; exceptions of jobs are rethrown.
+bool runInParallel(unsigned int count, const std::function<void(unsigned int)> &job,
+                   const etl::handle<synfigapp::UIInterface> &ui_interface,
+                   int progressFrom, int progressTo);
+
 // void applyStrokeColors(std::vector<TStroke *> &strokes, const TRasterP &ras,
 //                        TPalette *palette, VectorizerCoreGlobals &g);
 
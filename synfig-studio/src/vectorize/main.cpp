@@ -0,0 +1,311 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file vectorize/main.cpp
+**	\brief Command line batch centerline vectorization of images
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+/* ========================================================================= */
+
+/* === H E A D E R S ======================================================= */
+
+#ifdef USING_PCH
+#	include "pch.h"
+#else
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <glibmm/init.h>
+
+#include <ETL/stringf>
+
+#include <synfig/canvas.h>
+#include <synfig/filesystemnative.h>
+#include <synfig/general.h>
+#include <synfig/layers/layer_bitmap.h>
+#include <synfig/rendering/surface.h>
+#include <synfig/savecanvas.h>
+#include <synfig/threadpool.h>
+
+#include <synfigapp/main.h>
+#include <synfigapp/uimanager.h>
+#include <synfigapp/vectorizer/centerlinevectorizer.h>
+
+#endif
+
+/* === U S I N G =========================================================== */
+
+using namespace synfig;
+
+/* === M A C R O S ========================================================= */
+
+/* === G L O B A L S ======================================================= */
+
+const char commandname[] = "synfigvectorize";
+
+// synfig units per image pixel, the same as for images imported by Synfig Studio
+const Real units_per_pixel = 1.0/60.0;
+
+/* === P R O C E D U R E S ================================================= */
+
+namespace {
+
+class VectorizeUIInterface: public synfigapp::ConsoleUIInterface {
+	int percent;
+public:
+	VectorizeUIInterface(): percent(-1) { }
+
+	void reset() { percent = -1; }
+
+	virtual bool amount_complete(int current, int total) {
+		int p = total > 0 ? 100*current/total : 0;
+		if (p != percent) {
+			percent = p;
+			std::cout << "\r  " << p << "%" << std::flush;
+		}
+		return true;
+	}
+};
+
+struct Options {
+	String output_dir;
+	int threshold;
+	int accuracy;
+	int despeckling;
+	int maxthickness;
+	bool keep_image;
+	int threads;
+	std::vector<String> files;
+
+	Options():
+		threshold(8),
+		accuracy(9),
+		despeckling(5),
+		maxthickness(200),
+		keep_image(false),
+		threads(0)
+	{ }
+
+	// values are taken in the scale of the Convert to Vector dialog of Synfig Studio
+	studio::CenterlineConfiguration get_configuration() const {
+		studio::CenterlineConfiguration conf;
+		conf.m_outline        = false;
+		conf.m_threshold      = threshold*25;
+		conf.m_penalty        = 10 - accuracy;
+		conf.m_despeckling    = despeckling*2;
+		conf.m_maxThickness   = maxthickness/2;
+		conf.m_thicknessRatio = 1.0;
+		conf.m_leaveUnpainted = false;
+		conf.m_makeFrame      = false;
+		conf.m_naaSource      = false;
+		return conf;
+	}
+};
+
+void
+print_usage()
+{
+	std::cout << std::endl;
+	std::cout << "usage: " << std::endl;
+	std::cout << "  " << commandname << " [options] <image> [<image> ...]" << std::endl;
+	std::cout << std::endl;
+	std::cout << "Every image is vectorized with the centerline method and saved" << std::endl;
+	std::cout << "as a .sif document with the same base name." << std::endl;
+	std::cout << std::endl;
+	std::cout << "Options:" << std::endl;
+	std::cout << "  -o, --output-dir <dir>    - Directory for the documents (default: next to the images)" << std::endl;
+	std::cout << "  --threshold <1..10>       - Darkest pixels taken into account as lines (default: 8)" << std::endl;
+	std::cout << "  --accuracy <1..10>        - How closely strokes follow the drawing (default: 9)" << std::endl;
+	std::cout << "  --despeckling <0..500>    - Size of noise areas to ignore (default: 5)" << std::endl;
+	std::cout << "  --max-thickness <0..500>  - Maximum thickness of strokes (default: 200)" << std::endl;
+	std::cout << "  --keep-image              - Keep the source image as a disabled layer below the result" << std::endl;
+	std::cout << "  --threads <count>         - Number of threads to use (default: all cores)" << std::endl;
+	std::cout << std::endl;
+}
+
+bool
+parse_int(const String &value, int min, int max, int &out)
+{
+	char *end = nullptr;
+	long x = strtol(value.c_str(), &end, 10);
+	if (value.empty() || *end || x < min || x > max)
+		return false;
+	out = (int)x;
+	return true;
+}
+
+bool
+parse_options(int argc, char **argv, Options &options)
+{
+	for(int i = 1; i < argc; ++i) {
+		const String arg = argv[i];
+		const bool has_value = i + 1 < argc;
+
+		int *int_value = nullptr;
+		int min = 0, max = 0;
+		if      (arg == "--threshold")     { int_value = &options.threshold;    min = 1; max = 10; }
+		else if (arg == "--accuracy")      { int_value = &options.accuracy;     min = 1; max = 10; }
+		else if (arg == "--despeckling")   { int_value = &options.despeckling;  min = 0; max = 500; }
+		else if (arg == "--max-thickness") { int_value = &options.maxthickness; min = 0; max = 500; }
+		else if (arg == "--threads")       { int_value = &options.threads;      min = 1; max = 1024; }
+
+		if (int_value) {
+			if (!has_value || !parse_int(argv[++i], min, max, *int_value)) {
+				error("%s expects a number in range %d..%d", arg.c_str(), min, max);
+				return false;
+			}
+		} else
+		if (arg == "-o" || arg == "--output-dir") {
+			if (!has_value) {
+				error("%s expects a directory", arg.c_str());
+				return false;
+			}
+			options.output_dir = argv[++i];
+		} else
+		if (arg == "--keep-image") {
+			options.keep_image = true;
+		} else
+		if (arg.size() > 1 && arg[0] == '-') {
+			error("unknown option: %s", arg.c_str());
+			return false;
+		} else {
+			options.files.push_back(arg);
+		}
+	}
+	return !options.files.empty();
+}
+
+String
+output_filename(const Options &options, const String &filename)
+{
+	String dir = options.output_dir.empty() ? etl::dirname(filename) : options.output_dir;
+	return dir + ETL_DIRECTORY_SEPARATOR + etl::filename_sans_extension(etl::basename(filename)) + ".sif";
+}
+
+bool
+vectorize_file(const Options &options, const String &filename, const etl::handle<VectorizeUIInterface> &ui_interface)
+{
+	const String out_filename = output_filename(options, filename);
+	FileSystem::Handle file_system = FileSystemNative::instance();
+
+	Canvas::Handle canvas = Canvas::create();
+	canvas->set_identifier(file_system->get_identifier(out_filename));
+	canvas->set_file_name(out_filename);
+
+	Layer_Bitmap::Handle image = Layer_Bitmap::Handle::cast_dynamic(Layer::create("import"));
+	if (!image) {
+		error("import layer is not available, check synfig modules");
+		return false;
+	}
+	image->set_canvas(canvas);
+	image->set_param("filename", ValueBase(etl::absolute_path(filename)));
+	if (!image->rendering_surface || !image->rendering_surface->is_exists()) {
+		error("unable to load image: %s", filename.c_str());
+		return false;
+	}
+
+	// canvas gets the size of the image, so its pixels stay pixels
+	const VectorInt size = image->rendering_surface->get_size();
+	const Point br(0.5*units_per_pixel*size[0], -0.5*units_per_pixel*size[1]);
+	RendDesc &desc = canvas->rend_desc();
+	desc.set_wh(size[0], size[1]);
+	desc.set_tl_br(-br, br);
+	image->set_param("tl", ValueBase(-br));
+	image->set_param("br", ValueBase(br));
+	image->set_description(etl::basename(filename));
+
+	Gamma gamma = desc.get_gamma();
+	gamma.invert();
+
+	studio::CenterlineConfiguration configuration = options.get_configuration();
+	studio::VectorizerCore core;
+	ui_interface->reset();
+	std::vector< etl::handle<Layer> > layers = core.vectorize(image, ui_interface, configuration, gamma);
+	std::cout << std::endl;
+	if (core.isCanceled())
+		return false;
+
+	Canvas::Handle child_canvas = Canvas::create_inline(canvas);
+	for(std::vector< etl::handle<Layer> >::const_iterator i = layers.begin(); i != layers.end(); ++i) {
+		(*i)->set_canvas(child_canvas);
+		child_canvas->push_front(*i);
+	}
+
+	Layer::Handle group = Layer::create("group");
+	group->set_description("Vectorized " + image->get_description());
+	group->set_param("canvas", child_canvas);
+
+	if (options.keep_image) {
+		image->set_active(false);
+		canvas->push_front(image);
+	}
+	group->set_canvas(canvas);
+	canvas->push_front(group);
+
+	if (!save_canvas(file_system->get_identifier(out_filename), canvas)) {
+		error("unable to save: %s", out_filename.c_str());
+		return false;
+	}
+
+	info("%s: %d strokes saved to %s", filename.c_str(), (int)layers.size(), out_filename.c_str());
+	return true;
+}
+
+} // END of anonymous namespace
+
+/* === E N T R Y P O I N T ================================================= */
+
+int main(int argc, char **argv)
+{
+	Glib::init();
+
+	Options options;
+	if (!parse_options(argc, argv, options)) {
+		print_usage();
+		return 2;
+	}
+
+	const String binary_path = get_binary_path(argv[0]);
+	const String rootpath = etl::dirname(etl::dirname(binary_path));
+	synfigapp::Main main(rootpath);
+
+	if (options.threads)
+		ThreadPool::instance().set_num_threads(options.threads);
+
+	etl::handle<VectorizeUIInterface> ui_interface(new VectorizeUIInterface());
+
+	int failed = 0;
+	for(std::vector<String>::const_iterator i = options.files.begin(); i != options.files.end(); ++i) {
+		std::cout << *i << std::endl;
+		try {
+			if (!vectorize_file(options, *i, ui_interface))
+				++failed;
+		} catch(const std::exception &e) {
+			error("%s: %s", i->c_str(), e.what());
+			++failed;
+		}
+	}
+
+	if (failed)
+		error("%d of %d images were not vectorized", failed, (int)options.files.size());
+	return failed ? 1 : 0;
+}
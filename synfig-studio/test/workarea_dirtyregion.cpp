@@ -0,0 +1,162 @@
+/* === S Y N F I G ========================================================= */
+/*!	\file test/workarea_dirtyregion.cpp
+**	\brief Tests for regions of the work area changed by layer edits
+**
+**	\legal
+**	This file is part of Synfig.
+**
+**	Synfig is free software: you can redistribute it and/or modify
+**	it under the terms of the GNU General Public License as published by
+**	the Free Software Foundation, either version 2 of the License, or
+**	(at your option) any later version.
+**
+**	Synfig is distributed in the hope that it will be useful,
+**	but WITHOUT ANY WARRANTY; without even the implied warranty of
+**	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+**	GNU General Public License for more details.
+**
+**	You should have received a copy of the GNU General Public License
+**	along with Synfig.  If not, see <https://www.gnu.org/licenses/>.
+**	\endlegal
+*/
+
+#include "test_base.h"
+
+#include <cmath>
+
+#include <synfig/canvas.h>
+#include <synfig/layer.h>
+
+#include <synfigapp/main.h>
+
+#include <gui/workarearenderer/dirtyregion.h>
+
+using namespace studio;
+
+static synfig::Layer::Handle create_circle(const synfig::Canvas::Handle &canvas)
+{
+	synfig::Layer::Handle layer = synfig::Layer::create("circle");
+	layer->set_param("radius", 0.5);
+	layer->set_canvas(canvas);
+	canvas->push_back(layer);
+	return layer;
+}
+
+static synfig::Layer::Handle create_rotate(const synfig::Canvas::Handle &canvas)
+{
+	synfig::Layer::Handle layer = synfig::Layer::create("rotate");
+	layer->set_param("amount", synfig::Angle::deg(45));
+	layer->set_canvas(canvas);
+	canvas->push_back(layer);
+	return layer;
+}
+
+static synfig::Layer::Handle create_translate(const synfig::Canvas::Handle &canvas)
+{
+	synfig::Layer::Handle layer = synfig::Layer::create("translate");
+	layer->set_param("origin", synfig::Vector(1.0, 0.5));
+	layer->set_canvas(canvas);
+	canvas->push_back(layer);
+	return layer;
+}
+
+static synfig::Layer::Handle create_blur(const synfig::Canvas::Handle &canvas)
+{
+	synfig::Layer::Handle layer = synfig::Layer::create("blur");
+	layer->set_canvas(canvas);
+	canvas->push_back(layer);
+	return layer;
+}
+
+// Translation above the edited layer moves the region, plain layers keep it in place
+static void test_dirtyregion_layer_under_translate_layer()
+{
+	synfig::Canvas::Handle canvas = synfig::Canvas::create();
+	create_translate(canvas);
+	create_circle(canvas);
+	synfig::Layer::Handle edited = create_circle(canvas);
+
+	synfig::Rect rect = DirtyRegion::calc_layer_bounds(*edited);
+	synfig::Rect mapped = rect;
+	ASSERT(DirtyRegion::map_to_frame(*canvas, *edited, mapped))
+	ASSERT_APPROX_EQUAL(rect.minx + 1.0, mapped.minx)
+	ASSERT_APPROX_EQUAL(rect.miny + 0.5, mapped.miny)
+	ASSERT_APPROX_EQUAL(rect.maxx + 1.0, mapped.maxx)
+	ASSERT_APPROX_EQUAL(rect.maxy + 0.5, mapped.maxy)
+}
+
+// Rotation above the edited layer turns the region around the origin
+static void test_dirtyregion_layer_under_rotate_layer()
+{
+	synfig::Canvas::Handle canvas = synfig::Canvas::create();
+	synfig::Layer::Handle rotate = create_rotate(canvas);
+	create_circle(canvas);
+	synfig::Layer::Handle edited = create_circle(canvas);
+
+	// circle of radius 0.5 at the origin, its box turned by 45 degrees
+	synfig::Rect rect = DirtyRegion::calc_layer_bounds(*edited);
+	ASSERT_APPROX_EQUAL(-0.5, rect.minx)
+	ASSERT_APPROX_EQUAL( 0.5, rect.maxx)
+	synfig::Rect mapped = rect;
+	ASSERT(DirtyRegion::map_to_frame(*canvas, *edited, mapped))
+	ASSERT_APPROX_EQUAL(-std::sqrt(0.5), mapped.minx)
+	ASSERT_APPROX_EQUAL(-std::sqrt(0.5), mapped.miny)
+	ASSERT_APPROX_EQUAL( std::sqrt(0.5), mapped.maxx)
+	ASSERT_APPROX_EQUAL( std::sqrt(0.5), mapped.maxy)
+
+	// disabled layers are not rendered
+	rotate->set_active(false);
+	mapped = rect;
+	ASSERT(DirtyRegion::map_to_frame(*canvas, *edited, mapped))
+	ASSERT_APPROX_EQUAL(rect.minx, mapped.minx)
+	ASSERT_APPROX_EQUAL(rect.maxy, mapped.maxy)
+}
+
+// Blur reads its context around the region, so the changed region is unknown
+static void test_dirtyregion_layer_under_blur_layer()
+{
+	synfig::Canvas::Handle canvas = synfig::Canvas::create();
+	create_blur(canvas);
+	create_translate(canvas);
+	synfig::Layer::Handle edited = create_circle(canvas);
+
+	synfig::Rect rect = DirtyRegion::calc_layer_bounds(*edited);
+	ASSERT_FALSE(DirtyRegion::map_to_frame(*canvas, *edited, rect))
+}
+
+// Layers below the edited one don't change its region
+static void test_dirtyregion_layer_above_rotate_layer()
+{
+	synfig::Canvas::Handle canvas = synfig::Canvas::create();
+	synfig::Layer::Handle edited = create_circle(canvas);
+	create_rotate(canvas);
+
+	synfig::Rect rect = DirtyRegion::calc_layer_bounds(*edited);
+	ASSERT(DirtyRegion::map_to_frame(*canvas, *edited, rect))
+}
+
+// Layer from other canvas is not a root layer
+static void test_dirtyregion_layer_of_other_canvas()
+{
+	synfig::Canvas::Handle canvas = synfig::Canvas::create();
+	create_circle(canvas);
+	synfig::Layer::Handle other = create_circle(synfig::Canvas::create());
+
+	synfig::Rect rect = DirtyRegion::calc_layer_bounds(*other);
+	ASSERT_FALSE(DirtyRegion::map_to_frame(*canvas, *other, rect))
+}
+
+int main()
+{
+	synfigapp::Main Main("");
+
+	TEST_SUITE_BEGIN()
+		TEST_FUNCTION(test_dirtyregion_layer_under_translate_layer)
+		TEST_FUNCTION(test_dirtyregion_layer_under_rotate_layer)
+		TEST_FUNCTION(test_dirtyregion_layer_under_blur_layer)
+		TEST_FUNCTION(test_dirtyregion_layer_above_rotate_layer)
+		TEST_FUNCTION(test_dirtyregion_layer_of_other_canvas)
+	TEST_SUITE_END()
+
+	return tst_exit_status;
+}